@@ -0,0 +1,322 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-cpu.c
+ * @brief Measure the pure CPU helpers used on every frame
+ *
+ * Framing, CRC and bit mirroring helpers are run on frames of typical sizes:
+ * 18 bytes (a MIFARE block with its CRC) and the largest PN53x payloads.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "mirror-subr.h"
+#include "target-subr.h"
+#include "chips/pn53x.h"
+#include "chips/pn53x-internal.h"
+#include "bench-subr.h"
+
+#define SHORT_FRAME_LEN 18
+#define LONG_FRAME_LEN  256
+
+static uint8_t abtData[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+static uint8_t abtPar[LONG_FRAME_LEN];
+// 9 frame bits per data byte
+static uint8_t abtFrame[(LONG_FRAME_LEN * 9 + 7) / 8];
+
+struct bench_frame {
+  size_t szData;
+  size_t szFrameBits;
+};
+
+static void
+bench_wrap_frame(void *arg, size_t iterations)
+{
+  const struct bench_frame *bf = arg;
+
+  for (size_t i = 0; i < iterations; i++) {
+    bench_sink += pn53x_wrap_frame(abtData, bf->szData * 8, abtPar, abtFrame);
+  }
+}
+
+static void
+bench_unwrap_frame(void *arg, size_t iterations)
+{
+  const struct bench_frame *bf = arg;
+  uint8_t abtRx[LONG_FRAME_LEN];
+  uint8_t abtRxPar[LONG_FRAME_LEN];
+
+  for (size_t i = 0; i < iterations; i++) {
+    bench_sink += pn53x_unwrap_frame(abtFrame, bf->szFrameBits, abtRx, abtRxPar);
+  }
+}
+
+static void
+bench_crc_a(void *arg, size_t iterations)
+{
+  const size_t szLen = *(const size_t *)arg;
+  uint8_t abtCrc[2];
+
+  for (size_t i = 0; i < iterations; i++) {
+    iso14443a_crc(abtData, szLen, abtCrc);
+    bench_sink += abtCrc[0];
+  }
+}
+
+// CRC_A as computed before table-driven CRC, for comparison
+static void
+bench_crc_a_bitwise(void *arg, size_t iterations)
+{
+  const size_t szLen = *(const size_t *)arg;
+
+  for (size_t i = 0; i < iterations; i++) {
+    uint32_t wCrc = 0x6363;
+    for (size_t n = 0; n < szLen; n++) {
+      uint8_t bt = abtData[n];
+      bt = (bt ^ (uint8_t)(wCrc & 0x00FF));
+      bt = (bt ^ (bt << 4));
+      wCrc = (wCrc >> 8) ^ ((uint32_t) bt << 8) ^ ((uint32_t) bt << 3) ^ ((uint32_t) bt >> 4);
+    }
+    bench_sink += wCrc;
+  }
+}
+
+// 16-byte blocks CRC'd one after the other, as chained frames are
+static void
+bench_crc_a_incremental(void *arg, size_t iterations)
+{
+  const size_t szLen = *(const size_t *)arg;
+  uint8_t abtCrc[2];
+
+  for (size_t i = 0; i < iterations; i++) {
+    uint16_t ui16Crc = iso14443a_crc_init();
+    for (size_t n = 0; n < szLen; n += 16) {
+      ui16Crc = iso14443a_crc_update(ui16Crc, abtData + n, 16);
+    }
+    iso14443a_crc_final(ui16Crc, abtCrc);
+    bench_sink += abtCrc[0];
+  }
+}
+
+static void
+bench_crc_b(void *arg, size_t iterations)
+{
+  const size_t szLen = *(const size_t *)arg;
+  uint8_t abtCrc[2];
+
+  for (size_t i = 0; i < iterations; i++) {
+    iso14443b_crc(abtData, szLen, abtCrc);
+    bench_sink += abtCrc[0];
+  }
+}
+
+static void
+bench_mirror(void *arg, size_t iterations)
+{
+  (void) arg;
+  for (size_t i = 0; i < iterations; i++) {
+    bench_sink += mirror((uint8_t)i);
+  }
+}
+
+static void
+bench_mirror32(void *arg, size_t iterations)
+{
+  (void) arg;
+  for (size_t i = 0; i < iterations; i++) {
+    bench_sink += mirror32((uint32_t)i);
+  }
+}
+
+static void
+bench_mirror64(void *arg, size_t iterations)
+{
+  (void) arg;
+  for (size_t i = 0; i < iterations; i++) {
+    bench_sink += (uint32_t)mirror64((uint64_t)i * 0x9e3779b97f4a7c15ULL);
+  }
+}
+
+static void
+bench_mirror_bytes(void *arg, size_t iterations)
+{
+  const size_t szLen = *(const size_t *)arg;
+  uint8_t abtOut[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+
+  for (size_t i = 0; i < iterations; i++) {
+    mirror_bytes(abtOut, abtData, szLen);
+    bench_sink += abtOut[0];
+  }
+}
+
+static void
+bench_build_frame(void *arg, size_t iterations)
+{
+  const size_t szLen = *(const size_t *)arg;
+  uint8_t abtOut[PN53x_EXTENDED_FRAME__DATA_MAX_LEN + PN53x_EXTENDED_FRAME__OVERHEAD];
+  size_t szOut;
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (pn53x_build_frame(abtOut, &szOut, abtData, szLen) < 0) {
+      fprintf(stderr, "pn53x_build_frame failed\n");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtOut[szOut - 2];
+  }
+}
+
+struct bench_target_data {
+  const uint8_t *pbtRaw;
+  size_t szRaw;
+  nfc_modulation_type nmt;
+};
+
+static void
+bench_decode_target_data(void *arg, size_t iterations)
+{
+  const struct bench_target_data *btd = arg;
+  nfc_target_info nti;
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (pn53x_decode_target_data(btd->pbtRaw, btd->szRaw, PN532, btd->nmt, &nti) < 0) {
+      fprintf(stderr, "pn53x_decode_target_data failed\n");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += nti.nai.abtUid[0];
+  }
+}
+
+static void
+bench_snprint_nfc_target(void *arg, size_t iterations)
+{
+  const nfc_target *pnt = arg;
+  char acBuf[4096];
+
+  for (size_t i = 0; i < iterations; i++) {
+    snprint_nfc_target(acBuf, sizeof(acBuf), pnt, true);
+    bench_sink += (uint8_t)acBuf[0];
+  }
+}
+
+static void
+bench_connstring_decode(void *arg, size_t iterations)
+{
+  const char *connstring = arg;
+  char *param1, *param2;
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (connstring_decode(connstring, "pn532_uart", NULL, &param1, &param2) != 3) {
+      fprintf(stderr, "connstring_decode failed\n");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += (uint8_t)param1[0];
+    free(param1);
+    free(param2);
+  }
+}
+
+int
+main(int argc, const char *argv[])
+{
+  bench_init(argc, argv);
+
+  for (size_t n = 0; n < sizeof(abtData); n++) {
+    abtData[n] = (uint8_t)(n * 0x3b + 0x11);
+  }
+  // Odd parity, as sent on the air
+  for (size_t n = 0; n < sizeof(abtPar); n++) {
+    uint8_t bt = abtData[n];
+    bt ^= bt >> 4;
+    bt ^= bt >> 2;
+    bt ^= bt >> 1;
+    abtPar[n] = !(bt & 1);
+  }
+
+  struct bench_frame bfShort = { SHORT_FRAME_LEN, 0 };
+  struct bench_frame bfLong = { LONG_FRAME_LEN, 0 };
+  bench_run("pn53x_wrap_frame, 18 bytes", bench_wrap_frame, &bfShort, SHORT_FRAME_LEN);
+  bfShort.szFrameBits = pn53x_wrap_frame(abtData, SHORT_FRAME_LEN * 8, abtPar, abtFrame);
+  bench_run("pn53x_unwrap_frame, 18 bytes", bench_unwrap_frame, &bfShort, SHORT_FRAME_LEN);
+  bench_run("pn53x_wrap_frame, 256 bytes", bench_wrap_frame, &bfLong, LONG_FRAME_LEN);
+  bfLong.szFrameBits = pn53x_wrap_frame(abtData, LONG_FRAME_LEN * 8, abtPar, abtFrame);
+  bench_run("pn53x_unwrap_frame, 256 bytes", bench_unwrap_frame, &bfLong, LONG_FRAME_LEN);
+
+  size_t szShort = SHORT_FRAME_LEN - 2;
+  size_t szLong = LONG_FRAME_LEN;
+  bench_run("iso14443a_crc, 16 bytes", bench_crc_a, &szShort, szShort);
+  bench_run("iso14443a_crc, 256 bytes", bench_crc_a, &szLong, szLong);
+  bench_run("iso14443a_crc bit by bit, 16 bytes", bench_crc_a_bitwise, &szShort, szShort);
+  bench_run("iso14443a_crc bit by bit, 256 bytes", bench_crc_a_bitwise, &szLong, szLong);
+  bench_run("iso14443a_crc_update, 16 x 16 bytes", bench_crc_a_incremental, &szLong, szLong);
+  bench_run("iso14443b_crc, 16 bytes", bench_crc_b, &szShort, szShort);
+  bench_run("iso14443b_crc, 256 bytes", bench_crc_b, &szLong, szLong);
+
+  bench_run("mirror", bench_mirror, NULL, 1);
+  bench_run("mirror32", bench_mirror32, NULL, 4);
+  bench_run("mirror64", bench_mirror64, NULL, 8);
+  bench_run("mirror_bytes, 16 bytes", bench_mirror_bytes, &szShort, szShort);
+  bench_run("mirror_bytes, 256 bytes", bench_mirror_bytes, &szLong, szLong);
+
+  size_t szNormal = PN53x_NORMAL_FRAME__DATA_MAX_LEN - 1;
+  size_t szExtended = PN53x_EXTENDED_FRAME__DATA_MAX_LEN - 1;
+  bench_run("pn53x_build_frame, 16 bytes", bench_build_frame, &szShort, szShort);
+  bench_run("pn53x_build_frame, 253 bytes", bench_build_frame, &szNormal, szNormal);
+  bench_run("pn53x_build_frame, 263 bytes (extended)", bench_build_frame, &szExtended, szExtended);
+
+  // InListPassiveTarget replies, starting at Tg
+  const uint8_t abtMifare[] = { 0x01, 0x00, 0x04, 0x08, 0x04, 0x5e, 0x00, 0x00, 0x01 };
+  const uint8_t abtIso14443_4[] = { 0x01, 0x00, 0x44, 0x20, 0x07, 0x04, 0x5e, 0x00, 0x00, 0x00, 0x00, 0x01,
+                                    0x06, 0x75, 0x77, 0x81, 0x02, 0x80
+                                  };
+  const uint8_t abtFelica[] = { 0x01, 0x14, 0x01, 0x01, 0x2e, 0x5e, 0x00, 0x00, 0x00, 0x00, 0x01,
+                                0x00, 0xf1, 0x00, 0x00, 0x00, 0x01, 0x43, 0x00, 0x12, 0xfc
+                              };
+  struct bench_target_data btdMifare = { abtMifare, sizeof(abtMifare), NMT_ISO14443A };
+  struct bench_target_data btdIso14443_4 = { abtIso14443_4, sizeof(abtIso14443_4), NMT_ISO14443A };
+  struct bench_target_data btdFelica = { abtFelica, sizeof(abtFelica), NMT_FELICA };
+  bench_run("pn53x_decode_target_data, MIFARE Classic", bench_decode_target_data, &btdMifare, 0);
+  bench_run("pn53x_decode_target_data, ISO14443-4 with ATS", bench_decode_target_data, &btdIso14443_4, 0);
+  bench_run("pn53x_decode_target_data, FeliCa", bench_decode_target_data, &btdFelica, 0);
+
+  nfc_target nt = { .nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 } };
+  pn53x_decode_target_data(abtIso14443_4, sizeof(abtIso14443_4), PN532, NMT_ISO14443A, &nt.nti);
+  bench_run("snprint_nfc_target, ISO14443-4 verbose", bench_snprint_nfc_target, &nt, 0);
+
+  bench_run("connstring_decode, 3 levels", bench_connstring_decode, "pn532_uart:/dev/ttyUSB0:115200", 0);
+
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,185 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-list.c
+ * @brief Measure nfc_list_devices() against the number of readers to discover
+ *
+ * Every reader is found by its own driver whose scan takes SCAN_DELAY_US, about
+ * what probing a serial port or a USB reader costs. One iteration lists all of
+ * them, first by calling the driver scans one after the other as
+ * nfc_list_devices() used to, then through nfc_list_devices() which runs them
+ * in parallel. Last, one driver is made slower than the scan_timeout deadline
+ * to show the listing does not wait for it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "log.h"
+#include "bench-subr.h"
+
+#define MAX_DRIVERS       16
+#define SCAN_DELAY_US     10000
+#define SLOW_SCAN_US      200000
+#define SCAN_TIMEOUT_MS   50
+
+struct bench_list {
+  nfc_context *context;
+  size_t szDrivers;
+};
+
+static struct nfc_driver drivers[MAX_DRIVERS + 1];
+static char acNames[MAX_DRIVERS + 1][16];
+static useconds_t scan_delays[MAX_DRIVERS + 1];
+
+static size_t
+bench_scan(const struct nfc_driver *ndr, nfc_connstring connstrings[], const size_t connstrings_len)
+{
+  const size_t d = ndr - drivers;
+  usleep(scan_delays[d]);
+  if (connstrings_len < 1)
+    return 0;
+  snprintf(connstrings[0], sizeof(nfc_connstring), "%s:reader", ndr->name);
+  return 1;
+}
+
+// One scan function per driver, so each knows which reader it finds
+#define BENCH_SCAN(n) \
+  static size_t bench_scan_##n(const nfc_context *context, nfc_connstring connstrings[], const size_t connstrings_len) \
+  { (void) context; return bench_scan(&drivers[n], connstrings, connstrings_len); }
+BENCH_SCAN(0) BENCH_SCAN(1) BENCH_SCAN(2) BENCH_SCAN(3) BENCH_SCAN(4) BENCH_SCAN(5) BENCH_SCAN(6) BENCH_SCAN(7)
+BENCH_SCAN(8) BENCH_SCAN(9) BENCH_SCAN(10) BENCH_SCAN(11) BENCH_SCAN(12) BENCH_SCAN(13) BENCH_SCAN(14) BENCH_SCAN(15)
+BENCH_SCAN(16)
+
+#define BENCH_DRIVER(n) { .name = acNames[n], .scan_type = NOT_INTRUSIVE, .scan = bench_scan_##n }
+static struct nfc_driver drivers[MAX_DRIVERS + 1] = {
+  BENCH_DRIVER(0), BENCH_DRIVER(1), BENCH_DRIVER(2), BENCH_DRIVER(3), BENCH_DRIVER(4), BENCH_DRIVER(5),
+  BENCH_DRIVER(6), BENCH_DRIVER(7), BENCH_DRIVER(8), BENCH_DRIVER(9), BENCH_DRIVER(10), BENCH_DRIVER(11),
+  BENCH_DRIVER(12), BENCH_DRIVER(13), BENCH_DRIVER(14), BENCH_DRIVER(15), BENCH_DRIVER(16),
+};
+
+static void
+bench_register(const size_t d, const useconds_t delay)
+{
+  snprintf(acNames[d], sizeof(acNames[d]), "bench%zu", d);
+  scan_delays[d] = delay;
+  if (nfc_register_driver(&drivers[d]) < 0) {
+    fprintf(stderr, "Unable to register %s\n", acNames[d]);
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void
+bench_sequential(void *arg, size_t iterations)
+{
+  struct bench_list *bl = arg;
+  nfc_connstring connstrings[MAX_DRIVERS];
+
+  for (size_t i = 0; i < iterations; i++) {
+    size_t szFound = 0;
+    for (size_t d = bl->szDrivers; d-- > 0;)
+      szFound += drivers[d].scan(bl->context, connstrings + szFound, MAX_DRIVERS - szFound);
+    bench_sink += szFound;
+  }
+}
+
+static void
+bench_parallel(void *arg, size_t iterations)
+{
+  struct bench_list *bl = arg;
+  nfc_connstring connstrings[MAX_DRIVERS];
+
+  for (size_t i = 0; i < iterations; i++) {
+    const size_t szFound = nfc_list_devices(bl->context, connstrings, MAX_DRIVERS);
+    if (szFound != bl->szDrivers) {
+      fprintf(stderr, "%zu readers listed, expected %zu\n", szFound, bl->szDrivers);
+      exit(EXIT_FAILURE);
+    }
+    // Last registered driver is searched first
+    for (size_t d = 0; d < szFound; d++) {
+      if (strncmp(connstrings[d], acNames[bl->szDrivers - 1 - d], strlen(acNames[bl->szDrivers - 1 - d])) != 0) {
+        fprintf(stderr, "Reader %zu is %s, out of order\n", d, connstrings[d]);
+        exit(EXIT_FAILURE);
+      }
+    }
+    bench_sink += szFound;
+  }
+}
+
+int
+main(int argc, const char *argv[])
+{
+  struct bench_list bl;
+  char acName[64];
+
+  bench_init(argc, argv);
+
+  nfc_init(&bl.context);
+  if (bl.context == NULL) {
+    fprintf(stderr, "Unable to init libnfc (malloc)\n");
+    exit(EXIT_FAILURE);
+  }
+  log_set_level(0);
+  // Only list our readers
+  bl.context->user_defined_device_count = 0;
+  bl.context->allow_autoscan = true;
+  bl.context->allow_intrusive_scan = false;
+  bl.szDrivers = 0;
+
+  for (size_t szDrivers = 1; szDrivers <= MAX_DRIVERS; szDrivers *= 4) {
+    while (bl.szDrivers < szDrivers) {
+      bench_register(bl.szDrivers, SCAN_DELAY_US);
+      bl.szDrivers++;
+    }
+    snprintf(acName, sizeof(acName), "%zu readers, one scan after the other", szDrivers);
+    bench_run(acName, bench_sequential, &bl, 0);
+    snprintf(acName, sizeof(acName), "%zu readers, nfc_list_devices", szDrivers);
+    bench_run(acName, bench_parallel, &bl, 0);
+  }
+
+  // A driver slower than the deadline is left behind
+  nfc_connstring connstrings[MAX_DRIVERS + 1];
+  bench_register(MAX_DRIVERS, SLOW_SCAN_US);
+  bl.context->scan_timeout = SCAN_TIMEOUT_MS;
+  const uint64_t start = bench_now_ns();
+  const size_t szFound = nfc_list_devices(bl.context, connstrings, MAX_DRIVERS + 1);
+  printf("%zu readers and one taking %d ms, scan_timeout %d ms: %zu listed in %.1f ms\n",
+         bl.szDrivers, SLOW_SCAN_US / 1000, SCAN_TIMEOUT_MS, szFound, (double)(bench_now_ns() - start) / 1e6);
+
+  nfc_exit(bl.context);
+  exit(EXIT_SUCCESS);
+}
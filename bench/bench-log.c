@@ -0,0 +1,154 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-log.c
+ * @brief Measure what logging costs on the pn53x_transceive() hot path
+ *
+ * A loopback pn53x_io stands for the driver: it dumps frames with LOG_HEX like
+ * real drivers do and answers each InDataExchange with a canned response, so
+ * only libnfc's own overhead is measured.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "chips/pn53x.h"
+#include "log.h"
+#include "bench-subr.h"
+
+#define LOG_CATEGORY "libnfc.bench.log"
+#define LOG_GROUP    NFC_LOG_GROUP_COM
+
+static const uint8_t abtResponse[] = {
+  0x00, // status byte
+  0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10
+};
+
+static int
+loopback_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int timeout)
+{
+  (void) pnd;
+  (void) timeout;
+  LOG_HEX(LOG_GROUP, "TX", pbtData, szData);
+  return NFC_SUCCESS;
+}
+
+static int
+loopback_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int timeout)
+{
+  (void) pnd;
+  (void) timeout;
+  size_t szData = MIN(szDataLen, sizeof(abtResponse));
+  memcpy(pbtData, abtResponse, szData);
+  LOG_HEX(LOG_GROUP, "RX", pbtData, szData);
+  return (int)szData;
+}
+
+static const struct pn53x_io loopback_io = {
+  .send    = loopback_send,
+  .receive = loopback_receive,
+};
+
+static void
+bench_log_put(void *arg, size_t iterations)
+{
+  (void) arg;
+  for (size_t i = 0; i < iterations; i++) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "iteration %zu", i);
+    bench_sink++;
+  }
+}
+
+static void
+bench_log_hex(void *arg, size_t iterations)
+{
+  const uint8_t *pbtData = arg;
+  for (size_t i = 0; i < iterations; i++) {
+    LOG_HEX(LOG_GROUP, "TX", pbtData, 64);
+    bench_sink++;
+  }
+}
+
+static void
+bench_transceive(void *arg, size_t iterations)
+{
+  nfc_device *pnd = arg;
+  const uint8_t abtCmd[] = { InDataExchange, 0x01, 0x30, 0x04 };
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), abtRx, sizeof(abtRx), -1) < 0) {
+      fprintf(stderr, "pn53x_transceive failed\n");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[1];
+  }
+}
+
+int
+main(int argc, const char *argv[])
+{
+  nfc_context *context;
+  const nfc_connstring connstring = "bench";
+  uint8_t abtData[64] = { 0 };
+
+  bench_init(argc, argv);
+
+  nfc_init(&context);
+  if (context == NULL) {
+    fprintf(stderr, "Unable to init libnfc (malloc)\n");
+    exit(EXIT_FAILURE);
+  }
+
+  nfc_device *pnd = nfc_device_new(context, connstring);
+  if (!pnd || !pn53x_data_new(pnd, &loopback_io)) {
+    fprintf(stderr, "Unable to allocate device\n");
+    exit(EXIT_FAILURE);
+  }
+
+  log_set_level(0);
+  bench_run("log_put, logging off", bench_log_put, NULL, 0);
+  bench_run("LOG_HEX 64 bytes, logging off", bench_log_hex, abtData, 64);
+  bench_run("pn53x_transceive, logging off", bench_transceive, pnd, sizeof(abtResponse));
+
+  log_set_level(NFC_LOG_PRIORITY_ERROR);
+  bench_run("pn53x_transceive, errors only", bench_transceive, pnd, sizeof(abtResponse));
+
+  pn53x_data_free(pnd);
+  nfc_device_free(pnd);
+  nfc_exit(context);
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,241 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-loop.c
+ * @brief Measure one thread driving many pn532_uart readers through nfc_loop
+ *
+ * Each reader is a pn532-pty stand-in which takes RESPONSE_DELAY_US to answer
+ * a command, about what a PN532 needs for a short exchange with a tag. One
+ * iteration reads a MIFARE Ultralight page through every reader, first one
+ * reader after the other with nfc_initiator_transceive_bytes(), then with all
+ * the reads in flight at once in an nfc_loop. Sequential reads take the
+ * response delay once per reader while the loop should take it about once.
+ *
+ * Last, a single reader alternates reads with HOST_WORK_US of computation,
+ * such as checking the previous answer, either after each blocking read or
+ * while an nfc_initiator_transceive_bytes_async() read is in flight.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <nfc/nfc.h>
+
+#include "log.h"
+#include "bench-subr.h"
+#include "pn532-pty.h"
+
+#define MAX_DEVICES       16
+#define RESPONSE_DELAY_US 1000
+#define HOST_WORK_US      1000
+
+static const nfc_modulation nmMifare = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+static const uint8_t abtRead[2] = { 0x30, 0x00 };
+
+struct bench_loop {
+  nfc_context *context;
+  nfc_loop *loop;
+  nfc_device *devices[MAX_DEVICES];
+  pid_t pids[MAX_DEVICES];
+  size_t szDevices;
+};
+
+static void
+bench_sequential(void *arg, size_t iterations)
+{
+  struct bench_loop *bl = arg;
+  uint8_t abtRx[16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    for (size_t d = 0; d < bl->szDevices; d++) {
+      if (nfc_initiator_transceive_bytes(bl->devices[d], abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 1000) != 16) {
+        nfc_perror(bl->devices[d], "Ultralight read");
+        exit(EXIT_FAILURE);
+      }
+      bench_sink += abtRx[0];
+    }
+  }
+}
+
+static void
+bench_loop(void *arg, size_t iterations)
+{
+  struct bench_loop *bl = arg;
+  nfc_loop_completion completions[MAX_DEVICES];
+  uint8_t abtRx[MAX_DEVICES][16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    for (size_t d = 0; d < bl->szDevices; d++) {
+      if (nfc_loop_initiator_transceive_bytes(bl->loop, bl->devices[d], abtRead, sizeof(abtRead), abtRx[d], sizeof(abtRx[d]), 1000, NULL) < 0) {
+        nfc_perror(bl->devices[d], "nfc_loop_initiator_transceive_bytes");
+        exit(EXIT_FAILURE);
+      }
+    }
+    for (size_t szDone = 0; szDone < bl->szDevices;) {
+      int res = nfc_loop_run(bl->loop, completions, MAX_DEVICES, -1);
+      if (res <= 0) {
+        fprintf(stderr, "nfc_loop_run: %d\n", res);
+        exit(EXIT_FAILURE);
+      }
+      for (int c = 0; c < res; c++) {
+        if (completions[c].res != 16) {
+          nfc_perror(completions[c].pnd, "Ultralight read");
+          exit(EXIT_FAILURE);
+        }
+      }
+      szDone += res;
+    }
+    bench_sink += abtRx[0][0];
+  }
+}
+
+static void
+bench_host_work(void)
+{
+  const uint64_t end = bench_now_ns() + HOST_WORK_US * 1000ULL;
+  while (bench_now_ns() < end)
+    bench_sink++;
+}
+
+static void
+bench_work_blocking(void *arg, size_t iterations)
+{
+  struct bench_loop *bl = arg;
+  uint8_t abtRx[16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (nfc_initiator_transceive_bytes(bl->devices[0], abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 1000) != 16) {
+      nfc_perror(bl->devices[0], "Ultralight read");
+      exit(EXIT_FAILURE);
+    }
+    bench_host_work();
+  }
+}
+
+static void
+bench_work_done(nfc_device *pnd, int res, void *user_data)
+{
+  (void) user_data;
+  if (res != 16) {
+    nfc_perror(pnd, "Ultralight read");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void
+bench_work_async(void *arg, size_t iterations)
+{
+  struct bench_loop *bl = arg;
+  uint8_t abtRx[16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (nfc_initiator_transceive_bytes_async(bl->devices[0], abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 1000, bench_work_done, NULL) < 0) {
+      nfc_perror(bl->devices[0], "nfc_initiator_transceive_bytes_async");
+      exit(EXIT_FAILURE);
+    }
+    bench_host_work();
+    if (nfc_device_process_async(bl->devices[0], -1) != 1) {
+      nfc_perror(bl->devices[0], "nfc_device_process_async");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+static void
+bench_loop_open(struct bench_loop *bl)
+{
+  char acPty[64];
+  nfc_connstring connstring;
+  nfc_target nt;
+
+  const size_t d = bl->szDevices;
+  bl->pids[d] = pn532_pty_spawn_delayed("mful", RESPONSE_DELAY_US, acPty, sizeof(acPty));
+  if (bl->pids[d] < 0) {
+    fprintf(stderr, "Unable to start the PN532 stand-in\n");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(connstring, sizeof(connstring), "pn532_uart:%s", acPty);
+  if (!(bl->devices[d] = nfc_open(bl->context, connstring))) {
+    fprintf(stderr, "Unable to open %s\n", connstring);
+    exit(EXIT_FAILURE);
+  }
+  bl->szDevices++;
+  if ((nfc_initiator_init(bl->devices[d]) < 0) ||
+      (nfc_initiator_select_passive_target(bl->devices[d], nmMifare, NULL, 0, &nt) != 1)) {
+    nfc_perror(bl->devices[d], "Ultralight selection");
+    exit(EXIT_FAILURE);
+  }
+  if (nfc_loop_add_device(bl->loop, bl->devices[d]) < 0) {
+    nfc_perror(bl->devices[d], "nfc_loop_add_device");
+    exit(EXIT_FAILURE);
+  }
+}
+
+int
+main(int argc, const char *argv[])
+{
+  struct bench_loop bl;
+  char acName[64];
+
+  bench_init(argc, argv);
+
+  nfc_init(&bl.context);
+  if (bl.context == NULL) {
+    fprintf(stderr, "Unable to init libnfc (malloc)\n");
+    exit(EXIT_FAILURE);
+  }
+  log_set_level(0);
+  if (!(bl.loop = nfc_loop_new(bl.context))) {
+    fprintf(stderr, "Unable to create the event loop\n");
+    exit(EXIT_FAILURE);
+  }
+  bl.szDevices = 0;
+
+  for (size_t szDevices = 1; szDevices <= MAX_DEVICES; szDevices *= 4) {
+    while (bl.szDevices < szDevices)
+      bench_loop_open(&bl);
+    snprintf(acName, sizeof(acName), "%zu readers, one after the other", szDevices);
+    bench_run(acName, bench_sequential, &bl, 0);
+    snprintf(acName, sizeof(acName), "%zu readers, nfc_loop", szDevices);
+    bench_run(acName, bench_loop, &bl, 0);
+  }
+  bench_run("1 reader, host work after each read", bench_work_blocking, &bl, 0);
+  bench_run("1 reader, host work during async read", bench_work_async, &bl, 0);
+
+  nfc_loop_free(bl.loop);
+  for (size_t d = 0; d < bl.szDevices; d++) {
+    nfc_close(bl.devices[d]);
+    pn532_pty_stop(bl.pids[d]);
+  }
+  nfc_exit(bl.context);
+  exit(EXIT_SUCCESS);
+}
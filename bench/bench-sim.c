@@ -0,0 +1,275 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-sim.c
+ * @brief Measure public API operations against the simulated PN53x
+ *
+ * The pn53x_sim driver answers synchronously, so figures are libnfc's own
+ * cost per operation, whatever the transport.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "chips/pn53x.h"
+#include "drivers/pn53x_sim.h"
+#include "log.h"
+#include "bench-subr.h"
+
+static const nfc_modulation nmMifare = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+
+static void
+bench_select(void *arg, size_t iterations)
+{
+  nfc_device *pnd = arg;
+  nfc_target nt;
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (nfc_initiator_select_passive_target(pnd, nmMifare, NULL, 0, &nt) != 1) {
+      nfc_perror(pnd, "nfc_initiator_select_passive_target");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += nt.nti.nai.btSak;
+  }
+}
+
+static void
+bench_read(void *arg, size_t iterations)
+{
+  nfc_device *pnd = arg;
+  const uint8_t abtRead[2] = { 0x30, 0x04 };
+  uint8_t abtRx[16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (nfc_initiator_transceive_bytes(pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), -1) != 16) {
+      nfc_perror(pnd, "nfc_initiator_transceive_bytes");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_list(void *arg, size_t iterations)
+{
+  nfc_device *pnd = arg;
+  nfc_target ant[4];
+
+  for (size_t i = 0; i < iterations; i++) {
+    // Field off so listed (halted) tags answer again
+    nfc_device_set_property_bool(pnd, NP_ACTIVATE_FIELD, false);
+    if (nfc_initiator_list_passive_targets(pnd, nmMifare, ant, 4) != 3) {
+      nfc_perror(pnd, "nfc_initiator_list_passive_targets");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += ant[0].nti.nai.btSak;
+  }
+}
+
+static size_t szAnticolRounds;
+
+static void
+bench_anticol(void *arg, size_t iterations)
+{
+  nfc_device *pnd = arg;
+  const uint8_t abtWupa[1] = { 0x52 };
+  const uint8_t abtAnticol[2] = { 0x93, 0x20 };
+  uint8_t abtSelect[7] = { 0x93, 0x70 };
+  uint8_t abtRx[16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if ((nfc_initiator_transceive_bits(pnd, abtWupa, 7, NULL, abtRx, sizeof(abtRx), NULL) < 0) ||
+        (nfc_initiator_transceive_bytes(pnd, abtAnticol, sizeof(abtAnticol), abtRx, sizeof(abtRx), 0) != 5)) {
+      nfc_perror(pnd, "anticollision");
+      exit(EXIT_FAILURE);
+    }
+    // SELECT with the CRC appended by the chip
+    memcpy(abtSelect + 2, abtRx, 5);
+    nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, true);
+    if (nfc_initiator_transceive_bytes(pnd, abtSelect, sizeof(abtSelect), abtRx, sizeof(abtRx), 0) != 1) {
+      nfc_perror(pnd, "select");
+      exit(EXIT_FAILURE);
+    }
+    nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, false);
+    bench_sink += abtRx[0];
+  }
+  szAnticolRounds += iterations;
+}
+
+static size_t szCardCycles;
+
+// One card per cycle, as nfc-mfclassic does: init, select, authenticate, read
+static void
+bench_card_cycle(void *arg, size_t iterations)
+{
+  nfc_device *pnd = arg;
+  nfc_target nt;
+  uint8_t abtAuth[12] = { 0x60, 0x04, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  const uint8_t abtRead[2] = { 0x30, 0x04 };
+  uint8_t abtRx[16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if ((nfc_initiator_init(pnd) < 0) ||
+        (nfc_initiator_select_passive_target(pnd, nmMifare, NULL, 0, &nt) != 1)) {
+      nfc_perror(pnd, "select");
+      exit(EXIT_FAILURE);
+    }
+    memcpy(abtAuth + 8, nt.nti.nai.abtUid, 4);
+    if ((nfc_initiator_transceive_bytes(pnd, abtAuth, sizeof(abtAuth), NULL, 0, -1) < 0) ||
+        (nfc_initiator_transceive_bytes(pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), -1) != 16)) {
+      nfc_perror(pnd, "MIFARE read");
+      exit(EXIT_FAILURE);
+    }
+    nfc_initiator_deselect_target(pnd);
+    bench_sink += abtRx[0];
+  }
+  szCardCycles += iterations;
+}
+
+static size_t szResets;
+
+// Leave raw mode settings behind, then get back to the initiator state
+static void
+bench_reset(void *arg, size_t iterations)
+{
+  nfc_device *pnd = arg;
+
+  for (size_t i = 0; i < iterations; i++) {
+    nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, false);
+    nfc_device_set_property_bool(pnd, NP_HANDLE_PARITY, false);
+    nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, false);
+    if (nfc_initiator_reset(pnd) < 0) {
+      nfc_perror(pnd, "nfc_initiator_reset");
+      exit(EXIT_FAILURE);
+    }
+    // Any command flushes the register writes
+    nfc_device_set_property_bool(pnd, NP_ACTIVATE_FIELD, true);
+    bench_sink++;
+  }
+  szResets += iterations;
+}
+
+static void
+bench_open_close(void *arg, size_t iterations)
+{
+  nfc_context *context = arg;
+  const nfc_connstring connstring = "pn53x_sim";
+
+  for (size_t i = 0; i < iterations; i++) {
+    nfc_device *pnd = nfc_open(context, connstring);
+    if (!pnd) {
+      fprintf(stderr, "Unable to open %s\n", connstring);
+      exit(EXIT_FAILURE);
+    }
+    nfc_close(pnd);
+    bench_sink++;
+  }
+}
+
+int
+main(int argc, const char *argv[])
+{
+  nfc_context *context;
+  const nfc_connstring connstring = "pn53x_sim:pn532:mfc1k,mful,iso14443-4";
+
+  bench_init(argc, argv);
+
+  nfc_init(&context);
+  if (context == NULL) {
+    fprintf(stderr, "Unable to init libnfc (malloc)\n");
+    exit(EXIT_FAILURE);
+  }
+  log_set_level(0);
+
+  nfc_device *pnd = nfc_open(context, connstring);
+  if (!pnd) {
+    fprintf(stderr, "Unable to open %s\n", connstring);
+    exit(EXIT_FAILURE);
+  }
+  if (nfc_initiator_init(pnd) < 0) {
+    nfc_perror(pnd, "nfc_initiator_init");
+    exit(EXIT_FAILURE);
+  }
+
+  bench_run("nfc_initiator_select_passive_target", bench_select, pnd, 0);
+
+  // Authenticate the MIFARE Classic once, then read a block over and over
+  nfc_target nt;
+  nfc_initiator_select_passive_target(pnd, nmMifare, NULL, 0, &nt);
+  uint8_t abtAuth[12] = { 0x60, 0x04, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  memcpy(abtAuth + 8, nt.nti.nai.abtUid, 4);
+  if (nfc_initiator_transceive_bytes(pnd, abtAuth, sizeof(abtAuth), NULL, 0, -1) < 0) {
+    nfc_perror(pnd, "MIFARE authentication");
+    exit(EXIT_FAILURE);
+  }
+  bench_run("nfc_initiator_transceive_bytes, MIFARE read", bench_read, pnd, 16);
+
+  bench_run("nfc_initiator_list_passive_targets, 3 tags", bench_list, pnd, 0);
+
+  nfc_close(pnd);
+
+  // Raw mode anticollision loop, as nfc-anticol does, with a single tag
+  const nfc_connstring connstring_single = "pn53x_sim:pn532:mfc1k";
+  pnd = nfc_open(context, connstring_single);
+  if (!pnd || (nfc_initiator_init(pnd) < 0)) {
+    fprintf(stderr, "Unable to open a single tag simulator\n");
+    exit(EXIT_FAILURE);
+  }
+  nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, false);
+  nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, false);
+  const struct pn53x_register_stats stats = CHIP_DATA(pnd)->register_stats;
+  bench_run("raw anticollision (WUPA, ANTICOL, SELECT)", bench_anticol, pnd, 0);
+  printf("  register round trips per round: %.2f, saved by the register shadow: %.2f\n",
+         (double)(CHIP_DATA(pnd)->register_stats.round_trips - stats.round_trips) / szAnticolRounds,
+         (double)(CHIP_DATA(pnd)->register_stats.round_trips_saved - stats.round_trips_saved) / szAnticolRounds);
+
+  // Card after card, with a repeated nfc_initiator_init()
+  const struct pn53x_sim *sim = pn53x_sim_device_get(pnd);
+  uint64_t count = sim->command_count;
+  bench_run("card cycle (init, select, auth, read, deselect)", bench_card_cycle, pnd, 16);
+  printf("  frames per card cycle: %.2f\n", (double)(sim->command_count - count) / szCardCycles);
+
+  count = sim->command_count;
+  bench_run("nfc_initiator_reset after raw mode", bench_reset, pnd, 0);
+  // Minus the RF field command used to flush register writes
+  printf("  frames per reset: %.2f\n", (double)(sim->command_count - count) / szResets - 1);
+  nfc_close(pnd);
+
+  bench_run("nfc_open + nfc_close", bench_open_close, context, 0);
+
+  nfc_exit(context);
+  exit(EXIT_SUCCESS);
+}
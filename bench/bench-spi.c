@@ -0,0 +1,266 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-spi.c
+ * @brief Measure pn532_spi bus usage against a PN532 stand-in behind spidev
+ *
+ * The spidev ioctl(2) is intercepted by spidev-stub.c, which answers like a
+ * PN532 on SPI, so the figures are the host-side cost of pn532_spi and the
+ * SPI bus code. For each command the table reports the SPI_IOC_MESSAGE
+ * ioctls (one syscall and one chip select cycle each on real hardware), the
+ * transfer segments and bytes clocked, and the time those bytes take on the
+ * wire at the configured clock. Everything is run twice: once with a
+ * full-duplex controller, then with a half-duplex one.
+ *
+ * The last table holds replies back as if the PN532 needed some time to run
+ * the command, so the latency added by pn532_spi_wait_for_data() shows up.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "chips/pn53x.h"
+#include "log.h"
+#include "bench-subr.h"
+#include "spidev-stub.h"
+
+#define PROFILE_SAMPLES 1000
+
+static const nfc_modulation nmMifare = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+
+struct bench_spi {
+  nfc_device *pnd;
+};
+
+static void
+bench_firmware(void *arg, size_t iterations)
+{
+  struct bench_spi *bs = arg;
+  const uint8_t abtCmd[] = { GetFirmwareVersion };
+  uint8_t abtRx[4];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (pn53x_transceive(bs->pnd, abtCmd, sizeof(abtCmd), abtRx, sizeof(abtRx), 1000) != 4) {
+      nfc_perror(bs->pnd, "GetFirmwareVersion");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_mifare_read(void *arg, size_t iterations)
+{
+  struct bench_spi *bs = arg;
+  const uint8_t abtRead[2] = { 0x30, 0x04 };
+  uint8_t abtRx[16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (nfc_initiator_transceive_bytes(bs->pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 1000) != 16) {
+      nfc_perror(bs->pnd, "MIFARE read");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_read_binary(void *arg, size_t iterations)
+{
+  struct bench_spi *bs = arg;
+  // Le = 0: 256 bytes, the reply needs an extended frame
+  const uint8_t abtApdu[5] = { 0x00, 0xb0, 0x00, 0x00, 0x00 };
+  uint8_t abtRx[258];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (nfc_initiator_transceive_bytes(bs->pnd, abtApdu, sizeof(abtApdu), abtRx, sizeof(abtRx), 1000) != 258) {
+      nfc_perror(bs->pnd, "READ BINARY");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_update_binary(void *arg, size_t iterations)
+{
+  struct bench_spi *bs = arg;
+  // Lc = 250: the command needs an extended frame
+  uint8_t abtApdu[5 + 250] = { 0x00, 0xd6, 0x00, 0x00, 250 };
+  uint8_t abtRx[2];
+
+  for (size_t i = 0; i < iterations; i++) {
+    abtApdu[5] = (uint8_t)i;
+    if (nfc_initiator_transceive_bytes(bs->pnd, abtApdu, sizeof(abtApdu), abtRx, sizeof(abtRx), 1000) != 2) {
+      nfc_perror(bs->pnd, "UPDATE BINARY");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_spi_profile(const char *name, bench_fn fn, void *arg, size_t samples)
+{
+  struct spidev_stub_stats before, after;
+
+  spidev_stub_get_stats(&before);
+  uint64_t start = bench_now_ns();
+  fn(arg, samples);
+  uint64_t elapsed = bench_now_ns() - start;
+  spidev_stub_get_stats(&after);
+
+  const double bytes = (double)(after.bytes - before.bytes) / samples;
+  printf("%-40s %8.1f %8.1f %8.1f %8.1f %10.1f\n", name,
+         (double)elapsed / samples / 1000.0,
+         (double)(after.messages - before.messages) / samples,
+         (double)(after.transfers - before.transfers) / samples,
+         bytes,
+         after.speed_hz ? bytes * 8.0 * 1000000.0 / after.speed_hz : 0.0);
+}
+
+static void
+bench_spi_select(struct bench_spi *bs, const nfc_target *pnt)
+{
+  nfc_target nt;
+
+  // Field off so the listed (halted) tags answer again
+  nfc_device_set_property_bool(bs->pnd, NP_ACTIVATE_FIELD, false);
+  if (nfc_initiator_select_passive_target(bs->pnd, nmMifare, pnt->nti.nai.abtUid, pnt->nti.nai.szUidLen, &nt) != 1) {
+    nfc_perror(bs->pnd, "nfc_initiator_select_passive_target");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void
+bench_spi_suite(nfc_context *context, const nfc_connstring connstring, const char *mode)
+{
+  struct bench_spi bs;
+
+  bs.pnd = nfc_open(context, connstring);
+  if (!bs.pnd) {
+    fprintf(stderr, "Unable to open %s\n", connstring);
+    exit(EXIT_FAILURE);
+  }
+  if (nfc_initiator_init(bs.pnd) < 0) {
+    nfc_perror(bs.pnd, "nfc_initiator_init");
+    exit(EXIT_FAILURE);
+  }
+  nfc_target ant[2];
+  if (nfc_initiator_list_passive_targets(bs.pnd, nmMifare, ant, 2) != 2) {
+    nfc_perror(bs.pnd, "nfc_initiator_list_passive_targets");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("%s controller\n", mode);
+  bench_run("pn53x_transceive, GetFirmwareVersion", bench_firmware, &bs, 0);
+
+  // Authenticate the MIFARE Classic once, then read a block over and over
+  bench_spi_select(&bs, &ant[0]);
+  uint8_t abtAuth[12] = { 0x60, 0x04, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  memcpy(abtAuth + 8, ant[0].nti.nai.abtUid, 4);
+  if (nfc_initiator_transceive_bytes(bs.pnd, abtAuth, sizeof(abtAuth), NULL, 0, 1000) < 0) {
+    nfc_perror(bs.pnd, "MIFARE authentication");
+    exit(EXIT_FAILURE);
+  }
+  bench_run("nfc_initiator_transceive_bytes, MIFARE read", bench_mifare_read, &bs, 16);
+
+  printf("\n%-40s %8s %8s %8s %8s %10s\n", "command", "us/op", "ioctl", "xfers", "bytes", "bus us");
+  bench_spi_profile("MIFARE read", bench_mifare_read, &bs, PROFILE_SAMPLES);
+  bench_spi_profile("GetFirmwareVersion", bench_firmware, &bs, PROFILE_SAMPLES);
+  bench_spi_select(&bs, &ant[1]);
+  bench_spi_profile("READ BINARY 256 (extended reply)", bench_read_binary, &bs, PROFILE_SAMPLES);
+  bench_spi_profile("UPDATE BINARY 250 (extended command)", bench_update_binary, &bs, PROFILE_SAMPLES);
+  printf("\n");
+  nfc_close(bs.pnd);
+}
+
+static void
+bench_spi_latency(nfc_context *context, const nfc_connstring connstring)
+{
+  static const unsigned int latencies[] = { 200, 1000, 5000 };
+  struct bench_spi bs;
+  char name[64];
+
+  bs.pnd = nfc_open(context, connstring);
+  if (!bs.pnd) {
+    fprintf(stderr, "Unable to open %s\n", connstring);
+    exit(EXIT_FAILURE);
+  }
+
+  printf("%-40s %8s %8s %8s %8s %10s\n", "GetFirmwareVersion, chip busy for", "us/op", "ioctl", "xfers", "bytes", "bus us");
+  for (size_t i = 0; i < sizeof(latencies) / sizeof(latencies[0]); i++) {
+    spidev_stub_set_latency(latencies[i]);
+    snprintf(name, sizeof(name), "%u us", latencies[i]);
+    bench_spi_profile(name, bench_firmware, &bs, PROFILE_SAMPLES / 10);
+  }
+  spidev_stub_set_latency(0);
+  nfc_close(bs.pnd);
+}
+
+int
+main(int argc, const char *argv[])
+{
+  nfc_context *context;
+  nfc_connstring connstring;
+  char acPath[64];
+
+  bench_init(argc, argv);
+
+  if (spidev_stub_open("mfc1k,iso14443-4", acPath, sizeof(acPath)) < 0) {
+    fprintf(stderr, "Unable to start the PN532 stand-in\n");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(connstring, sizeof(connstring), "pn532_spi:%s", acPath);
+
+  nfc_init(&context);
+  if (context == NULL) {
+    fprintf(stderr, "Unable to init libnfc (malloc)\n");
+    spidev_stub_close();
+    exit(EXIT_FAILURE);
+  }
+  log_set_level(0);
+
+  bench_spi_suite(context, connstring, "Full-duplex");
+  spidev_stub_set_half_duplex(true);
+  bench_spi_suite(context, connstring, "Half-duplex");
+  spidev_stub_set_half_duplex(false);
+  bench_spi_latency(context, connstring);
+
+  nfc_exit(context);
+  spidev_stub_close();
+  exit(EXIT_SUCCESS);
+}
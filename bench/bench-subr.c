@@ -0,0 +1,135 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-subr.c
+ * @brief Minimal micro-benchmark harness shared by libnfc benchmarks
+ *
+ * Each benchmark is first run with a growing number of iterations until it
+ * lasts at least the requested time (100 ms by default, "-t <ms>" to change
+ * it). That iteration count is then timed several times (5 by default, "-r
+ * <runs>"), and the median cost is printed in ns/op with the half spread
+ * between the fastest and slowest runs, and in MB/s when the operation
+ * handles a known amount of data.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench-subr.h"
+
+volatile uint32_t bench_sink;
+
+#define BENCH_MAX_RUNS 32
+
+static uint64_t bench_min_time_ns = 100000000ULL;
+static unsigned bench_runs = 5;
+
+uint64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void
+bench_init(int argc, const char *argv[])
+{
+  for (int arg = 1; arg < argc; arg++) {
+    if ((0 == strcmp(argv[arg], "-t")) && (arg + 1 < argc)) {
+      bench_min_time_ns = strtoull(argv[++arg], NULL, 10) * 1000000ULL;
+    } else if ((0 == strcmp(argv[arg], "-r")) && (arg + 1 < argc)) {
+      bench_runs = (unsigned)strtoul(argv[++arg], NULL, 10);
+      if ((bench_runs == 0) || (bench_runs > BENCH_MAX_RUNS)) {
+        fprintf(stderr, "%s: runs must be between 1 and %d\n", argv[0], BENCH_MAX_RUNS);
+        exit(EXIT_FAILURE);
+      }
+    } else {
+      fprintf(stderr, "usage: %s [-t min_time_ms] [-r runs]\n", argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  printf("%-48s %12s %12s %7s %12s\n", "benchmark", "iterations", "ns/op", "+/-", "MB/s");
+}
+
+static int
+bench_cmp(const void *a, const void *b)
+{
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+void
+bench_run(const char *name, bench_fn fn, void *arg, size_t bytes_per_op)
+{
+  size_t iterations = 1;
+  uint64_t elapsed;
+  double ns_per_op[BENCH_MAX_RUNS];
+
+  // Warm up caches and branch predictors
+  fn(arg, 1);
+
+  for (;;) {
+    uint64_t start = bench_now_ns();
+    fn(arg, iterations);
+    elapsed = bench_now_ns() - start;
+    if ((elapsed >= bench_min_time_ns) || (iterations >= ((size_t)1 << 40)))
+      break;
+    // Aim directly at the target time once the measure is significant
+    if (elapsed > 1000000ULL) {
+      size_t next = (size_t)((double)iterations * (double)bench_min_time_ns * 1.1 / (double)elapsed);
+      iterations = (next > iterations) ? next : iterations * 2;
+    } else {
+      iterations *= 10;
+    }
+  }
+
+  for (unsigned run = 0; run < bench_runs; run++) {
+    uint64_t start = bench_now_ns();
+    fn(arg, iterations);
+    ns_per_op[run] = (double)(bench_now_ns() - start) / (double)iterations;
+  }
+  qsort(ns_per_op, bench_runs, sizeof(ns_per_op[0]), bench_cmp);
+
+  const double median = (bench_runs & 1) ? ns_per_op[bench_runs / 2] :
+                        (ns_per_op[bench_runs / 2 - 1] + ns_per_op[bench_runs / 2]) / 2.0;
+  char spread[16];
+  snprintf(spread, sizeof(spread), "%.1f%%", (ns_per_op[bench_runs - 1] - ns_per_op[0]) * 50.0 / median);
+  if (bytes_per_op) {
+    printf("%-48s %12zu %12.1f %7s %12.1f\n", name, iterations, median, spread, (double)bytes_per_op * 1000.0 / median);
+  } else {
+    printf("%-48s %12zu %12.1f %7s %12s\n", name, iterations, median, spread, "-");
+  }
+}
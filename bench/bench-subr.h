@@ -0,0 +1,51 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-subr.h
+ * @brief Minimal micro-benchmark harness shared by libnfc benchmarks
+ */
+
+#ifndef _LIBNFC_BENCH_SUBR_H_
+#  define _LIBNFC_BENCH_SUBR_H_
+
+#  include <stddef.h>
+#  include <stdint.h>
+
+/**
+ * @brief Benchmark body: run the measured operation @a iterations times
+ */
+typedef void (*bench_fn)(void *arg, size_t iterations);
+
+// Written by benchmark bodies so the compiler cannot drop the measured code
+extern volatile uint32_t bench_sink;
+
+uint64_t bench_now_ns(void);
+void bench_init(int argc, const char *argv[]);
+void bench_run(const char *name, bench_fn fn, void *arg, size_t bytes_per_op);
+
+#endif // _LIBNFC_BENCH_SUBR_H_
@@ -0,0 +1,300 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file bench-uart.c
+ * @brief Measure pn532_uart host-side overhead against a PN532 stand-in on a pty
+ *
+ * The PN532 is replaced by pn532-pty, which answers instantly, so the figures
+ * are the cost of pn532_uart_send(), pn532_uart_receive() and uart_receive()
+ * plus the pty round-trip, without any chip or baud rate.
+ *
+ * After the throughput table, each command is sampled one by one to report
+ * median and 99th percentile latencies, and the read(2)/write(2) calls and
+ * voluntary context switches it costs (Linux only, from /proc/self/io and
+ * getrusage()). Every read(2) of the UART bus comes with one select(2); a
+ * reply that reaches the pty in one burst should cost a single read(2), the
+ * ACK and the response frame being parsed from the port's receive buffer.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "chips/pn53x.h"
+#include "log.h"
+#include "bench-subr.h"
+#include "pn532-pty.h"
+
+#define PROFILE_SAMPLES 1000
+
+static const nfc_modulation nmMifare = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+
+struct bench_uart {
+  nfc_context *context;
+  nfc_device *pnd;
+  nfc_connstring connstring;
+};
+
+struct bench_uart_counters {
+  unsigned long long syscr;
+  unsigned long long syscw;
+  long nvcsw;
+};
+
+static void
+bench_uart_counters_get(struct bench_uart_counters *counters)
+{
+  char line[64];
+  FILE *f;
+
+  counters->syscr = 0;
+  counters->syscw = 0;
+  if ((f = fopen("/proc/self/io", "r")) != NULL) {
+    while (fgets(line, sizeof(line), f)) {
+      sscanf(line, "syscr: %llu", &counters->syscr);
+      sscanf(line, "syscw: %llu", &counters->syscw);
+    }
+    fclose(f);
+  }
+
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  counters->nvcsw = ru.ru_nvcsw;
+}
+
+static int
+bench_uart_cmp(const void *a, const void *b)
+{
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void
+bench_uart_profile(const char *name, bench_fn fn, void *arg, size_t samples)
+{
+  static uint64_t latencies[PROFILE_SAMPLES];
+  struct bench_uart_counters before, after;
+
+  if (samples > PROFILE_SAMPLES)
+    samples = PROFILE_SAMPLES;
+  bench_uart_counters_get(&before);
+  for (size_t i = 0; i < samples; i++) {
+    uint64_t start = bench_now_ns();
+    fn(arg, 1);
+    latencies[i] = bench_now_ns() - start;
+  }
+  bench_uart_counters_get(&after);
+  qsort(latencies, samples, sizeof(latencies[0]), bench_uart_cmp);
+
+  printf("%-48s %10.1f %10.1f %8.1f %8.1f %8.1f\n", name,
+         (double)latencies[samples / 2] / 1000.0,
+         (double)latencies[(samples * 99) / 100] / 1000.0,
+         (double)(after.syscr - before.syscr) / (double)samples,
+         (double)(after.syscw - before.syscw) / (double)samples,
+         (double)(after.nvcsw - before.nvcsw) / (double)samples);
+}
+
+static void
+bench_firmware(void *arg, size_t iterations)
+{
+  struct bench_uart *bu = arg;
+  const uint8_t abtCmd[] = { GetFirmwareVersion };
+  uint8_t abtRx[4];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (pn53x_transceive(bu->pnd, abtCmd, sizeof(abtCmd), abtRx, sizeof(abtRx), 1000) != 4) {
+      nfc_perror(bu->pnd, "GetFirmwareVersion");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_mifare_read(void *arg, size_t iterations)
+{
+  struct bench_uart *bu = arg;
+  const uint8_t abtRead[2] = { 0x30, 0x04 };
+  uint8_t abtRx[16];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (nfc_initiator_transceive_bytes(bu->pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 1000) != 16) {
+      nfc_perror(bu->pnd, "MIFARE read");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_read_binary(void *arg, size_t iterations)
+{
+  struct bench_uart *bu = arg;
+  // Le = 0: 256 bytes, the reply needs an extended frame
+  const uint8_t abtApdu[5] = { 0x00, 0xb0, 0x00, 0x00, 0x00 };
+  uint8_t abtRx[258];
+
+  for (size_t i = 0; i < iterations; i++) {
+    if (nfc_initiator_transceive_bytes(bu->pnd, abtApdu, sizeof(abtApdu), abtRx, sizeof(abtRx), 1000) != 258) {
+      nfc_perror(bu->pnd, "READ BINARY");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_update_binary(void *arg, size_t iterations)
+{
+  struct bench_uart *bu = arg;
+  // Lc = 250: the command needs an extended frame
+  uint8_t abtApdu[5 + 250] = { 0x00, 0xd6, 0x00, 0x00, 250 };
+  uint8_t abtRx[2];
+
+  for (size_t i = 0; i < iterations; i++) {
+    abtApdu[5] = (uint8_t)i;
+    if (nfc_initiator_transceive_bytes(bu->pnd, abtApdu, sizeof(abtApdu), abtRx, sizeof(abtRx), 1000) != 2) {
+      nfc_perror(bu->pnd, "UPDATE BINARY");
+      exit(EXIT_FAILURE);
+    }
+    bench_sink += abtRx[0];
+  }
+}
+
+static void
+bench_open_close(void *arg, size_t iterations)
+{
+  struct bench_uart *bu = arg;
+
+  for (size_t i = 0; i < iterations; i++) {
+    nfc_device *pnd = nfc_open(bu->context, bu->connstring);
+    if (!pnd) {
+      fprintf(stderr, "Unable to open %s\n", bu->connstring);
+      exit(EXIT_FAILURE);
+    }
+    nfc_close(pnd);
+    bench_sink++;
+  }
+}
+
+static void
+bench_uart_select(struct bench_uart *bu, const nfc_target *pnt)
+{
+  nfc_target nt;
+
+  // Field off so the listed (halted) tags answer again
+  nfc_device_set_property_bool(bu->pnd, NP_ACTIVATE_FIELD, false);
+  if (nfc_initiator_select_passive_target(bu->pnd, nmMifare, pnt->nti.nai.abtUid, pnt->nti.nai.szUidLen, &nt) != 1) {
+    nfc_perror(bu->pnd, "nfc_initiator_select_passive_target");
+    exit(EXIT_FAILURE);
+  }
+}
+
+int
+main(int argc, const char *argv[])
+{
+  struct bench_uart bu;
+  char acPty[64];
+
+  bench_init(argc, argv);
+
+  pid_t pid = pn532_pty_spawn("mfc1k,iso14443-4", acPty, sizeof(acPty));
+  if (pid < 0) {
+    fprintf(stderr, "Unable to start the PN532 stand-in\n");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(bu.connstring, sizeof(bu.connstring), "pn532_uart:%s", acPty);
+
+  nfc_init(&bu.context);
+  if (bu.context == NULL) {
+    fprintf(stderr, "Unable to init libnfc (malloc)\n");
+    pn532_pty_stop(pid);
+    exit(EXIT_FAILURE);
+  }
+  log_set_level(0);
+
+  bu.pnd = nfc_open(bu.context, bu.connstring);
+  if (!bu.pnd) {
+    fprintf(stderr, "Unable to open %s\n", bu.connstring);
+    pn532_pty_stop(pid);
+    exit(EXIT_FAILURE);
+  }
+  if (nfc_initiator_init(bu.pnd) < 0) {
+    nfc_perror(bu.pnd, "nfc_initiator_init");
+    exit(EXIT_FAILURE);
+  }
+  nfc_target ant[2];
+  if (nfc_initiator_list_passive_targets(bu.pnd, nmMifare, ant, 2) != 2) {
+    nfc_perror(bu.pnd, "nfc_initiator_list_passive_targets");
+    exit(EXIT_FAILURE);
+  }
+
+  bench_run("pn53x_transceive, GetFirmwareVersion", bench_firmware, &bu, 0);
+
+  // Authenticate the MIFARE Classic once, then read a block over and over
+  bench_uart_select(&bu, &ant[0]);
+  uint8_t abtAuth[12] = { 0x60, 0x04, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  memcpy(abtAuth + 8, ant[0].nti.nai.abtUid, 4);
+  if (nfc_initiator_transceive_bytes(bu.pnd, abtAuth, sizeof(abtAuth), NULL, 0, 1000) < 0) {
+    nfc_perror(bu.pnd, "MIFARE authentication");
+    exit(EXIT_FAILURE);
+  }
+  bench_run("nfc_initiator_transceive_bytes, MIFARE read", bench_mifare_read, &bu, 16);
+
+  bench_uart_select(&bu, &ant[1]);
+  bench_run("nfc_initiator_transceive_bytes, READ BINARY 256", bench_read_binary, &bu, 256);
+  bench_run("nfc_initiator_transceive_bytes, UPDATE BINARY 250", bench_update_binary, &bu, 250);
+
+  printf("\n%-48s %10s %10s %8s %8s %8s\n", "command", "p50 us", "p99 us", "read/op", "write/op", "ctxsw/op");
+  bench_uart_profile("GetFirmwareVersion", bench_firmware, &bu, PROFILE_SAMPLES);
+  bench_uart_profile("READ BINARY 256 (extended reply)", bench_read_binary, &bu, PROFILE_SAMPLES);
+  bench_uart_profile("UPDATE BINARY 250 (extended command)", bench_update_binary, &bu, PROFILE_SAMPLES);
+  bench_uart_select(&bu, &ant[0]);
+  if (nfc_initiator_transceive_bytes(bu.pnd, abtAuth, sizeof(abtAuth), NULL, 0, 1000) < 0) {
+    nfc_perror(bu.pnd, "MIFARE authentication");
+    exit(EXIT_FAILURE);
+  }
+  bench_uart_profile("MIFARE read", bench_mifare_read, &bu, PROFILE_SAMPLES);
+  nfc_close(bu.pnd);
+
+  // Dominated by the 50 ms input flush of pn532_uart_open()
+  bench_uart_profile("nfc_open + nfc_close", bench_open_close, &bu, 20);
+
+  nfc_exit(bu.context);
+  pn532_pty_stop(pid);
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,205 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn532-pty.c
+ * @brief PN532 HSU stand-in served on a pseudo-terminal
+ *
+ * A child process owns the master side of a pty and answers like a PN532
+ * on its High Speed UART, framing being handled by pn532-stub.c. pn532_uart
+ * can open the slave side with a plain "pn532_uart:/dev/pts/N" connstring and
+ * only the host-side cost remains to be measured.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <nfc/nfc.h>
+
+#include "chips/pn53x.h"
+#include "chips/pn53x-internal.h"
+#include "pn532-pty.h"
+#include "pn532-stub.h"
+
+#define PN532_PTY_FRAME_MAX (PN53x_EXTENDED_FRAME__DATA_MAX_LEN + PN53x_EXTENDED_FRAME__OVERHEAD)
+
+struct pn532_pty {
+  int fd;
+  struct pn532_stub *stub;
+  /** Time taken before each response, in us */
+  unsigned int uiDelay;
+};
+
+static const uint8_t pn532_pty_ack[] = { 0x00, 0x00, 0xff, 0x00, 0xff, 0x00 };
+
+static void
+pn532_pty_write(void *arg, const uint8_t *pbtData, const size_t szData)
+{
+  struct pn532_pty *pty = arg;
+  size_t szDone = 0;
+
+  // The ACK is immediate, the response waits for the chip and the RF exchange
+  if (pty->uiDelay && ((szData != sizeof(pn532_pty_ack)) || memcmp(pbtData, pn532_pty_ack, szData))) {
+    const struct timespec ts = { .tv_sec = pty->uiDelay / 1000000, .tv_nsec = (pty->uiDelay % 1000000) * 1000 };
+    nanosleep(&ts, NULL);
+  }
+  while (szDone < szData) {
+    ssize_t res = write(pty->fd, pbtData + szDone, szData - szDone);
+    if (res < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    szDone += res;
+  }
+}
+
+static void
+pn532_pty_serve(struct pn532_pty *pty, const pid_t parent)
+{
+  uint8_t abtBuf[4 * PN532_PTY_FRAME_MAX];
+  size_t szBuf = 0;
+
+  for (;;) {
+    struct pollfd pfd = { .fd = pty->fd, .events = POLLIN };
+    int res = poll(&pfd, 1, 1000);
+    // Do not outlive a benchmark that crashed
+    if (getppid() != parent)
+      return;
+    if (res <= 0)
+      continue;
+
+    ssize_t szRead = read(pty->fd, abtBuf + szBuf, sizeof(abtBuf) - szBuf);
+    if (szRead < 0) {
+      if ((errno == EINTR) || (errno == EAGAIN))
+        continue;
+      return;
+    }
+    szBuf += szRead;
+
+    size_t szUsed = pn532_stub_input(pty->stub, abtBuf, szBuf);
+    if ((szUsed == 0) && (szBuf == sizeof(abtBuf))) {
+      // Junk without any start code, drop it
+      szUsed = szBuf - 1;
+    }
+    memmove(abtBuf, abtBuf + szUsed, szBuf - szUsed);
+    szBuf -= szUsed;
+  }
+}
+
+/**
+ * @brief Start a PN532 stand-in with @a tags (see pn53x_sim_add_tags) in its field
+ * @return child process id, or -1 on failure
+ *
+ * The slave pty path is stored in @a pcPath. pn532_pty_stop() terminates it.
+ */
+pid_t
+pn532_pty_spawn(const char *tags, char *pcPath, const size_t szPath)
+{
+  return pn532_pty_spawn_delayed(tags, 0, pcPath, szPath);
+}
+
+/**
+ * @brief Same as pn532_pty_spawn(), each response being sent @a uiDelay us after the command
+ */
+pid_t
+pn532_pty_spawn_delayed(const char *tags, const unsigned int uiDelay, char *pcPath, const size_t szPath)
+{
+  struct pn532_pty pty;
+
+  pty.uiDelay = uiDelay;
+
+  pty.fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (pty.fd < 0) {
+    perror("posix_openpt");
+    return -1;
+  }
+  if ((grantpt(pty.fd) < 0) || (unlockpt(pty.fd) < 0) || (ptsname(pty.fd) == NULL)) {
+    perror("pty");
+    close(pty.fd);
+    return -1;
+  }
+  snprintf(pcPath, szPath, "%s", ptsname(pty.fd));
+
+  // The child keeps the slave side open so the master never reads a hang-up
+  // between two nfc_open(), and sets it raw until pn532_uart does
+  int iSlave = open(pcPath, O_RDWR | O_NOCTTY);
+  struct termios tio;
+  if ((iSlave < 0) || (tcgetattr(iSlave, &tio) < 0)) {
+    perror(pcPath);
+    close(pty.fd);
+    return -1;
+  }
+  tio.c_iflag = 0;
+  tio.c_oflag = 0;
+  tio.c_lflag = 0;
+  tio.c_cflag = CS8 | CLOCAL | CREAD;
+  tcsetattr(iSlave, TCSANOW, &tio);
+
+  pty.stub = pn532_stub_new(tags, pn532_pty_write, &pty);
+  if (!pty.stub) {
+    close(iSlave);
+    close(pty.fd);
+    return -1;
+  }
+
+  const pid_t parent = getpid();
+  const pid_t pid = fork();
+  if (pid == 0) {
+    pn532_pty_serve(&pty, parent);
+    _exit(EXIT_SUCCESS);
+  }
+  if (pid < 0)
+    perror("fork");
+  pn532_stub_free(pty.stub);
+  close(iSlave);
+  close(pty.fd);
+  return pid;
+}
+
+void
+pn532_pty_stop(pid_t pid)
+{
+  if (pid <= 0)
+    return;
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
+}
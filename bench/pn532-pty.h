@@ -0,0 +1,43 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn532-pty.h
+ * @brief PN532 HSU stand-in served on a pseudo-terminal
+ */
+
+#ifndef _LIBNFC_PN532_PTY_H_
+#  define _LIBNFC_PN532_PTY_H_
+
+#  include <stddef.h>
+#  include <sys/types.h>
+
+pid_t pn532_pty_spawn(const char *tags, char *pcPath, const size_t szPath);
+pid_t pn532_pty_spawn_delayed(const char *tags, const unsigned int uiDelay, char *pcPath, const size_t szPath);
+void pn532_pty_stop(pid_t pid);
+
+#endif // _LIBNFC_PN532_PTY_H_
@@ -0,0 +1,226 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn532-stub.c
+ * @brief PN532 host interface framing shared by the benchmark stand-ins
+ *
+ * Chip side of the PN532 frame protocol, whatever the bus: it skips the
+ * wake-up preamble, parses normal and extended information frames, answers
+ * an ACK frame then the reply frame, and resends the last reply on NACK.
+ * Replies come from the pn53x_sim engine; the bus stand-ins only move bytes.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "chips/pn53x.h"
+#include "chips/pn53x-internal.h"
+#include "chips/pn53x-sim.h"
+#include "pn532-stub.h"
+
+#define PN532_STUB_FRAME_MAX (PN53x_EXTENDED_FRAME__DATA_MAX_LEN + PN53x_EXTENDED_FRAME__OVERHEAD)
+
+static const uint8_t pn532_stub_ack_frame[] = { 0x00, 0x00, 0xff, 0x00, 0xff, 0x00 };
+static const uint8_t pn532_stub_error_frame[] = { 0x00, 0x00, 0xff, 0x01, 0xff, 0x7f, 0x81, 0x00 };
+
+struct pn532_stub {
+  struct pn53x_sim *sim;
+  pn532_stub_output output;
+  void *arg;
+  uint8_t abtLast[PN532_STUB_FRAME_MAX];
+  size_t szLast;
+};
+
+static void
+pn532_stub_reply(struct pn532_stub *stub, const uint8_t *pbtCmd, const size_t szCmd)
+{
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  uint8_t *pbtFrame = stub->abtLast;
+
+  stub->output(stub->arg, pn532_stub_ack_frame, sizeof(pn532_stub_ack_frame));
+
+  int res = pn53x_sim_command(stub->sim, pbtCmd, szCmd, abtRx, sizeof(abtRx) - 2);
+  if (res == NFC_ETIMEOUT) {
+    // Still waiting for a target: a real chip would stay silent too
+    stub->szLast = 0;
+    return;
+  }
+  if (res < 0) {
+    memcpy(pbtFrame, pn532_stub_error_frame, sizeof(pn532_stub_error_frame));
+    stub->szLast = sizeof(pn532_stub_error_frame);
+    stub->output(stub->arg, pbtFrame, stub->szLast);
+    return;
+  }
+
+  // LEN covers TFI and the response code
+  const size_t szLen = (size_t)res + 2;
+  size_t szFrame = 0;
+  pbtFrame[szFrame++] = 0x00;
+  pbtFrame[szFrame++] = 0x00;
+  pbtFrame[szFrame++] = 0xff;
+  if (szLen > 0xff) {
+    pbtFrame[szFrame++] = 0xff;
+    pbtFrame[szFrame++] = 0xff;
+    pbtFrame[szFrame++] = (uint8_t)(szLen >> 8);
+    pbtFrame[szFrame++] = (uint8_t)szLen;
+    pbtFrame[szFrame] = (uint8_t)(256 - ((pbtFrame[szFrame - 2] + pbtFrame[szFrame - 1]) & 0xff));
+    szFrame++;
+  } else {
+    pbtFrame[szFrame++] = (uint8_t)szLen;
+    pbtFrame[szFrame++] = (uint8_t)(256 - szLen);
+  }
+  uint8_t btDCS = 0;
+  pbtFrame[szFrame++] = 0xd5;
+  pbtFrame[szFrame++] = pbtCmd[0] + 1;
+  memcpy(pbtFrame + szFrame, abtRx, res);
+  for (size_t n = szFrame - 2; n < szFrame + (size_t)res; n++) {
+    btDCS -= pbtFrame[n];
+  }
+  szFrame += res;
+  pbtFrame[szFrame++] = btDCS;
+  pbtFrame[szFrame++] = 0x00;
+  stub->szLast = szFrame;
+  stub->output(stub->arg, pbtFrame, szFrame);
+}
+
+/**
+ * @brief Start a PN532 stand-in with @a tags (see pn53x_sim_add_tags) in its field
+ * @return the stand-in, or NULL on failure
+ *
+ * Every frame for the host is handed to @a output along with @a arg.
+ */
+struct pn532_stub *
+pn532_stub_new(const char *tags, pn532_stub_output output, void *arg)
+{
+  struct pn532_stub *stub = malloc(sizeof(struct pn532_stub));
+  if (!stub) {
+    perror("malloc");
+    return NULL;
+  }
+  stub->output = output;
+  stub->arg = arg;
+  stub->szLast = 0;
+  stub->sim = pn53x_sim_new(PN532);
+  if (!stub->sim) {
+    free(stub);
+    return NULL;
+  }
+  if ((tags != NULL) && (pn53x_sim_add_tags(stub->sim, tags) < 0)) {
+    fprintf(stderr, "Invalid simulated tags: %s\n", tags);
+    pn532_stub_free(stub);
+    return NULL;
+  }
+  return stub;
+}
+
+void
+pn532_stub_free(struct pn532_stub *stub)
+{
+  if (!stub)
+    return;
+  pn53x_sim_free(stub->sim);
+  free(stub);
+}
+
+/**
+ * @brief Handle every complete frame the host wrote in @a pbtBuf
+ * @return count of bytes consumed; an incomplete trailing frame is left for the next call
+ */
+size_t
+pn532_stub_input(struct pn532_stub *stub, const uint8_t *pbtBuf, const size_t szBuf)
+{
+  size_t szPos = 0;
+
+  for (;;) {
+    // Skip the wake-up preamble and any junk up to the "00 ff" start code
+    size_t i = szPos;
+    while ((i + 1 < szBuf) && !((pbtBuf[i] == 0x00) && (pbtBuf[i + 1] == 0xff)))
+      i++;
+    if (i + 1 >= szBuf)
+      return i;
+    if (i + 5 > szBuf)
+      return i;
+
+    const uint8_t btLen = pbtBuf[i + 2];
+    const uint8_t btLCS = pbtBuf[i + 3];
+    size_t szHeader, szLen;
+
+    if ((btLen == 0x00) && (btLCS == 0xff)) {
+      // ACK from the host aborts the running command: nothing is running here
+      szPos = i + 5;
+      continue;
+    }
+    if ((btLen == 0xff) && (btLCS == 0x00)) {
+      // NACK asks for the last reply again
+      if (stub->szLast)
+        stub->output(stub->arg, stub->abtLast, stub->szLast);
+      szPos = i + 5;
+      continue;
+    }
+    if ((btLen == 0xff) && (btLCS == 0xff)) {
+      if (i + 7 > szBuf)
+        return i;
+      if (((pbtBuf[i + 4] + pbtBuf[i + 5] + pbtBuf[i + 6]) & 0xff) != 0) {
+        szPos = i + 2;
+        continue;
+      }
+      szHeader = 7;
+      szLen = (pbtBuf[i + 4] << 8) | pbtBuf[i + 5];
+    } else {
+      if (((btLen + btLCS) & 0xff) != 0) {
+        szPos = i + 2;
+        continue;
+      }
+      szHeader = 4;
+      szLen = btLen;
+    }
+    if ((szLen < 2) || (szLen > PN53x_EXTENDED_FRAME__DATA_MAX_LEN)) {
+      szPos = i + 2;
+      continue;
+    }
+    if (i + szHeader + szLen + 2 > szBuf)
+      return i;
+
+    const uint8_t *pbtData = pbtBuf + i + szHeader;
+    uint8_t btDCS = pbtData[szLen];
+    for (size_t n = 0; n < szLen; n++) {
+      btDCS += pbtData[n];
+    }
+    // A PN532 drops frames it cannot check, the host will time out
+    if ((btDCS == 0) && (pbtData[0] == 0xd4))
+      pn532_stub_reply(stub, pbtData + 1, szLen - 1);
+    szPos = i + szHeader + szLen + 2;
+  }
+}
@@ -0,0 +1,48 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn532-stub.h
+ * @brief PN532 host interface framing shared by the benchmark stand-ins
+ */
+
+#ifndef _LIBNFC_PN532_STUB_H_
+#  define _LIBNFC_PN532_STUB_H_
+
+#  include <stddef.h>
+#  include <stdint.h>
+
+struct pn532_stub;
+
+/* Called with each frame the stand-in sends back to the host */
+typedef void (*pn532_stub_output)(void *arg, const uint8_t *pbtFrame, const size_t szFrame);
+
+struct pn532_stub *pn532_stub_new(const char *tags, pn532_stub_output output, void *arg);
+void pn532_stub_free(struct pn532_stub *stub);
+size_t pn532_stub_input(struct pn532_stub *stub, const uint8_t *pbtBuf, const size_t szBuf);
+
+#endif // _LIBNFC_PN532_STUB_H_
@@ -0,0 +1,287 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file spidev-stub.c
+ * @brief PN532 SPI stand-in behind an intercepted spidev ioctl(2)
+ *
+ * Linking this file into a program replaces ioctl(2): requests of the spidev
+ * type are answered here, like a PN532 on its SPI interface would, and any
+ * other request goes to the kernel. libnfc then opens a plain temporary file
+ * with a "pn532_spi:/tmp/..." connstring and its SPI bus code runs unchanged.
+ *
+ * The chip model follows pn532_spi.c: the first byte of each message (chip
+ * select assertion) is the STATREAD, DATAWRITE or DATAREAD command, all bytes
+ * are LSB first, and a DATAREAD continuing a partly read frame clocks out the
+ * next frame byte along with the command byte. Messages only clocking zeroes
+ * peek at the next frame byte. Frames come from pn532-stub.c; replies (not
+ * ACK frames) can be held back for a given command execution time, during
+ * which STATREAD reports the chip busy.
+ */
+
+// syscall(2) forwards the requests which are not ours
+#define _DEFAULT_SOURCE
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/spi/spidev.h>
+
+#include <nfc/nfc.h>
+
+#include "chips/pn53x-internal.h"
+#include "mirror-subr.h"
+#include "pn532-stub.h"
+#include "spidev-stub.h"
+
+#define SPIDEV_STUB_FRAME_MAX (PN53x_EXTENDED_FRAME__DATA_MAX_LEN + PN53x_EXTENDED_FRAME__OVERHEAD)
+#define SPIDEV_STUB_FRAMES 4
+
+#define SPIDEV_STUB_DATAWRITE 0x01
+#define SPIDEV_STUB_STATREAD  0x02
+#define SPIDEV_STUB_DATAREAD  0x03
+
+struct spidev_stub_frame {
+  uint8_t abt[SPIDEV_STUB_FRAME_MAX];
+  size_t sz;
+  uint64_t ready_us;
+};
+
+static struct {
+  struct pn532_stub *stub;
+  char acPath[64];
+  bool half_duplex;
+  unsigned int latency_us;
+  // Host frame being written
+  uint8_t abtIn[2 * SPIDEV_STUB_FRAME_MAX];
+  size_t szIn;
+  // Frames for the host, the first one being read from szPos
+  struct spidev_stub_frame frames[SPIDEV_STUB_FRAMES];
+  size_t szHead, szCount, szPos;
+  struct spidev_stub_stats stats;
+} spidev_stub;
+
+static uint64_t
+spidev_stub_now_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void
+spidev_stub_queue(void *arg, const uint8_t *pbtFrame, const size_t szFrame)
+{
+  static const uint8_t abtAck[] = { 0x00, 0x00, 0xff, 0x00, 0xff, 0x00 };
+
+  (void)arg;
+  if ((spidev_stub.szCount == SPIDEV_STUB_FRAMES) || (szFrame > SPIDEV_STUB_FRAME_MAX))
+    return;
+  struct spidev_stub_frame *frame = &spidev_stub.frames[(spidev_stub.szHead + spidev_stub.szCount) % SPIDEV_STUB_FRAMES];
+  memcpy(frame->abt, pbtFrame, szFrame);
+  frame->sz = szFrame;
+  frame->ready_us = spidev_stub_now_us();
+  if ((szFrame != sizeof(abtAck)) || memcmp(pbtFrame, abtAck, szFrame))
+    frame->ready_us += spidev_stub.latency_us;
+  spidev_stub.szCount++;
+}
+
+static uint8_t
+spidev_stub_next(bool consume)
+{
+  if (!spidev_stub.szCount)
+    return 0x00;
+  const struct spidev_stub_frame *frame = &spidev_stub.frames[spidev_stub.szHead];
+  if (spidev_stub.szPos >= frame->sz)
+    return 0x00;
+  return consume ? frame->abt[spidev_stub.szPos++] : frame->abt[spidev_stub.szPos];
+}
+
+static int
+spidev_stub_message(const struct spi_ioc_transfer *tr, const size_t szTransfers)
+{
+  uint8_t btCmd = 0x00;
+  bool first = true;
+  int total = 0;
+
+  for (size_t t = 0; t < szTransfers; t++) {
+    // Half-duplex controllers refuse to clock both ways in one transfer
+    if (spidev_stub.half_duplex && tr[t].tx_buf && tr[t].rx_buf) {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+  spidev_stub.stats.messages++;
+  spidev_stub.stats.transfers += szTransfers;
+
+  for (size_t t = 0; t < szTransfers; t++) {
+    const uint8_t *pbtTx = (const uint8_t *)(uintptr_t)tr[t].tx_buf;
+    uint8_t *pbtRx = (uint8_t *)(uintptr_t)tr[t].rx_buf;
+
+    for (size_t i = 0; i < tr[t].len; i++) {
+      const uint8_t btMosi = pbtTx ? mirror(pbtTx[i]) : 0x00;
+      uint8_t btMiso = 0x00;
+
+      if (first) {
+        btCmd = btMosi;
+        first = false;
+        if (btCmd == SPIDEV_STUB_DATAREAD)
+          btMiso = spidev_stub.szPos ? spidev_stub_next(true) : 0x01;
+        else if (btCmd != SPIDEV_STUB_DATAWRITE && btCmd != SPIDEV_STUB_STATREAD)
+          btMiso = spidev_stub_next(false);
+      } else {
+        switch (btCmd) {
+          case SPIDEV_STUB_STATREAD:
+            btMiso = (spidev_stub.szCount && (spidev_stub.frames[spidev_stub.szHead].ready_us <= spidev_stub_now_us())) ? 0x01 : 0x00;
+            break;
+          case SPIDEV_STUB_DATAWRITE:
+            if (spidev_stub.szIn < sizeof(spidev_stub.abtIn))
+              spidev_stub.abtIn[spidev_stub.szIn++] = btMosi;
+            break;
+          case SPIDEV_STUB_DATAREAD:
+            btMiso = spidev_stub_next(true);
+            break;
+          default:
+            btMiso = spidev_stub_next(false);
+            break;
+        }
+      }
+      if (pbtRx)
+        pbtRx[i] = mirror(btMiso);
+    }
+    total += tr[t].len;
+  }
+  spidev_stub.stats.bytes += total;
+
+  // Chip select is released
+  if (btCmd == SPIDEV_STUB_DATAWRITE) {
+    size_t szUsed = pn532_stub_input(spidev_stub.stub, spidev_stub.abtIn, spidev_stub.szIn);
+    if ((szUsed == 0) && (spidev_stub.szIn == sizeof(spidev_stub.abtIn)))
+      szUsed = spidev_stub.szIn;
+    memmove(spidev_stub.abtIn, spidev_stub.abtIn + szUsed, spidev_stub.szIn - szUsed);
+    spidev_stub.szIn -= szUsed;
+  } else if ((btCmd == SPIDEV_STUB_DATAREAD) && spidev_stub.szCount &&
+             (spidev_stub.szPos >= spidev_stub.frames[spidev_stub.szHead].sz)) {
+    spidev_stub.szHead = (spidev_stub.szHead + 1) % SPIDEV_STUB_FRAMES;
+    spidev_stub.szCount--;
+    spidev_stub.szPos = 0;
+  }
+  return total;
+}
+
+int
+ioctl(int fd, unsigned long request, ...)
+{
+  va_list ap;
+  va_start(ap, request);
+  void *arg = va_arg(ap, void *);
+  va_end(ap);
+
+  if (!spidev_stub.stub || (_IOC_TYPE(request) != SPI_IOC_MAGIC))
+    return syscall(SYS_ioctl, fd, request, arg);
+
+  switch (request) {
+    case SPI_IOC_WR_MAX_SPEED_HZ:
+      spidev_stub.stats.speed_hz = *(const uint32_t *)arg;
+      return 0;
+    case SPI_IOC_RD_MAX_SPEED_HZ:
+      *(uint32_t *)arg = spidev_stub.stats.speed_hz;
+      return 0;
+    case SPI_IOC_WR_MODE:
+    case SPI_IOC_WR_BITS_PER_WORD:
+    case SPI_IOC_WR_LSB_FIRST:
+      return 0;
+  }
+  if ((_IOC_NR(request) == _IOC_NR(SPI_IOC_MESSAGE(1))) && (_IOC_DIR(request) == _IOC_WRITE)) {
+    return spidev_stub_message(arg, _IOC_SIZE(request) / sizeof(struct spi_ioc_transfer));
+  }
+  errno = ENOTTY;
+  return -1;
+}
+
+/**
+ * @brief Start a PN532 SPI stand-in with @a tags (see pn53x_sim_add_tags) in its field
+ * @return 0 on success, -1 otherwise
+ *
+ * The path to open with pn532_spi is stored in @a pcPath.
+ */
+int
+spidev_stub_open(const char *tags, char *pcPath, const size_t szPath)
+{
+  snprintf(spidev_stub.acPath, sizeof(spidev_stub.acPath), "/tmp/spidev-stub-XXXXXX");
+  int fd = mkstemp(spidev_stub.acPath);
+  if (fd < 0) {
+    perror("mkstemp");
+    return -1;
+  }
+  close(fd);
+  if (!(spidev_stub.stub = pn532_stub_new(tags, spidev_stub_queue, NULL))) {
+    unlink(spidev_stub.acPath);
+    return -1;
+  }
+  snprintf(pcPath, szPath, "%s", spidev_stub.acPath);
+  return 0;
+}
+
+void
+spidev_stub_close(void)
+{
+  pn532_stub_free(spidev_stub.stub);
+  spidev_stub.stub = NULL;
+  unlink(spidev_stub.acPath);
+}
+
+void
+spidev_stub_set_half_duplex(bool half_duplex)
+{
+  spidev_stub.half_duplex = half_duplex;
+}
+
+/**
+ * @brief Hold replies back for @a uiMicros, as if commands took that long to run
+ */
+void
+spidev_stub_set_latency(unsigned int uiMicros)
+{
+  spidev_stub.latency_us = uiMicros;
+}
+
+void
+spidev_stub_get_stats(struct spidev_stub_stats *stats)
+{
+  *stats = spidev_stub.stats;
+}
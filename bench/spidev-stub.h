@@ -0,0 +1,53 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file spidev-stub.h
+ * @brief PN532 SPI stand-in behind an intercepted spidev ioctl(2)
+ */
+
+#ifndef _LIBNFC_SPIDEV_STUB_H_
+#  define _LIBNFC_SPIDEV_STUB_H_
+
+#  include <stdbool.h>
+#  include <stddef.h>
+#  include <stdint.h>
+
+struct spidev_stub_stats {
+  unsigned long messages;       // SPI_IOC_MESSAGE ioctls
+  unsigned long transfers;      // spi_ioc_transfer segments
+  unsigned long bytes;          // bytes clocked on the bus
+  uint32_t speed_hz;            // last SPI_IOC_WR_MAX_SPEED_HZ
+};
+
+int spidev_stub_open(const char *tags, char *pcPath, const size_t szPath);
+void spidev_stub_close(void);
+void spidev_stub_set_half_duplex(bool half_duplex);
+void spidev_stub_set_latency(unsigned int uiMicros);
+void spidev_stub_get_stats(struct spidev_stub_stats *stats);
+
+#endif // _LIBNFC_SPIDEV_STUB_H_
@@ -3,3 +3,5 @@
 #cmakedefine PACKAGE_STRING "@PACKAGE_STRING@"
 #cmakedefine _XOPEN_SOURCE @_XOPEN_SOURCE@
 #cmakedefine SYSCONFDIR "@SYSCONFDIR@"
+#cmakedefine HAVE_SYS_EPOLL_H 1
+#cmakedefine HAVE_SYS_TIMERFD_H 1
@@ -12,6 +12,8 @@ ELSE(${CMAKE_SYSTEM_NAME} MATCHES "Linux")
 ENDIF(${CMAKE_SYSTEM_NAME} MATCHES "Linux")
 SET(LIBNFC_DRIVER_PN532_UART ON CACHE BOOL "Enable PN532 UART support (Use serial port)")
 SET(LIBNFC_DRIVER_PN53X_USB ON CACHE BOOL "Enable PN531 and PN531 USB support (Depends on libusb)")
+SET(LIBNFC_DRIVER_REPLAY ON CACHE BOOL "Enable replay of PN53x binary traces")
+SET(LIBNFC_DRIVER_PN53X_SIM ON CACHE BOOL "Enable simulated PN53x with virtual tags")
 
 IF(LIBNFC_DRIVER_PCSC)
   FIND_PACKAGE(PCSC REQUIRED)
@@ -75,4 +77,14 @@ IF(LIBNFC_DRIVER_ACR122_USB)
   SET(USB_REQUIRED TRUE)
 ENDIF(LIBNFC_DRIVER_ACR122_USB)
 
+IF(LIBNFC_DRIVER_REPLAY)
+  ADD_DEFINITIONS("-DDRIVER_REPLAY_ENABLED")
+  SET(DRIVERS_SOURCES ${DRIVERS_SOURCES} "drivers/replay")
+ENDIF(LIBNFC_DRIVER_REPLAY)
+
+IF(LIBNFC_DRIVER_PN53X_SIM)
+  ADD_DEFINITIONS("-DDRIVER_PN53X_SIM_ENABLED")
+  SET(DRIVERS_SOURCES ${DRIVERS_SOURCES} "drivers/pn53x_sim")
+ENDIF(LIBNFC_DRIVER_PN53X_SIM)
+
 INCLUDE_DIRECTORIES(${CMAKE_CURRENT_SOURCE_DIR}/libnfc/drivers)
@@ -53,6 +53,9 @@ struct serial_port_windows {
   HANDLE  hPort;                // Serial port handle
   DCB     dcb;                  // Device control settings
   COMMTIMEOUTS ct;              // Serial port time-out configuration
+  size_t  szRxHead;             // First unconsumed byte in abtRx
+  size_t  szRxTail;             // End of the received bytes in abtRx
+  uint8_t abtRx[UART_RX_BUFFER_LEN];  // Bytes peeked but not consumed yet
 };
 
 serial_port
@@ -64,6 +67,7 @@ uart_open(const char *pcPortName)
   if (sp == 0)
     return INVALID_SERIAL_PORT;
 
+  sp->szRxHead = sp->szRxTail = 0;
   // Copy the input "com?" to "\\.\COM?" format
   sprintf(acPortName, "\\\\.\\%s", pcPortName);
   _strupr(acPortName);
@@ -115,6 +119,7 @@ uart_close(const serial_port sp)
 void
 uart_flush_input(const serial_port sp, bool wait)
 {
+  ((struct serial_port_windows *) sp)->szRxHead = ((struct serial_port_windows *) sp)->szRxTail = 0;
   PurgeComm(((struct serial_port_windows *) sp)->hPort, PURGE_RXABORT | PURGE_RXCLEAR);
 }
 
@@ -159,8 +164,8 @@ uart_get_speed(const serial_port sp)
   return 0;
 }
 
-int
-uart_receive(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout)
+static int
+uart_receive_port(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout)
 {
   DWORD dwBytesToGet = (DWORD)szRx;
   DWORD dwBytesReceived = 0;
@@ -214,6 +219,87 @@ uart_receive(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, i
   return (dwTotalBytesReceived == (DWORD) szRx) ? 0 : NFC_EIO;
 }
 
+int
+uart_receive(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout)
+{
+  struct serial_port_windows *spw = (struct serial_port_windows *) sp;
+  // Serve the bytes left by uart_peek() first
+  size_t szBuffered = MIN(spw->szRxTail - spw->szRxHead, szRx);
+
+  memcpy(pbtRx, spw->abtRx + spw->szRxHead, szBuffered);
+  uart_skip(sp, szBuffered);
+  if (szBuffered == szRx)
+    return NFC_SUCCESS;
+  return uart_receive_port(sp, pbtRx + szBuffered, szRx - szBuffered, abort_p, timeout);
+}
+
+int
+uart_peek(serial_port sp, const uint8_t **ppbtRx, const size_t szMin, void *abort_p, int timeout)
+{
+  struct serial_port_windows *spw = (struct serial_port_windows *) sp;
+  int res;
+
+  if (szMin > sizeof(spw->abtRx))
+    return NFC_EINVARG;
+
+  if (spw->szRxTail - spw->szRxHead < szMin) {
+    if (spw->szRxHead + szMin > sizeof(spw->abtRx)) {
+      memmove(spw->abtRx, spw->abtRx + spw->szRxHead, spw->szRxTail - spw->szRxHead);
+      spw->szRxTail -= spw->szRxHead;
+      spw->szRxHead = 0;
+    }
+    // ReadFile() blocks until the requested count, so only ask for what is missing
+    if ((res = uart_receive_port(sp, spw->abtRx + spw->szRxTail, szMin - (spw->szRxTail - spw->szRxHead), abort_p, timeout)) < 0)
+      return res;
+    spw->szRxTail = spw->szRxHead + szMin;
+  }
+  *ppbtRx = spw->abtRx + spw->szRxHead;
+  return (int)(spw->szRxTail - spw->szRxHead);
+}
+
+int
+uart_poll(serial_port sp, const uint8_t **ppbtRx)
+{
+  struct serial_port_windows *spw = (struct serial_port_windows *) sp;
+  COMSTAT cs;
+  DWORD dwErrors;
+  DWORD dwBytesReceived = 0;
+
+  if (spw->szRxHead) {
+    memmove(spw->abtRx, spw->abtRx + spw->szRxHead, spw->szRxTail - spw->szRxHead);
+    spw->szRxTail -= spw->szRxHead;
+    spw->szRxHead = 0;
+  }
+  if (!ClearCommError(spw->hPort, &dwErrors, &cs))
+    return NFC_EIO;
+  // Only read what is already queued, ReadFile() does not block then
+  if (cs.cbInQue > 0) {
+    if (!ReadFile(spw->hPort, spw->abtRx + spw->szRxTail, MIN(cs.cbInQue, (DWORD)(sizeof(spw->abtRx) - spw->szRxTail)), &dwBytesReceived, NULL))
+      return NFC_EIO;
+    spw->szRxTail += dwBytesReceived;
+  }
+  *ppbtRx = spw->abtRx + spw->szRxHead;
+  return (int)(spw->szRxTail - spw->szRxHead);
+}
+
+int
+uart_get_fd(serial_port sp)
+{
+  (void) sp;
+  // Handles can not be waited for with the event loop
+  return NFC_EDEVNOTSUPP;
+}
+
+void
+uart_skip(serial_port sp, const size_t szSkip)
+{
+  struct serial_port_windows *spw = (struct serial_port_windows *) sp;
+
+  spw->szRxHead += MIN(szSkip, spw->szRxTail - spw->szRxHead);
+  if (spw->szRxHead == spw->szRxTail)
+    spw->szRxHead = spw->szRxTail = 0;
+}
+
 int
 uart_send(serial_port sp, const uint8_t *pbtTx, const size_t szTx, int timeout)
 {
@@ -58,6 +58,7 @@
 #include "utils/nfc-utils.h"
 
 #define MAX_DEVICE_COUNT 16
+#define MODULATION_COUNT 6
 
 static nfc_device *pnd = NULL;
 static nfc_context *context;
@@ -102,7 +103,7 @@ main(int argc, const char *argv[])
 
   const uint8_t uiPollNr = 20;
   const uint8_t uiPeriod = 2;
-  const nfc_modulation nmModulations[6] = {
+  const nfc_modulation nmModulations[MODULATION_COUNT] = {
     { .nmt = NMT_ISO14443A, .nbr = NBR_106 },
     { .nmt = NMT_ISO14443B, .nbr = NBR_106 },
     { .nmt = NMT_FELICA, .nbr = NBR_212 },
@@ -110,7 +111,7 @@ main(int argc, const char *argv[])
     { .nmt = NMT_JEWEL, .nbr = NBR_106 },
     { .nmt = NMT_ISO14443BICLASS, .nbr = NBR_106 },
   };
-  const size_t szModulations = 6;
+  const size_t szModulations = MODULATION_COUNT;
 
   nfc_target nt;
   int res = 0;
@@ -145,6 +146,16 @@ main(int argc, const char *argv[])
     exit(EXIT_FAILURE);
   }
 
+  if (verbose) {
+    nfc_poll_stats stats[MODULATION_COUNT];
+    const int szStats = nfc_initiator_poll_stats(pnd, stats, szModulations);
+    for (int n = 0; n < szStats && n < (int) szModulations; n++) {
+      printf("%s (%s): %u hit(s) in %u attempt(s), %u us per attempt\n",
+             str_nfc_modulation_type(stats[n].nm.nmt), str_nfc_baud_rate(stats[n].nm.nbr),
+             stats[n].uiHits, stats[n].uiAttempts, stats[n].uiMeanLatency);
+    }
+  }
+
   if (res > 0) {
     print_nfc_target(&nt, verbose);
     printf("Waiting for card removing...");
@@ -69,6 +69,7 @@
 #endif
 
 #define ST25TB_SR_BLOCK_MAX_SIZE	((uint8_t) 4) // for static arrays
+#define ST25TB_SR_MAX_TARGETS	16 // tags processed in one field activation
 typedef void(*get_info_specific) (uint8_t * systemArea);
 
 typedef struct _st_data {
@@ -93,11 +94,12 @@ int main(int argc, char *argv[])
 {
 	nfc_context *context = NULL;
 	nfc_device *pnd = NULL;
-	nfc_target nt = {0};
+	nfc_target nt = {0}, ant[ST25TB_SR_MAX_TARGETS];
 	nfc_modulation nm = {NMT_ISO14443B, NBR_106};
 	const st_data * stcurrent;
 	int opt, res;
 	bool bIsBlock = false, bIsRead = false, bIsWrite = false, bIsBadCli = false;
+	int t;
 	uint8_t i, blockNumber = 0, data[ST25TB_SR_BLOCK_MAX_SIZE] = {0xff, 0xff, 0xff, 0xff}; // just in case...
 	size_t cbData = 0;
 	
@@ -209,35 +211,52 @@ int main(int argc, char *argv[])
 					if(res == 0) // we don't really wanted a NMT_ISO14443B
 					{
 						nm.nmt = NMT_ISO14443B2SR; // we want a NMT_ISO14443B2SR, but needed to ask for NMT_ISO14443B before
-						if (nfc_initiator_select_passive_target(pnd, nm, NULL, 0, &nt) > 0)
+						// all the tags of a stack are inventoried at once, then selected in turn with their UID
+						res = nfc_initiator_list_passive_targets(pnd, nm, ant, ST25TB_SR_MAX_TARGETS);
+						if(res > 1)
 						{
-							stcurrent = get_info(&nt, true);
-							if(stcurrent)
+							printf("Tags    : %i\n", res);
+						}
+						for(t = 0; t < res; t++)
+						{
+							if(t)
 							{
 								printf("\n");
-
-								if(bIsBlock && (bIsRead || bIsWrite))
+							}
+							if (nfc_initiator_select_passive_target(pnd, nm, ant[t].nti.nsi.abtUID, sizeof(ant[t].nti.nsi.abtUID), &nt) > 0)
+							{
+								stcurrent = get_info(&nt, true);
+								if(stcurrent)
 								{
-									if(bIsRead)
-									{
-										get_block_at(pnd, blockNumber, NULL, 0, true);
-									}
-									
-									if(bIsWrite)
+									printf("\n");
+
+									if(bIsBlock && (bIsRead || bIsWrite))
 									{
-										set_block_at_confirmed(pnd, blockNumber, data, cbData, true);
+										if(bIsRead)
+										{
+											get_block_at(pnd, blockNumber, NULL, 0, true);
+										}
+										
+										if(bIsWrite)
+										{
+											set_block_at_confirmed(pnd, blockNumber, data, cbData, true);
+										}
 									}
-								}
-								else if(!bIsRead && !bIsWrite && !bIsBlock)
-								{
-									for(i = 0; i < stcurrent->nbNormalBlock; i++)
+									else if(!bIsRead && !bIsWrite && !bIsBlock)
 									{
-										get_block_at(pnd, i, NULL, 0, true);
+										for(i = 0; i < stcurrent->nbNormalBlock; i++)
+										{
+											get_block_at(pnd, i, NULL, 0, true);
+										}
+										display_system_info(pnd, stcurrent);
 									}
-									display_system_info(pnd, stcurrent);
 								}
 							}
 						}
+						if(res < 0)
+						{
+							printf("ERROR - nfc_initiator_list_passive_targets: %i\n", res);
+						}
 					}
 					else if(res > 0)
 					{
@@ -279,6 +298,7 @@ int main(int argc, char *argv[])
 			"        Read, then write block 0x0c (12) of the tag with hexadecimal value '01 23 ab cd'\n"
 			"Warnings:\n"
 			"  Be careful with: system area, counters & otp, bytes order.\n"
+			"  All the tags in the field (up to 16) are processed in turn, writes included.\n"
 		, argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
 	}
 	
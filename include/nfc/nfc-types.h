@@ -353,6 +353,66 @@ typedef struct {
   nfc_modulation nm;
 } nfc_target;
 
+/**
+ * NFC event loop
+ */
+typedef struct nfc_loop nfc_loop;
+
+/**
+ * @enum nfc_loop_op
+ * @brief Operation submitted to an event loop
+ */
+typedef enum {
+  /** nfc_loop_initiator_select_passive_target() */
+  NLO_INITIATOR_SELECT_PASSIVE_TARGET,
+  /** nfc_loop_initiator_transceive_bytes() */
+  NLO_INITIATOR_TRANSCEIVE_BYTES,
+  /** nfc_loop_target_receive_bytes() */
+  NLO_TARGET_RECEIVE_BYTES,
+} nfc_loop_op;
+
+/**
+ * @struct nfc_loop_completion
+ * @brief Operation completed by an event loop
+ */
+typedef struct {
+  /** Device the operation was submitted to */
+  nfc_device *pnd;
+  /** Completed operation */
+  nfc_loop_op op;
+  /** Result, as returned by the blocking counterpart of the operation */
+  int res;
+  /** Pointer given when the operation was submitted */
+  void *user_data;
+} nfc_loop_completion;
+
+/**
+ * @brief Completion callback of an asynchronous operation
+ *
+ * \a res is the result the blocking counterpart of the operation would have
+ * returned, or NFC_EOPABORTED if it was cancelled.
+ */
+typedef void (*nfc_async_callback)(nfc_device *pnd, int res, void *user_data);
+
+/**
+ * @struct nfc_poll_stats
+ * @brief Polling statistics of a modulation, see nfc_initiator_poll_stats()
+ */
+typedef struct {
+  /** Polled modulation */
+  nfc_modulation nm;
+  /** Number of attempts to find a target with this modulation */
+  uint32_t uiAttempts;
+  /** Number of these attempts which found a target */
+  uint32_t uiHits;
+  /** Recent hit rate, in 1/65536, polling order follows it */
+  uint32_t uiHitRate;
+  /** Duration of the last attempt, in microseconds */
+  uint32_t uiLastLatency;
+  /** Moving average of the attempts duration, in microseconds */
+  uint32_t uiMeanLatency;
+} nfc_poll_stats;
+
 // Reset struct alignment to default
 #  pragma pack()
 
@@ -94,14 +94,18 @@ NFC_EXPORT int nfc_idle(nfc_device *pnd);
 
 /* NFC initiator: act as "reader" */
 NFC_EXPORT int nfc_initiator_init(nfc_device *pnd);
+NFC_EXPORT int nfc_initiator_reset(nfc_device *pnd);
 NFC_EXPORT int nfc_initiator_init_secure_element(nfc_device *pnd);
 NFC_EXPORT int nfc_initiator_select_passive_target(nfc_device *pnd, const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target *pnt);
 NFC_EXPORT int nfc_initiator_list_passive_targets(nfc_device *pnd, const nfc_modulation nm, nfc_target ant[], const size_t szTargets);
+NFC_EXPORT int nfc_initiator_inventory(nfc_device *pnd, const nfc_modulation nm, nfc_target ant[], const size_t szTargets, size_t *pszRoundTrips);
 NFC_EXPORT int nfc_initiator_poll_target(nfc_device *pnd, const nfc_modulation *pnmTargetTypes, const size_t szTargetTypes, const uint8_t uiPollNr, const uint8_t uiPeriod, nfc_target *pnt);
+NFC_EXPORT int nfc_initiator_poll_stats(nfc_device *pnd, nfc_poll_stats stats[], const size_t szStats);
 NFC_EXPORT int nfc_initiator_select_dep_target(nfc_device *pnd, const nfc_dep_mode ndm, const nfc_baud_rate nbr, const nfc_dep_info *pndiInitiator, nfc_target *pnt, const int timeout);
 NFC_EXPORT int nfc_initiator_poll_dep_target(nfc_device *pnd, const nfc_dep_mode ndm, const nfc_baud_rate nbr, const nfc_dep_info *pndiInitiator, nfc_target *pnt, const int timeout);
 NFC_EXPORT int nfc_initiator_deselect_target(nfc_device *pnd);
 NFC_EXPORT int nfc_initiator_transceive_bytes(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx, int timeout);
+NFC_EXPORT int nfc_initiator_transceive_bytes_async(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx, int timeout, nfc_async_callback cb, void *user_data);
 NFC_EXPORT int nfc_initiator_transceive_bits(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar, uint8_t *pbtRx, const size_t szRx, uint8_t *pbtRxPar);
 NFC_EXPORT int nfc_initiator_transceive_bytes_timed(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx, uint32_t *cycles);
 NFC_EXPORT int nfc_initiator_transceive_bits_timed(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar, uint8_t *pbtRx, const size_t szRx, uint8_t *pbtRxPar, uint32_t *cycles);
@@ -111,9 +115,24 @@ NFC_EXPORT int nfc_initiator_target_is_present(nfc_device *pnd, const nfc_target
 NFC_EXPORT int nfc_target_init(nfc_device *pnd, nfc_target *pnt, uint8_t *pbtRx, const size_t szRx, int timeout);
 NFC_EXPORT int nfc_target_send_bytes(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, int timeout);
 NFC_EXPORT int nfc_target_receive_bytes(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int timeout);
+NFC_EXPORT int nfc_target_receive_bytes_async(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int timeout, nfc_async_callback cb, void *user_data);
 NFC_EXPORT int nfc_target_send_bits(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar);
 NFC_EXPORT int nfc_target_receive_bits(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, uint8_t *pbtRxPar);
 
+/* Asynchronous operations and event loop: drive many devices from a single thread */
+NFC_EXPORT int nfc_device_process_async(nfc_device *pnd, int timeout);
+NFC_EXPORT int nfc_device_cancel_async(nfc_device *pnd);
+NFC_EXPORT nfc_loop *nfc_loop_new(nfc_context *context) ATTRIBUTE_NONNULL(1);
+NFC_EXPORT void nfc_loop_free(nfc_loop *loop);
+NFC_EXPORT int nfc_loop_get_fd(const nfc_loop *loop);
+NFC_EXPORT int nfc_loop_add_device(nfc_loop *loop, nfc_device *pnd);
+NFC_EXPORT int nfc_loop_remove_device(nfc_loop *loop, nfc_device *pnd);
+NFC_EXPORT int nfc_loop_initiator_select_passive_target(nfc_loop *loop, nfc_device *pnd, const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target *pnt, int timeout, void *user_data);
+NFC_EXPORT int nfc_loop_initiator_transceive_bytes(nfc_loop *loop, nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx, int timeout, void *user_data);
+NFC_EXPORT int nfc_loop_target_receive_bytes(nfc_loop *loop, nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int timeout, void *user_data);
+NFC_EXPORT int nfc_loop_run(nfc_loop *loop, nfc_loop_completion completions[], const size_t szCompletions, int timeout);
+NFC_EXPORT int nfc_device_get_pollfd(nfc_device *pnd);
+
 /* Error reporting */
 NFC_EXPORT const char *nfc_strerror(const nfc_device *pnd);
 NFC_EXPORT int nfc_strerror_r(const nfc_device *pnd, char *buf, size_t buflen);
@@ -130,12 +149,20 @@ NFC_EXPORT int nfc_device_get_supported_baud_rate_target_mode(nfc_device *pnd, c
 /* Properties accessors */
 NFC_EXPORT int nfc_device_set_property_int(nfc_device *pnd, const nfc_property property, const int value);
 NFC_EXPORT int nfc_device_set_property_bool(nfc_device *pnd, const nfc_property property, const bool bEnable);
+NFC_EXPORT int nfc_device_begin_properties(nfc_device *pnd);
+NFC_EXPORT int nfc_device_commit_properties(nfc_device *pnd);
 
 /* Misc. functions */
 NFC_EXPORT void iso14443a_crc(uint8_t *pbtData, size_t szLen, uint8_t *pbtCrc);
 NFC_EXPORT void iso14443a_crc_append(uint8_t *pbtData, size_t szLen);
 NFC_EXPORT void iso14443b_crc(uint8_t *pbtData, size_t szLen, uint8_t *pbtCrc);
 NFC_EXPORT void iso14443b_crc_append(uint8_t *pbtData, size_t szLen);
+NFC_EXPORT uint16_t iso14443a_crc_init(void);
+NFC_EXPORT uint16_t iso14443a_crc_update(uint16_t ui16Crc, const uint8_t *pbtData, size_t szLen);
+NFC_EXPORT void iso14443a_crc_final(uint16_t ui16Crc, uint8_t *pbtCrc);
+NFC_EXPORT uint16_t iso14443b_crc_init(void);
+NFC_EXPORT uint16_t iso14443b_crc_update(uint16_t ui16Crc, const uint8_t *pbtData, size_t szLen);
+NFC_EXPORT void iso14443b_crc_final(uint16_t ui16Crc, uint8_t *pbtCrc);
 NFC_EXPORT uint8_t *iso14443a_locate_historical_bytes(uint8_t *pbtAts, size_t szAts, size_t *pszTk);
 
 NFC_EXPORT void nfc_free(void *p);
@@ -0,0 +1,155 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file gpio.c
+ * @brief GPIO interrupt line, through the Linux GPIO character device
+ *
+ * The line is requested for falling edge events: PN53x chips pull their
+ * active-low IRQ pin down when a frame is ready for the host.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "gpio.h"
+
+#include <sys/ioctl.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/gpio.h>
+
+#include <nfc/nfc.h>
+#include "nfc-internal.h"
+
+#define LOG_GROUP    NFC_LOG_GROUP_COM
+#define LOG_CATEGORY "libnfc.bus.gpio"
+
+struct gpio_irq_unix {
+  int fd;                       // Line event file descriptor
+};
+
+#define GPIO_DATA( X ) ((struct gpio_irq_unix *) X)
+
+/**
+ * @brief Request line \a uiLine of GPIO chip \a pcChipName ("gpiochip0" or "/dev/gpiochip0") as interrupt input
+ *
+ * @return the line, or INVALID_GPIO_IRQ on failure
+ */
+gpio_irq
+gpio_irq_open(const char *pcChipName, const uint32_t uiLine)
+{
+  char acPath[64];
+  snprintf(acPath, sizeof(acPath), "%s%s", strchr(pcChipName, '/') ? "" : "/dev/", pcChipName);
+
+  int iChip = open(acPath, O_RDONLY);
+  if (iChip < 0) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to open %s: %s", acPath, strerror(errno));
+    return INVALID_GPIO_IRQ;
+  }
+
+  struct gpioevent_request req;
+  memset(&req, 0, sizeof(req));
+  req.lineoffset = uiLine;
+  req.handleflags = GPIOHANDLE_REQUEST_INPUT;
+  req.eventflags = GPIOEVENT_REQUEST_FALLING_EDGE;
+  snprintf(req.consumer_label, sizeof(req.consumer_label), "libnfc");
+  int res = ioctl(iChip, GPIO_GET_LINEEVENT_IOCTL, &req);
+  close(iChip);
+  if (res < 0) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to request line %u of %s: %s", uiLine, acPath, strerror(errno));
+    return INVALID_GPIO_IRQ;
+  }
+
+  struct gpio_irq_unix *irq = malloc(sizeof(struct gpio_irq_unix));
+  if (!irq) {
+    perror("malloc");
+    close(req.fd);
+    return INVALID_GPIO_IRQ;
+  }
+  irq->fd = req.fd;
+  fcntl(irq->fd, F_SETFL, fcntl(irq->fd, F_GETFL) | O_NONBLOCK);
+  log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Using line %u of %s as IRQ", uiLine, acPath);
+  return irq;
+}
+
+void
+gpio_irq_close(const gpio_irq irq)
+{
+  close(GPIO_DATA(irq)->fd);
+  free(irq);
+}
+
+/**
+ * @brief Wait up to \a timeout ms (forever if negative) for the line to be asserted (low)
+ *
+ * @return 0 when the line is asserted or went down, NFC_ETIMEOUT or NFC_EIO otherwise
+ */
+int
+gpio_irq_wait(gpio_irq irq, int timeout)
+{
+  struct gpioevent_data event;
+  struct gpiohandle_data data;
+
+  // Forget edges already seen, the level tells whether the line is still asserted
+  while (read(GPIO_DATA(irq)->fd, &event, sizeof(event)) == sizeof(event))
+    ;
+  if (ioctl(GPIO_DATA(irq)->fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to read IRQ line: %s", strerror(errno));
+    return NFC_EIO;
+  }
+  if (data.values[0] == 0)
+    return NFC_SUCCESS;
+
+  struct pollfd pfd = { .fd = GPIO_DATA(irq)->fd, .events = POLLIN };
+  int res = poll(&pfd, 1, timeout);
+  if (res < 0) {
+    if (errno == EINTR)
+      return NFC_ETIMEOUT;
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to wait for IRQ: %s", strerror(errno));
+    return NFC_EIO;
+  }
+  if (res == 0)
+    return NFC_ETIMEOUT;
+  return NFC_SUCCESS;
+}
+
+/**
+ * @brief File descriptor which becomes readable on each falling edge of the line
+ */
+int
+gpio_irq_get_fd(gpio_irq irq)
+{
+  return GPIO_DATA(irq)->fd;
+}
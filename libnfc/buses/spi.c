@@ -54,6 +54,7 @@
 
 #include <nfc/nfc.h>
 #include "nfc-internal.h"
+#include "mirror-subr.h"
 
 #define LOG_GROUP    NFC_LOG_GROUP_COM
 #define LOG_CATEGORY "libnfc.bus.spi"
@@ -71,8 +72,8 @@ const char *spi_ports_device_radix[] = { "spidev", NULL };
 
 struct spi_port_unix {
   int 			fd; 			// Serial port file descriptor
-  //~ struct termios 	termios_backup; 	// Terminal info before using the port
-  //~ struct termios 	termios_new; 		// Terminal info during the transaction
+  bool			half_duplex;		// Controller refused a full-duplex transfer
+  uint8_t		abtScratch[SPI_SCRATCH_LEN];	// Bit-reversed TX data, avoids a malloc() per transfer
 };
 
 #define SPI_DATA( X ) ((struct spi_port_unix *) X)
@@ -86,6 +87,7 @@ spi_open(const char *pcPortName)
   if (sp == 0)
     return INVALID_SPI_PORT;
 
+  sp->half_duplex = false;
   sp->fd = open(pcPortName, O_RDWR | O_NOCTTY | O_NONBLOCK);
   if (sp->fd == -1) {
     spi_close(sp);
@@ -143,26 +145,26 @@ spi_close(const spi_port sp)
 }
 
 
-/**
- * @brief Perform bit reversal on one byte \a x
- *
- * @return reversed byte
+/*
+ * Returns the buffer to put on the wire: pbtTx itself, or its bit-reversed
+ * copy in the port scratch buffer (allocated only for oversized transfers).
  */
-
-static uint8_t
-bit_reversal(const uint8_t x)
+static const uint8_t *
+spi_tx_buffer(spi_port sp, const uint8_t *pbtTx, const size_t szTx, bool lsb_first, uint8_t **ppbtAlloc)
 {
-  uint8_t ret = x;
-  ret = (((ret & 0xaa) >> 1) | ((ret & 0x55) << 1));
-  ret = (((ret & 0xcc) >> 2) | ((ret & 0x33) << 2));
-  ret = (((ret & 0xf0) >> 4) | ((ret & 0x0f) << 4));
-  return ret;
+  *ppbtAlloc = NULL;
+  if (!lsb_first)
+    return pbtTx;
+
+  uint8_t *pbtLSB = SPI_DATA(sp)->abtScratch;
+  if (szTx > sizeof(SPI_DATA(sp)->abtScratch)) {
+    if (!(pbtLSB = *ppbtAlloc = malloc(szTx)))
+      return NULL;
+  }
+  mirror_bytes(pbtLSB, pbtTx, szTx);
+  return pbtLSB;
 }
 
-
-
-
-
 /**
  * @brief Send \a pbtTx content to SPI then receive data from SPI and copy data to \a pbtRx. CS line stays active	 between transfers as well as during transfers.
  *
@@ -173,24 +175,12 @@ spi_send_receive(spi_port sp, const uint8_t *pbtTx, const size_t szTx, uint8_t *
 {
   size_t transfers = 0;
   struct spi_ioc_transfer tr[2];
-
-
-  uint8_t *pbtTxLSB = 0;
+  uint8_t *pbtAlloc = NULL;
 
   if (szTx) {
     LOG_HEX(LOG_GROUP, "TX", pbtTx, szTx);
-    if (lsb_first) {
-      pbtTxLSB = malloc(szTx * sizeof(uint8_t));
-      if (!pbtTxLSB) {
-        return NFC_ESOFT;
-      }
-
-      size_t i;
-      for (i = 0; i < szTx; ++i) {
-        pbtTxLSB[i] = bit_reversal(pbtTx[i]);
-      }
-
-      pbtTx = pbtTxLSB;
+    if (!(pbtTx = spi_tx_buffer(sp, pbtTx, szTx, lsb_first, &pbtAlloc))) {
+      return NFC_ESOFT;
     }
 
     struct spi_ioc_transfer tr_send = {
@@ -219,13 +209,9 @@ spi_send_receive(spi_port sp, const uint8_t *pbtTx, const size_t szTx, uint8_t *
     ++transfers;
   }
 
-
-
   if (transfers) {
     int ret = ioctl(SPI_DATA(sp)->fd, SPI_IOC_MESSAGE(transfers), tr);
-    if (szTx && lsb_first) {
-      free(pbtTxLSB);
-    }
+    free(pbtAlloc);
 
     if (ret != (int)(szRx + szTx)) {
       return NFC_EIO;
@@ -234,10 +220,7 @@ spi_send_receive(spi_port sp, const uint8_t *pbtTx, const size_t szTx, uint8_t *
     // Reverse received bytes if needed
     if (szRx) {
       if (lsb_first) {
-        size_t i;
-        for (i = 0; i < szRx; ++i) {
-          pbtRx[i] = bit_reversal(pbtRx[i]);
-        }
+        mirror_bytes(pbtRx, pbtRx, szRx);
       }
 
       LOG_HEX(LOG_GROUP, "RX", pbtRx, szRx);
@@ -248,6 +231,57 @@ spi_send_receive(spi_port sp, const uint8_t *pbtTx, const size_t szTx, uint8_t *
   return NFC_SUCCESS;
 }
 
+/**
+ * @brief Full-duplex transfer: clock out \a pbtTx while \a szLen bytes are clocked in to \a pbtRx
+ *
+ * Both buffers are \a szLen bytes long and go in a single SPI message.
+ *
+ * @return 0 on success, NFC_EDEVNOTSUPP when the controller only does
+ * half-duplex transfers (then spi_send_receive() has to be used), otherwise a
+ * driver error
+ */
+int
+spi_transfer(spi_port sp, const uint8_t *pbtTx, uint8_t *pbtRx, const size_t szLen, bool lsb_first)
+{
+  uint8_t *pbtAlloc = NULL;
+
+  if (SPI_DATA(sp)->half_duplex)
+    return NFC_EDEVNOTSUPP;
+  if (!szLen)
+    return NFC_SUCCESS;
+
+  LOG_HEX(LOG_GROUP, "TX", pbtTx, szLen);
+  if (!(pbtTx = spi_tx_buffer(sp, pbtTx, szLen, lsb_first, &pbtAlloc))) {
+    return NFC_ESOFT;
+  }
+
+  struct spi_ioc_transfer tr = {
+    .tx_buf = (unsigned long) pbtTx,
+    .rx_buf = (unsigned long) pbtRx,
+    .len = szLen,
+    .delay_usecs = 0,
+    .speed_hz = 0,
+    .bits_per_word = 0,
+  };
+  int ret = ioctl(SPI_DATA(sp)->fd, SPI_IOC_MESSAGE(1), &tr);
+  free(pbtAlloc);
+
+  if ((ret < 0) && (errno == EINVAL)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s", "SPI controller does not support full-duplex transfers.");
+    SPI_DATA(sp)->half_duplex = true;
+    return NFC_EDEVNOTSUPP;
+  }
+  if (ret != (int)szLen) {
+    return NFC_EIO;
+  }
+
+  if (lsb_first) {
+    mirror_bytes(pbtRx, pbtRx, szLen);
+  }
+  LOG_HEX(LOG_GROUP, "RX", pbtRx, szLen);
+  return NFC_SUCCESS;
+}
+
 
 /**
  * @brief Receive data from SPI and copy data to \a pbtRx
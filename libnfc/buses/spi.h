@@ -49,6 +49,9 @@ typedef void *spi_port;
 #  define INVALID_SPI_PORT (void*)(~1)
 #  define CLAIMED_SPI_PORT (void*)(~2)
 
+// Largest bit-reversed transfer done without allocation: a PN532 extended frame and its SPI command byte
+#  define SPI_SCRATCH_LEN 280
+
 spi_port spi_open(const char *pcPortName);
 void    spi_close(const spi_port sp);
 
@@ -59,6 +62,7 @@ uint32_t spi_get_speed(const spi_port sp);
 int     spi_receive(spi_port sp, uint8_t *pbtRx, const size_t szRx, bool lsb_first);
 int     spi_send(spi_port sp, const uint8_t *pbtTx, const size_t szTx, bool lsb_first);
 int     spi_send_receive(spi_port sp, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx, bool lsb_first);
+int     spi_transfer(spi_port sp, const uint8_t *pbtTx, uint8_t *pbtRx, const size_t szLen, bool lsb_first);
 
 char  **spi_list_ports(void);
 
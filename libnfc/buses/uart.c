@@ -45,6 +45,7 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <stdio.h>
 #include <termios.h>
@@ -99,6 +100,9 @@ struct serial_port_unix {
   int 			fd; 			// Serial port file descriptor
   struct termios 	termios_backup; 	// Terminal info before using the port
   struct termios 	termios_new; 		// Terminal info during the transaction
+  size_t		szRxHead;		// First unconsumed byte in abtRx
+  size_t		szRxTail;		// End of the received bytes in abtRx
+  uint8_t		abtRx[UART_RX_BUFFER_LEN];	// Bytes read from fd but not consumed yet
 };
 
 #define UART_DATA( X ) ((struct serial_port_unix *) X)
@@ -113,6 +117,7 @@ uart_open(const char *pcPortName)
   if (sp == 0)
     return INVALID_SERIAL_PORT;
 
+  sp->szRxHead = sp->szRxTail = 0;
   sp->fd = open(pcPortName, O_RDWR | O_NOCTTY | O_NONBLOCK);
   if (sp->fd == -1) {
     uart_close_ext(sp, false);
@@ -157,6 +162,11 @@ uart_flush_input(serial_port sp, bool wait)
     msleep(50); // 50 ms
   }
 
+  if (UART_DATA(sp)->szRxTail > UART_DATA(sp)->szRxHead) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%" PRIuPTR " buffered bytes have eaten.", UART_DATA(sp)->szRxTail - UART_DATA(sp)->szRxHead);
+  }
+  UART_DATA(sp)->szRxHead = UART_DATA(sp)->szRxTail = 0;
+
   // This line seems to produce absolutely no effect on my system (GNU/Linux 2.6.35)
   tcflush(UART_DATA(sp)->fd, TCIFLUSH);
   // So, I wrote this byte-eater
@@ -293,25 +303,44 @@ uart_close(const serial_port sp)
   uart_close_ext(sp, true);
 }
 
+// Keep the unconsumed bytes contiguous and at the front of the buffer
+static void
+uart_compact(struct serial_port_unix *spu)
+{
+  if (spu->szRxHead) {
+    memmove(spu->abtRx, spu->abtRx + spu->szRxHead, spu->szRxTail - spu->szRxHead);
+    spu->szRxTail -= spu->szRxHead;
+    spu->szRxHead = 0;
+  }
+}
+
 /**
- * @brief Receive data from UART and copy data to \a pbtRx
+ * @brief Wait for the port to become readable and append whatever it holds to the receive buffer
+ *
+ * One select(2) and one read(2) of as many bytes as the buffer can take, so a
+ * reply that arrives in a single burst (e.g. a PN53x ACK and its response
+ * frame) costs a single system call whatever the caller asks for next.
  *
  * @return 0 on success, otherwise driver error code
  */
-int
-uart_receive(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout)
+static int
+uart_fill(serial_port sp, int iAbortFd, int timeout)
 {
-  int iAbortFd = abort_p ? *((int *)abort_p) : 0;
-  int received_bytes_count = 0;
-  int available_bytes_count = 0;
-  const int expected_bytes_count = (int)szRx;
+  struct serial_port_unix *spu = UART_DATA(sp);
   int res;
   fd_set rfds;
+
+  uart_compact(spu);
+  if (spu->szRxTail == sizeof(spu->abtRx)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Receive buffer overflow");
+    return NFC_EIO;
+  }
+
   do {
 select:
     // Reset file descriptor
     FD_ZERO(&rfds);
-    FD_SET(UART_DATA(sp)->fd, &rfds);
+    FD_SET(spu->fd, &rfds);
 
     if (iAbortFd) {
       FD_SET(iAbortFd, &rfds);
@@ -323,7 +352,7 @@ select:
       timeout_tv.tv_usec = ((timeout % 1000) * 1000);
     }
 
-    res = select(MAX(UART_DATA(sp)->fd, iAbortFd) + 1, &rfds, NULL, NULL, timeout ? &timeout_tv : NULL);
+    res = select(MAX(spu->fd, iAbortFd) + 1, &rfds, NULL, NULL, timeout ? &timeout_tv : NULL);
 
     if ((res < 0) && (EINTR == errno)) {
       // The system call was interupted by a signal and a signal handler was
@@ -349,20 +378,120 @@ select:
       return NFC_EOPABORTED;
     }
 
-    // Retrieve the count of the incoming bytes
-    res = ioctl(UART_DATA(sp)->fd, FIONREAD, &available_bytes_count);
-    if (res != 0) {
-      return NFC_EIO;
+    // There is something available, read as much of it as fits: the port is
+    // non-blocking so no FIONREAD is needed to size the read
+    res = read(spu->fd, spu->abtRx + spu->szRxTail, sizeof(spu->abtRx) - spu->szRxTail);
+    if (res > 0) {
+      spu->szRxTail += res;
+      return NFC_SUCCESS;
     }
-    // There is something available, read the data
-    res = read(UART_DATA(sp)->fd, pbtRx + received_bytes_count, MIN(available_bytes_count, (expected_bytes_count - received_bytes_count)));
     // Stop if the OS has some troubles reading the data
-    if (res <= 0) {
+    if ((res == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))) {
       return NFC_EIO;
     }
-    received_bytes_count += res;
+  } while (true);
+}
 
-  } while (expected_bytes_count > received_bytes_count);
+/**
+ * @brief Wait until at least \a szMin bytes are buffered and expose them without consuming them
+ *
+ * \a ppbtRx is pointed at the buffered bytes, which stay valid until the next
+ * call on \a sp. Use uart_skip() to consume them.
+ *
+ * @return the number of buffered bytes (>= \a szMin) on success, otherwise driver error code
+ */
+int
+uart_peek(serial_port sp, const uint8_t **ppbtRx, const size_t szMin, void *abort_p, int timeout)
+{
+  struct serial_port_unix *spu = UART_DATA(sp);
+  int iAbortFd = abort_p ? *((int *)abort_p) : 0;
+  int res;
+
+  if (szMin > sizeof(spu->abtRx))
+    return NFC_EINVARG;
+
+  while (spu->szRxTail - spu->szRxHead < szMin) {
+    if ((res = uart_fill(sp, iAbortFd, timeout)) < 0)
+      return res;
+  }
+  *ppbtRx = spu->abtRx + spu->szRxHead;
+  return (int)(spu->szRxTail - spu->szRxHead);
+}
+
+/**
+ * @brief Append whatever the port holds to the receive buffer, without waiting, and expose the buffered bytes
+ *
+ * @return the number of buffered bytes, otherwise driver error code
+ */
+int
+uart_poll(serial_port sp, const uint8_t **ppbtRx)
+{
+  struct serial_port_unix *spu = UART_DATA(sp);
+
+  uart_compact(spu);
+  if (spu->szRxTail < sizeof(spu->abtRx)) {
+    ssize_t res = read(spu->fd, spu->abtRx + spu->szRxTail, sizeof(spu->abtRx) - spu->szRxTail);
+    if (res > 0) {
+      spu->szRxTail += res;
+    } else if ((res < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Error: %s", strerror(errno));
+      return NFC_EIO;
+    }
+  }
+  *ppbtRx = spu->abtRx + spu->szRxHead;
+  return (int)(spu->szRxTail - spu->szRxHead);
+}
+
+/**
+ * @brief File descriptor which becomes readable when bytes arrive on the port
+ */
+int
+uart_get_fd(serial_port sp)
+{
+  return UART_DATA(sp)->fd;
+}
+
+/**
+ * @brief Consume \a szSkip bytes previously exposed by uart_peek()
+ */
+void
+uart_skip(serial_port sp, const size_t szSkip)
+{
+  struct serial_port_unix *spu = UART_DATA(sp);
+
+  LOG_HEX(LOG_GROUP, "RX", spu->abtRx + spu->szRxHead, MIN(szSkip, spu->szRxTail - spu->szRxHead));
+  spu->szRxHead += MIN(szSkip, spu->szRxTail - spu->szRxHead);
+  if (spu->szRxHead == spu->szRxTail)
+    spu->szRxHead = spu->szRxTail = 0;
+}
+
+/**
+ * @brief Receive data from UART and copy data to \a pbtRx
+ *
+ * Bytes already buffered by a previous call are served first.
+ *
+ * @return 0 on success, otherwise driver error code
+ */
+int
+uart_receive(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout)
+{
+  struct serial_port_unix *spu = UART_DATA(sp);
+  int iAbortFd = abort_p ? *((int *)abort_p) : 0;
+  size_t received_bytes_count = 0;
+  int res;
+
+  do {
+    size_t sz = MIN(spu->szRxTail - spu->szRxHead, szRx - received_bytes_count);
+    memcpy(pbtRx + received_bytes_count, spu->abtRx + spu->szRxHead, sz);
+    spu->szRxHead += sz;
+    received_bytes_count += sz;
+    if (spu->szRxHead == spu->szRxTail)
+      spu->szRxHead = spu->szRxTail = 0;
+    if (received_bytes_count == szRx)
+      break;
+    if ((res = uart_fill(sp, iAbortFd, timeout)) < 0)
+      return res;
+  } while (true);
   LOG_HEX(LOG_GROUP, "RX", pbtRx, szRx);
   return NFC_SUCCESS;
 }
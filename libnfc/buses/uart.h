@@ -49,6 +49,9 @@ typedef void *serial_port;
 #  define INVALID_SERIAL_PORT (void*)(~1)
 #  define CLAIMED_SERIAL_PORT (void*)(~2)
 
+// Receive buffer size: room for an ACK and the largest extended PN53x frame, twice
+#  define UART_RX_BUFFER_LEN 1024
+
 serial_port uart_open(const char *pcPortName);
 void    uart_close(const serial_port sp);
 void    uart_flush_input(const serial_port sp, bool wait);
@@ -57,6 +60,10 @@ void    uart_set_speed(serial_port sp, const uint32_t uiPortSpeed);
 uint32_t uart_get_speed(const serial_port sp);
 
 int     uart_receive(serial_port sp, uint8_t *pbtRx, const size_t szRx, void *abort_p, int timeout);
+int     uart_peek(serial_port sp, const uint8_t **ppbtRx, const size_t szMin, void *abort_p, int timeout);
+void    uart_skip(serial_port sp, const size_t szSkip);
+int     uart_poll(serial_port sp, const uint8_t **ppbtRx);
+int     uart_get_fd(serial_port sp);
 int     uart_send(serial_port sp, const uint8_t *pbtTx, const size_t szTx, int timeout);
 
 char  **uart_list_ports(void);
@@ -35,22 +35,218 @@
 #endif // HAVE_CONFIG_H
 
 #include <stdlib.h>
+#include <errno.h>
+
+#if defined(__linux__)
+#  include <dirent.h>
+#  include <fcntl.h>
+#  include <time.h>
+#  include <unistd.h>
+#  include <sys/socket.h>
+#  include <linux/netlink.h>
+#endif
 
 #include "usbbus.h"
 #include "log.h"
+#include "nfc-internal.h"
 #define LOG_CATEGORY "libnfc.buses.usbbus"
 #define LOG_GROUP    NFC_LOG_GROUP_DRIVER
 
-int usb_prepare(void)
+// libusb-0.1 keeps a single process-wide bus list, and refreshing it frees the
+// nodes of the previous one: initialize, refresh and walk it from one thread at
+// a time, see usb_busses_lock()
+static nfc_mutex usb_lock = NFC_MUTEX_INITIALIZER;
+static bool usb_initialized = false;
+
+/*
+ * Enumerating re-reads the descriptors of every device on the system, so the
+ * bus list is only refreshed when the kernel reports a USB uevent since the
+ * previous enumeration. Without uevents (non-Linux hosts, no netlink access),
+ * every usb_busses_lock() enumerates as before.
+ *
+ * The socket may also bind without ever receiving uevents, e.g. in a network
+ * namespace owned by a non-initial user namespace (rootless containers), so the
+ * names listed in /sys/bus/usb/devices are checked as well, or, without sysfs,
+ * the list is refreshed once it is USB_ENUMERATION_MAX_AGE_MS old.
+ */
+static bool usb_enumerated = false;
+#if defined(__linux__)
+#  define USB_SYSFS_DEVICES "/sys/bus/usb/devices"
+#  define USB_ENUMERATION_MAX_AGE_MS 5000
+static int usb_uevent_fd = -1;
+static bool usb_sysfs_available = false;
+static uint64_t usb_sysfs_signature = 0;
+static struct timespec usb_enumerated_at;
+#endif
+
+/*
+ * Devices a driver of this process has opened and not closed yet, keyed by bus,
+ * device number, VID and PID. No other process can claim them meanwhile, so
+ * scans list them without opening them again. Any other device is opened by
+ * each scan: a claim by another process raises no uevent.
+ */
+struct usb_claim {
+  struct usb_claim *next;
+  char *dirname;
+  char *filename;
+  uint16_t vendor_id;
+  uint16_t product_id;
+};
+static struct usb_claim *usb_claims = NULL;
+
+static void
+usb_uevent_open(void)
+{
+#if defined(__linux__)
+  struct sockaddr_nl snl;
+  memset(&snl, 0, sizeof(snl));
+  snl.nl_family = AF_NETLINK;
+  snl.nl_groups = 1; // kernel uevents
+
+  int fd = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_KOBJECT_UEVENT);
+  if (fd < 0) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "No uevent socket (%s), USB devices are enumerated on each scan", strerror(errno));
+    return;
+  }
+  if ((fcntl(fd, F_SETFL, O_NONBLOCK) < 0) || (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0) ||
+      (bind(fd, (struct sockaddr *) &snl, sizeof(snl)) < 0)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Unable to listen to uevents (%s), USB devices are enumerated on each scan", strerror(errno));
+    close(fd);
+    return;
+  }
+  usb_uevent_fd = fd;
+#endif
+}
+
+#if defined(__linux__)
+/*
+ * Order independent hash (FNV-1a of each name, summed) of the devices and
+ * interfaces listed by sysfs: any device plugged or unplugged changes it.
+ */
+static bool
+usb_sysfs_read_signature(uint64_t *psignature)
+{
+  DIR *dir = opendir(USB_SYSFS_DEVICES);
+  if (!dir)
+    return false;
+
+  uint64_t signature = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir))) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char *c = entry->d_name; *c; c++) {
+      hash ^= (uint8_t) *c;
+      hash *= 0x100000001b3ULL;
+    }
+    signature += hash;
+  }
+  closedir(dir);
+  *psignature = signature;
+  return true;
+}
+#endif
+
+/*
+ * Tell if USB devices may have come or gone since the last enumeration.
+ */
+static bool
+usb_topology_changed(void)
+{
+  if (!usb_enumerated)
+    return true;
+#if defined(__linux__)
+  if (usb_uevent_fd < 0)
+    return true;
+
+  bool changed = false;
+  char buffer[4096];
+  ssize_t len;
+  while ((len = recv(usb_uevent_fd, buffer, sizeof(buffer) - 1, 0)) > 0) {
+    // "action@devpath" followed by NUL separated KEY=value pairs
+    buffer[len] = '\0';
+    for (ssize_t off = 0; off < len; off += strlen(buffer + off) + 1) {
+      if (strcmp(buffer + off, "SUBSYSTEM=usb") == 0)
+        changed = true;
+    }
+  }
+  // ENOBUFS: we missed some events
+  if ((len < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
+    changed = true;
+
+  // In case uevents are not delivered
+  uint64_t signature;
+  if (usb_sysfs_available && usb_sysfs_read_signature(&signature)) {
+    if (signature != usb_sysfs_signature)
+      changed = true;
+  } else {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec - usb_enumerated_at.tv_sec) * 1000 + (now.tv_nsec - usb_enumerated_at.tv_nsec) / 1000000 >= USB_ENUMERATION_MAX_AGE_MS)
+      changed = true;
+  }
+  return changed;
+#else
+  return true;
+#endif
+}
+
+static struct usb_claim **
+usb_claim_find(const struct usb_device *dev)
+{
+  struct usb_claim **pclaim;
+  for (pclaim = &usb_claims; *pclaim; pclaim = &(*pclaim)->next) {
+    const struct usb_claim *claim = *pclaim;
+    if ((claim->vendor_id == dev->descriptor.idVendor) && (claim->product_id == dev->descriptor.idProduct) &&
+        (strcmp(claim->filename, dev->filename) == 0) && (strcmp(claim->dirname, dev->bus->dirname) == 0))
+      break;
+  }
+  return pclaim;
+}
+
+static void
+usb_claim_free(struct usb_claim *claim)
+{
+  free(claim->dirname);
+  free(claim->filename);
+  free(claim);
+}
+
+// Forget devices which left the bus while claimed
+static void
+usb_claims_prune(void)
+{
+  struct usb_claim **pclaim = &usb_claims;
+  while (*pclaim) {
+    struct usb_claim *claim = *pclaim;
+    bool present = false;
+    for (struct usb_bus *bus = usb_get_busses(); bus && !present; bus = bus->next) {
+      if (strcmp(claim->dirname, bus->dirname) != 0)
+        continue;
+      for (struct usb_device *dev = bus->devices; dev && !present; dev = dev->next) {
+        present = (strcmp(claim->filename, dev->filename) == 0) &&
+                  (claim->vendor_id == dev->descriptor.idVendor) && (claim->product_id == dev->descriptor.idProduct);
+      }
+    }
+    if (present) {
+      pclaim = &claim->next;
+    } else {
+      *pclaim = claim->next;
+      usb_claim_free(claim);
+    }
+  }
+}
+
+static int
+usb_prepare_locked(void)
 {
-  static bool usb_initialized = false;
   if (!usb_initialized) {
+    // Listen before the first enumeration so no change is missed
+    usb_uevent_open();
 
 #ifdef ENVVARS
-    char *env_log_level = getenv("LIBNFC_LOG_LEVEL");
     // Set libusb debug only if asked explicitely:
     // LIBUSB_LOG_LEVEL=12288 (= NFC_LOG_PRIORITY_DEBUG * 2 ^ NFC_LOG_GROUP_LIBUSB)
-    if (env_log_level && (((atoi(env_log_level) >> (NFC_LOG_GROUP_LIBUSB * 2)) & 0x00000003) >= NFC_LOG_PRIORITY_DEBUG)) {
+    if (((log_get_level() >> (NFC_LOG_GROUP_LIBUSB * 2)) & 0x00000003) >= NFC_LOG_PRIORITY_DEBUG) {
       setenv("USB_DEBUG", "255", 1);
     }
 #endif
@@ -59,6 +255,15 @@ int usb_prepare(void)
     usb_initialized = true;
   }
 
+  if (!usb_topology_changed())
+    return 0;
+
+#if defined(__linux__)
+  // Read before enumerating, so a change made meanwhile is seen next time
+  usb_sysfs_available = usb_sysfs_read_signature(&usb_sysfs_signature);
+  clock_gettime(CLOCK_MONOTONIC, &usb_enumerated_at);
+#endif
+
   int res;
   // usb_find_busses will find all of the busses on the system. Returns the
   // number of changes since previous call to this function (total of new
@@ -74,6 +279,54 @@ int usb_prepare(void)
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to find USB devices (%s)", _usb_strerror(res));
     return -1;
   }
+  usb_claims_prune();
+  usb_enumerated = true;
   return 0;
 }
 
+int usb_busses_lock(void)
+{
+  nfc_mutex_lock(&usb_lock);
+  return usb_prepare_locked();
+}
+
+void usb_busses_unlock(void)
+{
+  nfc_mutex_unlock(&usb_lock);
+}
+
+bool usb_probe_claimed(const struct usb_device *dev)
+{
+  return (*usb_claim_find(dev) != NULL);
+}
+
+void usb_probe_claim(const struct usb_device *dev)
+{
+  if (*usb_claim_find(dev) == NULL) {
+    struct usb_claim *claim = malloc(sizeof(struct usb_claim));
+    if (claim) {
+      claim->dirname = strdup(dev->bus->dirname);
+      claim->filename = strdup(dev->filename);
+      claim->vendor_id = dev->descriptor.idVendor;
+      claim->product_id = dev->descriptor.idProduct;
+      if (claim->dirname && claim->filename) {
+        claim->next = usb_claims;
+        usb_claims = claim;
+      } else {
+        usb_claim_free(claim);
+      }
+    }
+  }
+}
+
+void usb_probe_release(const struct usb_device *dev)
+{
+  nfc_mutex_lock(&usb_lock);
+  struct usb_claim **pclaim = usb_claim_find(dev);
+  struct usb_claim *claim = *pclaim;
+  if (claim) {
+    *pclaim = claim->next;
+    usb_claim_free(claim);
+  }
+  nfc_mutex_unlock(&usb_lock);
+}
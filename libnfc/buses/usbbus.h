@@ -49,6 +49,21 @@
 #include <stdbool.h>
 #include <string.h>
 
-int usb_prepare(void);
+/*
+ * Refresh libusb's bus list if needed and keep it locked until
+ * usb_busses_unlock(), even on error: another thread must not refresh it while
+ * usb_get_busses() is walked.
+ */
+int usb_busses_lock(void);
+void usb_busses_unlock(void);
+
+/*
+ * Track devices claimed by this process, from a successful open to close, so
+ * scans list them without opening them again. usb_probe_claimed() and
+ * usb_probe_claim() are called with the bus list locked.
+ */
+bool usb_probe_claimed(const struct usb_device *dev);
+void usb_probe_claim(const struct usb_device *dev);
+void usb_probe_release(const struct usb_device *dev);
 
 #endif // __NFC_BUS_USB_H__
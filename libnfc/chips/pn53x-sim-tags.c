@@ -0,0 +1,630 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn53x-sim-tags.c
+ * @brief Virtual tags for the PN53x software model
+ *
+ * Tags behave as seen through InDataExchange: MIFARE Classic authentication
+ * only checks the keys (no Crypto1), ISO/IEC 14443-4 and FeliCa tags expose
+ * their memory as a flat file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "pn53x-sim.h"
+
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "pn53x-internal.h"
+
+/*
+ * MIFARE Classic 1K
+ */
+
+#define MFC_BLOCKS 64
+
+static void
+mfc_init(struct pn53x_sim_tag *tag, const uint32_t serial)
+{
+  static const uint8_t abtTrailer[16] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x07, 0x80, 0x69, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+  };
+  nfc_iso14443a_info *nai = &tag->target.nti.nai;
+
+  nai->abtAtqa[0] = 0x00;
+  nai->abtAtqa[1] = 0x04;
+  nai->btSak = 0x08;
+  nai->szUidLen = 4;
+  nai->abtUid[0] = 0x5e;
+  nai->abtUid[1] = (uint8_t)(serial >> 16);
+  nai->abtUid[2] = (uint8_t)(serial >> 8);
+  nai->abtUid[3] = (uint8_t)serial;
+
+  tag->szMemory = MFC_BLOCKS * 16;
+  memset(tag->abtMemory, 0x00, tag->szMemory);
+  // Manufacturer block: UID, BCC, SAK, ATQA
+  memcpy(tag->abtMemory, nai->abtUid, 4);
+  tag->abtMemory[4] = nai->abtUid[0] ^ nai->abtUid[1] ^ nai->abtUid[2] ^ nai->abtUid[3];
+  tag->abtMemory[5] = nai->btSak;
+  tag->abtMemory[6] = nai->abtAtqa[1];
+  tag->abtMemory[7] = nai->abtAtqa[0];
+  // Transport configuration: default keys, key B readable
+  for (size_t sector = 0; sector < MFC_BLOCKS / 4; sector++) {
+    memcpy(tag->abtMemory + ((sector * 4 + 3) * 16), abtTrailer, sizeof(abtTrailer));
+  }
+}
+
+static int
+mfc_value_load(struct pn53x_sim_tag *tag, const uint8_t block)
+{
+  const uint8_t *pbtBlock = tag->abtMemory + (block * 16);
+  for (size_t n = 0; n < 4; n++) {
+    if (((pbtBlock[n] ^ pbtBlock[n + 4]) != 0xff) || (pbtBlock[n] != pbtBlock[n + 8]))
+      return -ERFPROTO;
+  }
+  memcpy(tag->abtValue, pbtBlock, 4);
+  return 0;
+}
+
+static int
+mfc_exchange(struct pn53x_sim_tag *tag, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen)
+{
+  if ((szTx < 2) || (pbtTx[1] >= MFC_BLOCKS))
+    return -ETIMEOUT;
+  const uint8_t block = pbtTx[1];
+  const int sector = block / 4;
+  uint8_t *pbtBlock = tag->abtMemory + (block * 16);
+
+  switch (pbtTx[0]) {
+    case 0x60: // AUTH A
+    case 0x61: { // AUTH B
+      if (szTx == 2) {
+        // Raw authentication: answer a tag nonce, the encrypted part is not modeled
+        memcpy(pbtRx, "\x01\x20\x01\x45", 4);
+        return 4;
+      }
+      const uint8_t *pbtKey = tag->abtMemory + ((sector * 4 + 3) * 16) + ((pbtTx[0] == 0x60) ? 0 : 10);
+      if ((szTx < 12) || (memcmp(pbtTx + 2, pbtKey, 6) != 0) || (memcmp(pbtTx + 8, tag->target.nti.nai.abtUid, 4) != 0)) {
+        tag->auth_sector = -1;
+        tag->state = SIM_TAG_HALT;
+        return -EMFAUTH;
+      }
+      tag->auth_sector = sector;
+      return 0;
+    }
+    case 0x30: // READ
+      if (tag->auth_sector != sector)
+        return -ERFPROTO;
+      if (szRxLen < 16)
+        return -EBUFOVF;
+      memcpy(pbtRx, pbtBlock, 16);
+      if ((block % 4) == 3)
+        memset(pbtRx, 0x00, 6); // Key A is never readable
+      return 16;
+    case 0xa0: // WRITE
+      if ((tag->auth_sector != sector) || (szTx < 18) || (block == 0))
+        return -ERFPROTO;
+      memcpy(pbtBlock, pbtTx + 2, 16);
+      return 0;
+    case 0xc0: // DECREMENT
+    case 0xc1: // INCREMENT
+    case 0xc2: { // RESTORE
+      if ((tag->auth_sector != sector) || (szTx < 6))
+        return -ERFPROTO;
+      int res;
+      if ((res = mfc_value_load(tag, block)) < 0)
+        return res;
+      int32_t value, operand;
+      memcpy(&value, tag->abtValue, 4);
+      memcpy(&operand, pbtTx + 2, 4);
+      if (pbtTx[0] == 0xc0)
+        value -= operand;
+      else if (pbtTx[0] == 0xc1)
+        value += operand;
+      memcpy(tag->abtValue, &value, 4);
+      return 0;
+    }
+    case 0xb0: // TRANSFER
+      if ((tag->auth_sector != sector) || (block == 0))
+        return -ERFPROTO;
+      for (size_t n = 0; n < 4; n++) {
+        pbtBlock[n] = pbtBlock[n + 8] = tag->abtValue[n];
+        pbtBlock[n + 4] = ~tag->abtValue[n];
+      }
+      return 0;
+    default:
+      return -ETIMEOUT;
+  }
+}
+
+const struct pn53x_sim_tag_ops pn53x_sim_mifare_classic_1k = {
+  .name     = "mfc1k",
+  .nmt      = NMT_ISO14443A,
+  .init     = mfc_init,
+  .reset    = NULL,
+  .exchange = mfc_exchange,
+};
+
+/*
+ * MIFARE Ultralight
+ */
+
+#define MFUL_PAGES 16
+
+static void
+iso14443a_double_uid(nfc_iso14443a_info *nai, const uint32_t serial)
+{
+  nai->szUidLen = 7;
+  nai->abtUid[0] = 0x04; // NXP
+  nai->abtUid[1] = 0x5e;
+  nai->abtUid[2] = 0x00;
+  nai->abtUid[3] = (uint8_t)(serial >> 24);
+  nai->abtUid[4] = (uint8_t)(serial >> 16);
+  nai->abtUid[5] = (uint8_t)(serial >> 8);
+  nai->abtUid[6] = (uint8_t)serial;
+}
+
+static void
+mful_init(struct pn53x_sim_tag *tag, const uint32_t serial)
+{
+  nfc_iso14443a_info *nai = &tag->target.nti.nai;
+  const uint8_t *uid = nai->abtUid;
+
+  nai->abtAtqa[0] = 0x00;
+  nai->abtAtqa[1] = 0x44;
+  nai->btSak = 0x00;
+  iso14443a_double_uid(nai, serial);
+
+  tag->szMemory = MFUL_PAGES * 4;
+  memset(tag->abtMemory, 0x00, tag->szMemory);
+  memcpy(tag->abtMemory, uid, 3);
+  tag->abtMemory[3] = 0x88 ^ uid[0] ^ uid[1] ^ uid[2];
+  memcpy(tag->abtMemory + 4, uid + 3, 4);
+  tag->abtMemory[8] = uid[3] ^ uid[4] ^ uid[5] ^ uid[6];
+  tag->abtMemory[9] = 0x48;
+}
+
+static int
+mful_exchange(struct pn53x_sim_tag *tag, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen)
+{
+  if ((szTx < 2) || (pbtTx[1] >= MFUL_PAGES))
+    return -ETIMEOUT;
+  const uint8_t page = pbtTx[1];
+  uint8_t *pbtPage = tag->abtMemory + (page * 4);
+
+  switch (pbtTx[0]) {
+    case 0x30: // READ, 4 pages rolling over
+      if (szRxLen < 16)
+        return -EBUFOVF;
+      for (size_t n = 0; n < 4; n++) {
+        memcpy(pbtRx + (n * 4), tag->abtMemory + (((page + n) % MFUL_PAGES) * 4), 4);
+      }
+      return 16;
+    case 0xa2: // WRITE
+    case 0xa0: // COMPATIBILITY WRITE, only the first 4 bytes are used
+      if ((page < 2) || (szTx < ((pbtTx[0] == 0xa2) ? 6 : 18)))
+        return -ERFPROTO;
+      if (page == 2) { // Lock bytes are OTP
+        pbtPage[2] |= pbtTx[4];
+        pbtPage[3] |= pbtTx[5];
+      } else if (page == 3) { // OTP
+        for (size_t n = 0; n < 4; n++)
+          pbtPage[n] |= pbtTx[2 + n];
+      } else {
+        memcpy(pbtPage, pbtTx + 2, 4);
+      }
+      return 0;
+    default:
+      return -ETIMEOUT;
+  }
+}
+
+const struct pn53x_sim_tag_ops pn53x_sim_mifare_ultralight = {
+  .name     = "mful",
+  .nmt      = NMT_ISO14443A,
+  .init     = mful_init,
+  .reset    = NULL,
+  .exchange = mful_exchange,
+};
+
+/*
+ * ISO/IEC 14443-4 type A, answering APDUs on a transparent file
+ */
+
+static void
+iso14443_4_init(struct pn53x_sim_tag *tag, const uint32_t serial)
+{
+  nfc_iso14443a_info *nai = &tag->target.nti.nai;
+
+  nai->abtAtqa[0] = 0x03;
+  nai->abtAtqa[1] = 0x44;
+  nai->btSak = 0x20;
+  iso14443a_double_uid(nai, serial);
+  // T0, TA, TB, TC then one historical byte
+  memcpy(nai->abtAts, "\x75\x77\x81\x02\x80", 5);
+  nai->szAtsLen = 5;
+
+  tag->szMemory = PN53X_SIM_TAG_MEMORY_LEN;
+  memset(tag->abtMemory, 0x00, tag->szMemory);
+}
+
+static int
+iso14443_4_sw(uint8_t *pbtRx, const size_t szData, const uint16_t sw)
+{
+  pbtRx[szData] = (uint8_t)(sw >> 8);
+  pbtRx[szData + 1] = (uint8_t)sw;
+  return (int)szData + 2;
+}
+
+static int
+iso14443_4_exchange(struct pn53x_sim_tag *tag, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen)
+{
+  if (szTx < 4)
+    return iso14443_4_sw(pbtRx, 0, 0x6700);
+  const size_t offset = (pbtTx[2] << 8) | pbtTx[3];
+  size_t szLe = (szTx == 5) ? pbtTx[4] : 0;
+
+  switch (pbtTx[1]) {
+    case 0xa4: // SELECT
+      return iso14443_4_sw(pbtRx, 0, 0x9000);
+    case 0x84: // GET CHALLENGE
+      if (szLe == 0)
+        szLe = 8;
+      if (szLe + 2 > szRxLen)
+        return iso14443_4_sw(pbtRx, 0, 0x6700);
+      // Not random at all, but different on each call
+      for (size_t n = 0; n < szLe; n++) {
+        pbtRx[n] = (uint8_t)((tag->abtValue[0] + n) * 0x9d);
+      }
+      tag->abtValue[0]++;
+      return iso14443_4_sw(pbtRx, szLe, 0x9000);
+    case 0xb0: // READ BINARY
+      if (szLe == 0)
+        szLe = 256;
+      if (offset >= tag->szMemory)
+        return iso14443_4_sw(pbtRx, 0, 0x6b00);
+      if (offset + szLe > tag->szMemory)
+        szLe = tag->szMemory - offset;
+      if (szLe + 2 > szRxLen)
+        return iso14443_4_sw(pbtRx, 0, 0x6700);
+      memcpy(pbtRx, tag->abtMemory + offset, szLe);
+      return iso14443_4_sw(pbtRx, szLe, 0x9000);
+    case 0xd6: { // UPDATE BINARY
+      const size_t szLc = (szTx > 4) ? pbtTx[4] : 0;
+      if (szTx < 5 + szLc)
+        return iso14443_4_sw(pbtRx, 0, 0x6700);
+      if (offset + szLc > tag->szMemory)
+        return iso14443_4_sw(pbtRx, 0, 0x6b00);
+      memcpy(tag->abtMemory + offset, pbtTx + 5, szLc);
+      return iso14443_4_sw(pbtRx, 0, 0x9000);
+    }
+    default:
+      return iso14443_4_sw(pbtRx, 0, 0x6d00);
+  }
+}
+
+const struct pn53x_sim_tag_ops pn53x_sim_iso14443_4 = {
+  .name     = "iso14443-4",
+  .nmt      = NMT_ISO14443A,
+  .init     = iso14443_4_init,
+  .reset    = NULL,
+  .exchange = iso14443_4_exchange,
+};
+
+/*
+ * FeliCa, one service without encryption
+ */
+
+#define FELICA_BLOCKS 64
+
+static void
+felica_init(struct pn53x_sim_tag *tag, const uint32_t serial)
+{
+  nfc_felica_info *nfi = &tag->target.nti.nfi;
+
+  tag->target.nm.nbr = NBR_212;
+  nfi->szLen = 0x12;
+  nfi->btResCode = 0x01;
+  memcpy(nfi->abtId, "\x01\x2e\x5e\x00", 4);
+  nfi->abtId[4] = (uint8_t)(serial >> 24);
+  nfi->abtId[5] = (uint8_t)(serial >> 16);
+  nfi->abtId[6] = (uint8_t)(serial >> 8);
+  nfi->abtId[7] = (uint8_t)serial;
+  memcpy(nfi->abtPad, "\x03\x01\x4b\x02\x4f\x49\x93\xff", 8);
+  // NFC Forum Type 3 Tag system code
+  nfi->abtSysCode[0] = 0x12;
+  nfi->abtSysCode[1] = 0xfc;
+
+  tag->szMemory = FELICA_BLOCKS * 16;
+  memset(tag->abtMemory, 0x00, tag->szMemory);
+}
+
+// Returns the block number of the block list element at pbtElement and the element length
+static int
+felica_block(const uint8_t *pbtElement, const size_t szLeft, size_t *pszElement)
+{
+  if ((szLeft >= 2) && (pbtElement[0] & 0x80)) {
+    *pszElement = 2;
+    return pbtElement[1];
+  }
+  if (szLeft >= 3) {
+    *pszElement = 3;
+    return pbtElement[1] | (pbtElement[2] << 8);
+  }
+  return -1;
+}
+
+static int
+felica_exchange(struct pn53x_sim_tag *tag, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen)
+{
+  const nfc_felica_info *nfi = &tag->target.nti.nfi;
+
+  if ((szTx < 2) || (pbtTx[0] != szTx) || (szRxLen < 13))
+    return -ETIMEOUT;
+  if (pbtTx[1] == 0x00) { // Polling
+    if ((szTx < 6) ||
+        ((pbtTx[2] != 0xff) && (pbtTx[2] != nfi->abtSysCode[0])) ||
+        ((pbtTx[3] != 0xff) && (pbtTx[3] != nfi->abtSysCode[1])))
+      return -ETIMEOUT;
+    pbtRx[1] = 0x01;
+    memcpy(pbtRx + 2, nfi->abtId, 8);
+    memcpy(pbtRx + 10, nfi->abtPad, 8);
+    pbtRx[0] = 18;
+    if (pbtTx[4] == 0x01) {
+      memcpy(pbtRx + 18, nfi->abtSysCode, 2);
+      pbtRx[0] = 20;
+    }
+    return pbtRx[0];
+  }
+  if ((szTx < 10) || (memcmp(pbtTx + 2, nfi->abtId, 8) != 0))
+    return -ETIMEOUT;
+
+  pbtRx[1] = pbtTx[1] + 1;
+  memcpy(pbtRx + 2, nfi->abtId, 8);
+  switch (pbtTx[1]) {
+    case 0x04: // Request Response
+      pbtRx[10] = 0x00; // Mode
+      pbtRx[0] = 11;
+      return 11;
+    case 0x06: // Read Without Encryption
+    case 0x08: { // Write Without Encryption
+      const bool bWrite = (pbtTx[1] == 0x08);
+      // Services list, then blocks list
+      size_t off = 11 + (2 * (size_t)pbtTx[10]);
+      if (off >= szTx)
+        return -ETIMEOUT;
+      const size_t szBlocks = pbtTx[off++];
+      size_t szElementsOff = off;
+      size_t szDataOff = off;
+      for (size_t n = 0; n < szBlocks; n++) {
+        size_t szElement = 0;
+        if (felica_block(pbtTx + szDataOff, szTx - szDataOff, &szElement) < 0)
+          return -ETIMEOUT;
+        szDataOff += szElement;
+      }
+      pbtRx[10] = pbtRx[11] = 0x00; // Status flags
+      size_t szRx = 12;
+      if (!bWrite)
+        pbtRx[szRx++] = (uint8_t)szBlocks;
+      if ((bWrite && (szTx < szDataOff + (16 * szBlocks))) || (!bWrite && (szRx + (16 * szBlocks) > szRxLen)))
+        return -ETIMEOUT;
+      for (size_t n = 0; n < szBlocks; n++) {
+        size_t szElement = 0;
+        const int block = felica_block(pbtTx + szElementsOff, szTx - szElementsOff, &szElement);
+        szElementsOff += szElement;
+        if (block >= FELICA_BLOCKS) {
+          pbtRx[10] = 0x01;
+          pbtRx[11] = 0xa8; // Illegal block number
+          pbtRx[0] = 12;
+          return 12;
+        }
+        if (bWrite) {
+          memcpy(tag->abtMemory + (block * 16), pbtTx + szDataOff + (16 * n), 16);
+        } else {
+          memcpy(pbtRx + szRx, tag->abtMemory + (block * 16), 16);
+          szRx += 16;
+        }
+      }
+      pbtRx[0] = (uint8_t)szRx;
+      return (int)szRx;
+    }
+    default:
+      return -ETIMEOUT;
+  }
+}
+
+const struct pn53x_sim_tag_ops pn53x_sim_felica = {
+  .name     = "felica",
+  .nmt      = NMT_FELICA,
+  .init     = felica_init,
+  .reset    = NULL,
+  .exchange = felica_exchange,
+};
+
+/*
+ * Innovision Jewel (Topaz), static memory
+ */
+
+#define JEWEL_MEMORY_LEN 120
+
+static void
+jewel_init(struct pn53x_sim_tag *tag, const uint32_t serial)
+{
+  nfc_jewel_info *nji = &tag->target.nti.nji;
+
+  nji->btSensRes[0] = 0x0c;
+  nji->btSensRes[1] = 0x00;
+  tag->szMemory = JEWEL_MEMORY_LEN;
+  memset(tag->abtMemory, 0x00, tag->szMemory);
+  // Block 0: 7 bytes UID, UID0 is the manufacturer
+  tag->abtMemory[0] = 0x5e;
+  tag->abtMemory[1] = (uint8_t)(serial >> 16);
+  tag->abtMemory[2] = (uint8_t)(serial >> 8);
+  tag->abtMemory[3] = (uint8_t)serial;
+  memcpy(nji->btId, tag->abtMemory, 4);
+}
+
+static int
+jewel_exchange(struct pn53x_sim_tag *tag, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen)
+{
+  static const uint8_t abtHr[2] = { 0x11, 0x48 };
+
+  if (szTx < 1)
+    return -ETIMEOUT;
+  switch (pbtTx[0]) {
+    case 0x78: // RID
+      memcpy(pbtRx, abtHr, 2);
+      memcpy(pbtRx + 2, tag->abtMemory, 4);
+      return 6;
+    case 0x00: // RALL, blocks 0 to C
+      if (szRxLen < 106)
+        return -EBUFOVF;
+      memcpy(pbtRx, abtHr, 2);
+      memcpy(pbtRx + 2, tag->abtMemory, 104);
+      return 106;
+    case 0x01: // READ
+      if ((szTx < 2) || (pbtTx[1] >= JEWEL_MEMORY_LEN))
+        return -ETIMEOUT;
+      pbtRx[0] = tag->abtMemory[pbtTx[1]];
+      return 1;
+    case 0x53: // WRITE-E
+    case 0x1a: // WRITE-NE
+      // UID block is read only
+      if ((szTx < 3) || (pbtTx[1] >= JEWEL_MEMORY_LEN) || (pbtTx[1] < 8))
+        return -ETIMEOUT;
+      if (pbtTx[0] == 0x53)
+        tag->abtMemory[pbtTx[1]] = pbtTx[2];
+      else
+        tag->abtMemory[pbtTx[1]] |= pbtTx[2];
+      pbtRx[0] = tag->abtMemory[pbtTx[1]];
+      return 1;
+    default:
+      return -ETIMEOUT;
+  }
+}
+
+const struct pn53x_sim_tag_ops pn53x_sim_jewel = {
+  .name     = "jewel",
+  .nmt      = NMT_JEWEL,
+  .init     = jewel_init,
+  .reset    = NULL,
+  .exchange = jewel_exchange,
+};
+
+/*
+ * ST25TB512-AC, 16 blocks of 4 bytes and the system block. Inventory and
+ * SELECT are handled by the simulated chip.
+ */
+
+#define ST25TB_BLOCKS 16
+#define ST25TB_SYSTEM_BLOCK 0xff
+
+static void
+st25tb_init(struct pn53x_sim_tag *tag, const uint32_t serial)
+{
+  nfc_iso14443b2sr_info *nsi = &tag->target.nti.nsi;
+
+  // UID is sent LSB first: serial number, product code, manufacturer then 0xd0
+  nsi->abtUID[0] = (uint8_t)serial;
+  nsi->abtUID[1] = (uint8_t)(serial >> 8);
+  nsi->abtUID[2] = (uint8_t)(serial >> 16);
+  nsi->abtUID[3] = (uint8_t)(serial >> 24);
+  nsi->abtUID[4] = 0x5e;
+  nsi->abtUID[5] = 0x1b;
+  nsi->abtUID[6] = 0x02;
+  nsi->abtUID[7] = 0xd0;
+  tag->szMemory = (ST25TB_BLOCKS + 1) * 4;
+  memset(tag->abtMemory, 0xff, tag->szMemory);
+}
+
+static int
+st25tb_block(const uint8_t btBlock)
+{
+  if (btBlock == ST25TB_SYSTEM_BLOCK)
+    return ST25TB_BLOCKS;
+  return (btBlock < ST25TB_BLOCKS) ? btBlock : -1;
+}
+
+static int
+st25tb_exchange(struct pn53x_sim_tag *tag, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen)
+{
+  int block;
+
+  if ((szTx < 1) || (szRxLen < 8))
+    return -ETIMEOUT;
+  switch (pbtTx[0]) {
+    case 0x0b: // GET_UID
+      memcpy(pbtRx, tag->target.nti.nsi.abtUID, 8);
+      return 8;
+    case 0x08: // READ_BLOCK
+      if ((szTx < 2) || ((block = st25tb_block(pbtTx[1])) < 0))
+        return -ETIMEOUT;
+      memcpy(pbtRx, tag->abtMemory + (block * 4), 4);
+      return 4;
+    case 0x09: // WRITE_BLOCK, never answered
+      if ((szTx >= 6) && ((block = st25tb_block(pbtTx[1])) >= 0))
+        memcpy(tag->abtMemory + (block * 4), pbtTx + 2, 4);
+      return -ETIMEOUT;
+    case 0x0c: // RESET_TO_INVENTORY
+      tag->state = SIM_TAG_READY;
+      return -ETIMEOUT;
+    default:
+      return -ETIMEOUT;
+  }
+}
+
+const struct pn53x_sim_tag_ops pn53x_sim_st25tb = {
+  .name     = "st25tb",
+  .nmt      = NMT_ISO14443B2SR,
+  .init     = st25tb_init,
+  .reset    = NULL,
+  .exchange = st25tb_exchange,
+};
+
+static const struct pn53x_sim_tag_ops *pn53x_sim_tags[] = {
+  &pn53x_sim_mifare_classic_1k,
+  &pn53x_sim_mifare_ultralight,
+  &pn53x_sim_iso14443_4,
+  &pn53x_sim_felica,
+  &pn53x_sim_jewel,
+  &pn53x_sim_st25tb,
+};
+
+const struct pn53x_sim_tag_ops *
+pn53x_sim_tag_ops_by_name(const char *name)
+{
+  for (size_t n = 0; n < sizeof(pn53x_sim_tags) / sizeof(pn53x_sim_tags[0]); n++) {
+    if (strcmp(name, pn53x_sim_tags[n]->name) == 0)
+      return pn53x_sim_tags[n];
+  }
+  return NULL;
+}
@@ -0,0 +1,1108 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn53x-sim.c
+ * @brief Software model of a PN53x chip and of the tags in its field
+ *
+ * pn53x_sim_command() takes a command as given to pn53x_io send() and
+ * produces the response pn53x_io receive() would return, so the model can be
+ * put behind any transport. It covers the commands used by libnfc in
+ * initiator and target modes but it does not model RF timings nor direct CIU
+ * operations (timed transceive), and ISO/IEC 14443B, DEP and Barcode targets
+ * are never found.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "pn53x-sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "pn53x.h"
+#include "pn53x-internal.h"
+
+#define LOG_CATEGORY "libnfc.chip.pn53x-sim"
+#define LOG_GROUP    NFC_LOG_GROUP_CHIP
+
+#define SIM_BUFSIZE PN53x_EXTENDED_FRAME__DATA_MAX_LEN
+
+#define SAK_UID_NOT_COMPLETE     0x04
+#define SAK_ISO14443_4_COMPLIANT 0x20
+
+struct pn53x_sim *
+pn53x_sim_new(const pn53x_type type)
+{
+  struct pn53x_sim *sim;
+
+  if ((type != PN532) && (type != PN533))
+    return NULL;
+  if ((sim = calloc(1, sizeof(struct pn53x_sim))) == NULL)
+    return NULL;
+  sim->type = type;
+  sim->ui8MaxRtyPassiveActivation = 0xff;
+  sim->random = 0x5eed5eed;
+  // Registers libnfc relies on, with their reset value
+  sim->abtRegisters[PN53X_REG_CIU_TxMode] = SYMBOL_TX_CRC_ENABLE;
+  sim->abtRegisters[PN53X_REG_CIU_RxMode] = SYMBOL_RX_CRC_ENABLE;
+  sim->abtRegisters[PN53X_REG_CIU_Control] = 0x10;
+  sim->abtRegisters[PN53X_SFR_P3] = 0xff;
+  sim->abtRegisters[PN53X_SFR_P7] = 0xff;
+  return sim;
+}
+
+void
+pn53x_sim_free(struct pn53x_sim *sim)
+{
+  for (size_t n = 0; n < sim->tag_count; n++) {
+    free(sim->tags[n]);
+  }
+  free(sim);
+}
+
+static void
+pn53x_sim_tag_reset(struct pn53x_sim_tag *tag)
+{
+  tag->state = SIM_TAG_IDLE;
+  tag->cascade_level = 0;
+  tag->iso14443_4 = false;
+  tag->block_number = 0;
+  tag->auth_sector = -1;
+  if (tag->ops->reset)
+    tag->ops->reset(tag);
+}
+
+struct pn53x_sim_tag *
+pn53x_sim_add_tag(struct pn53x_sim *sim, const struct pn53x_sim_tag_ops *ops)
+{
+  struct pn53x_sim_tag *tag;
+
+  if (sim->tag_count == PN53X_SIM_MAX_TAGS)
+    return NULL;
+  if ((tag = calloc(1, sizeof(struct pn53x_sim_tag))) == NULL)
+    return NULL;
+  tag->ops = ops;
+  tag->present = true;
+  tag->target.nm.nmt = ops->nmt;
+  tag->target.nm.nbr = NBR_106;
+  // Serial number makes identifiers unique within the field
+  ops->init(tag, ++sim->serial);
+  pn53x_sim_tag_reset(tag);
+  sim->tags[sim->tag_count++] = tag;
+  return tag;
+}
+
+int
+pn53x_sim_add_tags(struct pn53x_sim *sim, const char *names)
+{
+  char name[32];
+
+  while (*names) {
+    size_t len = strcspn(names, ",");
+    if (len >= sizeof(name))
+      return NFC_EINVARG;
+    memcpy(name, names, len);
+    name[len] = '\0';
+    names += len + ((names[len] == ',') ? 1 : 0);
+    if (len == 0)
+      continue;
+
+    const struct pn53x_sim_tag_ops *ops = pn53x_sim_tag_ops_by_name(name);
+    if (!ops) {
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unknown virtual tag \"%s\"", name);
+      return NFC_EINVARG;
+    }
+    if (!pn53x_sim_add_tag(sim, ops))
+      return NFC_ESOFT;
+  }
+  return NFC_SUCCESS;
+}
+
+int
+pn53x_sim_push_initiator_frame(struct pn53x_sim *sim, const uint8_t *pbtData, const size_t szData)
+{
+  if (sim->initiator_frame_next == sim->initiator_frame_count) {
+    sim->initiator_frame_next = sim->initiator_frame_count = 0;
+  }
+  if ((sim->initiator_frame_count == PN53X_SIM_MAX_FRAMES) || (szData > SIM_BUFSIZE - 1))
+    return NFC_EOVFLOW;
+  struct pn53x_sim_frame *frame = sim->initiator_frames + sim->initiator_frame_count++;
+  memcpy(frame->abtData, pbtData, szData);
+  frame->szData = szData;
+  return NFC_SUCCESS;
+}
+
+static bool
+pn53x_sim_tag_in_field(const struct pn53x_sim *sim, const struct pn53x_sim_tag *tag)
+{
+  return sim->field && tag->present;
+}
+
+static void
+pn53x_sim_set_field(struct pn53x_sim *sim, const bool field)
+{
+  if (sim->field && !field) {
+    // Tags lose power
+    for (size_t n = 0; n < sim->tag_count; n++) {
+      pn53x_sim_tag_reset(sim->tags[n]);
+    }
+    sim->target_count = 0;
+    sim->thru_tag = NULL;
+  }
+  sim->field = field;
+}
+
+static int
+pn53x_sim_status(uint8_t *pbtRx, const uint8_t ui8Status)
+{
+  pbtRx[0] = ui8Status;
+  return 1;
+}
+
+// Cascade level of a 14443A UID: CT + 3 UID bytes or 4 UID bytes, then BCC
+static void
+pn53x_sim_iso14443a_cln(const struct pn53x_sim_tag *tag, const uint8_t ui8Level, uint8_t *pbtCln)
+{
+  const nfc_iso14443a_info *nai = &tag->target.nti.nai;
+  const size_t szLevels = (nai->szUidLen == 4) ? 1 : ((nai->szUidLen == 7) ? 2 : 3);
+  const uint8_t *pbtUid = nai->abtUid + (3 * ui8Level);
+
+  if ((size_t) ui8Level + 1 < szLevels) {
+    pbtCln[0] = 0x88;
+    memcpy(pbtCln + 1, pbtUid, 3);
+  } else {
+    memcpy(pbtCln, pbtUid, 4);
+  }
+  pbtCln[4] = pbtCln[0] ^ pbtCln[1] ^ pbtCln[2] ^ pbtCln[3];
+}
+
+static bool
+pn53x_sim_iso14443a_last_level(const struct pn53x_sim_tag *tag, const uint8_t ui8Level)
+{
+  const size_t szUidLen = tag->target.nti.nai.szUidLen;
+  return ((szUidLen == 4) && (ui8Level == 0)) || ((szUidLen == 7) && (ui8Level == 1)) || (ui8Level == 2);
+}
+
+static bool
+pn53x_sim_bits_equal(const uint8_t *pbtA, const uint8_t *pbtB, const size_t szBits)
+{
+  const size_t szBytes = szBits / 8;
+  if (memcmp(pbtA, pbtB, szBytes) != 0)
+    return false;
+  if (szBits % 8) {
+    const uint8_t mask = (1 << (szBits % 8)) - 1;
+    return ((pbtA[szBytes] ^ pbtB[szBytes]) & mask) == 0;
+  }
+  return true;
+}
+
+/*
+ * Initiator commands
+ */
+
+static int
+pn53x_sim_list_iso14443a(struct pn53x_sim *sim, struct pn53x_sim_tag *tag, const uint8_t *pbtInit, const size_t szInit, uint8_t *pbtEntry)
+{
+  const nfc_iso14443a_info *nai = &tag->target.nti.nai;
+  uint8_t abtCascadedUid[12];
+  size_t szCascadedUid;
+
+  // Halted tags do not answer REQA
+  if (tag->state == SIM_TAG_HALT)
+    return 0;
+  if (szInit) {
+    iso14443_cascade_uid(nai->abtUid, nai->szUidLen, abtCascadedUid, &szCascadedUid);
+    if ((szInit != szCascadedUid) || (memcmp(pbtInit, abtCascadedUid, szInit) != 0))
+      return 0;
+  }
+  size_t off = 0;
+  pbtEntry[off++] = nai->abtAtqa[0];
+  pbtEntry[off++] = nai->abtAtqa[1];
+  pbtEntry[off++] = nai->btSak;
+  pbtEntry[off++] = (uint8_t)nai->szUidLen;
+  memcpy(pbtEntry + off, nai->abtUid, nai->szUidLen);
+  off += nai->szUidLen;
+  tag->iso14443_4 = false;
+  if ((nai->btSak & SAK_ISO14443_4_COMPLIANT) && (sim->ui8Parameters & PARAM_AUTO_RATS)) {
+    pbtEntry[off++] = (uint8_t)(nai->szAtsLen + 1);
+    memcpy(pbtEntry + off, nai->abtAts, nai->szAtsLen);
+    off += nai->szAtsLen;
+    tag->iso14443_4 = true;
+    tag->block_number = 1;
+  }
+  tag->cascade_level = 0;
+  tag->auth_sector = -1;
+  return (int)off;
+}
+
+static int
+pn53x_sim_list_felica(struct pn53x_sim_tag *tag, const uint8_t *pbtInit, const size_t szInit, uint8_t *pbtEntry)
+{
+  const nfc_felica_info *nfi = &tag->target.nti.nfi;
+  bool bSysCode = false;
+
+  if (szInit >= 5) {
+    // Polling request: 00 SC SC RC TSN, FF in system code is a wildcard
+    if ((pbtInit[0] != 0x00) ||
+        ((pbtInit[1] != 0xff) && (pbtInit[1] != nfi->abtSysCode[0])) ||
+        ((pbtInit[2] != 0xff) && (pbtInit[2] != nfi->abtSysCode[1])))
+      return 0;
+    bSysCode = (pbtInit[3] == 0x01);
+  }
+  size_t off = 0;
+  pbtEntry[off++] = bSysCode ? 0x14 : 0x12;
+  pbtEntry[off++] = 0x01;
+  memcpy(pbtEntry + off, nfi->abtId, 8);
+  off += 8;
+  memcpy(pbtEntry + off, nfi->abtPad, 8);
+  off += 8;
+  if (bSysCode) {
+    memcpy(pbtEntry + off, nfi->abtSysCode, 2);
+    off += 2;
+  }
+  return (int)off;
+}
+
+static int
+pn53x_sim_list_jewel(struct pn53x_sim_tag *tag, uint8_t *pbtEntry)
+{
+  memcpy(pbtEntry, tag->target.nti.nji.btSensRes, 2);
+  memcpy(pbtEntry + 2, tag->target.nti.nji.btId, 4);
+  return 6;
+}
+
+// Encodes, after the Tg byte, the target data of the tag when it answers a poll of the given modulation
+static int
+pn53x_sim_list_tag(struct pn53x_sim *sim, struct pn53x_sim_tag *tag, const pn53x_modulation pm,
+                   const uint8_t *pbtInit, const size_t szInit, uint8_t *pbtEntry)
+{
+  if (!pn53x_sim_tag_in_field(sim, tag))
+    return 0;
+  switch (pm) {
+    case PM_ISO14443A_106:
+      if (tag->ops->nmt == NMT_ISO14443A)
+        return pn53x_sim_list_iso14443a(sim, tag, pbtInit, szInit, pbtEntry);
+      break;
+    case PM_FELICA_212:
+    case PM_FELICA_424:
+      if (tag->ops->nmt == NMT_FELICA)
+        return pn53x_sim_list_felica(tag, pbtInit, szInit, pbtEntry);
+      break;
+    case PM_JEWEL_106:
+      if (tag->ops->nmt == NMT_JEWEL)
+        return pn53x_sim_list_jewel(tag, pbtEntry);
+      break;
+    default:
+      break;
+  }
+  return 0;
+}
+
+// xorshift32, reproducible from one run to the other
+static uint8_t
+pn53x_sim_random(struct pn53x_sim *sim)
+{
+  sim->random ^= sim->random << 13;
+  sim->random ^= sim->random >> 17;
+  sim->random ^= sim->random << 5;
+  return (uint8_t)(sim->random >> 24);
+}
+
+static int
+pn53x_sim_InListPassiveTarget(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  if ((szParams < 2) || (pbtParams[0] < 1) || (pbtParams[0] > 2))
+    return NFC_EINVARG;
+  const size_t szMaxTargets = pbtParams[0];
+  const pn53x_modulation pm = (pn53x_modulation)pbtParams[1];
+
+  // The RF field is switched on and previous targets are released
+  pn53x_sim_set_field(sim, true);
+  sim->target_count = 0;
+  sim->thru_tag = NULL;
+
+  size_t off = 1;
+  if ((pm == PM_FELICA_212) || (pm == PM_FELICA_424)) {
+    // Each card answers in a random one of the TSN + 1 time slots, answers in a same slot collide
+    const size_t szSlots = (szParams >= 7) ? (size_t)(pbtParams[6] & 0x0f) + 1 : 1;
+    uint8_t abtEntry[SIM_BUFSIZE];
+    for (size_t n = 0; n < sim->tag_count; n++) {
+      if (sim->tags[n]->ops->nmt == NMT_FELICA)
+        sim->tags[n]->slot = (uint8_t)(pn53x_sim_random(sim) % szSlots);
+    }
+    for (size_t slot = 0; (slot < szSlots) && (sim->target_count < szMaxTargets); slot++) {
+      struct pn53x_sim_tag *answer = NULL;
+      size_t szAnswers = 0;
+      for (size_t n = 0; n < sim->tag_count; n++) {
+        struct pn53x_sim_tag *tag = sim->tags[n];
+        if ((tag->slot == slot) && (pn53x_sim_list_tag(sim, tag, pm, pbtParams + 2, szParams - 2, abtEntry) > 0)) {
+          answer = tag;
+          szAnswers++;
+        }
+      }
+      if (szAnswers != 1)
+        continue;
+      int res = pn53x_sim_list_tag(sim, answer, pm, pbtParams + 2, szParams - 2, pbtRx + off + 1);
+      pbtRx[off] = (uint8_t)(sim->target_count + 1);
+      off += res + 1;
+      answer->state = SIM_TAG_ACTIVE;
+      sim->targets[sim->target_count++] = answer;
+    }
+  } else {
+    for (size_t n = 0; (n < sim->tag_count) && (sim->target_count < szMaxTargets); n++) {
+      struct pn53x_sim_tag *tag = sim->tags[n];
+      int res = pn53x_sim_list_tag(sim, tag, pm, pbtParams + 2, szParams - 2, pbtRx + off + 1);
+      if (res > 0) {
+        pbtRx[off] = (uint8_t)(sim->target_count + 1);
+        off += res + 1;
+        tag->state = SIM_TAG_ACTIVE;
+        sim->targets[sim->target_count++] = tag;
+      }
+    }
+  }
+  if ((sim->target_count == 0) && (sim->ui8MaxRtyPassiveActivation == 0xff)) {
+    // Endless retries: the chip waits until the host gives up
+    return NFC_ETIMEOUT;
+  }
+  sim->thru_tag = sim->target_count ? sim->targets[0] : NULL;
+  pbtRx[0] = (uint8_t)sim->target_count;
+  return (int)off;
+}
+
+static int
+pn53x_sim_InAutoPoll(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  if (sim->type != PN532)
+    return NFC_EIO;
+  if (szParams < 3)
+    return NFC_EINVARG;
+
+  pn53x_sim_set_field(sim, true);
+  sim->target_count = 0;
+  sim->thru_tag = NULL;
+
+  size_t off = 1;
+  for (size_t t = 2; (t < szParams) && (sim->target_count < 2); t++) {
+    const pn53x_target_type ptt = (pn53x_target_type)pbtParams[t];
+    pn53x_modulation pm;
+    switch (ptt) {
+      case PTT_GENERIC_PASSIVE_106:
+      case PTT_MIFARE:
+      case PTT_ISO14443_4A_106:
+        pm = PM_ISO14443A_106;
+        break;
+      case PTT_GENERIC_PASSIVE_212:
+      case PTT_FELICA_212:
+        pm = PM_FELICA_212;
+        break;
+      case PTT_GENERIC_PASSIVE_424:
+      case PTT_FELICA_424:
+        pm = PM_FELICA_424;
+        break;
+      case PTT_JEWEL_106:
+        pm = PM_JEWEL_106;
+        break;
+      default:
+        continue;
+    }
+    for (size_t n = 0; (n < sim->tag_count) && (sim->target_count < 2); n++) {
+      struct pn53x_sim_tag *tag = sim->tags[n];
+      if (tag->state == SIM_TAG_ACTIVE)
+        continue;
+      if ((ptt == PTT_MIFARE) && (tag->target.nti.nai.btSak & SAK_ISO14443_4_COMPLIANT))
+        continue;
+      if ((ptt == PTT_ISO14443_4A_106) && !(tag->target.nti.nai.btSak & SAK_ISO14443_4_COMPLIANT))
+        continue;
+      // Type, length, then target data starting with Tg
+      int res = pn53x_sim_list_tag(sim, tag, pm, NULL, 0, pbtRx + off + 3);
+      if (res > 0) {
+        pbtRx[off] = ptt;
+        pbtRx[off + 1] = (uint8_t)(res + 1);
+        pbtRx[off + 2] = (uint8_t)(sim->target_count + 1);
+        off += res + 3;
+        tag->state = SIM_TAG_ACTIVE;
+        sim->targets[sim->target_count++] = tag;
+      }
+    }
+  }
+  if (sim->target_count == 0 && pbtParams[0] == 0xff) {
+    return NFC_ETIMEOUT;
+  }
+  sim->thru_tag = sim->target_count ? sim->targets[0] : NULL;
+  pbtRx[0] = (uint8_t)sim->target_count;
+  return (int)off;
+}
+
+static struct pn53x_sim_tag *
+pn53x_sim_target(struct pn53x_sim *sim, const uint8_t ui8Tg)
+{
+  const uint8_t tg = ui8Tg & 0x0f;
+  if ((tg == 0) || (tg > sim->target_count))
+    return NULL;
+  return sim->targets[tg - 1];
+}
+
+static int
+pn53x_sim_InDataExchange(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  struct pn53x_sim_tag *tag;
+
+  if ((szParams < 1) || ((tag = pn53x_sim_target(sim, pbtParams[0])) == NULL))
+    return pn53x_sim_status(pbtRx, ECMD);
+  if (!pn53x_sim_tag_in_field(sim, tag) || (tag->state != SIM_TAG_ACTIVE))
+    return pn53x_sim_status(pbtRx, ETIMEOUT);
+
+  int res = tag->ops->exchange(tag, pbtParams + 1, szParams - 1, pbtRx + 1, SIM_BUFSIZE - 1);
+  if (res < 0)
+    return pn53x_sim_status(pbtRx, (uint8_t)(-res));
+  // A successful MIFARE Classic authentication switches the Crypto1 unit on
+  if ((tag->ops == &pn53x_sim_mifare_classic_1k) && (szParams > 1) && ((pbtParams[1] == 0x60) || (pbtParams[1] == 0x61)))
+    sim->abtRegisters[PN53X_REG_CIU_Status2] |= SYMBOL_MF_CRYPTO1_ON;
+  pbtRx[0] = 0x00;
+  return res + 1;
+}
+
+static int
+pn53x_sim_thru_iso14443_4(struct pn53x_sim_tag *tag, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx)
+{
+  const uint8_t pcb = pbtTx[0];
+  const size_t szHeader = 1 + ((pcb & 0x08) ? 1 : 0) + ((pcb & 0x04) ? 1 : 0);
+
+  if (szTx < szHeader)
+    return -ETIMEOUT;
+  if ((pcb & 0xe2) == 0x02) { // I-block
+    int res = tag->ops->exchange(tag, pbtTx + szHeader, szTx - szHeader, pbtRx + szHeader, SIM_BUFSIZE - 1 - szHeader);
+    if (res < 0)
+      return res;
+    memcpy(pbtRx, pbtTx, szHeader);
+    pbtRx[0] &= ~0x10;
+    tag->block_number = pcb & 0x01;
+    return res + (int)szHeader;
+  }
+  if ((pcb & 0xe6) == 0xa2) { // R-block, answer R(ACK) with the current block number
+    memcpy(pbtRx, pbtTx, szHeader);
+    pbtRx[0] = (pcb & ~0x11) | tag->block_number;
+    return (int)szHeader;
+  }
+  if ((pcb & 0xf7) == 0xc2) { // S(DESELECT)
+    memcpy(pbtRx, pbtTx, szHeader);
+    tag->state = SIM_TAG_HALT;
+    tag->iso14443_4 = false;
+    return (int)szHeader;
+  }
+  if ((pcb & 0xf7) == 0xf2) { // S(WTX)
+    memcpy(pbtRx, pbtTx, szTx);
+    return (int)szTx;
+  }
+  return -ETIMEOUT;
+}
+
+static int
+pn53x_sim_reqa(struct pn53x_sim *sim, const bool bWakeUp, uint8_t *pbtRx)
+{
+  size_t szResponders = 0;
+
+  sim->thru_tag = NULL;
+  pbtRx[0] = pbtRx[1] = 0x00;
+  for (size_t n = 0; n < sim->tag_count; n++) {
+    struct pn53x_sim_tag *tag = sim->tags[n];
+    if (!pn53x_sim_tag_in_field(sim, tag) || (tag->ops->nmt != NMT_ISO14443A))
+      continue;
+    if ((tag->state == SIM_TAG_HALT) && !bWakeUp)
+      continue;
+    tag->state = SIM_TAG_READY;
+    tag->cascade_level = 0;
+    tag->iso14443_4 = false;
+    tag->auth_sector = -1;
+    // ATQA is sent LSB first
+    pbtRx[0] |= tag->target.nti.nai.abtAtqa[1];
+    pbtRx[1] |= tag->target.nti.nai.abtAtqa[0];
+    szResponders++;
+  }
+  return szResponders ? 16 : -ETIMEOUT;
+}
+
+// SELECT or ANTICOLLISION of cascade level ui8Level with NVB coded known bits
+static int
+pn53x_sim_select(struct pn53x_sim *sim, const uint8_t ui8Level, const uint8_t *pbtTx, const size_t szTxBits,
+                 uint8_t *pbtRx, bool *pbCrc)
+{
+  const uint8_t nvb = pbtTx[1];
+  const size_t szKnownBits = (((nvb >> 4) - 2) * 8) + (nvb & 0x0f);
+  uint8_t abtCln[5];
+
+  if ((nvb < 0x20) || (szKnownBits > 40) || (szTxBits < 16 + szKnownBits))
+    return -ETIMEOUT;
+
+  if (szKnownBits == 40) {
+    // SELECT: the matching tags answer their SAK, the others go back to idle.
+    // Tags sharing this UID CLn all move on to the next cascade level
+    struct pn53x_sim_tag *selected = NULL;
+    for (size_t n = 0; n < sim->tag_count; n++) {
+      struct pn53x_sim_tag *tag = sim->tags[n];
+      if (!pn53x_sim_tag_in_field(sim, tag) || (tag->state != SIM_TAG_READY) || (tag->cascade_level != ui8Level))
+        continue;
+      pn53x_sim_iso14443a_cln(tag, ui8Level, abtCln);
+      if (memcmp(abtCln, pbtTx + 2, 5) != 0) {
+        tag->state = SIM_TAG_IDLE;
+      } else if (!pn53x_sim_iso14443a_last_level(tag, ui8Level)) {
+        tag->cascade_level++;
+        pbtRx[0] = SAK_UID_NOT_COMPLETE;
+        selected = tag;
+      } else if (selected == NULL) {
+        tag->state = SIM_TAG_ACTIVE;
+        sim->thru_tag = tag;
+        pbtRx[0] = tag->target.nti.nai.btSak;
+        selected = tag;
+      } else {
+        tag->state = SIM_TAG_IDLE;
+      }
+    }
+    if (!selected)
+      return -ETIMEOUT;
+    *pbCrc = true;
+    return 8;
+  }
+
+  // ANTICOLLISION: tags matching the known bits send the remaining ones
+  const uint8_t *pbtFirst = NULL;
+  uint8_t abtFirst[5];
+  size_t szCollision = 0;
+  for (size_t n = 0; n < sim->tag_count; n++) {
+    struct pn53x_sim_tag *tag = sim->tags[n];
+    if (!pn53x_sim_tag_in_field(sim, tag) || (tag->state != SIM_TAG_READY) || (tag->cascade_level != ui8Level))
+      continue;
+    pn53x_sim_iso14443a_cln(tag, ui8Level, abtCln);
+    if (!pn53x_sim_bits_equal(abtCln, pbtTx + 2, szKnownBits))
+      continue;
+    if (!pbtFirst) {
+      memcpy(abtFirst, abtCln, sizeof(abtFirst));
+      pbtFirst = abtFirst;
+      continue;
+    }
+    // Locate the first bit on which both answers differ
+    for (size_t bit = szKnownBits; bit < 40; bit++) {
+      if (((abtFirst[bit / 8] ^ abtCln[bit / 8]) >> (bit % 8)) & 1) {
+        if ((szCollision == 0) || (bit + 1 < szCollision))
+          szCollision = bit + 1;
+        break;
+      }
+    }
+  }
+  if (!pbtFirst)
+    return -ETIMEOUT;
+  if (szCollision) {
+    // CollPos counts from the first received bit, 0 stands for 32
+    sim->abtRegisters[PN53X_REG_CIU_Coll] = (uint8_t)((szCollision - szKnownBits) & 0x1f);
+    return -EBITCOLL;
+  }
+  sim->abtRegisters[PN53X_REG_CIU_Coll] = 0x20; // CollPosNotValid
+  // Remaining bits are received from bit 0 of the first byte
+  const size_t szRxBits = 40 - szKnownBits;
+  memset(pbtRx, 0x00, 5);
+  for (size_t bit = 0; bit < szRxBits; bit++) {
+    const size_t src = szKnownBits + bit;
+    pbtRx[bit / 8] |= ((abtFirst[src / 8] >> (src % 8)) & 1) << (bit % 8);
+  }
+  return (int)szRxBits;
+}
+
+// ISO/IEC 14443A frame sent with InCommunicateThru, returns the answer length in bits or a negated PN53x status
+static int
+pn53x_sim_thru_iso14443a(struct pn53x_sim *sim, const uint8_t *pbtTx, const size_t szTxBits, uint8_t *pbtRx, bool *pbCrc)
+{
+  struct pn53x_sim_tag *tag = sim->thru_tag;
+  const size_t szTx = szTxBits / 8;
+
+  *pbCrc = false;
+  if (szTxBits == 7) {
+    if ((pbtTx[0] & 0x7f) == 0x26)
+      return pn53x_sim_reqa(sim, false, pbtRx);
+    if ((pbtTx[0] & 0x7f) == 0x52)
+      return pn53x_sim_reqa(sim, true, pbtRx);
+    return -ETIMEOUT;
+  }
+  if ((szTxBits >= 16) && ((pbtTx[0] == 0x93) || (pbtTx[0] == 0x95) || (pbtTx[0] == 0x97)))
+    return pn53x_sim_select(sim, (pbtTx[0] - 0x93) / 2, pbtTx, szTxBits, pbtRx, pbCrc);
+  if ((szTxBits % 8) || !tag || (tag->state != SIM_TAG_ACTIVE) || !pn53x_sim_tag_in_field(sim, tag))
+    return -ETIMEOUT;
+
+  if ((szTx == 2) && (pbtTx[0] == 0x50) && (pbtTx[1] == 0x00)) { // HLTA, never answered
+    tag->state = SIM_TAG_HALT;
+    sim->thru_tag = NULL;
+    return -ETIMEOUT;
+  }
+  *pbCrc = true;
+  if ((szTx == 2) && (pbtTx[0] == 0xe0) && (tag->target.nti.nai.btSak & SAK_ISO14443_4_COMPLIANT)) { // RATS
+    const nfc_iso14443a_info *nai = &tag->target.nti.nai;
+    pbtRx[0] = (uint8_t)(nai->szAtsLen + 1);
+    memcpy(pbtRx + 1, nai->abtAts, nai->szAtsLen);
+    tag->iso14443_4 = true;
+    tag->block_number = 1;
+    return (int)(nai->szAtsLen + 1) * 8;
+  }
+  int res;
+  if (tag->iso14443_4) {
+    res = pn53x_sim_thru_iso14443_4(tag, pbtTx, szTx, pbtRx);
+  } else if ((res = tag->ops->exchange(tag, pbtTx, szTx, pbtRx, SIM_BUFSIZE - 1)) == 0) {
+    // 4-bit ACK
+    pbtRx[0] = 0x0a;
+    *pbCrc = false;
+    return 4;
+  }
+  if (res == -EMFAUTH) // A MIFARE tag which refuses authentication just goes mute
+    res = -ETIMEOUT;
+  return (res < 0) ? res : res * 8;
+}
+
+static int
+pn53x_sim_thru_felica(struct pn53x_sim *sim, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx)
+{
+  if ((szTx < 2) || (pbtTx[0] != szTx))
+    return -ETIMEOUT;
+  for (size_t n = 0; n < sim->tag_count; n++) {
+    struct pn53x_sim_tag *tag = sim->tags[n];
+    if (!pn53x_sim_tag_in_field(sim, tag) || (tag->ops->nmt != NMT_FELICA))
+      continue;
+    // Polling is answered by any tag, other commands are addressed with the IDm
+    if ((pbtTx[1] != 0x00) && ((szTx < 10) || (memcmp(pbtTx + 2, tag->target.nti.nfi.abtId, 8) != 0)))
+      continue;
+    int res = tag->ops->exchange(tag, pbtTx, szTx, pbtRx, SIM_BUFSIZE - 1);
+    if (res > 0)
+      return res;
+  }
+  return -ETIMEOUT;
+}
+
+/*
+ * ST SRx frames. The tag states are mapped on the ISO/IEC 14443-3 ones:
+ * SIM_TAG_IDLE is Ready, SIM_TAG_READY is Inventory, SIM_TAG_ACTIVE is
+ * Selected and SIM_TAG_HALT is Deselected.
+ */
+static int
+pn53x_sim_thru_iso14443b2sr(struct pn53x_sim *sim, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx)
+{
+  struct pn53x_sim_tag *answer = NULL;
+  size_t szAnswers = 0;
+
+  if (szTx < 1)
+    return -ETIMEOUT;
+  const bool bInitiate = (szTx == 2) && (pbtTx[0] == 0x06) && (pbtTx[1] == 0x00);
+  const bool bPcall16 = (szTx == 2) && (pbtTx[0] == 0x06) && (pbtTx[1] == 0x04);
+  const bool bSlotMarker = (szTx == 1) && ((pbtTx[0] & 0x0f) == 0x06) && (pbtTx[0] >> 4);
+  const bool bSelect = (szTx == 2) && (pbtTx[0] == 0x0e);
+  if (!bInitiate && !bPcall16 && !bSlotMarker && !bSelect) {
+    struct pn53x_sim_tag *tag = sim->thru_tag;
+    if (!tag || (tag->state != SIM_TAG_ACTIVE) || !pn53x_sim_tag_in_field(sim, tag) || (tag->ops->nmt != NMT_ISO14443B2SR))
+      return -ETIMEOUT;
+    return tag->ops->exchange(tag, pbtTx, szTx, pbtRx, SIM_BUFSIZE - 1);
+  }
+
+  for (size_t n = 0; n < sim->tag_count; n++) {
+    struct pn53x_sim_tag *tag = sim->tags[n];
+    if (!pn53x_sim_tag_in_field(sim, tag) || (tag->ops->nmt != NMT_ISO14443B2SR))
+      continue;
+    if (bSelect) {
+      if ((tag->state != SIM_TAG_IDLE) && (tag->chip_id == pbtTx[1])) {
+        tag->state = SIM_TAG_ACTIVE;
+      } else {
+        if (tag->state == SIM_TAG_ACTIVE)
+          tag->state = SIM_TAG_HALT;
+        continue;
+      }
+    } else if (bSlotMarker) {
+      if ((tag->state != SIM_TAG_READY) || (tag->slot != (pbtTx[0] >> 4)))
+        continue;
+    } else {
+      if ((tag->state != SIM_TAG_READY) && !((tag->state == SIM_TAG_IDLE) && bInitiate))
+        continue;
+      // PCALL16 puts the slot number in the low nibble of the Chip_ID
+      tag->state = SIM_TAG_READY;
+      tag->chip_id = pn53x_sim_random(sim);
+      tag->slot = bPcall16 ? (tag->chip_id & 0x0f) : 0;
+      if (tag->slot != 0)
+        continue;
+    }
+    answer = tag;
+    szAnswers++;
+  }
+  if (bSelect)
+    sim->thru_tag = (szAnswers == 1) ? answer : NULL;
+  if (szAnswers == 0)
+    return -ETIMEOUT;
+  // Colliding answers do not pass the CRC check
+  if (szAnswers > 1)
+    return -ECRC;
+  pbtRx[0] = answer->chip_id;
+  return 1;
+}
+
+static int
+pn53x_sim_InCommunicateThru(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  uint8_t abtTx[SIM_BUFSIZE];
+  const uint8_t ui8TxBits = sim->abtRegisters[PN53X_REG_CIU_BitFraming] & SYMBOL_TX_LAST_BITS;
+  const bool bTxCrc = sim->abtRegisters[PN53X_REG_CIU_TxMode] & SYMBOL_TX_CRC_ENABLE;
+  const bool bRxCrc = sim->abtRegisters[PN53X_REG_CIU_RxMode] & SYMBOL_RX_CRC_ENABLE;
+  size_t szTx = szParams;
+  size_t szTxBits;
+  int res;
+
+  if ((szParams == 0) || (szParams > sizeof(abtTx)))
+    return pn53x_sim_status(pbtRx, EINVPARAM);
+  memcpy(abtTx, pbtParams, szParams);
+  szTxBits = ui8TxBits ? ((szTx - 1) * 8) + ui8TxBits : szTx * 8;
+  sim->abtRegisters[PN53X_REG_CIU_Control] &= ~SYMBOL_RX_LAST_BITS;
+  if (!sim->field)
+    return pn53x_sim_status(pbtRx, ETIMEOUT);
+
+  bool bCrc = false;
+  switch (sim->abtRegisters[PN53X_REG_CIU_TxMode] & SYMBOL_TX_FRAMING) {
+    case 0x00: // ISO/IEC 14443A and MIFARE
+      if (!bTxCrc && !ui8TxBits && (szTx >= 3)) {
+        // CRC appended by the host: it is checked then removed, except on anticollision frames
+        const bool bAnticol = ((abtTx[0] == 0x93) || (abtTx[0] == 0x95) || (abtTx[0] == 0x97)) && (abtTx[1] != 0x70);
+        uint8_t abtCrc[2];
+        iso14443a_crc(abtTx, szTx - 2, abtCrc);
+        if (!bAnticol && (abtCrc[0] == abtTx[szTx - 2]) && (abtCrc[1] == abtTx[szTx - 1])) {
+          szTx -= 2;
+          szTxBits -= 16;
+        }
+      }
+      res = pn53x_sim_thru_iso14443a(sim, abtTx, szTxBits, pbtRx + 1, &bCrc);
+      break;
+    case 0x02: // FeliCa
+      res = pn53x_sim_thru_felica(sim, abtTx, szTx, pbtRx + 1);
+      res = (res < 0) ? res : res * 8;
+      break;
+    case 0x03: // ISO/IEC 14443B
+      res = pn53x_sim_thru_iso14443b2sr(sim, abtTx, szTx, pbtRx + 1);
+      res = (res < 0) ? res : res * 8;
+      break;
+    default:
+      res = -ETIMEOUT;
+      break;
+  }
+  if (res < 0)
+    return pn53x_sim_status(pbtRx, (uint8_t)(-res));
+
+  size_t szRx = (size_t)(res + 7) / 8;
+  if (bCrc && !bRxCrc && !(res % 8)) {
+    iso14443a_crc_append(pbtRx + 1, szRx);
+    szRx += 2;
+  }
+  sim->abtRegisters[PN53X_REG_CIU_Control] |= (uint8_t)(res % 8);
+  pbtRx[0] = 0x00;
+  return (int)szRx + 1;
+}
+
+static int
+pn53x_sim_InDeselect(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx, const bool bRelease)
+{
+  const uint8_t tg = szParams ? pbtParams[0] : 0;
+
+  for (size_t n = 0; n < sim->target_count; n++) {
+    struct pn53x_sim_tag *tag = sim->targets[n];
+    if ((tg != 0) && (tg != n + 1))
+      continue;
+    // HLTA or S(DESELECT), FeliCa and Jewel tags have no such state
+    if ((tag->ops->nmt == NMT_ISO14443A) && (tag->state == SIM_TAG_ACTIVE))
+      tag->state = SIM_TAG_HALT;
+    tag->iso14443_4 = false;
+    if (tag == sim->thru_tag)
+      sim->thru_tag = NULL;
+  }
+  if (bRelease) {
+    if (tg == 0) {
+      sim->target_count = 0;
+    } else if (tg <= sim->target_count) {
+      memmove(sim->targets + tg - 1, sim->targets + tg, (sim->target_count - tg) * sizeof(sim->targets[0]));
+      sim->target_count--;
+    }
+  }
+  return pn53x_sim_status(pbtRx, 0x00);
+}
+
+static int
+pn53x_sim_InSelect(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  struct pn53x_sim_tag *tag;
+
+  if ((szParams < 1) || ((tag = pn53x_sim_target(sim, pbtParams[0])) == NULL))
+    return pn53x_sim_status(pbtRx, ECMD);
+  if (!pn53x_sim_tag_in_field(sim, tag))
+    return pn53x_sim_status(pbtRx, ETIMEOUT);
+  tag->state = SIM_TAG_ACTIVE;
+  sim->thru_tag = tag;
+  return pn53x_sim_status(pbtRx, 0x00);
+}
+
+/*
+ * Target commands
+ */
+
+static int
+pn53x_sim_TgInitAsTarget(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  static const uint8_t abtZero[6] = { 0 };
+
+  if (szParams < 35)
+    return NFC_EINVARG;
+  if (sim->initiator_frame_next == sim->initiator_frame_count) {
+    // No virtual initiator ever comes in the field
+    return NFC_ETIMEOUT;
+  }
+  const uint8_t ptm = pbtParams[0];
+  uint8_t mode;
+  if (ptm & PTM_DEP_ONLY) {
+    mode = 0x04; // DEP, passive, 106kbps
+  } else if (memcmp(pbtParams + 1, abtZero, sizeof(abtZero)) == 0) {
+    mode = 0x12; // FeliCa 212kbps
+  } else {
+    mode = 0x00; // MIFARE 106kbps
+  }
+  const struct pn53x_sim_frame *frame = sim->initiator_frames + sim->initiator_frame_next++;
+  pbtRx[0] = mode;
+  memcpy(pbtRx + 1, frame->abtData, frame->szData);
+  return (int)frame->szData + 1;
+}
+
+static int
+pn53x_sim_TgGetData(struct pn53x_sim *sim, uint8_t *pbtRx)
+{
+  if (sim->initiator_frame_next == sim->initiator_frame_count)
+    return pn53x_sim_status(pbtRx, ETGREL);
+  const struct pn53x_sim_frame *frame = sim->initiator_frames + sim->initiator_frame_next++;
+  pbtRx[0] = 0x00;
+  memcpy(pbtRx + 1, frame->abtData, frame->szData);
+  sim->abtRegisters[PN53X_REG_CIU_Control] &= ~SYMBOL_RX_LAST_BITS;
+  return (int)frame->szData + 1;
+}
+
+static int
+pn53x_sim_TgSetData(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  memcpy(sim->target_response.abtData, pbtParams, szParams);
+  sim->target_response.szData = szParams;
+  return pn53x_sim_status(pbtRx, 0x00);
+}
+
+/*
+ * Miscellaneous commands
+ */
+
+static int
+pn53x_sim_GetGeneralStatus(struct pn53x_sim *sim, uint8_t *pbtRx)
+{
+  size_t off = 0;
+  pbtRx[off++] = 0x00; // Last error
+  pbtRx[off++] = sim->field ? 0x01 : 0x00;
+  pbtRx[off++] = (uint8_t)sim->target_count;
+  for (size_t n = 0; n < sim->target_count; n++) {
+    pbtRx[off++] = (uint8_t)(n + 1);
+    pbtRx[off++] = 0x00; // BrRx
+    pbtRx[off++] = 0x00; // BrTx
+    pbtRx[off++] = (sim->targets[n]->ops->nmt == NMT_FELICA) ? 0x10 : 0x00;
+  }
+  pbtRx[off++] = 0x00; // SAM status
+  return (int)off;
+}
+
+static int
+pn53x_sim_ReadRegister(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  size_t off = 0;
+  if (sim->type == PN533)
+    pbtRx[off++] = 0x00;
+  for (size_t n = 0; n + 1 < szParams; n += 2) {
+    pbtRx[off++] = sim->abtRegisters[(pbtParams[n] << 8) | pbtParams[n + 1]];
+  }
+  return (int)off;
+}
+
+static int
+pn53x_sim_WriteRegister(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams, uint8_t *pbtRx)
+{
+  for (size_t n = 0; n + 2 < szParams; n += 3) {
+    sim->abtRegisters[(pbtParams[n] << 8) | pbtParams[n + 1]] = pbtParams[n + 2];
+  }
+  if (sim->type == PN533)
+    return pn53x_sim_status(pbtRx, 0x00);
+  return 0;
+}
+
+static int
+pn53x_sim_RFConfiguration(struct pn53x_sim *sim, const uint8_t *pbtParams, const size_t szParams)
+{
+  if (szParams < 2)
+    return NFC_EINVARG;
+  switch (pbtParams[0]) {
+    case 0x01: // RF field
+      pn53x_sim_set_field(sim, pbtParams[1] & 0x01);
+      break;
+    case 0x05: // MaxRetries: MxRtyATR, MxRtyPSL, MxRtyPassiveActivation
+      if (szParams >= 4)
+        sim->ui8MaxRtyPassiveActivation = pbtParams[3];
+      break;
+    default: // Timings and analog settings are not modeled
+      break;
+  }
+  return 0;
+}
+
+int
+pn53x_sim_command(struct pn53x_sim *sim, const uint8_t *pbtCmd, const size_t szCmd, uint8_t *pbtRx, const size_t szRxLen)
+{
+  uint8_t abtRx[SIM_BUFSIZE];
+  const uint8_t *pbtParams = pbtCmd + 1;
+  const size_t szParams = szCmd - 1;
+  int res;
+
+  if (szCmd < 1)
+    return NFC_EINVARG;
+  sim->command_count++;
+
+  switch (pbtCmd[0]) {
+    case Diagnose:
+      if ((szParams >= 1) && (pbtParams[0] == 0x00)) { // Communication line test, echo
+        memcpy(abtRx, pbtParams, szParams);
+        res = (int)szParams;
+      } else if ((szParams >= 1) && (pbtParams[0] == 0x06)) { // Card presence
+        const struct pn53x_sim_tag *tag = sim->thru_tag;
+        res = pn53x_sim_status(abtRx, (tag && pn53x_sim_tag_in_field(sim, tag)) ? 0x00 : ETIMEOUT);
+      } else {
+        res = pn53x_sim_status(abtRx, 0x00);
+      }
+      break;
+    case GetFirmwareVersion:
+      if (sim->type == PN532) {
+        memcpy(abtRx, "\x32\x01\x06\x07", 4);
+      } else {
+        memcpy(abtRx, "\x33\x02\x07\x07", 4);
+      }
+      res = 4;
+      break;
+    case GetGeneralStatus:
+      res = pn53x_sim_GetGeneralStatus(sim, abtRx);
+      break;
+    case ReadRegister:
+      res = pn53x_sim_ReadRegister(sim, pbtParams, szParams, abtRx);
+      break;
+    case WriteRegister:
+      res = pn53x_sim_WriteRegister(sim, pbtParams, szParams, abtRx);
+      break;
+    case ReadGPIO:
+      abtRx[0] = sim->abtRegisters[PN53X_SFR_P3];
+      abtRx[1] = sim->abtRegisters[PN53X_SFR_P7];
+      abtRx[2] = 0x00;
+      res = 3;
+      break;
+    case WriteGPIO:
+    case SetSerialBaudRate:
+    case SAMConfiguration:
+      res = 0;
+      break;
+    case SetParameters:
+      if (szParams < 1)
+        return NFC_EINVARG;
+      sim->ui8Parameters = pbtParams[0];
+      res = 0;
+      break;
+    case PowerDown:
+      res = pn53x_sim_status(abtRx, 0x00);
+      break;
+    case RFConfiguration:
+      res = pn53x_sim_RFConfiguration(sim, pbtParams, szParams);
+      break;
+    case InListPassiveTarget:
+      res = pn53x_sim_InListPassiveTarget(sim, pbtParams, szParams, abtRx);
+      break;
+    case InAutoPoll:
+      res = pn53x_sim_InAutoPoll(sim, pbtParams, szParams, abtRx);
+      break;
+    case InDataExchange:
+      res = pn53x_sim_InDataExchange(sim, pbtParams, szParams, abtRx);
+      break;
+    case InCommunicateThru:
+      res = pn53x_sim_InCommunicateThru(sim, pbtParams, szParams, abtRx);
+      break;
+    case InDeselect:
+      res = pn53x_sim_InDeselect(sim, pbtParams, szParams, abtRx, false);
+      break;
+    case InRelease:
+      res = pn53x_sim_InDeselect(sim, pbtParams, szParams, abtRx, true);
+      break;
+    case InSelect:
+      res = pn53x_sim_InSelect(sim, pbtParams, szParams, abtRx);
+      break;
+    case InPSL:
+      res = pn53x_sim_status(abtRx, 0x00);
+      break;
+    case InJumpForDEP:
+    case InJumpForPSL:
+    case InATR:
+      // No DEP target in the field
+      res = pn53x_sim_status(abtRx, ETIMEOUT);
+      break;
+    case TgInitAsTarget:
+      res = pn53x_sim_TgInitAsTarget(sim, pbtParams, szParams, abtRx);
+      break;
+    case TgGetData:
+    case TgGetInitiatorCommand:
+      res = pn53x_sim_TgGetData(sim, abtRx);
+      break;
+    case TgSetData:
+    case TgResponseToInitiator:
+      res = pn53x_sim_TgSetData(sim, pbtParams, szParams, abtRx);
+      break;
+    case TgSetGeneralBytes:
+    case TgSetMetaData:
+      res = pn53x_sim_status(abtRx, 0x00);
+      break;
+    case TgGetTargetStatus:
+      abtRx[0] = 0x01; // Activated
+      abtRx[1] = 0x00; // 106kbps
+      res = 2;
+      break;
+    default:
+      // The chip answers an unknown command with a syntax error frame
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Unsupported command %02x", pbtCmd[0]);
+      return NFC_EIO;
+  }
+  if (res < 0)
+    return res;
+  if ((size_t)res > szRxLen)
+    return NFC_EOVFLOW;
+  memcpy(pbtRx, abtRx, res);
+  return res;
+}
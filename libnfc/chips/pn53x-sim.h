@@ -0,0 +1,157 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn53x-sim.h
+ * @brief Software model of a PN53x chip and of the tags in its field
+ */
+
+#ifndef __NFC_CHIPS_PN53X_SIM_H__
+#  define __NFC_CHIPS_PN53X_SIM_H__
+
+#  include <stdbool.h>
+#  include <stdint.h>
+
+#  include <nfc/nfc-types.h>
+
+#  include "pn53x.h"
+
+#  define PN53X_SIM_MAX_TAGS          32
+#  define PN53X_SIM_MAX_FRAMES        16
+#  define PN53X_SIM_TAG_MEMORY_LEN    1024
+
+/**
+ * @enum pn53x_sim_tag_state
+ * @brief ISO/IEC 14443-3 like state of a virtual tag
+ */
+typedef enum {
+  SIM_TAG_IDLE,
+  SIM_TAG_READY,
+  SIM_TAG_ACTIVE,
+  SIM_TAG_HALT,
+} pn53x_sim_tag_state;
+
+struct pn53x_sim_tag;
+
+/**
+ * @struct pn53x_sim_tag_ops
+ * @brief Behaviour of a kind of virtual tag
+ *
+ * exchange() receives the frames sent by the initiator once the tag is
+ * selected, without CRC nor ISO/IEC 14443-4 block framing, and returns the
+ * length of the answer or a negated PN53x error code (eg. -ETIMEOUT for a
+ * mute tag). A zero length answer is an ACK for tags which use one.
+ */
+struct pn53x_sim_tag_ops {
+  const char *name;
+  nfc_modulation_type nmt;
+  void (*init)(struct pn53x_sim_tag *tag, const uint32_t serial);
+  void (*reset)(struct pn53x_sim_tag *tag);
+  int (*exchange)(struct pn53x_sim_tag *tag, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen);
+};
+
+/**
+ * @struct pn53x_sim_tag
+ * @brief Virtual tag placed in the field of a simulated PN53x
+ */
+struct pn53x_sim_tag {
+  const struct pn53x_sim_tag_ops *ops;
+  /** Identity of the tag, as it would be reported by libnfc */
+  nfc_target target;
+  /** Tag leaves the field when false */
+  bool present;
+  pn53x_sim_tag_state state;
+  /** Current cascade level during ISO/IEC 14443-3 anticollision */
+  uint8_t cascade_level;
+  /** ISO/IEC 14443-4 layer activated and its current block number */
+  bool iso14443_4;
+  uint8_t block_number;
+  /** MIFARE Classic authenticated sector, -1 if none */
+  int auth_sector;
+  /** ST SRx random Chip_ID and slot drawn by the last INITIATE or PCALL16 */
+  uint8_t chip_id;
+  /** Also the FeliCa time slot drawn by the last Polling */
+  uint8_t slot;
+  /** MIFARE Classic value transfer buffer */
+  uint8_t abtValue[4];
+  uint8_t abtMemory[PN53X_SIM_TAG_MEMORY_LEN];
+  size_t szMemory;
+};
+
+struct pn53x_sim_frame {
+  uint8_t abtData[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  size_t szData;
+};
+
+/**
+ * @struct pn53x_sim
+ * @brief State of a simulated PN53x chip
+ */
+struct pn53x_sim {
+  pn53x_type type;
+  uint8_t abtRegisters[0x10000];
+  uint8_t ui8Parameters;
+  bool field;
+  uint8_t ui8MaxRtyPassiveActivation;
+  struct pn53x_sim_tag *tags[PN53X_SIM_MAX_TAGS];
+  size_t tag_count;
+  uint32_t serial;
+  /** Pseudo random generator state (ST SRx Chip_ID) */
+  uint32_t random;
+  /** Targets listed by InListPassiveTarget, Tg is index + 1 */
+  struct pn53x_sim_tag *targets[2];
+  size_t target_count;
+  /** Tag currently addressed by InCommunicateThru */
+  struct pn53x_sim_tag *thru_tag;
+  /** Frames a virtual initiator sends while the chip is a target */
+  struct pn53x_sim_frame initiator_frames[PN53X_SIM_MAX_FRAMES];
+  size_t initiator_frame_count;
+  size_t initiator_frame_next;
+  /** Last frame sent as a target */
+  struct pn53x_sim_frame target_response;
+  /** Number of commands processed */
+  uint64_t command_count;
+};
+
+struct pn53x_sim *pn53x_sim_new(const pn53x_type type);
+void    pn53x_sim_free(struct pn53x_sim *sim);
+int     pn53x_sim_command(struct pn53x_sim *sim, const uint8_t *pbtCmd, const size_t szCmd, uint8_t *pbtRx, const size_t szRxLen);
+
+struct pn53x_sim_tag *pn53x_sim_add_tag(struct pn53x_sim *sim, const struct pn53x_sim_tag_ops *ops);
+int     pn53x_sim_add_tags(struct pn53x_sim *sim, const char *names);
+int     pn53x_sim_push_initiator_frame(struct pn53x_sim *sim, const uint8_t *pbtData, const size_t szData);
+
+const struct pn53x_sim_tag_ops *pn53x_sim_tag_ops_by_name(const char *name);
+
+extern const struct pn53x_sim_tag_ops pn53x_sim_mifare_classic_1k;
+extern const struct pn53x_sim_tag_ops pn53x_sim_mifare_ultralight;
+extern const struct pn53x_sim_tag_ops pn53x_sim_iso14443_4;
+extern const struct pn53x_sim_tag_ops pn53x_sim_felica;
+extern const struct pn53x_sim_tag_ops pn53x_sim_jewel;
+extern const struct pn53x_sim_tag_ops pn53x_sim_st25tb;
+
+#endif // __NFC_CHIPS_PN53X_SIM_H__
@@ -0,0 +1,211 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn53x-trace.c
+ * @brief Binary trace of PN53x frames exchanged at pn53x_io level
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+#include "pn53x-trace.h"
+
+#define LOG_CATEGORY "libnfc.chip.pn53x.trace"
+#define LOG_GROUP    NFC_LOG_GROUP_CHIP
+
+#define PN53X_TRACE_HEADER_LEN 12
+#define PN53X_TRACE_RECORD_LEN 18
+
+struct pn53x_trace {
+  FILE *f;
+  uint64_t start;
+};
+
+static uint64_t
+pn53x_trace_now(void)
+{
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+  return (uint64_t)time(NULL) * 1000000000ULL;
+}
+
+static void
+le_put(uint8_t *pbt, uint64_t value, const size_t sz)
+{
+  for (size_t n = 0; n < sz; n++) {
+    pbt[n] = value & 0xff;
+    value >>= 8;
+  }
+}
+
+static uint64_t
+le_get(const uint8_t *pbt, const size_t sz)
+{
+  uint64_t value = 0;
+  for (size_t n = sz; n > 0; n--) {
+    value = (value << 8) | pbt[n - 1];
+  }
+  return value;
+}
+
+struct pn53x_trace *
+pn53x_trace_new(const char *path, const nfc_connstring connstring)
+{
+  struct pn53x_trace *trace = malloc(sizeof(struct pn53x_trace));
+  if (!trace) {
+    return NULL;
+  }
+  if ((trace->f = fopen(path, "wb")) == NULL) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to open trace file %s", path);
+    free(trace);
+    return NULL;
+  }
+  trace->start = pn53x_trace_now();
+
+  size_t szConnstring = strlen(connstring);
+  uint8_t abtHeader[PN53X_TRACE_HEADER_LEN];
+  memcpy(abtHeader, PN53X_TRACE_MAGIC, 8);
+  le_put(abtHeader + 8, PN53X_TRACE_VERSION, 2);
+  le_put(abtHeader + 10, szConnstring, 2);
+  if ((fwrite(abtHeader, sizeof(abtHeader), 1, trace->f) != 1) ||
+      (fwrite(connstring, 1, szConnstring, trace->f) != szConnstring)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to write trace file %s", path);
+    pn53x_trace_free(trace);
+    return NULL;
+  }
+  log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Tracing %s to %s", connstring, path);
+  return trace;
+}
+
+void
+pn53x_trace_put(struct pn53x_trace *trace, const uint8_t direction, const uint8_t command, const uint8_t status,
+                const int result, const uint8_t *pbtData, const size_t szData)
+{
+  uint8_t abtRecord[PN53X_TRACE_RECORD_LEN];
+  const size_t szLen = MIN(szData, PN53x_EXTENDED_FRAME__DATA_MAX_LEN);
+
+  le_put(abtRecord, pn53x_trace_now() - trace->start, 8);
+  abtRecord[8] = direction;
+  abtRecord[9] = command;
+  abtRecord[10] = status;
+  abtRecord[11] = 0;
+  le_put(abtRecord + 12, (uint32_t)result, 4);
+  le_put(abtRecord + 16, szLen, 2);
+  if ((fwrite(abtRecord, sizeof(abtRecord), 1, trace->f) != 1) ||
+      (fwrite(pbtData, 1, szLen, trace->f) != szLen)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to write trace record");
+  }
+  // Keep the trace usable even if the process does not exit cleanly
+  fflush(trace->f);
+}
+
+void
+pn53x_trace_free(struct pn53x_trace *trace)
+{
+  if (trace) {
+    fclose(trace->f);
+    free(trace);
+  }
+}
+
+int
+pn53x_trace_load(const char *path, nfc_connstring connstring, struct pn53x_trace_frame **frames, size_t *frame_count)
+{
+  FILE *f;
+  uint8_t abtHeader[PN53X_TRACE_HEADER_LEN];
+  uint8_t abtRecord[PN53X_TRACE_RECORD_LEN];
+  size_t szFrames = 0;
+  size_t szAllocated = 0;
+  struct pn53x_trace_frame *pFrames = NULL;
+
+  if ((f = fopen(path, "rb")) == NULL) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to open trace file %s", path);
+    return NFC_EIO;
+  }
+  if ((fread(abtHeader, sizeof(abtHeader), 1, f) != 1) ||
+      (memcmp(abtHeader, PN53X_TRACE_MAGIC, 8) != 0) ||
+      (le_get(abtHeader + 8, 2) != PN53X_TRACE_VERSION)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s is not a PN53x trace file", path);
+    fclose(f);
+    return NFC_EINVARG;
+  }
+  size_t szConnstring = le_get(abtHeader + 10, 2);
+  char acConnstring[NFC_BUFSIZE_CONNSTRING];
+  if ((szConnstring >= sizeof(acConnstring)) || (fread(acConnstring, 1, szConnstring, f) != szConnstring)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s: invalid trace header", path);
+    fclose(f);
+    return NFC_EINVARG;
+  }
+  acConnstring[szConnstring] = '\0';
+  if (connstring) {
+    memcpy(connstring, acConnstring, szConnstring + 1);
+  }
+
+  while (fread(abtRecord, sizeof(abtRecord), 1, f) == 1) {
+    if (szFrames == szAllocated) {
+      szAllocated = szAllocated ? szAllocated * 2 : 64;
+      struct pn53x_trace_frame *pNew = realloc(pFrames, szAllocated * sizeof(struct pn53x_trace_frame));
+      if (!pNew) {
+        free(pFrames);
+        fclose(f);
+        return NFC_ESOFT;
+      }
+      pFrames = pNew;
+    }
+    struct pn53x_trace_frame *pFrame = pFrames + szFrames;
+    pFrame->timestamp = le_get(abtRecord, 8);
+    pFrame->direction = abtRecord[8];
+    pFrame->command = abtRecord[9];
+    pFrame->status = abtRecord[10];
+    pFrame->result = (int32_t)(uint32_t)le_get(abtRecord + 12, 4);
+    pFrame->len = le_get(abtRecord + 16, 2);
+    if ((pFrame->len > sizeof(pFrame->data)) || (fread(pFrame->data, 1, pFrame->len, f) != pFrame->len)) {
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s: truncated record #%" PRIuPTR, path, szFrames);
+      break;
+    }
+    szFrames++;
+  }
+  fclose(f);
+
+  log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%" PRIuPTR " frame(s) loaded from %s (%s)", szFrames, path, acConnstring);
+  *frames = pFrames;
+  *frame_count = szFrames;
+  return NFC_SUCCESS;
+}
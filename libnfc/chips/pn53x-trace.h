@@ -0,0 +1,87 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn53x-trace.h
+ * @brief Binary trace of PN53x frames exchanged at pn53x_io level
+ */
+
+#ifndef __NFC_CHIPS_PN53X_TRACE_H__
+#  define __NFC_CHIPS_PN53X_TRACE_H__
+
+#  include <stdint.h>
+#  include <stdio.h>
+
+#  include <nfc/nfc-types.h>
+
+#  include "pn53x-internal.h"
+
+/** @note PN53x trace file format, all integers are little-endian:
+ *
+ * File header:
+ *   8 bytes  magic "NFCTRACE"
+ *   2 bytes  format version (PN53X_TRACE_VERSION)
+ *   2 bytes  connstring length N
+ *   N bytes  connstring of the traced device (not NUL terminated)
+ *
+ * Then one record per frame:
+ *   8 bytes  timestamp, in ns since the trace was started
+ *   1 byte   direction (PN53X_TRACE_TX or PN53X_TRACE_RX)
+ *   1 byte   PN53x command code
+ *   1 byte   PN53x status byte (RX only, 0 for TX)
+ *   1 byte   reserved, 0
+ *   4 bytes  signed result of pn53x_io send/receive (length or NFC_E* error)
+ *   2 bytes  data length L
+ *   L bytes  data: the command (TX) or the response (RX) as seen by
+ *            pn53x_transceive(), without any transport framing
+ */
+#  define PN53X_TRACE_MAGIC          "NFCTRACE"
+#  define PN53X_TRACE_VERSION        1
+
+#  define PN53X_TRACE_TX             0
+#  define PN53X_TRACE_RX             1
+
+struct pn53x_trace_frame {
+  uint64_t timestamp;
+  uint8_t direction;
+  uint8_t command;
+  uint8_t status;
+  int32_t result;
+  uint16_t len;
+  uint8_t data[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+};
+
+struct pn53x_trace;
+
+struct pn53x_trace *pn53x_trace_new(const char *path, const nfc_connstring connstring);
+void    pn53x_trace_put(struct pn53x_trace *trace, const uint8_t direction, const uint8_t command, const uint8_t status,
+                        const int result, const uint8_t *pbtData, const size_t szData);
+void    pn53x_trace_free(struct pn53x_trace *trace);
+
+int     pn53x_trace_load(const char *path, nfc_connstring connstring, struct pn53x_trace_frame **frames, size_t *frame_count);
+
+#endif // __NFC_CHIPS_PN53X_TRACE_H__
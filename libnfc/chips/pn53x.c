@@ -34,6 +34,7 @@
 #  include "config.h"
 #endif // HAVE_CONFIG_H
 
+#include <ctype.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -44,8 +45,8 @@
 #include "nfc-internal.h"
 #include "pn53x.h"
 #include "pn53x-internal.h"
+#include "pn53x-trace.h"
 
-#include "mirror-subr.h"
 
 #define LOG_CATEGORY "libnfc.chip.pn53x"
 #define LOG_GROUP NFC_LOG_GROUP_CHIP
@@ -66,6 +67,7 @@ const nfc_modulation_type pn53x_supported_modulation_as_target[] = {NMT_ISO14443
 /* prototypes */
 int pn53x_reset_settings(struct nfc_device *pnd);
 int pn53x_writeback_register(struct nfc_device *pnd);
+static int pn53x_RFConfiguration_send(struct nfc_device *pnd, const size_t n, const uint8_t *pbtValue);
 
 nfc_modulation pn53x_ptt_to_nm(const pn53x_target_type ptt);
 pn53x_modulation pn53x_nm_to_pm(const nfc_modulation nm);
@@ -145,9 +147,12 @@ pn53x_reset_settings(struct nfc_device *pnd)
 {
   int res = 0;
   // Reset the ending transmission bits register, it is unknown what the last tranmission used there
-  CHIP_DATA(pnd)->ui8TxBits = 0;
-  if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_BitFraming, SYMBOL_TX_LAST_BITS, 0x00)) < 0) {
-    return res;
+  // unless the initiator settings are still in effect
+  if (!CHIP_DATA(pnd)->initiator_defaults || (CHIP_DATA(pnd)->ui8TxBits != 0)) {
+    CHIP_DATA(pnd)->ui8TxBits = 0;
+    if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_BitFraming, SYMBOL_TX_LAST_BITS, 0x00)) < 0) {
+      return res;
+    }
   }
   // Make sure we reset the CRC and parity to chip handling.
   if ((res = pn53x_set_property_bool(pnd, NP_HANDLE_CRC, true)) < 0)
@@ -164,10 +169,185 @@ pn53x_reset_settings(struct nfc_device *pnd)
   return NFC_SUCCESS;
 }
 
+/*
+ * The register shadow holds the last value read from or written to each
+ * register of the write-back window, so masked writes and reads of registers
+ * which only change when libnfc writes them cost no ReadRegister round trip.
+ * Registers the CIU or the firmware update on their own are never shadowed,
+ * and commands letting the firmware reprogram the CIU invalidate the shadow.
+ */
+static bool
+pn53x_register_is_cacheable(const uint16_t ui16RegisterAddress)
+{
+  if ((ui16RegisterAddress < PN53X_CACHE_REGISTER_MIN_ADDRESS) || (ui16RegisterAddress > PN53X_CACHE_REGISTER_MAX_ADDRESS))
+    return false;
+  switch (ui16RegisterAddress) {
+    case 0x630F: // Reserved
+    case 0x6310: // Reserved
+    case PN53X_REG_CIU_CRCResultMSB:
+    case PN53X_REG_CIU_CRCResultLSB:
+    // Timer is also programmed by the firmware for its own timeouts
+    case PN53X_REG_CIU_TMode:
+    case PN53X_REG_CIU_TPrescaler:
+    case PN53X_REG_CIU_TReloadVal_hi:
+    case PN53X_REG_CIU_TReloadVal_lo:
+    case PN53X_REG_CIU_TCounterVal_hi:
+    case PN53X_REG_CIU_TCounterVal_lo:
+    case 0x6320: // Reserved
+    case PN53X_REG_CIU_TestBus:
+    case PN53X_REG_CIU_AutoTest:
+    case PN53X_REG_CIU_TestADC:
+    case 0x632C: // Reserved
+    case 0x632D: // Reserved
+    case 0x632E: // Reserved
+    case PN53X_REG_CIU_RFlevelDet:
+    case PN53X_REG_CIU_Command:
+    case PN53X_REG_CIU_CommIEn:
+    case PN53X_REG_CIU_DivIEn:
+    case PN53X_REG_CIU_CommIrq:
+    case PN53X_REG_CIU_DivIrq:
+    case PN53X_REG_CIU_Error:
+    case PN53X_REG_CIU_Status1:
+    case PN53X_REG_CIU_Status2:
+    case PN53X_REG_CIU_FIFOData:
+    case PN53X_REG_CIU_FIFOLevel:
+    case PN53X_REG_CIU_Control:
+    case PN53X_REG_CIU_Coll:
+      return false;
+  }
+  return true;
+}
+
+static void
+pn53x_shadow_invalidate(struct nfc_device *pnd)
+{
+  memset(CHIP_DATA(pnd)->sh_valid, false, sizeof(CHIP_DATA(pnd)->sh_valid));
+}
+
+static void
+pn53x_shadow_set(struct nfc_device *pnd, const uint16_t ui16RegisterAddress, const uint8_t ui8Value)
+{
+  if (pn53x_register_is_cacheable(ui16RegisterAddress)) {
+    const int internal_address = ui16RegisterAddress - PN53X_CACHE_REGISTER_MIN_ADDRESS;
+    CHIP_DATA(pnd)->sh_data[internal_address] = ui8Value;
+    CHIP_DATA(pnd)->sh_valid[internal_address] = true;
+  }
+}
+
+/*
+ * CHIP_DATA(pnd)->initiator_defaults is set by pn53x_initiator_init() once the
+ * CIU holds the settings nfc_initiator_init() asks for. The firmware leaves
+ * the CIU in that configuration when it drives an ISO14443-A 106 kbps target,
+ * so the flag survives such commands and a repeated initiator init only sends
+ * what really changed in between. Any other command or a setting changed away
+ * from its default clears it. A MIFARE authentication only leaves the Crypto1
+ * state unknown.
+ */
+static int
+pn53x_initiator_default(const nfc_property property)
+{
+  switch (property) {
+    case NP_HANDLE_CRC:
+    case NP_HANDLE_PARITY:
+    case NP_FORCE_ISO14443_A:
+    case NP_FORCE_SPEED_106:
+      return true;
+    case NP_ACTIVATE_CRYPTO1:
+    case NP_ACCEPT_INVALID_FRAMES:
+    case NP_ACCEPT_MULTIPLE_FRAMES:
+    case NP_FORCE_ISO14443_B:
+      return false;
+    default:
+      // Not a CIU setting
+      return -1;
+  }
+}
+
+// Update the shadow for a command which has just been sent to the chip
+static void
+pn53x_shadow_submit(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx)
+{
+  switch (pbtTx[0]) {
+    case ReadRegister:
+      CHIP_DATA(pnd)->register_stats.round_trips++;
+      break;
+    case WriteRegister:
+      CHIP_DATA(pnd)->register_stats.round_trips++;
+      for (size_t n = 1; n + 2 < szTx; n += 3) {
+        pn53x_shadow_set(pnd, (pbtTx[n] << 8) | pbtTx[n + 1], pbtTx[n + 2]);
+      }
+      break;
+    case GetFirmwareVersion:
+    case GetGeneralStatus:
+    case ReadGPIO:
+    case WriteGPIO:
+    case SetParameters:
+    case InCommunicateThru:
+      // These commands leave CIU settings alone
+      break;
+    case RFConfiguration:
+      if ((szTx > 1) && ((pbtTx[1] == RFCI_TIMING) || (pbtTx[1] == RFCI_RETRY_DATA) || (pbtTx[1] == RFCI_RETRY_SELECT)))
+        break;
+      if ((szTx > 1) && (pbtTx[1] == RFCI_FIELD)) {
+        CHIP_DATA(pnd)->sh_valid[PN53X_REG_CIU_TxControl - PN53X_CACHE_REGISTER_MIN_ADDRESS] = false;
+        CHIP_DATA(pnd)->sh_valid[PN53X_REG_CIU_TxAuto - PN53X_CACHE_REGISTER_MIN_ADDRESS] = false;
+        break;
+      }
+      pn53x_shadow_invalidate(pnd);
+      CHIP_DATA(pnd)->initiator_defaults = false;
+      break;
+    case InListPassiveTarget:
+      if ((szTx > 2) && (pbtTx[2] != PM_ISO14443A_106))
+        CHIP_DATA(pnd)->initiator_defaults = false;
+      pn53x_shadow_invalidate(pnd);
+      break;
+    case InDataExchange:
+      // MIFARE Classic authentication switches Crypto1 on
+      if ((szTx > 2) && ((pbtTx[2] == 0x60) || (pbtTx[2] == 0x61)))
+        CHIP_DATA(pnd)->crypto1_off = false;
+      pn53x_shadow_invalidate(pnd);
+      break;
+    case InSelect:
+    case InDeselect:
+    case InRelease:
+      pn53x_shadow_invalidate(pnd);
+      break;
+    default:
+      // The firmware may reprogram the CIU (e.g. while activating a target)
+      pn53x_shadow_invalidate(pnd);
+      CHIP_DATA(pnd)->initiator_defaults = false;
+      break;
+  }
+}
+
+// Record the values answered to a ReadRegister command
+static void
+pn53x_shadow_complete(struct nfc_device *pnd, const uint8_t *pbtTx, const uint8_t *pbtRx, const size_t szRx)
+{
+  // PN533 prepends its answer by a status byte
+  const size_t off = (CHIP_DATA(pnd)->type == PN533) ? 1 : 0;
+  for (size_t n = off; n < szRx; n++) {
+    const size_t i = 1 + ((n - off) * 2);
+    pn53x_shadow_set(pnd, (pbtTx[i] << 8) | pbtTx[i + 1], pbtRx[n]);
+  }
+}
+
+/*
+ * pn53x_transceive() is made of a submit half, which sends the command frame
+ * and gets it ACKed by the chip, and a completion half, which reads the
+ * response, follows MI chaining and maps the status byte to a libnfc error.
+ * Blocking callers run both back to back; the event loop (nfc-loop.c) lets
+ * the device become readable in between.
+ */
+static int
+pn53x_command_timeout(struct nfc_device *pnd, int timeout)
+{
+  return (timeout == -1) ? CHIP_DATA(pnd)->timeout_command : timeout;
+}
+
 int
-pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen, int timeout)
+pn53x_transceive_submit(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, int timeout)
 {
-  bool mi = false;
   int res = 0;
   if (CHIP_DATA(pnd)->wb_trigged) {
     if ((res = pn53x_writeback_register(pnd)) < 0) {
@@ -186,30 +366,59 @@ pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Invalid timeout value: %d", timeout);
   }
 
-  uint8_t  abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
-  size_t  szRx = sizeof(abtRx);
-
-  // Check if receiving buffers are available, if not, replace them
-  if (szRxLen == 0 || !pbtRx) {
-    pbtRx = abtRx;
-  } else {
-    szRx = szRxLen;
+  // Call the send callback function of the current driver
+  res = CHIP_DATA(pnd)->io->send(pnd, pbtTx, szTx, timeout);
+  if (CHIP_DATA(pnd)->trace) {
+    pn53x_trace_put(CHIP_DATA(pnd)->trace, PN53X_TRACE_TX, pbtTx[0], 0, res, pbtTx, szTx);
   }
-
-  // Call the send/receice callback functions of the current driver
-  if ((res = CHIP_DATA(pnd)->io->send(pnd, pbtTx, szTx, timeout)) < 0) {
+  if (res < 0) {
     return res;
   }
 
   // Command is sent, we store the command
   CHIP_DATA(pnd)->last_command = pbtTx[0];
+  pn53x_shadow_submit(pnd, pbtTx, szTx);
 
   // Handle power mode for PN532
   if ((CHIP_DATA(pnd)->type == PN532) && (TgInitAsTarget == pbtTx[0])) {  // PN532 automatically goes into PowerDown mode when TgInitAsTarget command will be sent
     CHIP_DATA(pnd)->power_mode = POWERDOWN;
   }
+  return NFC_SUCCESS;
+}
+
+/*
+ * \a pbtTx is the command given to pn53x_transceive_submit(): its first two
+ * bytes are sent again to fetch the next part of a chained (MI) response.
+ */
+int
+pn53x_transceive_complete(struct nfc_device *pnd, const uint8_t *pbtTx, uint8_t *pbtRx, const size_t szRxLen, int timeout)
+{
+  bool mi = false;
+  int res = 0;
+
+  timeout = pn53x_command_timeout(pnd, timeout);
+
+  uint8_t  abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  size_t  szRx = sizeof(abtRx);
+
+  // Check if receiving buffers are available, if not, replace them
+  if (szRxLen == 0 || !pbtRx) {
+    pbtRx = abtRx;
+  } else {
+    szRx = szRxLen;
+  }
 
+  // Call the receive callback function of the current driver
   if ((res = CHIP_DATA(pnd)->io->receive(pnd, pbtRx, szRx, timeout)) < 0) {
+    if (CHIP_DATA(pnd)->trace) {
+      pn53x_trace_put(CHIP_DATA(pnd)->trace, PN53X_TRACE_RX, pbtTx[0], 0, res, NULL, 0);
+    }
+    if (pbtTx[0] == WriteRegister) {
+      // We can't tell which registers have been written
+      pn53x_shadow_invalidate(pnd);
+      CHIP_DATA(pnd)->initiator_defaults = false;
+      CHIP_DATA(pnd)->crypto1_off = false;
+    }
     return res;
   }
 
@@ -266,15 +475,26 @@ pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx
     default:
       CHIP_DATA(pnd)->last_status_byte = 0;
   }
+  if (CHIP_DATA(pnd)->trace) {
+    pn53x_trace_put(CHIP_DATA(pnd)->trace, PN53X_TRACE_RX, pbtTx[0], CHIP_DATA(pnd)->last_status_byte, res, pbtRx, res);
+  }
 
   while (mi) {
     int res2;
     uint8_t  abtRx2[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
     // Send empty command to card
-    if ((res2 = CHIP_DATA(pnd)->io->send(pnd, pbtTx, 2, timeout)) < 0) {
+    res2 = CHIP_DATA(pnd)->io->send(pnd, pbtTx, 2, timeout);
+    if (CHIP_DATA(pnd)->trace) {
+      pn53x_trace_put(CHIP_DATA(pnd)->trace, PN53X_TRACE_TX, pbtTx[0], 0, res2, pbtTx, 2);
+    }
+    if (res2 < 0) {
       return res2;
     }
-    if ((res2 = CHIP_DATA(pnd)->io->receive(pnd, abtRx2, sizeof(abtRx2), timeout)) < 0) {
+    res2 = CHIP_DATA(pnd)->io->receive(pnd, abtRx2, sizeof(abtRx2), timeout);
+    if (CHIP_DATA(pnd)->trace) {
+      pn53x_trace_put(CHIP_DATA(pnd)->trace, PN53X_TRACE_RX, pbtTx[0], (res2 > 0) ? (abtRx2[0] & 0x3f) : 0, res2, abtRx2, (res2 > 0) ? res2 : 0);
+    }
+    if (res2 < 0) {
       return res2;
     }
     mi = abtRx2[0] & 0x40;
@@ -341,15 +561,38 @@ pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx
   if (res < 0) {
     pnd->last_error = res;
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Chip error: \"%s\" (%02x), returned error: \"%s\" (%d))", pn53x_strerror(pnd), CHIP_DATA(pnd)->last_status_byte, nfc_strerror(pnd), res);
+    if (pbtTx[0] == WriteRegister) {
+      pn53x_shadow_invalidate(pnd);
+      CHIP_DATA(pnd)->initiator_defaults = false;
+      CHIP_DATA(pnd)->crypto1_off = false;
+    }
   } else {
     pnd->last_error = 0;
+    if (pbtTx[0] == ReadRegister) {
+      pn53x_shadow_complete(pnd, pbtTx, pbtRx, szRx);
+    }
   }
   return res;
 }
 
+int
+pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen, int timeout)
+{
+  int res;
+  if ((res = pn53x_transceive_submit(pnd, pbtTx, szTx, timeout)) < 0)
+    return res;
+  return pn53x_transceive_complete(pnd, pbtTx, pbtRx, szRxLen, timeout);
+}
+
 int
 pn53x_set_parameters(struct nfc_device *pnd, const uint8_t ui8Parameter, const bool bEnable)
 {
+  if (CHIP_DATA(pnd)->property_batch) {
+    // Sent by pn53x_commit_properties()
+    uint8_t *pui8Pending = &CHIP_DATA(pnd)->ui8ParametersPending;
+    *pui8Pending = (bEnable) ? (*pui8Pending | ui8Parameter) : (*pui8Pending & ~(ui8Parameter));
+    return NFC_SUCCESS;
+  }
   uint8_t ui8Value = (bEnable) ? (CHIP_DATA(pnd)->ui8Parameters | ui8Parameter) : (CHIP_DATA(pnd)->ui8Parameters & ~(ui8Parameter));
   if (ui8Value != CHIP_DATA(pnd)->ui8Parameters) {
     return pn53x_SetParameters(pnd, ui8Value);
@@ -373,107 +616,149 @@ pn53x_set_tx_bits(struct nfc_device *pnd, const uint8_t ui8Bits)
   return NFC_SUCCESS;
 }
 
+/*
+ * On the air, ISO14443-A sends each data byte LSB first followed by its
+ * parity bit. Seen as a little-endian bit stream, 8 data bytes and their 8
+ * parity bits fill exactly 9 frame bytes, so frames are (un)wrapped one
+ * 64-bit word at a time: byte j of the word lands at stream bit 9 * j.
+ */
+static inline uint64_t
+pn53x_load_le(const uint8_t *pbt, const size_t sz)
+{
+  uint64_t ui64 = 0;
+  for (size_t n = 0; n < sz; n++) {
+    ui64 |= (uint64_t)pbt[n] << (8 * n);
+  }
+  return ui64;
+}
+
+static inline void
+pn53x_store_le(uint8_t *pbt, uint64_t ui64, const size_t sz)
+{
+  for (size_t n = 0; n < sz; n++) {
+    pbt[n] = (uint8_t)(ui64 >> (8 * n));
+  }
+}
+
+// Odd parity of each byte of ui64Data, in bit 0 of that byte
+static inline uint64_t
+pn53x_odd_parity64(uint64_t ui64Data)
+{
+  ui64Data ^= ui64Data >> 4;
+  ui64Data ^= ui64Data >> 2;
+  ui64Data ^= ui64Data >> 1;
+  return ~ui64Data & 0x0101010101010101ULL;
+}
+
+// Interleave 8 data bytes and their parity (bit 0 of each byte of ui64Par) into 9 frame bytes
+static inline void
+pn53x_wrap_word(const uint64_t ui64Data, const uint64_t ui64Par, uint8_t *pbtFrame)
+{
+  uint64_t ui64Frame = 0;
+  for (unsigned j = 0; j < 7; j++) {
+    ui64Frame |= (((ui64Data >> (8 * j)) & 0xff) | (((ui64Par >> (8 * j)) & 0x01) << 8)) << (9 * j);
+  }
+  const uint64_t ui64Last = (ui64Data >> 56) | (((ui64Par >> 56) & 0x01) << 8);
+  ui64Frame |= ui64Last << 63;
+  pn53x_store_le(pbtFrame, ui64Frame, 8);
+  pbtFrame[8] = (uint8_t)(ui64Last >> 1);
+}
+
+// Split 9 frame bytes into 8 data bytes and their parity bits
+static inline uint64_t
+pn53x_unwrap_word(const uint64_t ui64Frame, const uint8_t btFrameHigh, uint64_t *pui64Par)
+{
+  uint64_t ui64Data = 0;
+  uint64_t ui64Par = 0;
+  for (unsigned j = 0; j < 7; j++) {
+    ui64Data |= ((ui64Frame >> (9 * j)) & 0xff) << (8 * j);
+    ui64Par |= ((ui64Frame >> (9 * j + 8)) & 0x01) << (8 * j);
+  }
+  ui64Data |= (((ui64Frame >> 63) | ((uint64_t)btFrameHigh << 1)) & 0xff) << 56;
+  ui64Par |= (uint64_t)(btFrameHigh >> 7) << 56;
+  *pui64Par = ui64Par;
+  return ui64Data;
+}
+
+/*
+ * Builds the frame of szTxBits data bits with a parity bit after each byte.
+ * Parity bits are taken from bit 0 of each pbtTxPar byte or, when pbtTxPar
+ * is NULL, computed as the ISO14443-A odd parity of the data.
+ */
 int
 pn53x_wrap_frame(const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar,
                  uint8_t *pbtFrame)
 {
-  uint8_t  btData;
-  uint32_t uiBitPos;
-  uint32_t uiDataPos = 0;
-  size_t  szBitsLeft = szTxBits;
-  size_t szFrameBits = 0;
-
   // Make sure we should frame at least something
-  if (szBitsLeft == 0)
+  if (szTxBits == 0)
     return NFC_ECHIP;
 
   // Handle a short response (1byte) as a special case
-  if (szBitsLeft < 9) {
+  if (szTxBits < 9) {
     *pbtFrame = *pbtTx;
-    szFrameBits = szTxBits;
-    return szFrameBits;
-  }
-  // We start by calculating the frame length in bits
-  szFrameBits = szTxBits + (szTxBits / 8);
-
-  // Parse the data bytes and add the parity bits
-  // This is really a sensitive process, mirror the frame bytes and append parity bits
-  // buffer = mirror(frame-byte) + parity + mirror(frame-byte) + parity + ...
-  // split "buffer" up in segments of 8 bits again and mirror them
-  // air-bytes = mirror(buffer-byte) + mirror(buffer-byte) + mirror(buffer-byte) + ..
-  while (true) {
-    // Reset the temporary frame byte;
-    uint8_t  btFrame = 0;
-
-    for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
-      // Copy as much data that fits in the frame byte
-      btData = mirror(pbtTx[uiDataPos]);
-      btFrame |= (btData >> uiBitPos);
-      // Save this frame byte
-      *pbtFrame = mirror(btFrame);
-      // Set the remaining bits of the date in the new frame byte and append the parity bit
-      btFrame = (btData << (8 - uiBitPos));
-      btFrame |= ((pbtTxPar[uiDataPos] & 0x01) << (7 - uiBitPos));
-      // Backup the frame bits we have so far
-      pbtFrame++;
-      *pbtFrame = mirror(btFrame);
-      // Increase the data (without parity bit) position
-      uiDataPos++;
-      // Test if we are done
-      if (szBitsLeft < 9)
-        return szFrameBits;
-      szBitsLeft -= 8;
-    }
-    // Every 8 data bytes we lose one frame byte to the parities
-    pbtFrame++;
-  }
+    return szTxBits;
+  }
+
+  const size_t szTxBytes = (szTxBits + 7) / 8;
+  size_t n;
+  for (n = 0; n + 8 <= szTxBytes; n += 8) {
+    const uint64_t ui64Data = pn53x_load_le(pbtTx + n, 8);
+    const uint64_t ui64Par = pbtTxPar ? (pn53x_load_le(pbtTxPar + n, 8) & 0x0101010101010101ULL) : pn53x_odd_parity64(ui64Data);
+    pn53x_wrap_word(ui64Data, ui64Par, pbtFrame);
+    pbtFrame += 9;
+  }
+  if (n < szTxBytes) {
+    // Last bytes: only the frame bytes they touch are written
+    const size_t szLeft = szTxBytes - n;
+    const uint64_t ui64Mask = ((uint64_t)1 << (8 * szLeft)) - 1;
+    const uint64_t ui64Data = pn53x_load_le(pbtTx + n, szLeft);
+    const uint64_t ui64Par = pbtTxPar ? (pn53x_load_le(pbtTxPar + n, szLeft) & 0x0101010101010101ULL) : (pn53x_odd_parity64(ui64Data) & ui64Mask);
+    uint8_t abtWord[9];
+    pn53x_wrap_word(ui64Data, ui64Par, abtWord);
+    memcpy(pbtFrame, abtWord, (9 * szLeft + 7) / 8);
+  }
+  // Every data byte but a trailing partial one gets a parity bit
+  return szTxBits + (szTxBits / 8);
 }
 
 int
 pn53x_unwrap_frame(const uint8_t *pbtFrame, const size_t szFrameBits, uint8_t *pbtRx, uint8_t *pbtRxPar)
 {
-  uint8_t  btFrame;
-  uint8_t  btData;
-  uint8_t uiBitPos;
-  uint32_t uiDataPos = 0;
-  uint8_t *pbtFramePos = (uint8_t *) pbtFrame;
-  size_t  szBitsLeft = szFrameBits;
-  size_t szRxBits = 0;
-
   // Make sure we should frame at least something
-  if (szBitsLeft == 0)
+  if (szFrameBits == 0)
     return NFC_ECHIP;
 
   // Handle a short response (1byte) as a special case
-  if (szBitsLeft < 9) {
+  if (szFrameBits < 9) {
     *pbtRx = *pbtFrame;
-    szRxBits = szFrameBits;
-    return szRxBits;
+    return szFrameBits;
   }
+
   // Calculate the data length in bits
-  szRxBits = szFrameBits - (szFrameBits / 9);
-
-  // Parse the frame bytes, remove the parity bits and store them in the parity array
-  // This process is the reverse of WrapFrame(), look there for more info
-  while (true) {
-    for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
-      btFrame = mirror(pbtFramePos[uiDataPos]);
-      btData = (btFrame << uiBitPos);
-      btFrame = mirror(pbtFramePos[uiDataPos + 1]);
-      btData |= (btFrame >> (8 - uiBitPos));
-      pbtRx[uiDataPos] = mirror(btData);
-      if (pbtRxPar != NULL)
-        pbtRxPar[uiDataPos] = ((btFrame >> (7 - uiBitPos)) & 0x01);
-      // Increase the data (without parity bit) position
-      uiDataPos++;
-      // Test if we are done
-      if (szBitsLeft < 9)
-        return szRxBits;
-      szBitsLeft -= 9;
-    }
-    // Every 8 data bytes we lose one frame byte to the parities
-    pbtFramePos++;
+  const size_t szRxBits = szFrameBits - (szFrameBits / 9);
+  const size_t szRxBytes = (szRxBits + 7) / 8;
+  const size_t szFrameBytes = (szFrameBits + 7) / 8;
+  size_t n, szFramePos = 0;
+  uint64_t ui64Par;
+
+  for (n = 0; (n + 8 <= szRxBytes) && (szFramePos + 9 <= szFrameBytes); n += 8) {
+    const uint64_t ui64Data = pn53x_unwrap_word(pn53x_load_le(pbtFrame + szFramePos, 8), pbtFrame[szFramePos + 8], &ui64Par);
+    pn53x_store_le(pbtRx + n, ui64Data, 8);
+    if (pbtRxPar != NULL)
+      pn53x_store_le(pbtRxPar + n, ui64Par, 8);
+    szFramePos += 9;
+  }
+  if (n < szRxBytes) {
+    // Last bytes: never read past the received frame
+    const size_t szFrameLeft = szFrameBytes - szFramePos;
+    const uint64_t ui64Frame = pn53x_load_le(pbtFrame + szFramePos, (szFrameLeft < 8) ? szFrameLeft : 8);
+    const uint8_t btFrameHigh = (szFrameLeft > 8) ? pbtFrame[szFramePos + 8] : 0;
+    const uint64_t ui64Data = pn53x_unwrap_word(ui64Frame, btFrameHigh, &ui64Par);
+    pn53x_store_le(pbtRx + n, ui64Data, szRxBytes - n);
+    if (pbtRxPar != NULL)
+      pn53x_store_le(pbtRxPar + n, ui64Par, szRxBytes - n);
   }
+  return szRxBits;
 }
 
 int
@@ -656,7 +941,23 @@ pn53x_ReadRegister(struct nfc_device *pnd, uint16_t ui16RegisterAddress, uint8_t
 
 int pn53x_read_register(struct nfc_device *pnd, uint16_t ui16RegisterAddress, uint8_t *ui8Value)
 {
-  return pn53x_ReadRegister(pnd, ui16RegisterAddress, ui8Value);
+  if ((ui16RegisterAddress < PN53X_CACHE_REGISTER_MIN_ADDRESS) || (ui16RegisterAddress > PN53X_CACHE_REGISTER_MAX_ADDRESS)) {
+    return pn53x_ReadRegister(pnd, ui16RegisterAddress, ui8Value);
+  }
+  const int internal_address = ui16RegisterAddress - PN53X_CACHE_REGISTER_MIN_ADDRESS;
+  uint8_t ui8CurrentValue;
+  if (CHIP_DATA(pnd)->sh_valid[internal_address]) {
+    ui8CurrentValue = CHIP_DATA(pnd)->sh_data[internal_address];
+    CHIP_DATA(pnd)->register_stats.round_trips_saved++;
+  } else {
+    int res = 0;
+    if ((res = pn53x_ReadRegister(pnd, ui16RegisterAddress, &ui8CurrentValue)) < 0)
+      return res;
+  }
+  // Bits waiting in the write-back cache are what the register will hold
+  const uint8_t ui8Mask = CHIP_DATA(pnd)->wb_mask[internal_address];
+  *ui8Value = (ui8CurrentValue & ~ui8Mask) | (CHIP_DATA(pnd)->wb_data[internal_address] & ui8Mask);
+  return NFC_SUCCESS;
 }
 
 static int
@@ -670,6 +971,19 @@ pn53x_WriteRegister(struct nfc_device *pnd, const uint16_t ui16RegisterAddress,
 int
 pn53x_write_register(struct nfc_device *pnd, const uint16_t ui16RegisterAddress, const uint8_t ui8SymbolMask, const uint8_t ui8Value)
 {
+  switch (ui16RegisterAddress) {
+    case PN53X_REG_CIU_Control:
+    case PN53X_REG_CIU_TxMode:
+    case PN53X_REG_CIU_RxMode:
+    case PN53X_REG_CIU_TxAuto:
+    case PN53X_REG_CIU_ManualRCV:
+      // pn53x_initiator_init() sets it back once done
+      CHIP_DATA(pnd)->initiator_defaults = false;
+      break;
+    case PN53X_REG_CIU_Status2:
+      CHIP_DATA(pnd)->crypto1_off = false;
+      break;
+  }
   if ((ui16RegisterAddress < PN53X_CACHE_REGISTER_MIN_ADDRESS) || (ui16RegisterAddress > PN53X_CACHE_REGISTER_MAX_ADDRESS)) {
     // Direct write
     if (ui8SymbolMask != 0xff) {
@@ -702,9 +1016,19 @@ pn53x_writeback_register(struct nfc_device *pnd)
   BUFFER_INIT(abtReadRegisterCmd, PN53x_EXTENDED_FRAME__DATA_MAX_LEN);
   BUFFER_APPEND(abtReadRegisterCmd, ReadRegister);
 
+  // Frames made unnecessary by the register shadow
+  bool bReadShadowed = false;
+  bool bWriteShadowed = false;
+
   // First step, it looks for registers to be read before applying the requested mask
   CHIP_DATA(pnd)->wb_trigged = false;
   for (size_t n = 0; n < PN53X_CACHE_REGISTER_SIZE; n++) {
+    if ((CHIP_DATA(pnd)->wb_mask[n]) && (CHIP_DATA(pnd)->wb_mask[n] != 0xff) && (CHIP_DATA(pnd)->sh_valid[n])) {
+      // The current value is known: apply the mask locally
+      CHIP_DATA(pnd)->wb_data[n] = ((CHIP_DATA(pnd)->wb_data[n] & CHIP_DATA(pnd)->wb_mask[n]) | (CHIP_DATA(pnd)->sh_data[n] & (~CHIP_DATA(pnd)->wb_mask[n])));
+      CHIP_DATA(pnd)->wb_mask[n] = 0xff;
+      bReadShadowed = true;
+    }
     if ((CHIP_DATA(pnd)->wb_mask[n]) && (CHIP_DATA(pnd)->wb_mask[n] != 0xff)) {
       // This register needs to be read: mask is present but does not cover full data width (ie. mask != 0xff)
       const uint16_t pn53x_register_address = PN53X_CACHE_REGISTER_MIN_ADDRESS + n;
@@ -738,11 +1062,18 @@ pn53x_writeback_register(struct nfc_device *pnd)
         i++;
       }
     }
+  } else if (bReadShadowed) {
+    CHIP_DATA(pnd)->register_stats.round_trips_saved++;
   }
   // Now, the writeback-cache only has masks with 0xff, we can start to WriteRegister
   BUFFER_INIT(abtWriteRegisterCmd, PN53x_EXTENDED_FRAME__DATA_MAX_LEN);
   BUFFER_APPEND(abtWriteRegisterCmd, WriteRegister);
   for (size_t n = 0; n < PN53X_CACHE_REGISTER_SIZE; n++) {
+    if ((CHIP_DATA(pnd)->wb_mask[n] == 0xff) && (CHIP_DATA(pnd)->sh_valid[n]) && (CHIP_DATA(pnd)->sh_data[n] == CHIP_DATA(pnd)->wb_data[n])) {
+      // The register already holds the requested value
+      CHIP_DATA(pnd)->wb_mask[n] = 0x00;
+      bWriteShadowed = true;
+    }
     if (CHIP_DATA(pnd)->wb_mask[n] == 0xff) {
       const uint16_t pn53x_register_address = PN53X_CACHE_REGISTER_MIN_ADDRESS + n;
       PNREG_TRACE(pn53x_register_address);
@@ -759,6 +1090,8 @@ pn53x_writeback_register(struct nfc_device *pnd)
     if ((res = pn53x_transceive(pnd, abtWriteRegisterCmd, BUFFER_SIZE(abtWriteRegisterCmd), NULL, 0, -1)) < 0) {
       return res;
     }
+  } else if (bWriteShadowed) {
+    CHIP_DATA(pnd)->register_stats.round_trips_saved++;
   }
   return NFC_SUCCESS;
 }
@@ -867,6 +1200,16 @@ pn53x_set_property_bool(struct nfc_device *pnd, const nfc_property property, con
 {
   uint8_t  btValue;
   int res = 0;
+  const int iDefault = pn53x_initiator_default(property);
+  if (iDefault >= 0) {
+    if (bEnable != (bool) iDefault) {
+      CHIP_DATA(pnd)->initiator_defaults = false;
+    } else if (CHIP_DATA(pnd)->initiator_defaults &&
+               ((property != NP_ACTIVATE_CRYPTO1) || CHIP_DATA(pnd)->crypto1_off)) {
+      // Already in effect
+      return NFC_SUCCESS;
+    }
+  }
   switch (property) {
     case NP_HANDLE_CRC:
       // Enable or disable automatic receiving/sending of CRC bytes
@@ -902,8 +1245,16 @@ pn53x_set_property_bool(struct nfc_device *pnd, const nfc_property property, con
       return pn53x_RFConfiguration__RF_field(pnd, bEnable);
 
     case NP_ACTIVATE_CRYPTO1:
-      btValue = (bEnable) ? SYMBOL_MF_CRYPTO1_ON : 0x00;
-      return pn53x_write_register(pnd, PN53X_REG_CIU_Status2, SYMBOL_MF_CRYPTO1_ON, btValue);
+      if (!bEnable) {
+        // ModemState is read-only and libnfc leaves TempSensClear and
+        // I2CForceHS at their reset value: Status2 is written without being
+        // read back first
+        if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_Status2, 0xff, 0x00)) < 0)
+          return res;
+        CHIP_DATA(pnd)->crypto1_off = true;
+        return NFC_SUCCESS;
+      }
+      return pn53x_write_register(pnd, PN53X_REG_CIU_Status2, SYMBOL_MF_CRYPTO1_ON, SYMBOL_MF_CRYPTO1_ON);
 
     case NP_INFINITE_SELECT:
       // TODO Made some research around this point:
@@ -977,6 +1328,53 @@ pn53x_set_property_bool(struct nfc_device *pnd, const nfc_property property, con
   return NFC_EINVARG;
 }
 
+/*
+ * Property changes made between pn53x_begin_properties() and
+ * pn53x_commit_properties() are applied by the latter with at most one
+ * SetParameters and one RFConfiguration per item, skipping values which are
+ * already in effect. The RF field is switched once, to its last requested
+ * state. Register changes wait in the write-back cache: they are sent with a
+ * single WriteRegister ahead of the next command, along with those made
+ * after the commit.
+ */
+int
+pn53x_begin_properties(struct nfc_device *pnd)
+{
+  if (CHIP_DATA(pnd)->property_batch++ == 0) {
+    CHIP_DATA(pnd)->ui8ParametersPending = CHIP_DATA(pnd)->ui8Parameters;
+  }
+  return NFC_SUCCESS;
+}
+
+int
+pn53x_commit_properties(struct nfc_device *pnd)
+{
+  int res = 0;
+
+  if (CHIP_DATA(pnd)->property_batch == 0) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  if (--CHIP_DATA(pnd)->property_batch > 0) {
+    // Applied by the outermost commit
+    return NFC_SUCCESS;
+  }
+
+  if (CHIP_DATA(pnd)->ui8ParametersPending != CHIP_DATA(pnd)->ui8Parameters) {
+    res = pn53x_SetParameters(pnd, CHIP_DATA(pnd)->ui8ParametersPending);
+  }
+  for (size_t n = 0; n < PN53X_RFCONFIG_ITEMS; n++) {
+    struct pn53x_rfconfig *prc = &(CHIP_DATA(pnd)->rfconfig[n]);
+    if (prc->pending) {
+      // Pending changes are dropped after a failure
+      prc->pending = false;
+      if (res >= 0)
+        res = pn53x_RFConfiguration_send(pnd, n, prc->abtPending);
+    }
+  }
+  return (res < 0) ? res : NFC_SUCCESS;
+}
+
 int
 pn53x_idle(struct nfc_device *pnd)
 {
@@ -1017,6 +1415,7 @@ pn53x_idle(struct nfc_device *pnd)
   // Clear the current nfc_target
   pn53x_current_target_free(pnd);
   CHIP_DATA(pnd)->operating_mode = IDLE;
+  CHIP_DATA(pnd)->initiator_defaults = false;
   return NFC_SUCCESS;
 }
 
@@ -1050,10 +1449,14 @@ pn53x_initiator_init(struct nfc_device *pnd)
   }
 
   // Configure the PN53X to be an Initiator or Reader/Writer
-  if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_Control, SYMBOL_INITIATOR, 0x10)) < 0)
-    return res;
+  if ((CHIP_DATA(pnd)->operating_mode != INITIATOR) || !CHIP_DATA(pnd)->initiator_defaults) {
+    if ((res = pn53x_write_register(pnd, PN53X_REG_CIU_Control, SYMBOL_INITIATOR, 0x10)) < 0)
+      return res;
+  }
 
   CHIP_DATA(pnd)->operating_mode = INITIATOR;
+  CHIP_DATA(pnd)->initiator_defaults = true;
+  CHIP_DATA(pnd)->crypto1_off = true;
   return NFC_SUCCESS;
 }
 
@@ -1066,6 +1469,7 @@ void pn53x_initiator_init_iclass_modulation(struct nfc_device *pnd)
   //	    // TxModeReg - Defines the data rate and framing during transmission.
   //// set bit 4 for target mode? - RxWaitRF Set to logic 1, the counter for RxWait starts only if an external RF field is detected in Target mode for NFCIP-1 or in Card Communication mode
   //pn512_write_register(0x12, "\x03", 1, false);
+  CHIP_DATA(pnd)->initiator_defaults = false;
   pn53x_WriteRegister(pnd, PN53X_REG_CIU_TxMode, 0x03);
   //
   //    // RxModeReg - Defines the data rate and framing during reception.
@@ -1113,6 +1517,222 @@ pn532_initiator_init_secure_element(struct nfc_device *pnd)
   return pn532_SAMConfiguration(pnd, PSM_WIRED_CARD, -1);
 }
 
+/*
+ * Decode the InListPassiveTarget response of a single target selection and
+ * make that target the current one.
+ */
+static int
+pn53x_initiator_listed_passive_target(struct nfc_device *pnd, const nfc_modulation nm,
+                                      const uint8_t *pbtTargetsData, const size_t szTargetsData,
+                                      nfc_target *pnt)
+{
+  int res = 0;
+  nfc_target nttmp;
+  memset(&nttmp, 0x00, sizeof(nfc_target));
+
+  if (szTargetsData <= 1) // For Coverity to know szTargetsData is always > 1 if res > 0
+    return 0;
+
+  nttmp.nm = nm;
+  if ((res = pn53x_decode_target_data(pbtTargetsData + 1, szTargetsData - 1, CHIP_DATA(pnd)->type, nm.nmt, &(nttmp.nti))) < 0) {
+    return res;
+  }
+  if ((nm.nmt == NMT_ISO14443A) && (nm.nbr != NBR_106)) {
+    uint8_t pncmd_inpsl[4] = { InPSL, 0x01 };
+    pncmd_inpsl[2] = nm.nbr - 1;
+    pncmd_inpsl[3] = nm.nbr - 1;
+    if ((res = pn53x_transceive(pnd, pncmd_inpsl, sizeof(pncmd_inpsl), NULL, 0, 0)) < 0) {
+      return res;
+    }
+  }
+  if (pn53x_current_target_new(pnd, &nttmp) == NULL) {
+    pnd->last_error = NFC_ESOFT;
+    return pnd->last_error;
+  }
+  // Is a tag info struct available
+  if (pnt) {
+    memcpy(pnt, &nttmp, sizeof(nfc_target));
+  }
+  return pbtTargetsData[0];
+}
+
+// Raw ISO/IEC 14443B frames at 106 kbps, the CRC being handled by the chip
+static int
+pn53x_initiator_raw_iso14443b(struct nfc_device *pnd)
+{
+  int res;
+
+  if ((res = nfc_device_begin_properties(pnd)) < 0) {
+    return res;
+  }
+  if (((res = nfc_device_set_property_bool(pnd, NP_FORCE_ISO14443_B, true)) >= 0) &&
+      ((res = nfc_device_set_property_bool(pnd, NP_FORCE_SPEED_106, true)) >= 0) &&
+      ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, true)) >= 0)) {
+    res = nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, false);
+  }
+  const int res_commit = nfc_device_commit_properties(pnd);
+  if (res < 0) {
+    return res;
+  }
+  return res_commit;
+}
+
+/*
+ * ST SRx anticollision: INITIATE moves the tags into their inventory state,
+ * then each PCALL16 makes them draw a new Chip_ID whose low nibble is the slot
+ * (0 to 15) in which they answer, slots 1 to 15 being opened by SLOT_MARKER.
+ * A tag is taken out of the inventory by its SELECT, it stays deselected when
+ * another one is selected and answers again to a SELECT of its Chip_ID.
+ */
+#define PN53X_SR_SLOTS 16
+#define PN53X_SR_ROUNDS 8
+
+// Returns the answer length, 0 when nothing answered, *pbCollision tells whether several tags did
+static int
+pn53x_sr_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRx,
+                    bool *pbCollision, int timeout)
+{
+  int res;
+
+  *pbCollision = false;
+  if ((res = pn53x_initiator_transceive_bytes(pnd, pbtTx, szTx, pbtRx, szRx, timeout)) >= 0)
+    return res;
+  if (res != NFC_ERFTRANS)
+    return res;
+  *pbCollision = (CHIP_DATA(pnd)->last_status_byte != ETIMEOUT);
+  return 0;
+}
+
+static int
+pn53x_sr_chip_find(const struct nfc_device *pnd, const uint8_t *pbtUID, const int iChipId)
+{
+  for (size_t n = 0; n < CHIP_DATA(pnd)->sr_chip_count; n++) {
+    const struct pn53x_sr_chip *psc = &(CHIP_DATA(pnd)->sr_chips[n]);
+    if (pbtUID ? (memcmp(psc->abtUID, pbtUID, 8) == 0) : (psc->btChipId == iChipId))
+      return (int) n;
+  }
+  return -1;
+}
+
+// SELECT of btChipId then GET_UID, returns 1 with the UID, 0 when the tag is gone
+static int
+pn53x_sr_select(struct nfc_device *pnd, const uint8_t btChipId, uint8_t *pbtUID, int timeout)
+{
+  const uint8_t abtSelect[2] = { 0x0e, btChipId };
+  const uint8_t abtGetUid[1] = { 0x0b };
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  bool bCollision;
+  int res;
+
+  if ((res = pn53x_sr_transceive(pnd, abtSelect, sizeof(abtSelect), abtRx, sizeof(abtRx), &bCollision, timeout)) < 0)
+    return res;
+  if ((res != 1) || (abtRx[0] != btChipId))
+    return 0;
+  if ((res = pn53x_sr_transceive(pnd, abtGetUid, sizeof(abtGetUid), abtRx, sizeof(abtRx), &bCollision, timeout)) < 0)
+    return res;
+  if (res != 8)
+    return 0;
+  memcpy(pbtUID, abtRx, 8);
+
+  // Remember the Chip_ID to select the tag again later
+  int n = pn53x_sr_chip_find(pnd, pbtUID, 0);
+  if ((n < 0) && (CHIP_DATA(pnd)->sr_chip_count < PN53X_SR_MAX_CHIPS))
+    n = (int) CHIP_DATA(pnd)->sr_chip_count++;
+  if (n >= 0) {
+    memcpy(CHIP_DATA(pnd)->sr_chips[n].abtUID, pbtUID, 8);
+    CHIP_DATA(pnd)->sr_chips[n].btChipId = btChipId;
+  }
+  return 1;
+}
+
+static int
+pn53x_initiator_list_sr_targets(struct nfc_device *pnd, nfc_target ant[], const size_t szTargets, int timeout)
+{
+  const uint8_t abtInitiate[2] = { 0x06, 0x00 };
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  size_t szFound = 0;
+  bool bCollision;
+  int res;
+
+  if ((res = pn53x_sr_transceive(pnd, abtInitiate, sizeof(abtInitiate), abtRx, sizeof(abtRx), &bCollision, timeout)) < 0)
+    return res;
+  if ((res == 0) && !bCollision)
+    return 0;
+
+  for (size_t round = 0; (round < PN53X_SR_ROUNDS) && (szFound < szTargets); round++) {
+    uint8_t abtChipIds[PN53X_SR_SLOTS];
+    size_t szChipIds = 0;
+    bool bRetry = false;
+    for (uint8_t slot = 0; slot < PN53X_SR_SLOTS; slot++) {
+      // PCALL16 opens slot 0, SLOT_MARKER the other ones
+      const uint8_t abtSlot[2] = { (uint8_t)((slot << 4) | 0x06), 0x04 };
+      if ((res = pn53x_sr_transceive(pnd, abtSlot, slot ? 1 : 2, abtRx, sizeof(abtRx), &bCollision, timeout)) < 0)
+        return res;
+      if (bCollision) {
+        bRetry = true;
+      } else if (res == 1) {
+        abtChipIds[szChipIds++] = abtRx[0];
+      }
+    }
+    for (size_t n = 0; (n < szChipIds) && (szFound < szTargets); n++) {
+      // Tags sharing a Chip_ID, with each other or with a deselected tag, would answer together
+      bool bShared = (pn53x_sr_chip_find(pnd, NULL, abtChipIds[n]) >= 0);
+      for (size_t i = 0; i < szChipIds; i++) {
+        bShared |= ((i != n) && (abtChipIds[i] == abtChipIds[n]));
+      }
+      if (bShared) {
+        bRetry = true;
+        continue;
+      }
+      uint8_t abtUID[8];
+      if ((res = pn53x_sr_select(pnd, abtChipIds[n], abtUID, timeout)) < 0)
+        return res;
+      if (res == 0)
+        continue;
+      memset(&(ant[szFound]), 0x00, sizeof(nfc_target));
+      ant[szFound].nm.nmt = NMT_ISO14443B2SR;
+      ant[szFound].nm.nbr = NBR_106;
+      if ((res = pn53x_decode_target_data(abtUID, sizeof(abtUID), CHIP_DATA(pnd)->type, NMT_ISO14443B2SR, &(ant[szFound].nti))) < 0)
+        return res;
+      szFound++;
+    }
+    if (!bRetry)
+      break;
+  }
+  return (int) szFound;
+}
+
+// Selects the ST SRx tag whose UID is pbtInitData if it is known, any tag otherwise. Returns 1 with its UID in pbtUID
+static int
+pn53x_initiator_select_sr(struct nfc_device *pnd, const uint8_t *pbtInitData, const size_t szInitData, uint8_t *pbtUID,
+                          int timeout)
+{
+  const uint8_t abtInitiate[2] = { 0x06, 0x00 };
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  bool bCollision;
+  int res;
+
+  const int n = (szInitData == 8) ? pn53x_sr_chip_find(pnd, pbtInitData, 0) : -1;
+  if (n >= 0) {
+    res = pn53x_sr_select(pnd, CHIP_DATA(pnd)->sr_chips[n].btChipId, pbtUID, timeout);
+  } else {
+    // Getting random Chip_ID
+    if ((res = pn53x_sr_transceive(pnd, abtInitiate, sizeof(abtInitiate), abtRx, sizeof(abtRx), &bCollision, timeout)) < 0)
+      return res;
+    if ((res == 1) && (pn53x_sr_chip_find(pnd, NULL, abtRx[0]) < 0)) {
+      res = pn53x_sr_select(pnd, abtRx[0], pbtUID, timeout);
+    } else if ((res != 0) || bCollision) {
+      // Several tags, use the slots
+      nfc_target nt;
+      if ((res = pn53x_initiator_list_sr_targets(pnd, &nt, 1, timeout)) > 0)
+        memcpy(pbtUID, nt.nti.nsi.abtUID, 8);
+    }
+  }
+  if ((res > 0) && (szInitData == 8) && (memcmp(pbtUID, pbtInitData, 8) != 0))
+    return 0;
+  return res;
+}
+
 static int
 pn53x_initiator_select_passive_target_ext(struct nfc_device *pnd,
                                           const nfc_modulation nm,
@@ -1133,47 +1753,19 @@ pn53x_initiator_select_passive_target_ext(struct nfc_device *pnd,
       return pnd->last_error;
     }
     // No native support in InListPassiveTarget so we do discovery by hand
-    if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_ISO14443_B, true)) < 0) {
-      return res;
-    }
-    if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_SPEED_106, true)) < 0) {
-      return res;
-    }
-    if ((res = nfc_device_set_property_bool(pnd, NP_HANDLE_CRC, true)) < 0) {
-      return res;
-    }
-    if ((res = nfc_device_set_property_bool(pnd, NP_EASY_FRAMING, false)) < 0) {
+    if ((res = pn53x_initiator_raw_iso14443b(pnd)) < 0) {
       return res;
     }
     bool found = false;
     do {
       if (nm.nmt == NMT_ISO14443B2SR) {
-        // Some work to do before getting the UID...
-        uint8_t abtInitiate[] = "\x06\x00";
-        size_t szInitiateLen = 2;
-        uint8_t abtSelect[] = { 0x0e, 0x00 };
-        uint8_t abtRx[1];
-        uint8_t *pbtInitData = (uint8_t *) "\x0b";
-        size_t szInitData = 1;
-        // Getting random Chip_ID
-        if ((res = pn53x_initiator_transceive_bytes(pnd, abtInitiate, szInitiateLen, abtRx, sizeof(abtRx), timeout)) < 0) {
-          if ((res == NFC_ERFTRANS) && (CHIP_DATA(pnd)->last_status_byte == 0x01)) { // Chip timeout
-            continue;
-          } else
-            return res;
-        }
-        abtSelect[1] = abtRx[0];
-        if ((res = pn53x_initiator_transceive_bytes(pnd, abtSelect, sizeof(abtSelect), abtRx, sizeof(abtRx), timeout)) < 0) {
+        if ((res = pn53x_initiator_select_sr(pnd, pbtInitData, szInitData, abtTargetsData, timeout)) < 0) {
           return res;
         }
-        szTargetsData = (size_t)res;
-        if ((res = pn53x_initiator_transceive_bytes(pnd, pbtInitData, szInitData, abtTargetsData, sizeof(abtTargetsData), timeout)) < 0) {
-          if ((res == NFC_ERFTRANS) && (CHIP_DATA(pnd)->last_status_byte == 0x01)) { // Chip timeout
-            continue;
-          } else
-            return res;
+        if (res == 0) {
+          continue;
         }
-        szTargetsData = (size_t)res;
+        szTargetsData = 8;
       } else if (nm.nmt == NMT_ISO14443B2CT) {
         // Some work to do before getting the UID...
         const uint8_t abtReqt[] = { 0x10 };
@@ -1354,21 +1946,7 @@ pn53x_initiator_select_passive_target_ext(struct nfc_device *pnd,
     if ((res = pn53x_InListPassiveTarget(pnd, pm, 1, pbtInitData, szInitData, abtTargetsData, &szTargetsData, timeout)) <= 0)
       return res;
 
-    if (szTargetsData <= 1) // For Coverity to know szTargetsData is always > 1 if res > 0
-      return 0;
-
-    nttmp.nm = nm;
-    if ((res = pn53x_decode_target_data(abtTargetsData + 1, szTargetsData - 1, CHIP_DATA(pnd)->type, nm.nmt, &(nttmp.nti))) < 0) {
-      return res;
-    }
-    if ((nm.nmt == NMT_ISO14443A) && (nm.nbr != NBR_106)) {
-      uint8_t pncmd_inpsl[4] = { InPSL, 0x01 };
-      pncmd_inpsl[2] = nm.nbr - 1;
-      pncmd_inpsl[3] = nm.nbr - 1;
-      if ((res = pn53x_transceive(pnd, pncmd_inpsl, sizeof(pncmd_inpsl), NULL, 0, 0)) < 0) {
-        return res;
-      }
-    }
+    return pn53x_initiator_listed_passive_target(pnd, nm, abtTargetsData, szTargetsData, pnt);
   }
   if (pn53x_current_target_new(pnd, &nttmp) == NULL) {
     pnd->last_error = NFC_ESOFT;
@@ -1378,7 +1956,7 @@ pn53x_initiator_select_passive_target_ext(struct nfc_device *pnd,
   if (pnt) {
     memcpy(pnt, &nttmp, sizeof(nfc_target));
   }
-  return abtTargetsData[0];
+  return 1;
 }
 
 int
@@ -1390,6 +1968,323 @@ pn53x_initiator_select_passive_target(struct nfc_device *pnd,
   return pn53x_initiator_select_passive_target_ext(pnd, nm, pbtInitData, szInitData, pnt, 300);
 }
 
+// Length of the first target listed in InListPassiveTarget answer, Tg included
+static size_t
+pn53x_listed_target_length(struct nfc_device *pnd, const nfc_modulation_type nmt, const uint8_t *pbtData, const size_t szData)
+{
+  size_t szTarget = 0;
+  switch (nmt) {
+    case NMT_ISO14443A:
+      // Tg, SENS_RES, SEL_RES, NFCIDLength, NFCID1
+      if (szData < 5)
+        return 0;
+      szTarget = 5 + pbtData[4];
+      // ATS follows when the target is ISO14443-4 compliant and RATS is sent automatically
+      if ((pbtData[3] & 0x20) && (CHIP_DATA(pnd)->ui8Parameters & PARAM_AUTO_RATS) && (szData > szTarget))
+        szTarget += pbtData[szTarget];
+      break;
+    case NMT_FELICA:
+      // Tg, POL_RES length byte counting itself
+      if (szData < 2)
+        return 0;
+      szTarget = 1 + pbtData[1];
+      break;
+    default:
+      return 0;
+  }
+  return (szTarget <= szData) ? szTarget : 0;
+}
+
+/*
+ * For nfc_initiator_list_passive_targets(): a single InListPassiveTarget
+ * activates two ISO14443-A 106 kbps or FeliCa targets, then a single
+ * InRelease releases both. Other modulations are selected one at a time.
+ */
+int
+pn53x_initiator_list_passive_targets(struct nfc_device *pnd,
+                                     const nfc_modulation nm,
+                                     const uint8_t *pbtInitData, const size_t szInitData,
+                                     nfc_target ant[], const size_t szTargets)
+{
+  uint8_t  abtTargetsData[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  size_t  szTargetsData = sizeof(abtTargetsData);
+  int res = 0;
+
+  if ((szTargets == 0) || (CHIP_DATA(pnd)->type == RCS360))
+    return NFC_ENOTIMPL;
+  if (nm.nmt == NMT_ISO14443B2SR) {
+    // Every ST SRx tag at once, the last one listed stays selected
+    pn53x_current_target_free(pnd);
+    if ((res = pn53x_initiator_raw_iso14443b(pnd)) < 0)
+      return res;
+    return pn53x_initiator_list_sr_targets(pnd, ant, szTargets, 300);
+  }
+  if (!(((nm.nmt == NMT_ISO14443A) && (nm.nbr == NBR_106)) || (nm.nmt == NMT_FELICA)))
+    return NFC_ENOTIMPL;
+  const pn53x_modulation pm = pn53x_nm_to_pm(nm);
+  if (PM_UNDEFINED == pm) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+
+  // InListPassiveTarget releases the previous targets
+  pn53x_current_target_free(pnd);
+  if ((res = pn53x_InListPassiveTarget(pnd, pm, (szTargets > 1) ? 2 : 1, pbtInitData, szInitData, abtTargetsData, &szTargetsData, 300)) <= 0)
+    return res;
+
+  const int iTargets = res;
+  size_t off = 1;
+  for (int n = 0; n < iTargets; n++) {
+    // The last target takes up the rest of the answer
+    const size_t szTarget = (n == iTargets - 1) ? (szTargetsData - off) :
+                            pn53x_listed_target_length(pnd, nm.nmt, abtTargetsData + off, szTargetsData - off);
+    if ((szTarget == 0) || (off + szTarget > szTargetsData) || (n >= (int) szTargets)) {
+      pnd->last_error = NFC_EIO;
+      return pnd->last_error;
+    }
+    memset(&(ant[n]), 0x00, sizeof(nfc_target));
+    ant[n].nm = nm;
+    if ((res = pn53x_decode_target_data(abtTargetsData + off, szTarget, CHIP_DATA(pnd)->type, nm.nmt, &(ant[n].nti))) < 0)
+      return res;
+    off += szTarget;
+  }
+  if ((res = pn53x_InRelease(pnd, 0)) < 0)
+    return res;
+  return iTargets;
+}
+
+// ISO/IEC 14443A inventory paths: the known bits of the UID CLn of every cascade level
+#define PN53X_INVENTORY_LEVEL_BITS 40
+#define PN53X_INVENTORY_MAX_LEVELS 3
+#define SAK_UID_NOT_COMPLETE       0x04
+
+struct pn53x_inventory_path {
+  uint8_t abtCln[PN53X_INVENTORY_MAX_LEVELS * 5];
+  size_t szBits;
+};
+
+static void
+pn53x_inventory_set_bit(uint8_t *pbt, const size_t szBit, const bool bValue)
+{
+  if (bValue) {
+    pbt[szBit / 8] |= (uint8_t)(1 << (szBit % 8));
+  } else {
+    pbt[szBit / 8] &= (uint8_t) ~(1 << (szBit % 8));
+  }
+}
+
+// Sends a raw frame, returns the received bits, 0 when nothing answered or a negative error.
+// On a bit collision the position of the first collided received bit (from 1) goes to *pszCollision.
+static int
+pn53x_inventory_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, uint8_t *pbtRx,
+                           size_t *pszCollision, size_t *pszRoundTrips)
+{
+  uint8_t ui8Coll;
+  int res;
+
+  (*pszRoundTrips)++;
+  *pszCollision = 0;
+  if ((res = pn53x_initiator_transceive_bits(pnd, pbtTx, szTxBits, NULL, pbtRx, NULL)) >= 0)
+    return res;
+  if ((res != NFC_ERFTRANS) || (CHIP_DATA(pnd)->last_status_byte == ETIMEOUT))
+    return (res == NFC_ERFTRANS) ? 0 : res;
+  if (CHIP_DATA(pnd)->last_status_byte != EBITCOLL)
+    return res;
+  if ((res = pn53x_read_register(pnd, PN53X_REG_CIU_Coll, &ui8Coll)) < 0)
+    return res;
+  // CollPos 0 stands for the 32nd bit, without a valid position the first bit is assumed
+  *pszCollision = (ui8Coll & 0x20) ? 1 : ((ui8Coll & 0x1f) ? (ui8Coll & 0x1f) : 32);
+  return 0;
+}
+
+// Resolves the unknown bits of the current cascade level of pPath, pushing on pStack the branches left behind.
+// Returns 1 when the UID CLn is complete, 0 when no tag answered on this path
+static int
+pn53x_inventory_anticollision(struct nfc_device *pnd, struct pn53x_inventory_path *pPath,
+                              struct pn53x_inventory_path *pStack, size_t *pszStack, size_t *pszRoundTrips)
+{
+  const size_t szLevel = pPath->szBits / PN53X_INVENTORY_LEVEL_BITS;
+  uint8_t *pbtCln = pPath->abtCln + (szLevel * 5);
+  size_t szKnown = pPath->szBits % PN53X_INVENTORY_LEVEL_BITS;
+  // The first bit on which the answering tags differ, the bits before it are common to all of them
+  size_t szSplit = PN53X_INVENTORY_LEVEL_BITS;
+  uint8_t abtTx[2 + 5];
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  size_t szCollision;
+  int res;
+
+  abtTx[0] = (uint8_t)(0x93 + (2 * szLevel));
+  while (szKnown < PN53X_INVENTORY_LEVEL_BITS) {
+    bool bCommon = false;
+    if (szKnown == szSplit) {
+      // Both values have tags behind them: keep 1 for later and follow 0
+      pn53x_inventory_set_bit(pbtCln, szKnown, true);
+      pStack[*pszStack] = *pPath;
+      pStack[*pszStack].szBits = (szLevel * PN53X_INVENTORY_LEVEL_BITS) + szKnown + 1;
+      (*pszStack)++;
+      pn53x_inventory_set_bit(pbtCln, szKnown++, false);
+      szSplit = PN53X_INVENTORY_LEVEL_BITS;
+    } else if (szSplit < PN53X_INVENTORY_LEVEL_BITS) {
+      // A common bit which collided data did not tell: guess 0
+      pn53x_inventory_set_bit(pbtCln, szKnown++, false);
+      bCommon = true;
+    }
+    abtTx[1] = (uint8_t)(((2 + (szKnown / 8)) << 4) | (szKnown % 8));
+    memcpy(abtTx + 2, pbtCln, (szKnown + 7) / 8);
+    if ((res = pn53x_inventory_transceive(pnd, abtTx, 16 + szKnown, abtRx, &szCollision, pszRoundTrips)) < 0)
+      return res;
+    if (szCollision) {
+      szSplit = szKnown + szCollision - 1;
+    } else if (res == 0) {
+      if (!bCommon)
+        return 0;
+      // Nobody answered 0 to a bit the tags share
+      pn53x_inventory_set_bit(pbtCln, szKnown - 1, true);
+    } else {
+      // A single tag sent the remaining bits, from bit 0 of the first received byte
+      if ((size_t) res != PN53X_INVENTORY_LEVEL_BITS - szKnown) {
+        pnd->last_error = NFC_ERFTRANS;
+        return pnd->last_error;
+      }
+      for (size_t n = 0; szKnown < PN53X_INVENTORY_LEVEL_BITS; n++, szKnown++)
+        pn53x_inventory_set_bit(pbtCln, szKnown, (abtRx[n / 8] >> (n % 8)) & 1);
+    }
+  }
+  pPath->szBits = (szLevel + 1) * PN53X_INVENTORY_LEVEL_BITS;
+  if ((pbtCln[0] ^ pbtCln[1] ^ pbtCln[2] ^ pbtCln[3]) != pbtCln[4]) {
+    pnd->last_error = NFC_ERFTRANS;
+    return pnd->last_error;
+  }
+  return 1;
+}
+
+// SELECT of cascade level szLevel, returns the SAK or a negative error
+static int
+pn53x_inventory_select(struct nfc_device *pnd, const size_t szLevel, const uint8_t *pbtCln, size_t *pszRoundTrips)
+{
+  uint8_t abtTx[2 + 5 + 2] = { (uint8_t)(0x93 + (2 * szLevel)), 0x70 };
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  uint8_t abtCrc[2];
+  size_t szCollision;
+  int res;
+
+  memcpy(abtTx + 2, pbtCln, 5);
+  iso14443a_crc_append(abtTx, 7);
+  if ((res = pn53x_inventory_transceive(pnd, abtTx, sizeof(abtTx) * 8, abtRx, &szCollision, pszRoundTrips)) < 0)
+    return res;
+  if (res != 24) {
+    pnd->last_error = NFC_ERFTRANS;
+    return pnd->last_error;
+  }
+  iso14443a_crc(abtRx, 1, abtCrc);
+  if (memcmp(abtRx + 1, abtCrc, 2) != 0) {
+    pnd->last_error = NFC_ERFTRANS;
+    return pnd->last_error;
+  }
+  return abtRx[0];
+}
+
+static int
+pn53x_inventory_walk(struct nfc_device *pnd, nfc_target ant[], const size_t szTargets, size_t *pszRoundTrips)
+{
+  struct pn53x_inventory_path aStack[(PN53X_INVENTORY_MAX_LEVELS * PN53X_INVENTORY_LEVEL_BITS) + 1];
+  size_t szStack = 0;
+  size_t szFound = 0;
+  // True while all the tags which are not halted are ready for the first cascade level
+  bool bReady = false;
+  const uint8_t abtReqa[1] = { 0x26 };
+  const uint8_t abtHlta[4] = { 0x50, 0x00, 0x57, 0xcd };
+  uint8_t abtAtqa[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  size_t szCollision;
+  int res;
+
+  memset(&(aStack[szStack++]), 0x00, sizeof(struct pn53x_inventory_path));
+  while ((szStack > 0) && (szFound < szTargets)) {
+    struct pn53x_inventory_path path = aStack[--szStack];
+    if (!bReady) {
+      // Halted tags stay mute, the ATQA is the one of all the answering tags superimposed
+      if ((res = pn53x_inventory_transceive(pnd, abtReqa, 7, abtAtqa, &szCollision, pszRoundTrips)) < 0)
+        return res;
+      if ((res == 0) && (szCollision == 0))
+        break;
+      bReady = true;
+    }
+    size_t szLevel = 0;
+    for (;;) {
+      if (path.szBits < (szLevel + 1) * PN53X_INVENTORY_LEVEL_BITS) {
+        if ((res = pn53x_inventory_anticollision(pnd, &path, aStack, &szStack, pszRoundTrips)) < 0)
+          return res;
+        if (res == 0)
+          break;
+      }
+      // Tags with another UID CLn go back to idle
+      bReady = false;
+      if ((res = pn53x_inventory_select(pnd, szLevel, path.abtCln + (szLevel * 5), pszRoundTrips)) < 0)
+        return res;
+      const uint8_t btSak = (uint8_t) res;
+      if (btSak & SAK_UID_NOT_COMPLETE) {
+        if (++szLevel == PN53X_INVENTORY_MAX_LEVELS) {
+          pnd->last_error = NFC_ERFTRANS;
+          return pnd->last_error;
+        }
+        continue;
+      }
+      nfc_iso14443a_info *pnai = &(ant[szFound].nti.nai);
+      memset(&(ant[szFound]), 0x00, sizeof(nfc_target));
+      ant[szFound].nm.nmt = NMT_ISO14443A;
+      ant[szFound].nm.nbr = NBR_106;
+      pnai->abtAtqa[0] = abtAtqa[1];
+      pnai->abtAtqa[1] = abtAtqa[0];
+      pnai->btSak = btSak;
+      // Cascade tags are left out of the UID
+      for (size_t n = 0; n < szLevel; n++) {
+        memcpy(pnai->abtUid + pnai->szUidLen, path.abtCln + (n * 5) + 1, 3);
+        pnai->szUidLen += 3;
+      }
+      memcpy(pnai->abtUid + pnai->szUidLen, path.abtCln + (szLevel * 5), 4);
+      pnai->szUidLen += 4;
+      szFound++;
+      // HLTA is never answered
+      if ((res = pn53x_inventory_transceive(pnd, abtHlta, sizeof(abtHlta) * 8, abtAtqa, &szCollision, pszRoundTrips)) < 0)
+        return res;
+      break;
+    }
+  }
+  return (int) szFound;
+}
+
+int
+pn53x_initiator_inventory(struct nfc_device *pnd, const nfc_modulation nm,
+                          nfc_target ant[], const size_t szTargets, size_t *pszRoundTrips)
+{
+  const bool bCrc = pnd->bCrc;
+  const bool bPar = pnd->bPar;
+  const bool bEasyFraming = pnd->bEasyFraming;
+  size_t szRoundTrips = 0;
+  int res, res2;
+
+  if ((nm.nmt != NMT_ISO14443A) || (nm.nbr != NBR_106)) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  pn53x_current_target_free(pnd);
+  // Raw frames: the anticollision frames are not CRC protected, HLTA and SELECT get their CRC from us
+  if (((res = pn53x_set_property_bool(pnd, NP_HANDLE_CRC, false)) < 0) ||
+      ((res = pn53x_set_property_bool(pnd, NP_HANDLE_PARITY, true)) < 0) ||
+      ((res = pn53x_set_property_bool(pnd, NP_EASY_FRAMING, false)) < 0))
+    return res;
+  res = pn53x_inventory_walk(pnd, ant, szTargets, &szRoundTrips);
+  if (pszRoundTrips)
+    *pszRoundTrips = szRoundTrips;
+  if (((res2 = pn53x_set_property_bool(pnd, NP_HANDLE_CRC, bCrc)) < 0) ||
+      ((res2 = pn53x_set_property_bool(pnd, NP_HANDLE_PARITY, bPar)) < 0) ||
+      ((res2 = pn53x_set_property_bool(pnd, NP_EASY_FRAMING, bEasyFraming)) < 0))
+    return (res < 0) ? res : res2;
+  if (res >= 0)
+    pnd->last_error = NFC_SUCCESS;
+  return res;
+}
+
 int
 pn53x_initiator_poll_target(struct nfc_device *pnd,
                             const nfc_modulation *pnmModulations, const size_t szModulations,
@@ -1440,41 +2335,10 @@ pn53x_initiator_poll_target(struct nfc_device *pnd,
       default:
         return NFC_ECHIP;
     }
-  } else {
-    bool bInfiniteSelect = pnd->bInfiniteSelect;
-    int result = 0;
-    if ((res = pn53x_set_property_bool(pnd, NP_INFINITE_SELECT, true)) < 0)
-      return res;
-    // FIXME It does not support DEP targets
-    do {
-      for (size_t p = 0; p < uiPollNr; p++) {
-        for (size_t n = 0; n < szModulations; n++) {
-          uint8_t *pbtInitiatorData;
-          size_t szInitiatorData;
-          prepare_initiator_data(pnmModulations[n], &pbtInitiatorData, &szInitiatorData);
-          const int timeout_ms = uiPeriod * 150;
-
-          if ((res = pn53x_initiator_select_passive_target_ext(pnd, pnmModulations[n], pbtInitiatorData, szInitiatorData, pnt, timeout_ms)) < 0) {
-            if (pnd->last_error != NFC_ETIMEOUT) {
-              result = pnd->last_error;
-              goto end;
-            }
-          } else {
-            result = res;
-            goto end;
-          }
-        }
-      }
-    } while (uiPollNr == 0xff); // uiPollNr==0xff means infinite polling
-    // We reach this point when each listing give no result, we simply have to return 0
-end:
-    if (! bInfiniteSelect) {
-      if ((res = pn53x_set_property_bool(pnd, NP_INFINITE_SELECT, false)) < 0)
-        return res;
-    }
-    return result;
   }
-  return NFC_ECHIP;
+  // Other chips can't poll by themselves, nfc_initiator_poll_target() polls them
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
 }
 
 int
@@ -2630,24 +3494,25 @@ pn53x_target_receive_bits(struct nfc_device *pnd, uint8_t *pbtRx, const size_t s
   return szRxBits;
 }
 
-int
-pn53x_target_receive_bytes(struct nfc_device *pnd, uint8_t *pbtRx, const size_t szRxLen, int timeout)
+/*
+ * Pick the PN53x command that fetches the next frame received as target.
+ */
+static int
+pn53x_target_receive_command(struct nfc_device *pnd, uint8_t *pbtCmd)
 {
-  uint8_t  abtCmd[1];
-
   // XXX I think this is not a clean way to provide some kind of "EasyFraming"
   // but at the moment I have no more better than this
   if (pnd->bEasyFraming) {
     switch (CHIP_DATA(pnd)->current_target->nm.nmt) {
       case NMT_DEP:
-        abtCmd[0] = TgGetData;
+        pbtCmd[0] = TgGetData;
         break;
       case NMT_ISO14443A:
         if (CHIP_DATA(pnd)->current_target->nti.nai.btSak & SAK_ISO14443_4_COMPLIANT) {
           // We are dealing with a ISO/IEC 14443-4 compliant target
           if ((CHIP_DATA(pnd)->type == PN532) && (pnd->bAutoIso14443_4)) {
             // We are using ISO/IEC 14443-4 PICC emulation capability from the PN532
-            abtCmd[0] = TgGetData;
+            pbtCmd[0] = TgGetData;
             break;
           } else {
             // TODO Support EasyFraming for other cases by software
@@ -2655,7 +3520,7 @@ pn53x_target_receive_bytes(struct nfc_device *pnd, uint8_t *pbtRx, const size_t
             return pnd->last_error;
           }
         }
-        abtCmd[0] = TgGetInitiatorCommand;
+        pbtCmd[0] = TgGetInitiatorCommand;
         break;
       case NMT_JEWEL:
       case NMT_BARCODE:
@@ -2665,17 +3530,27 @@ pn53x_target_receive_bytes(struct nfc_device *pnd, uint8_t *pbtRx, const size_t
       case NMT_ISO14443B2CT:
       case NMT_ISO14443BICLASS:
       case NMT_FELICA:
-        abtCmd[0] = TgGetInitiatorCommand;
+        pbtCmd[0] = TgGetInitiatorCommand;
         break;
     }
   } else {
-    abtCmd[0] = TgGetInitiatorCommand;
+    pbtCmd[0] = TgGetInitiatorCommand;
   }
+  return NFC_SUCCESS;
+}
+
+int
+pn53x_target_receive_bytes(struct nfc_device *pnd, uint8_t *pbtRx, const size_t szRxLen, int timeout)
+{
+  uint8_t  abtCmd[1];
+  int res = 0;
+
+  if ((res = pn53x_target_receive_command(pnd, abtCmd)) < 0)
+    return res;
 
   // Try to gather a received frame from the reader
   uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
   size_t szRx = sizeof(abtRx);
-  int res = 0;
   if ((res = pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), abtRx, szRx, timeout)) < 0)
     return pnd->last_error;
   szRx = (size_t) res;
@@ -2845,49 +3720,88 @@ pn53x_strerror(const struct nfc_device *pnd)
   return pcRes;
 }
 
+// RFConfiguration item and configuration data length, indexed by PN53X_RFCONFIG_*
+static const uint8_t pn53x_rfconfig_items[PN53X_RFCONFIG_ITEMS][2] = {
+  { RFCI_FIELD,        1 },
+  { RFCI_TIMING,       3 },
+  { RFCI_RETRY_DATA,   1 },
+  { RFCI_RETRY_SELECT, 3 },
+};
+
+static int
+pn53x_RFConfiguration_send(struct nfc_device *pnd, const size_t n, const uint8_t *pbtValue)
+{
+  struct pn53x_rfconfig *prc = &(CHIP_DATA(pnd)->rfconfig[n]);
+  const size_t szValue = pn53x_rfconfig_items[n][1];
+  int res = 0;
+
+  // The firmware also switches the field on by itself (eg. InListPassiveTarget), its state is never assumed
+  if ((n != PN53X_RFCONFIG_FIELD) && prc->known && (memcmp(prc->abtValue, pbtValue, szValue) == 0)) {
+    return NFC_SUCCESS;
+  }
+  uint8_t abtCmd[2 + sizeof(prc->abtValue)] = { RFConfiguration, pn53x_rfconfig_items[n][0] };
+  memcpy(abtCmd + 2, pbtValue, szValue);
+  if ((res = pn53x_transceive(pnd, abtCmd, 2 + szValue, NULL, 0, -1)) < 0) {
+    prc->known = false;
+    return res;
+  }
+  memcpy(prc->abtValue, abtCmd + 2, szValue);
+  prc->known = true;
+  return NFC_SUCCESS;
+}
+
+static int
+pn53x_RFConfiguration(struct nfc_device *pnd, const size_t n, const uint8_t *pbtValue)
+{
+  if (CHIP_DATA(pnd)->property_batch) {
+    // Sent by pn53x_commit_properties()
+    memcpy(CHIP_DATA(pnd)->rfconfig[n].abtPending, pbtValue, pn53x_rfconfig_items[n][1]);
+    CHIP_DATA(pnd)->rfconfig[n].pending = true;
+    return NFC_SUCCESS;
+  }
+  return pn53x_RFConfiguration_send(pnd, n, pbtValue);
+}
+
 int
 pn53x_RFConfiguration__RF_field(struct nfc_device *pnd, bool bEnable)
 {
-  uint8_t  abtCmd[] = { RFConfiguration, RFCI_FIELD, (bEnable) ? 0x01 : 0x00 };
-  return pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+  const uint8_t abtValue[] = { (bEnable) ? 0x01 : 0x00 };
+  // ST SRx tags lose their Chip_ID with the field
+  if (!bEnable)
+    CHIP_DATA(pnd)->sr_chip_count = 0;
+  return pn53x_RFConfiguration(pnd, PN53X_RFCONFIG_FIELD, abtValue);
 }
 
 int
 pn53x_RFConfiguration__Various_timings(struct nfc_device *pnd, const uint8_t fATR_RES_Timeout, const uint8_t fRetryTimeout)
 {
-  uint8_t  abtCmd[] = {
-    RFConfiguration,
-    RFCI_TIMING,
+  const uint8_t abtValue[] = {
     0x00,		 // RFU
     fATR_RES_Timeout,	 // ATR_RES timeout (default: 0x0B 102.4 ms)
     fRetryTimeout	 // TimeOut during non-DEP communications (default: 0x0A 51.2 ms)
   };
-  return pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+  return pn53x_RFConfiguration(pnd, PN53X_RFCONFIG_TIMING, abtValue);
 }
 
 int
 pn53x_RFConfiguration__MaxRtyCOM(struct nfc_device *pnd, const uint8_t MaxRtyCOM)
 {
-  uint8_t  abtCmd[] = {
-    RFConfiguration,
-    RFCI_RETRY_DATA,
+  const uint8_t abtValue[] = {
     MaxRtyCOM         // MaxRtyCOM, default: 0x00 (no retry, only one try), inifite: 0xff
   };
-  return pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+  return pn53x_RFConfiguration(pnd, PN53X_RFCONFIG_RETRY_DATA, abtValue);
 }
 
 int
 pn53x_RFConfiguration__MaxRetries(struct nfc_device *pnd, const uint8_t MxRtyATR, const uint8_t MxRtyPSL, const uint8_t MxRtyPassiveActivation)
 {
   // Retry format: 0x00 means only 1 try, 0xff means infinite
-  uint8_t  abtCmd[] = {
-    RFConfiguration,
-    RFCI_RETRY_SELECT,
+  const uint8_t abtValue[] = {
     MxRtyATR,        // MxRtyATR, default: active = 0xff, passive = 0x02
     MxRtyPSL,        // MxRtyPSL, default: 0x01
     MxRtyPassiveActivation         // MxRtyPassiveActivation, default: 0xff (0x00 leads to problems with PN531)
   };
-  return pn53x_transceive(pnd, abtCmd, sizeof(abtCmd), NULL, 0, -1);
+  return pn53x_RFConfiguration(pnd, PN53X_RFCONFIG_RETRY_SELECT, abtValue);
 }
 
 int
@@ -2959,16 +3873,18 @@ pn53x_PowerDown(struct nfc_device *pnd)
  * @note Selected targets count can be found in \a pbtTargetsData[0] if available (i.e. \a pszTargetsData content is more than 0)
  * @note To decode theses TargetData[n], there is @fn pn53x_decode_target_data
  */
-int
-pn53x_InListPassiveTarget(struct nfc_device *pnd,
-                          const pn53x_modulation pmInitModulation, const uint8_t szMaxTargets,
-                          const uint8_t *pbtInitiatorData, const size_t szInitiatorData,
-                          uint8_t *pbtTargetsData, size_t *pszTargetsData,
-                          int timeout)
+/*
+ * Build an InListPassiveTarget command in \a pbtCmd, which must hold 15 bytes.
+ * Returns the command length.
+ */
+static int
+pn53x_InListPassiveTarget_command(struct nfc_device *pnd,
+                                  const pn53x_modulation pmInitModulation, const uint8_t szMaxTargets,
+                                  const uint8_t *pbtInitiatorData, const size_t szInitiatorData,
+                                  uint8_t *pbtCmd)
 {
-  uint8_t  abtCmd[15] = { InListPassiveTarget };
-
-  abtCmd[1] = szMaxTargets;     // MaxTg
+  pbtCmd[0] = InListPassiveTarget;
+  pbtCmd[1] = szMaxTargets;     // MaxTg
 
   switch (pmInitModulation) {
     case PM_ISO14443A_106:
@@ -3004,19 +3920,153 @@ pn53x_InListPassiveTarget(struct nfc_device *pnd,
       pnd->last_error = NFC_EINVARG;
       return pnd->last_error;
   }
-  abtCmd[2] = pmInitModulation; // BrTy, the type of init modulation used for polling a passive tag
+  pbtCmd[2] = pmInitModulation; // BrTy, the type of init modulation used for polling a passive tag
 
   // Set the optional initiator data (used for Felica, ISO14443B, Topaz Polling or for ISO14443A selecting a specific UID).
+  if (szInitiatorData > 12) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
   if (pbtInitiatorData)
-    memcpy(abtCmd + 3, pbtInitiatorData, szInitiatorData);
+    memcpy(pbtCmd + 3, pbtInitiatorData, szInitiatorData);
+  return 3 + szInitiatorData;
+}
+
+int
+pn53x_InListPassiveTarget(struct nfc_device *pnd,
+                          const pn53x_modulation pmInitModulation, const uint8_t szMaxTargets,
+                          const uint8_t *pbtInitiatorData, const size_t szInitiatorData,
+                          uint8_t *pbtTargetsData, size_t *pszTargetsData,
+                          int timeout)
+{
+  uint8_t  abtCmd[15];
   int res = 0;
-  if ((res = pn53x_transceive(pnd, abtCmd, 3 + szInitiatorData, pbtTargetsData, *pszTargetsData, timeout)) < 0) {
+
+  if ((res = pn53x_InListPassiveTarget_command(pnd, pmInitModulation, szMaxTargets, pbtInitiatorData, szInitiatorData, abtCmd)) < 0) {
+    return res;
+  }
+  if ((res = pn53x_transceive(pnd, abtCmd, res, pbtTargetsData, *pszTargetsData, timeout)) < 0) {
     return res;
   }
   *pszTargetsData = (size_t) res;
   return pbtTargetsData[0];
 }
 
+/*
+ * Event loop support: the operations of nfc-loop.c are single PN53x commands
+ * whose submit and completion halves run at different times. The command code
+ * and first parameter are kept in CHIP_DATA(pnd)->abtAsyncCmd for the
+ * completion half.
+ */
+int
+pn53x_async_submit(struct nfc_device *pnd, struct nfc_async_op *op)
+{
+  uint8_t  abtCmd[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  size_t  szCmd = 0;
+  int res = 0;
+
+  switch (op->op) {
+    case NLO_INITIATOR_SELECT_PASSIVE_TARGET: {
+      // Only what InListPassiveTarget handles natively is a single command
+      switch (op->nm.nmt) {
+        case NMT_ISO14443BI:
+        case NMT_ISO14443B2SR:
+        case NMT_ISO14443B2CT:
+        case NMT_ISO14443BICLASS:
+        case NMT_BARCODE:
+          pnd->last_error = NFC_EDEVNOTSUPP;
+          return pnd->last_error;
+        default:
+          break;
+      }
+      const pn53x_modulation pm = pn53x_nm_to_pm(op->nm);
+      if ((PM_UNDEFINED == pm) || (NBR_UNDEFINED == op->nm.nbr)) {
+        pnd->last_error = NFC_EINVARG;
+        return pnd->last_error;
+      }
+      if ((res = pn53x_InListPassiveTarget_command(pnd, pm, 1, op->abtInit, op->szInit, abtCmd)) < 0)
+        return res;
+      szCmd = res;
+      // Same default as pn53x_initiator_select_passive_target()
+      if (op->timeout == -1)
+        op->timeout = 300;
+    }
+    break;
+    case NLO_INITIATOR_TRANSCEIVE_BYTES:
+      // See pn53x_initiator_transceive_bytes()
+      if (!pnd->bPar || (op->szTx > sizeof(abtCmd) - 2)) {
+        pnd->last_error = NFC_EINVARG;
+        return pnd->last_error;
+      }
+      if (pnd->bEasyFraming) {
+        abtCmd[0] = InDataExchange;
+        abtCmd[1] = 1;              /* target number */
+        memcpy(abtCmd + 2, op->pbtTx, op->szTx);
+        szCmd = op->szTx + 2;
+      } else {
+        abtCmd[0] = InCommunicateThru;
+        memcpy(abtCmd + 1, op->pbtTx, op->szTx);
+        szCmd = op->szTx + 1;
+      }
+      if ((res = pn53x_set_tx_bits(pnd, 0)) < 0) {
+        pnd->last_error = res;
+        return pnd->last_error;
+      }
+      break;
+    case NLO_TARGET_RECEIVE_BYTES:
+      if ((res = pn53x_target_receive_command(pnd, abtCmd)) < 0)
+        return res;
+      szCmd = 1;
+      break;
+    default:
+      pnd->last_error = NFC_EINVARG;
+      return pnd->last_error;
+  }
+
+  op->timeout = pn53x_command_timeout(pnd, op->timeout);
+  if ((res = pn53x_transceive_submit(pnd, abtCmd, szCmd, op->timeout)) < 0) {
+    pnd->last_error = res;
+    return pnd->last_error;
+  }
+  CHIP_DATA(pnd)->abtAsyncCmd[0] = abtCmd[0];
+  CHIP_DATA(pnd)->abtAsyncCmd[1] = (szCmd > 1) ? abtCmd[1] : 0;
+  return NFC_SUCCESS;
+}
+
+int
+pn53x_async_complete(struct nfc_device *pnd, struct nfc_async_op *op, int timeout)
+{
+  uint8_t  abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  int res = 0;
+
+  if ((res = pn53x_transceive_complete(pnd, CHIP_DATA(pnd)->abtAsyncCmd, abtRx, sizeof(abtRx), timeout)) < 0) {
+    pnd->last_error = res;
+    return pnd->last_error;
+  }
+
+  switch (op->op) {
+    case NLO_INITIATOR_SELECT_PASSIVE_TARGET:
+      if (abtRx[0] == 0)
+        return 0;
+      return pn53x_initiator_listed_passive_target(pnd, op->nm, abtRx, (size_t)res, op->pnt);
+    case NLO_INITIATOR_TRANSCEIVE_BYTES:
+    case NLO_TARGET_RECEIVE_BYTES: {
+      // Strip the status byte
+      const size_t szRxLen = (size_t)res - 1;
+      if (op->pbtRx == NULL)
+        return szRxLen;
+      if (szRxLen > op->szRx) {
+        log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Buffer size is too short: %" PRIuPTR " available(s), %" PRIuPTR " needed", op->szRx, szRxLen);
+        return NFC_EOVFLOW;
+      }
+      memcpy(op->pbtRx, abtRx + 1, szRxLen);
+      return szRxLen;
+    }
+  }
+  pnd->last_error = NFC_EINVARG;
+  return pnd->last_error;
+}
+
 int
 pn53x_InDeselect(struct nfc_device *pnd, const uint8_t ui8Target)
 {
@@ -3812,8 +4862,10 @@ pn53x_data_new(struct nfc_device *pnd, const struct pn53x_io *io)
   // UART) the driver layer have to correctly set it.
   CHIP_DATA(pnd)->power_mode = NORMAL;
 
-  // PN53x starts in initiator mode
+  // PN53x starts in initiator mode, its settings are unknown
   CHIP_DATA(pnd)->operating_mode = INITIATOR;
+  CHIP_DATA(pnd)->initiator_defaults = false;
+  CHIP_DATA(pnd)->crypto1_off = false;
 
   // Clear last status byte
   CHIP_DATA(pnd)->last_status_byte = 0x00;
@@ -3828,6 +4880,14 @@ pn53x_data_new(struct nfc_device *pnd, const struct pn53x_io *io)
   CHIP_DATA(pnd)->wb_trigged = false;
   memset(CHIP_DATA(pnd)->wb_mask, 0x00, PN53X_CACHE_REGISTER_SIZE);
 
+  // Register values are unknown until read or written
+  pn53x_shadow_invalidate(pnd);
+  memset(&CHIP_DATA(pnd)->register_stats, 0x00, sizeof(CHIP_DATA(pnd)->register_stats));
+
+  // No batched property changes, RFConfiguration items are unknown
+  CHIP_DATA(pnd)->property_batch = 0;
+  memset(CHIP_DATA(pnd)->rfconfig, 0x00, sizeof(CHIP_DATA(pnd)->rfconfig));
+
   // Set default command timeout (350 ms)
   CHIP_DATA(pnd)->timeout_command = 350;
 
@@ -3844,6 +4904,19 @@ pn53x_data_new(struct nfc_device *pnd, const struct pn53x_io *io)
   // Set default progressive field flag
   CHIP_DATA(pnd)->progressive_field = false;
 
+  // Trace frames exchanged with the chip if asked by user
+  CHIP_DATA(pnd)->trace = NULL;
+  if (pnd->context && pnd->context->trace_path[0]) {
+    char acPath[DEVICE_NAME_LENGTH + NFC_BUFSIZE_CONNSTRING + 8];
+    int n = snprintf(acPath, sizeof(acPath), "%s-", pnd->context->trace_path);
+    // Derive a file name per device from its connstring
+    for (const char *pc = pnd->connstring; *pc && (n < (int)sizeof(acPath) - 7); pc++, n++) {
+      acPath[n] = (isalnum((unsigned char) *pc) || (*pc == '.') || (*pc == '-')) ? *pc : '_';
+    }
+    snprintf(acPath + n, sizeof(acPath) - n, ".trace");
+    CHIP_DATA(pnd)->trace = pn53x_trace_new(acPath, pnd->connstring);
+  }
+
   return pnd->chip_data;
 }
 
@@ -3853,6 +4926,8 @@ pn53x_data_free(struct nfc_device *pnd)
   // Free current target
   pn53x_current_target_free(pnd);
 
+  pn53x_trace_free(CHIP_DATA(pnd)->trace);
+
   // Free supported modulation(s)
   if (CHIP_DATA(pnd)->supported_modulation_as_initiator) {
     free(CHIP_DATA(pnd)->supported_modulation_as_initiator);
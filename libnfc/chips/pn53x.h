@@ -166,6 +166,51 @@ struct pn53x_io {
 #define PN53X_CACHE_REGISTER_MAX_ADDRESS 	PN53X_REG_CIU_Coll
 #define PN53X_CACHE_REGISTER_SIZE 		((PN53X_CACHE_REGISTER_MAX_ADDRESS - PN53X_CACHE_REGISTER_MIN_ADDRESS) + 1)
 
+/**
+ * @internal
+ * @struct pn53x_register_stats
+ * @brief Register accesses counters
+ */
+struct pn53x_register_stats {
+  /** ReadRegister and WriteRegister commands sent to the chip */
+  unsigned long round_trips;
+  /** ReadRegister and WriteRegister commands made unnecessary by the register shadow */
+  unsigned long round_trips_saved;
+};
+
+/**
+ * @internal
+ * @struct pn53x_rfconfig
+ * @brief RFConfiguration item value, see pn53x_commit_properties()
+ */
+struct pn53x_rfconfig {
+  /** Value last sent to the chip, when known */
+  uint8_t abtValue[3];
+  bool known;
+  /** Value waiting for pn53x_commit_properties() */
+  uint8_t abtPending[3];
+  bool pending;
+};
+
+// RFConfiguration items handled by pn53x_rfconfig
+#define PN53X_RFCONFIG_FIELD         0
+#define PN53X_RFCONFIG_TIMING        1
+#define PN53X_RFCONFIG_RETRY_DATA    2
+#define PN53X_RFCONFIG_RETRY_SELECT  3
+#define PN53X_RFCONFIG_ITEMS         4
+
+#define PN53X_SR_MAX_CHIPS 64
+
+/**
+ * @internal
+ * @struct pn53x_sr_chip
+ * @brief ST SRx tag left deselected by an inventory, selectable again with its Chip_ID
+ */
+struct pn53x_sr_chip {
+  uint8_t abtUID[8];
+  uint8_t btChipId;
+};
+
 /**
  * @internal
  * @struct pn53x_data
@@ -180,8 +225,15 @@ struct pn53x_data {
   pn53x_power_mode power_mode;
   /** Current operating mode */
   pn53x_operating_mode operating_mode;
+  /** CIU holds the initiator settings left by pn53x_initiator_init() */
+  bool initiator_defaults;
+  /** Crypto1 cipher is known to be off, a MIFARE authentication may switch it on */
+  bool crypto1_off;
   /** Current emulated target */
   nfc_target *current_target;
+  /** ST SRx tags inventoried since the RF field was switched on */
+  struct pn53x_sr_chip sr_chips[PN53X_SR_MAX_CHIPS];
+  size_t sr_chip_count;
   /** Current sam mode (only applicable for PN532) */
   pn532_sam_mode sam_mode;
   /** PN53x I/O functions stored in struct */
@@ -192,6 +244,12 @@ struct pn53x_data {
   uint8_t ui8TxBits;
   /** Register cache for SetParameters function. */
   uint8_t ui8Parameters;
+  /** Nesting depth of pn53x_begin_properties(), property changes are applied when it drops to zero */
+  unsigned int property_batch;
+  /** SetParameters value waiting for pn53x_commit_properties() */
+  uint8_t ui8ParametersPending;
+  /** RFConfiguration items values */
+  struct pn53x_rfconfig rfconfig[PN53X_RFCONFIG_ITEMS];
   /** Last sent command */
   uint8_t last_command;
   /** Interframe timer correction */
@@ -202,6 +260,11 @@ struct pn53x_data {
   uint8_t wb_data[PN53X_CACHE_REGISTER_SIZE];
   uint8_t wb_mask[PN53X_CACHE_REGISTER_SIZE];
   bool wb_trigged;
+  /** Register shadow: last value read from or written to each cacheable register */
+  uint8_t sh_data[PN53X_CACHE_REGISTER_SIZE];
+  bool sh_valid[PN53X_CACHE_REGISTER_SIZE];
+  /** Register accesses counters */
+  struct pn53x_register_stats register_stats;
   /** Command timeout */
   int timeout_command;
   /** ATR timeout */
@@ -212,6 +275,10 @@ struct pn53x_data {
   nfc_modulation_type *supported_modulation_as_initiator;
   nfc_modulation_type *supported_modulation_as_target;
   bool progressive_field;
+  /** Binary frame trace, NULL when tracing is disabled */
+  struct pn53x_trace *trace;
+  /** Command code and first parameter of the command submitted by pn53x_async_submit() */
+  uint8_t abtAsyncCmd[2];
 };
 
 #define CHIP_DATA(pnd) ((struct pn53x_data*)(pnd->chip_data))
@@ -304,6 +371,8 @@ extern const uint8_t pn53x_nack_frame[PN53x_ACK_FRAME__LEN];
 
 int    pn53x_init(struct nfc_device *pnd);
 int    pn53x_transceive(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx, const size_t szRxLen, int timeout);
+int    pn53x_transceive_submit(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, int timeout);
+int    pn53x_transceive_complete(struct nfc_device *pnd, const uint8_t *pbtTx, uint8_t *pbtRx, const size_t szRxLen, int timeout);
 
 int    pn53x_set_parameters(struct nfc_device *pnd, const uint8_t ui8Value, const bool bEnable);
 int    pn53x_set_tx_bits(struct nfc_device *pnd, const uint8_t ui8Bits);
@@ -317,6 +386,8 @@ int    pn53x_write_register(struct nfc_device *pnd, uint16_t ui16Reg, uint8_t ui
 int    pn53x_decode_firmware_version(struct nfc_device *pnd);
 int    pn53x_set_property_int(struct nfc_device *pnd, const nfc_property property, const int value);
 int    pn53x_set_property_bool(struct nfc_device *pnd, const nfc_property property, const bool bEnable);
+int    pn53x_begin_properties(struct nfc_device *pnd);
+int    pn53x_commit_properties(struct nfc_device *pnd);
 
 int    pn53x_check_communication(struct nfc_device *pnd);
 int    pn53x_idle(struct nfc_device *pnd);
@@ -329,6 +400,12 @@ int    pn53x_initiator_select_passive_target(struct nfc_device *pnd,
                                              const nfc_modulation nm,
                                              const uint8_t *pbtInitData, const size_t szInitData,
                                              nfc_target *pnt);
+int    pn53x_initiator_list_passive_targets(struct nfc_device *pnd,
+                                            const nfc_modulation nm,
+                                            const uint8_t *pbtInitData, const size_t szInitData,
+                                            nfc_target ant[], const size_t szTargets);
+int    pn53x_initiator_inventory(struct nfc_device *pnd, const nfc_modulation nm,
+                                 nfc_target ant[], const size_t szTargets, size_t *pszRoundTrips);
 int    pn53x_initiator_poll_target(struct nfc_device *pnd,
                                    const nfc_modulation *pnmModulations, const size_t szModulations,
                                    const uint8_t uiPollNr, const uint8_t uiPeriod,
@@ -356,6 +433,11 @@ int    pn53x_target_receive_bytes(struct nfc_device *pnd, uint8_t *pbtRx, const
 int    pn53x_target_send_bits(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar);
 int    pn53x_target_send_bytes(struct nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, int timeout);
 
+// Event loop support
+struct nfc_async_op;
+int    pn53x_async_submit(struct nfc_device *pnd, struct nfc_async_op *op);
+int    pn53x_async_complete(struct nfc_device *pnd, struct nfc_async_op *op, int timeout);
+
 // Error handling functions
 const char *pn53x_strerror(const struct nfc_device *pnd);
 
@@ -215,8 +215,13 @@ conf_keyvalue_context(void *data, const char *key, const char *value)
     string_as_boolean(value, &(context->allow_autoscan));
   } else if (strcmp(key, "allow_intrusive_scan") == 0) {
     string_as_boolean(value, &(context->allow_intrusive_scan));
+  } else if (strcmp(key, "scan_timeout") == 0) {
+    context->scan_timeout = atoi(value);
   } else if (strcmp(key, "log_level") == 0) {
     context->log_level = atoi(value);
+  } else if (strcmp(key, "trace_path") == 0) {
+    strncpy(context->trace_path, value, sizeof(context->trace_path));
+    context->trace_path[sizeof(context->trace_path) - 1] = '\0';
   } else if (strcmp(key, "device.name") == 0) {
     if ((context->user_defined_device_count == 0) || strcmp(context->user_defined_devices[context->user_defined_device_count - 1].name, "") != 0) {
       if (context->user_defined_device_count >= MAX_USER_DEFINED_DEVICES) {
@@ -103,6 +103,7 @@ static const char *supported_devices[] = {
 };
 
 struct acr122_pcsc_data {
+  SCARDCONTEXT hContext;
   SCARDHANDLE hCard;
   SCARD_IO_REQUEST ioCard;
   uint8_t  abtRx[ACR122_PCSC_RESPONSE_LEN];
@@ -111,32 +112,6 @@ struct acr122_pcsc_data {
 
 #define DRIVER_DATA(pnd) ((struct acr122_pcsc_data*)(pnd->driver_data))
 
-static SCARDCONTEXT _SCardContext;
-static int _iSCardContextRefCount = 0;
-
-static SCARDCONTEXT *
-acr122_pcsc_get_scardcontext(void)
-{
-  if (_iSCardContextRefCount == 0) {
-    if (SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &_SCardContext) != SCARD_S_SUCCESS)
-      return NULL;
-  }
-  _iSCardContextRefCount++;
-
-  return &_SCardContext;
-}
-
-static void
-acr122_pcsc_free_scardcontext(void)
-{
-  if (_iSCardContextRefCount) {
-    _iSCardContextRefCount--;
-    if (!_iSCardContextRefCount) {
-      SCardReleaseContext(_SCardContext);
-    }
-  }
-}
-
 #define PCSC_MAX_DEVICES 16
 /**
  * @brief List opened devices
@@ -154,21 +129,24 @@ acr122_pcsc_scan(const nfc_context *context, nfc_connstring connstrings[], const
   size_t  szPos = 0;
   char    acDeviceNames[256 + 64 * PCSC_MAX_DEVICES];
   size_t  szDeviceNamesLen = sizeof(acDeviceNames);
-  SCARDCONTEXT *pscc;
+  SCARDCONTEXT hContext;
   int     i;
 
   // Clear the reader list
   memset(acDeviceNames, '\0', szDeviceNamesLen);
 
-  // Test if context succeeded
-  if (!(pscc = acr122_pcsc_get_scardcontext())) {
+  // Each scan gets its own short-lived context so concurrent scans and opened
+  // devices never share PC/SC state
+  if (SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &hContext) != SCARD_S_SUCCESS) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_INFO, "Warning: %s", "PCSC context not found (make sure PCSC daemon is running).");
     return 0;
   }
   // Retrieve the string array of all available pcsc readers
   DWORD dwDeviceNamesLen = szDeviceNamesLen;
-  if (SCardListReaders(*pscc, NULL, acDeviceNames, &dwDeviceNamesLen) != SCARD_S_SUCCESS)
+  if (SCardListReaders(hContext, NULL, acDeviceNames, &dwDeviceNamesLen) != SCARD_S_SUCCESS) {
+    SCardReleaseContext(hContext);
     return 0;
+  }
 
   size_t device_found = 0;
   while ((acDeviceNames[szPos] != '\0') && (device_found < connstrings_len)) {
@@ -189,7 +167,7 @@ acr122_pcsc_scan(const nfc_context *context, nfc_connstring connstrings[], const
     // Find next device name position
     while (acDeviceNames[szPos++] != '\0');
   }
-  acr122_pcsc_free_scardcontext();
+  SCardReleaseContext(hContext);
 
   return device_found;
 }
@@ -269,19 +247,17 @@ acr122_pcsc_open(const nfc_context *context, const nfc_connstring connstring)
     goto error;
   }
 
-  SCARDCONTEXT *pscc;
-
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Attempt to open %s", ndd.pcsc_device_name);
   // Test if context succeeded
-  if (!(pscc = acr122_pcsc_get_scardcontext()))
+  if (SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &(DRIVER_DATA(pnd)->hContext)) != SCARD_S_SUCCESS)
     goto error;
   // Test if we were able to connect to the "emulator" card
-  if (SCardConnect(*pscc, ndd.pcsc_device_name, SCARD_SHARE_EXCLUSIVE, SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1, &(DRIVER_DATA(pnd)->hCard), (void *) & (DRIVER_DATA(pnd)->ioCard.dwProtocol)) != SCARD_S_SUCCESS) {
+  if (SCardConnect(DRIVER_DATA(pnd)->hContext, ndd.pcsc_device_name, SCARD_SHARE_EXCLUSIVE, SCARD_PROTOCOL_T0 | SCARD_PROTOCOL_T1, &(DRIVER_DATA(pnd)->hCard), (void *) & (DRIVER_DATA(pnd)->ioCard.dwProtocol)) != SCARD_S_SUCCESS) {
     // Connect to ACR122 firmware version >2.0
-    if (SCardConnect(*pscc, ndd.pcsc_device_name, SCARD_SHARE_DIRECT, 0, &(DRIVER_DATA(pnd)->hCard), (void *) & (DRIVER_DATA(pnd)->ioCard.dwProtocol)) != SCARD_S_SUCCESS) {
+    if (SCardConnect(DRIVER_DATA(pnd)->hContext, ndd.pcsc_device_name, SCARD_SHARE_DIRECT, 0, &(DRIVER_DATA(pnd)->hCard), (void *) & (DRIVER_DATA(pnd)->ioCard.dwProtocol)) != SCARD_S_SUCCESS) {
       // We can not connect to this device.
       log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s", "PCSC connect failed");
-      goto error;
+      goto error_context;
     }
   }
   // Configure I/O settings for card communication
@@ -306,6 +282,8 @@ acr122_pcsc_open(const nfc_context *context, const nfc_connstring connstring)
     return pnd;
   }
 
+error_context:
+  SCardReleaseContext(DRIVER_DATA(pnd)->hContext);
 error:
   free(ndd.pcsc_device_name);
   nfc_device_free(pnd);
@@ -318,7 +296,7 @@ acr122_pcsc_close(nfc_device *pnd)
   pn53x_idle(pnd);
 
   SCardDisconnect(DRIVER_DATA(pnd)->hCard, SCARD_LEAVE_CARD);
-  acr122_pcsc_free_scardcontext();
+  SCardReleaseContext(DRIVER_DATA(pnd)->hContext);
 
   pn53x_data_free(pnd);
   nfc_device_free(pnd);
@@ -486,6 +464,8 @@ const struct nfc_driver acr122_pcsc_driver = {
   .initiator_init                   = pn53x_initiator_init,
   .initiator_init_secure_element    = NULL, // No secure-element support
   .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_inventory              = pn53x_initiator_inventory,
   .initiator_poll_target            = pn53x_initiator_poll_target,
   .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
   .initiator_deselect_target        = pn53x_initiator_deselect_target,
@@ -503,6 +483,8 @@ const struct nfc_driver acr122_pcsc_driver = {
 
   .device_set_property_bool     = pn53x_set_property_bool,
   .device_set_property_int      = pn53x_set_property_int,
+  .device_begin_properties      = pn53x_begin_properties,
+  .device_commit_properties     = pn53x_commit_properties,
   .get_supported_modulation     = pn53x_get_supported_modulation,
   .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
   .device_get_information_about = pn53x_get_information_about,
@@ -603,6 +603,8 @@ const struct nfc_driver arygon_driver = {
   .initiator_init                   = pn53x_initiator_init,
   .initiator_init_secure_element    = NULL, // No secure-element support
   .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_inventory              = pn53x_initiator_inventory,
   .initiator_poll_target            = pn53x_initiator_poll_target,
   .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
   .initiator_deselect_target        = pn53x_initiator_deselect_target,
@@ -620,6 +622,8 @@ const struct nfc_driver arygon_driver = {
 
   .device_set_property_bool     = pn53x_set_property_bool,
   .device_set_property_int      = pn53x_set_property_int,
+  .device_begin_properties      = pn53x_begin_properties,
+  .device_commit_properties     = pn53x_commit_properties,
   .get_supported_modulation     = pn53x_get_supported_modulation,
   .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
   .device_get_information_about = pn53x_get_information_about,
@@ -95,43 +95,19 @@ static const char *supported_devices[] = {
 };
 
 struct pcsc_data {
+  SCARDCONTEXT hContext;
   SCARDHANDLE hCard;
   SCARD_IO_REQUEST ioCard;
   DWORD dwShareMode;
   DWORD last_error;
+  char acError[75];
 };
 
 #define DRIVER_DATA(pnd) ((struct pcsc_data*)(pnd->driver_data))
 
-static SCARDCONTEXT _SCardContext;
-static int _iSCardContextRefCount = 0;
-
 const nfc_baud_rate pcsc_supported_brs[] = {NBR_106, NBR_424, 0};
 const nfc_modulation_type pcsc_supported_mts[] = {NMT_ISO14443A, NMT_ISO14443B, 0};
 
-static SCARDCONTEXT *
-pcsc_get_scardcontext(void)
-{
-  if (_iSCardContextRefCount == 0) {
-    if (SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &_SCardContext) != SCARD_S_SUCCESS)
-      return NULL;
-  }
-  _iSCardContextRefCount++;
-
-  return &_SCardContext;
-}
-
-static void
-pcsc_free_scardcontext(void)
-{
-  if (_iSCardContextRefCount) {
-    _iSCardContextRefCount--;
-    if (!_iSCardContextRefCount) {
-      SCardReleaseContext(_SCardContext);
-    }
-  }
-}
-
 #define ICC_TYPE_UNKNOWN 0
 #define ICC_TYPE_14443A  5
 #define ICC_TYPE_14443B  6
@@ -424,21 +400,24 @@ pcsc_scan(const nfc_context *context, nfc_connstring connstrings[], const size_t
   size_t  szPos = 0;
   char    acDeviceNames[256 + 64 * PCSC_MAX_DEVICES];
   size_t  szDeviceNamesLen = sizeof(acDeviceNames);
-  SCARDCONTEXT *pscc;
+  SCARDCONTEXT hContext;
   int     i;
 
   // Clear the reader list
   memset(acDeviceNames, '\0', szDeviceNamesLen);
 
-  // Test if context succeeded
-  if (!(pscc = pcsc_get_scardcontext())) {
+  // Each scan gets its own short-lived context so concurrent scans and opened
+  // devices never share PC/SC state
+  if (SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &hContext) != SCARD_S_SUCCESS) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_INFO, "Warning: %s", "PCSC context not found (make sure PCSC daemon is running).");
     return 0;
   }
   // Retrieve the string array of all available pcsc readers
   DWORD dwDeviceNamesLen = szDeviceNamesLen;
-  if (SCardListReaders(*pscc, NULL, acDeviceNames, &dwDeviceNamesLen) != SCARD_S_SUCCESS)
+  if (SCardListReaders(hContext, NULL, acDeviceNames, &dwDeviceNamesLen) != SCARD_S_SUCCESS) {
+    SCardReleaseContext(hContext);
     return 0;
+  }
 
   size_t device_found = 0;
   while ((acDeviceNames[szPos] != '\0') && (device_found < connstrings_len)) {
@@ -459,7 +438,7 @@ pcsc_scan(const nfc_context *context, nfc_connstring connstrings[], const size_t
     // Find next device name position
     while (acDeviceNames[szPos++] != '\0');
   }
-  pcsc_free_scardcontext();
+  SCardReleaseContext(hContext);
 
   return device_found;
 }
@@ -532,16 +511,15 @@ pcsc_open(const nfc_context *context, const nfc_connstring connstring)
     goto error;
   }
 
-  SCARDCONTEXT *pscc;
-
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Attempt to open %s", ndd.pcsc_device_name);
   // Test if context succeeded
-  if (!(pscc = pcsc_get_scardcontext()))
+  if (SCardEstablishContext(SCARD_SCOPE_USER, NULL, NULL, &(DRIVER_DATA(pnd)->hContext)) != SCARD_S_SUCCESS)
     goto error;
-  DRIVER_DATA(pnd)->last_error = SCardConnect(*pscc, ndd.pcsc_device_name, SCARD_SHARE_DIRECT, 0 | 1, &(DRIVER_DATA(pnd)->hCard), (void *) & (DRIVER_DATA(pnd)->ioCard.dwProtocol));
+  DRIVER_DATA(pnd)->last_error = SCardConnect(DRIVER_DATA(pnd)->hContext, ndd.pcsc_device_name, SCARD_SHARE_DIRECT, 0 | 1, &(DRIVER_DATA(pnd)->hCard), (void *) & (DRIVER_DATA(pnd)->ioCard.dwProtocol));
   if (DRIVER_DATA(pnd)->last_error != SCARD_S_SUCCESS) {
     // We can not connect to this device.
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s", "PCSC connect failed");
+    SCardReleaseContext(DRIVER_DATA(pnd)->hContext);
     goto error;
   }
   // Configure I/O settings for card communication
@@ -566,14 +544,13 @@ static void
 pcsc_close(nfc_device *pnd)
 {
   SCardDisconnect(DRIVER_DATA(pnd)->hCard, SCARD_LEAVE_CARD);
-  pcsc_free_scardcontext();
+  SCardReleaseContext(DRIVER_DATA(pnd)->hContext);
 
   nfc_device_free(pnd);
 }
 
-static const char *stringify_error(const LONG pcscError)
+static const char *stringify_error(const LONG pcscError, char *strError, const size_t szError)
 {
-  static char strError[75];
   const char *msg = NULL;
 
   switch (pcscError) {
@@ -713,18 +690,18 @@ static const char *stringify_error(const LONG pcscError)
       msg = "Feature not supported.";
       break;
     default:
-      (void)snprintf(strError, sizeof(strError) - 1, "Unknown error: 0x%08lX",
+      (void)snprintf(strError, szError - 1, "Unknown error: 0x%08lX",
                      pcscError);
   };
 
   if (msg)
-    (void)strncpy(strError, msg, sizeof(strError));
+    (void)strncpy(strError, msg, szError);
   else
-    (void)snprintf(strError, sizeof(strError) - 1, "Unknown error: 0x%08lX",
+    (void)snprintf(strError, szError - 1, "Unknown error: 0x%08lX",
                    pcscError);
 
   /* add a null byte */
-  strError[sizeof(strError) - 1] = '\0';
+  strError[szError - 1] = '\0';
 
   return strError;
 }
@@ -732,7 +709,7 @@ static const char *stringify_error(const LONG pcscError)
 static const char *
 pcsc_strerror(const struct nfc_device *pnd)
 {
-  return stringify_error(DRIVER_DATA(pnd)->last_error);
+  return stringify_error(DRIVER_DATA(pnd)->last_error, DRIVER_DATA(pnd)->acError, sizeof(DRIVER_DATA(pnd)->acError));
 }
 
 static int pcsc_initiator_init(struct nfc_device *pnd)
@@ -979,12 +956,6 @@ pcsc_get_information_about(nfc_device *pnd, char **pbuf)
            type_len = SCARD_AUTOALLOCATE, serial_len = SCARD_AUTOALLOCATE;
 #endif
   int res = NFC_SUCCESS;
-  SCARDCONTEXT *pscc;
-
-  if (!(pscc = pcsc_get_scardcontext())) {
-    pnd->last_error = NFC_ESOFT;
-    return pnd->last_error;
-  }
 
   SCardGetAttrib(data->hCard, SCARD_ATTR_VENDOR_NAME, (LPBYTE)&name, &name_len);
   SCardGetAttrib(data->hCard, SCARD_ATTR_VENDOR_IFD_TYPE, (LPBYTE)&type, &type_len);
@@ -1013,9 +984,6 @@ pcsc_get_information_about(nfc_device *pnd, char **pbuf)
 
 error:
 #ifdef __APPLE__
-  if (pscc != NULL) {
-    SCardReleaseContext(*pscc);
-  }
   if (name != NULL) {
     free(name);
     name = NULL;
@@ -1033,10 +1001,10 @@ error:
     serial = NULL;
   }
 #else
-  SCardFreeMemory(*pscc, name);
-  SCardFreeMemory(*pscc, type);
-  SCardFreeMemory(*pscc, version);
-  SCardFreeMemory(*pscc, serial);
+  SCardFreeMemory(data->hContext, name);
+  SCardFreeMemory(data->hContext, type);
+  SCardFreeMemory(data->hContext, version);
+  SCardFreeMemory(data->hContext, serial);
 #endif
 
   pnd->last_error = res;
@@ -41,6 +41,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <time.h>
 
 #include <nfc/nfc.h>
@@ -71,7 +72,11 @@ const struct pn53x_io pn532_i2c_io;
 
 struct pn532_i2c_data {
   i2c_device dev;
+  struct timespec bus_free;     // Earliest START condition after the last STOP
   volatile bool abort_flag;
+  // Response frame already read by pn532_i2c_async_ready(), for pn532_i2c_receive()
+  uint8_t abtReady[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  size_t szReady;
 };
 
 /* preamble and start bytes, see pn532-internal.h for details */
@@ -103,35 +108,70 @@ static size_t pn532_i2c_scan(const nfc_context *context, nfc_connstring connstri
  * Bus free time (in ms) between a STOP condition and START condition. See
  * tBuf in the PN532 data sheet, section 12.25: Timing for the I2C interface,
  * table 320. I2C timing specification, page 211, rev. 3.2 - 2007-12-07.
+ *
+ * The PN532 answers on a fixed address, so there is one device per bus and
+ * the time of the last STOP condition is kept in the driver data: devices on
+ * different buses do not delay each other.
  */
 #define PN532_BUS_FREE_TIME 5
-static struct timespec __transaction_stop;
+
+static bool
+pn532_i2c_timespec_before(const struct timespec *a, const struct timespec *b)
+{
+  return (a->tv_sec < b->tv_sec) || ((a->tv_sec == b->tv_sec) && (a->tv_nsec < b->tv_nsec));
+}
+
+static void
+pn532_i2c_timespec_add_ms(struct timespec *ts, int ms)
+{
+  ts->tv_sec += ms / 1000;
+  ts->tv_nsec += (long)(ms % 1000) * 1000 * 1000;
+  if (ts->tv_nsec >= 1000 * 1000 * 1000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000 * 1000 * 1000;
+  }
+}
+
+/*
+ * Sleeps until the bus free time following the last transaction has elapsed,
+ * if it has not already.
+ */
+static void
+pn532_i2c_wait_bus_free(nfc_device *pnd)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (!pn532_i2c_timespec_before(&now, &DRIVER_DATA(pnd)->bus_free))
+    return;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &DRIVER_DATA(pnd)->bus_free, NULL) == EINTR)
+    ;
+}
+
+static void
+pn532_i2c_transaction_stop(nfc_device *pnd)
+{
+  clock_gettime(CLOCK_MONOTONIC, &DRIVER_DATA(pnd)->bus_free);
+  pn532_i2c_timespec_add_ms(&DRIVER_DATA(pnd)->bus_free, PN532_BUS_FREE_TIME);
+}
 
 /**
  * @brief Wrapper around i2c_read to ensure proper timing by respecting the
  * 	  minimal free bus time between a STOP condition and a START condition.
  *
- * @note This is not thread safe, but since libnfc is single threaded
- * 	 this should be okay.
- *
- * @param id I2C device
+ * @param pnd pointer on the NFC device.
  * @param buf pointer on buffer used to store data
  * @param len length of the buffer
  * @return length (in bytes) of read data, or driver error code (negative value)
  */
-static ssize_t pn532_i2c_read(const i2c_device id,
+static ssize_t pn532_i2c_read(nfc_device *pnd,
                               uint8_t *buf, const size_t len)
 {
-  struct timespec transaction_start, bus_free_time = { 0, 0 };
   ssize_t ret;
 
-  clock_gettime(CLOCK_MONOTONIC, &transaction_start);
-  bus_free_time.tv_nsec = (PN532_BUS_FREE_TIME * 1000 * 1000) -
-                          (transaction_start.tv_nsec - __transaction_stop.tv_nsec);
-  nanosleep(&bus_free_time, NULL);
-
-  ret = i2c_read(id, buf, len);
-  clock_gettime(CLOCK_MONOTONIC, &__transaction_stop);
+  pn532_i2c_wait_bus_free(pnd);
+  ret = i2c_read(DRIVER_DATA(pnd)->dev, buf, len);
+  pn532_i2c_transaction_stop(pnd);
   return ret;
 }
 
@@ -139,27 +179,19 @@ static ssize_t pn532_i2c_read(const i2c_device id,
  * @brief Wrapper around i2c_write to ensure proper timing by respecting the
  * 	  minimal free bus time between a STOP condition and a START condition.
  *
- * @note This is not thread safe, but since libnfc is single threaded
- * 	 this should be okay.
- *
- * @param id I2C device
+ * @param pnd pointer on the NFC device.
  * @param buf pointer on buffer containing data
  * @param len length of the buffer
  * @return NFC_SUCCESS on success, otherwise driver error code
  */
-static ssize_t pn532_i2c_write(const i2c_device id,
+static ssize_t pn532_i2c_write(nfc_device *pnd,
                                const uint8_t *buf, const size_t len)
 {
-  struct timespec transaction_start, bus_free_time = { 0, 0 };
   ssize_t ret;
 
-  clock_gettime(CLOCK_MONOTONIC, &transaction_start);
-  bus_free_time.tv_nsec = (PN532_BUS_FREE_TIME * 1000 * 1000) -
-                          (transaction_start.tv_nsec - __transaction_stop.tv_nsec);
-  nanosleep(&bus_free_time, NULL);
-
-  ret = i2c_write(id, buf, len);
-  clock_gettime(CLOCK_MONOTONIC, &__transaction_stop);
+  pn532_i2c_wait_bus_free(pnd);
+  ret = i2c_write(DRIVER_DATA(pnd)->dev, buf, len);
+  pn532_i2c_transaction_stop(pnd);
   return ret;
 }
 
@@ -213,6 +245,9 @@ pn532_i2c_scan(const nfc_context *context, nfc_connstring connstrings[], const s
         return 0;
       }
       DRIVER_DATA(pnd)->dev = id;
+      DRIVER_DATA(pnd)->bus_free.tv_sec = 0;
+      DRIVER_DATA(pnd)->bus_free.tv_nsec = 0;
+      DRIVER_DATA(pnd)->szReady = 0;
 
       // Alloc and init chip's data
       if (pn53x_data_new(pnd, &pn532_i2c_io) == NULL) {
@@ -321,6 +356,9 @@ pn532_i2c_open(const nfc_context *context, const nfc_connstring connstring)
     return NULL;
   }
   DRIVER_DATA(pnd)->dev = i2c_dev;
+  DRIVER_DATA(pnd)->bus_free.tv_sec = 0;
+  DRIVER_DATA(pnd)->bus_free.tv_nsec = 0;
+  DRIVER_DATA(pnd)->szReady = 0;
 
   // Alloc and init chip's data
   if (pn53x_data_new(pnd, &pn532_i2c_io) == NULL) {
@@ -378,6 +416,7 @@ pn532_i2c_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int
   uint8_t retries;
 
   // Discard any existing data ?
+  DRIVER_DATA(pnd)->szReady = 0;
 
   switch (CHIP_DATA(pnd)->power_mode) {
     case LOWVBAT: {
@@ -412,7 +451,7 @@ pn532_i2c_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int
   }
 
   for (retries = PN532_SEND_RETRIES; retries > 0; retries--) {
-    res = pn532_i2c_write(DRIVER_DATA(pnd)->dev, abtFrame, szFrame);
+    res = pn532_i2c_write(pnd, abtFrame, szFrame);
     if (res >= 0)
       break;
 
@@ -462,20 +501,31 @@ pn532_i2c_wait_rdyframe(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLe
   bool done = false;
   int res;
 
-  struct timeval start_tv, cur_tv;
-  long long duration;
+  struct timespec deadline, now;
 
   // Actual I2C response frame includes an additional status byte,
   // so we use a temporary buffer to read the I2C frame
   uint8_t i2cRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN + 1];
 
+  // A frame read by pn532_i2c_async_ready() is served first
+  if (DRIVER_DATA(pnd)->szReady) {
+    res = DRIVER_DATA(pnd)->szReady;
+    memcpy(pbtData, DRIVER_DATA(pnd)->abtReady, MIN(DRIVER_DATA(pnd)->szReady, szDataLen));
+    DRIVER_DATA(pnd)->szReady = 0;
+    return res;
+  }
+
   if (timeout > 0) {
-    // If a timeout is specified, get current timestamp
-    gettimeofday(&start_tv, NULL);
+    // If a timeout is specified, compute when it expires
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    pn532_i2c_timespec_add_ms(&deadline, timeout);
   }
 
+  // Every poll reads a whole frame: polling the status byte alone would cost
+  // one more transaction, and bus free time, once the PN532 is ready. The
+  // only wait between polls is what is left of the bus free time.
   do {
-    int recCount = pn532_i2c_read(DRIVER_DATA(pnd)->dev, i2cRx, szDataLen + 1);
+    int recCount = pn532_i2c_read(pnd, i2cRx, szDataLen + 1);
 
     if (DRIVER_DATA(pnd)->abort_flag) {
       // Reset abort flag
@@ -502,11 +552,9 @@ pn532_i2c_wait_rdyframe(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLe
         /* Not ready yet. Check for elapsed timeout. */
 
         if (timeout > 0) {
-          gettimeofday(&cur_tv, NULL);
-          duration = (cur_tv.tv_sec - start_tv.tv_sec) * 1000000L
-                     + (cur_tv.tv_usec - start_tv.tv_usec);
+          clock_gettime(CLOCK_MONOTONIC, &now);
 
-          if (duration / 1000 > timeout) {
+          if (pn532_i2c_timespec_before(&deadline, &now)) {
             res = NFC_ETIMEOUT;
             done = true;
 
@@ -642,7 +690,7 @@ error:
 int
 pn532_i2c_ack(nfc_device *pnd)
 {
-  return pn532_i2c_write(DRIVER_DATA(pnd)->dev, pn53x_ack_frame, sizeof(pn53x_ack_frame));
+  return pn532_i2c_write(pnd, pn53x_ack_frame, sizeof(pn53x_ack_frame));
 }
 
 /**
@@ -660,6 +708,44 @@ pn532_i2c_abort_command(nfc_device *pnd)
   return NFC_SUCCESS;
 }
 
+/**
+ * @brief Check, without waiting, whether the response frame is ready
+ *
+ * A ready frame is read in full and kept for pn532_i2c_receive(), so that the
+ * event loop costs the same I2C transactions as a blocking receive.
+ *
+ * @param pnd pointer on the NFC device.
+ * @return 1 when ready, 0 if not or if the bus free time is not over yet, or driver error code
+ */
+static int
+pn532_i2c_async_ready(nfc_device *pnd)
+{
+  uint8_t i2cRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN + 1];
+  struct timespec now;
+
+  if (DRIVER_DATA(pnd)->szReady)
+    return 1;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (pn532_i2c_timespec_before(&now, &DRIVER_DATA(pnd)->bus_free))
+    return 0;
+
+  ssize_t recCount = pn532_i2c_read(pnd, i2cRx, sizeof(i2cRx));
+  if (recCount <= 0)
+    return NFC_EIO;
+  if (!(i2cRx[0] & 1))
+    return 0;
+  DRIVER_DATA(pnd)->szReady = recCount - 1;
+  memcpy(DRIVER_DATA(pnd)->abtReady, i2cRx + 1, recCount - 1);
+  return 1;
+}
+
+static int
+pn532_i2c_async_cancel(nfc_device *pnd)
+{
+  DRIVER_DATA(pnd)->szReady = 0;
+  return pn532_i2c_ack(pnd);
+}
+
 const struct pn53x_io pn532_i2c_io = {
   .send       = pn532_i2c_send,
   .receive    = pn532_i2c_receive,
@@ -676,6 +762,8 @@ const struct nfc_driver pn532_i2c_driver = {
   .initiator_init                   = pn53x_initiator_init,
   .initiator_init_secure_element    = pn532_initiator_init_secure_element,
   .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_inventory              = pn53x_initiator_inventory,
   .initiator_poll_target            = pn53x_initiator_poll_target,
   .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
   .initiator_deselect_target        = pn53x_initiator_deselect_target,
@@ -693,6 +781,8 @@ const struct nfc_driver pn532_i2c_driver = {
 
   .device_set_property_bool     = pn53x_set_property_bool,
   .device_set_property_int      = pn53x_set_property_int,
+  .device_begin_properties      = pn53x_begin_properties,
+  .device_commit_properties     = pn53x_commit_properties,
   .get_supported_modulation     = pn53x_get_supported_modulation,
   .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
   .device_get_information_about = pn53x_get_information_about,
@@ -700,5 +790,10 @@ const struct nfc_driver pn532_i2c_driver = {
   .abort_command  = pn532_i2c_abort_command,
   .idle           = pn53x_idle,
   .powerdown      = pn53x_PowerDown,
+
+  .async_submit   = pn53x_async_submit,
+  .async_ready    = pn532_i2c_async_ready,
+  .async_complete = pn53x_async_complete,
+  .async_cancel   = pn532_i2c_async_cancel,
 };
 
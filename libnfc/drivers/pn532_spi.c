@@ -28,6 +28,10 @@
 /**
  * @file pn532_spi.c
  * @brief PN532 driver using SPI bus
+ *
+ * Connstring: pn532_spi:<spidev>[:<speed>[:<gpiochip>:<line>]], e.g.
+ * "pn532_spi:/dev/spidev0.0:1000000:gpiochip0:25" when the PN532 IRQ pin is
+ * wired to GPIO 25. Without IRQ line, the SPI status byte is polled.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -46,6 +50,7 @@
 #include "chips/pn53x.h"
 #include "chips/pn53x-internal.h"
 #include "spi.h"
+#include "gpio.h"
 
 #define PN532_SPI_DEFAULT_SPEED 1000000 // 1 MHz
 #define PN532_SPI_DRIVER_NAME "pn532_spi"
@@ -74,6 +79,7 @@
 const struct pn53x_io pn532_spi_io;
 struct pn532_spi_data {
   spi_port port;
+  gpio_irq irq;
   volatile bool abort_flag;
 };
 
@@ -132,6 +138,7 @@ pn532_spi_scan(const nfc_context *context, nfc_connstring connstrings[], const s
         return 0;
       }
       DRIVER_DATA(pnd)->port = sp;
+      DRIVER_DATA(pnd)->irq = INVALID_GPIO_IRQ;
 
       // Alloc and init chip's data
       if (pn53x_data_new(pnd, &pn532_spi_io) == NULL) {
@@ -189,11 +196,40 @@ pn532_spi_close(nfc_device *pnd)
 
   // Release SPI port
   spi_close(DRIVER_DATA(pnd)->port);
+  if (DRIVER_DATA(pnd)->irq != INVALID_GPIO_IRQ)
+    gpio_irq_close(DRIVER_DATA(pnd)->irq);
 
   pn53x_data_free(pnd);
   nfc_device_free(pnd);
 }
 
+/*
+ * connstring_decode() stops at the speed, an IRQ line may follow as
+ * ":<gpiochip>:<line>"; returns 0 when there is none
+ */
+static int
+pn532_spi_decode_irq(const nfc_connstring connstring, gpio_irq *pirq)
+{
+  const char *pcIrq = connstring;
+  char acChip[NFC_BUFSIZE_CONNSTRING];
+  unsigned int uiLine;
+
+  *pirq = INVALID_GPIO_IRQ;
+  for (int i = 0; (i < 3) && pcIrq; i++) {
+    if ((pcIrq = strchr(pcIrq, ':')))
+      pcIrq++;
+  }
+  if (!pcIrq)
+    return 0;
+  if (sscanf(pcIrq, "%1023[^:]:%u", acChip, &uiLine) != 2) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Invalid IRQ line: %s (expected gpiochip:line)", pcIrq);
+    return NFC_EINVARG;
+  }
+  if ((*pirq = gpio_irq_open(acChip, uiLine)) == INVALID_GPIO_IRQ)
+    return NFC_EIO;
+  return 0;
+}
+
 static nfc_device *
 pn532_spi_open(const nfc_context *context, const nfc_connstring connstring)
 {
@@ -233,12 +269,21 @@ pn532_spi_open(const nfc_context *context, const nfc_connstring connstring)
   spi_set_speed(sp, ndd.speed);
   spi_set_mode(sp, PN532_SPI_MODE);
 
+  gpio_irq irq;
+  if (pn532_spi_decode_irq(connstring, &irq) < 0) {
+    free(ndd.port);
+    spi_close(sp);
+    return NULL;
+  }
+
   // We have a connection
   pnd = nfc_device_new(context, connstring);
   if (!pnd) {
     perror("malloc");
     free(ndd.port);
     spi_close(sp);
+    if (irq != INVALID_GPIO_IRQ)
+      gpio_irq_close(irq);
     return NULL;
   }
   snprintf(pnd->name, sizeof(pnd->name), "%s:%s", PN532_SPI_DRIVER_NAME, ndd.port);
@@ -248,15 +293,20 @@ pn532_spi_open(const nfc_context *context, const nfc_connstring connstring)
   if (!pnd->driver_data) {
     perror("malloc");
     spi_close(sp);
+    if (irq != INVALID_GPIO_IRQ)
+      gpio_irq_close(irq);
     nfc_device_free(pnd);
     return NULL;
   }
   DRIVER_DATA(pnd)->port = sp;
+  DRIVER_DATA(pnd)->irq = irq;
 
   // Alloc and init chip's data
   if (pn53x_data_new(pnd, &pn532_spi_io) == NULL) {
     perror("malloc");
     spi_close(DRIVER_DATA(pnd)->port);
+    if (irq != INVALID_GPIO_IRQ)
+      gpio_irq_close(irq);
     nfc_device_free(pnd);
     return NULL;
   }
@@ -339,14 +389,34 @@ pn532_spi_wakeup(nfc_device *pnd)
 #define PN532_BUFFER_LEN (PN53x_EXTENDED_FRAME__DATA_MAX_LEN + PN53x_EXTENDED_FRAME__OVERHEAD)
 
 
+/*
+ * The status byte is read back to back a few times, since many commands are
+ * answered within a few hundred microseconds, then with sleeps growing by half
+ * from PN532_SPI_POLL_MIN_US up to PN532_SPI_POLL_MAX_US, which keeps the
+ * overshoot around a third of the time already waited. With an IRQ line, the
+ * status is only read again when the PN532 asserted it (or the abort flag
+ * has to be checked).
+ */
+#define PN532_SPI_SPIN_READS    4
+#define PN532_SPI_POLL_MIN_US   50
+#define PN532_SPI_POLL_MAX_US   2000
+
+static int64_t
+pn532_spi_now_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
 static int
 pn532_spi_wait_for_data(nfc_device *pnd, int timeout)
 {
   static const uint8_t pn532_spi_ready = 0x01;
-  static const int pn532_spi_poll_interval = 10; //ms
 
-
-  int timer = 0;
+  const int64_t deadline = (timeout > 0) ? pn532_spi_now_us() + (int64_t)timeout * 1000 : 0;
+  int64_t interval = PN532_SPI_POLL_MIN_US;
+  int spins = 0;
 
   int ret;
   while ((ret = pn532_spi_read_spi_status(pnd)) != pn532_spi_ready) {
@@ -359,14 +429,32 @@ pn532_spi_wait_for_data(nfc_device *pnd, int timeout)
       return NFC_EOPABORTED;
     }
 
+    int64_t remaining = PN532_SPI_POLL_MAX_US;
     if (timeout > 0) {
-      timer += pn532_spi_poll_interval;
-      if (timer > timeout) {
+      remaining = deadline - pn532_spi_now_us();
+      if (remaining <= 0) {
         return NFC_ETIMEOUT;
       }
+    }
+
+    if (DRIVER_DATA(pnd)->irq != INVALID_GPIO_IRQ) {
+      // Round up so that a wait never turns into a busy loop
+      int res = gpio_irq_wait(DRIVER_DATA(pnd)->irq, (int)((MIN(remaining, PN532_SPI_POLL_MAX_US) + 999) / 1000));
+      if ((res < 0) && (res != NFC_ETIMEOUT)) {
+        return res;
+      }
+      continue;
+    }
 
-      msleep(pn532_spi_poll_interval);
+    if (spins < PN532_SPI_SPIN_READS) {
+      spins++;
+      continue;
     }
+
+    const int64_t sleep_us = MIN(interval, remaining);
+    struct timespec xsleep = { .tv_sec = sleep_us / 1000000, .tv_nsec = (sleep_us % 1000000) * 1000 };
+    nanosleep(&xsleep, NULL);
+    interval = MIN(interval + interval / 2, PN532_SPI_POLL_MAX_US);
   }
 
   return NFC_SUCCESS;
@@ -416,10 +504,45 @@ pn532_spi_receive_next_chunk(nfc_device *pnd, uint8_t *pbtData, const size_t szD
   return res;
 }
 
+/*
+ * First read of a response frame: enough for the longest header (long
+ * preamble and extended length) and for a whole MIFARE block read reply
+ */
+#define PN532_SPI_FIRST_READ 26
+
+// DATAREAD then dummy bytes, clocked out during full-duplex reads
+static const uint8_t pn532_spi_dataread_frame[PN532_BUFFER_LEN + 1] = { 0x03 };
+
+/*
+ * Reads szRx bytes of the response frame into pbtRx. pbtRx[-1] must be
+ * writable: the first full-duplex read clocks in a status byte along with the
+ * DATAREAD command. Following reads of the same frame get one more data byte
+ * in that slot, so a full-duplex controller reads the whole frame in one or
+ * two SPI messages; a half-duplex one falls back to pn532_spi_receive_next_chunk().
+ */
+static int
+pn532_spi_read_frame(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, const bool first)
+{
+  int res;
+
+  if (first) {
+    res = spi_transfer(DRIVER_DATA(pnd)->port, pn532_spi_dataread_frame, pbtRx - 1, szRx + 1, true);
+    if (res == NFC_EDEVNOTSUPP)
+      res = spi_send_receive(DRIVER_DATA(pnd)->port, &pn532_spi_cmd_dataread, 1, pbtRx, szRx, true);
+  } else {
+    res = spi_transfer(DRIVER_DATA(pnd)->port, pn532_spi_dataread_frame, pbtRx, szRx, true);
+    if (res == NFC_EDEVNOTSUPP)
+      res = pn532_spi_receive_next_chunk(pnd, pbtRx, szRx);
+  }
+  return res;
+}
+
 static int
 pn532_spi_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int timeout)
 {
-  uint8_t  abtRxBuf[5];
+  // One spare byte in front for the status byte of the first read
+  uint8_t  abtRxBuf[1 + 1 + PN532_BUFFER_LEN];
+  uint8_t *pbtFrame = abtRxBuf + 1;
   size_t len;
 
   pnd->last_error = pn532_spi_wait_for_data(pnd, timeout);
@@ -433,70 +556,56 @@ pn532_spi_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int
     goto error;
   }
 
-  pnd->last_error = spi_send_receive(DRIVER_DATA(pnd)->port, &pn532_spi_cmd_dataread, 1, abtRxBuf, 4, true);
+  // Reading past the end of a short frame is harmless: the PN532 clocks out zeroes
+  pnd->last_error = pn532_spi_read_frame(pnd, pbtFrame, PN532_SPI_FIRST_READ, true);
 
   if (pnd->last_error < 0) {
     goto error;
   }
 
   const uint8_t pn53x_long_preamble[3] = { 0x00, 0x00, 0xff };
-  if (0 == (memcmp(abtRxBuf, pn53x_long_preamble, 3))) {
-    // long preamble
-
-    // omit first byte
-    for (size_t i = 0; i < 3; ++i) {
-      abtRxBuf[i] = abtRxBuf[i + 1];
-    }
-
-    // need one more byte
-    pnd->last_error = pn532_spi_receive_next_chunk(pnd, abtRxBuf + 3, 1);
-    if (pnd->last_error != 0) {
-      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive one more byte for long preamble frame. (RX)");
-      goto error;
-    }
+  if (0 == (memcmp(pbtFrame, pn53x_long_preamble, 3))) {
+    // long preamble: omit first byte
+    pbtFrame++;
   }
-
+  // Bytes of the frame already read
+  const size_t szFrameRead = PN532_SPI_FIRST_READ - (pbtFrame - abtRxBuf - 1);
 
   const uint8_t pn53x_preamble[2] = { 0x00, 0xff };
-  if (0 != (memcmp(abtRxBuf, pn53x_preamble, 2))) {
+  if (0 != (memcmp(pbtFrame, pn53x_preamble, 2))) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", " preamble+start code mismatch");
     pnd->last_error = NFC_EIO;
     goto error;
   }
 
-  if ((0x01 == abtRxBuf[2]) && (0xff == abtRxBuf[3])) {
-    // Error frame
-    pn532_spi_receive_next_chunk(pnd, abtRxBuf, 3);
-
+  size_t szHeader;
+  if ((0x01 == pbtFrame[2]) && (0xff == pbtFrame[3])) {
+    // Error frame, entirely read by now
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Application level error detected");
     pnd->last_error = NFC_EIO;
     goto error;
-  } else if ((0xff == abtRxBuf[2]) && (0xff == abtRxBuf[3])) {
+  } else if ((0xff == pbtFrame[2]) && (0xff == pbtFrame[3])) {
     // Extended frame
-    pnd->last_error = pn532_spi_receive_next_chunk(pnd, abtRxBuf, 3);
-
-    if (pnd->last_error != 0) {
-      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
-      goto error;
-    }
-    // (abtRxBuf[0] << 8) + abtRxBuf[1] (LEN) include TFI + (CC+1)
-    len = (abtRxBuf[0] << 8) + abtRxBuf[1] - 2;
-    if (((abtRxBuf[0] + abtRxBuf[1] + abtRxBuf[2]) % 256) != 0) {
+    // (pbtFrame[4] << 8) + pbtFrame[5] (LEN) include TFI + (CC+1)
+    len = (pbtFrame[4] << 8) + pbtFrame[5] - 2;
+    if (((pbtFrame[4] + pbtFrame[5] + pbtFrame[6]) % 256) != 0) {
       log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Length checksum mismatch");
       pnd->last_error = NFC_EIO;
       goto error;
     }
+    szHeader = 7;
   } else {
     // Normal frame
-    if (256 != (abtRxBuf[2] + abtRxBuf[3])) {
+    if (256 != (pbtFrame[2] + pbtFrame[3])) {
       // TODO: Retry
       log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Length checksum mismatch");
       pnd->last_error = NFC_EIO;
       goto error;
     }
 
-    // abtRxBuf[3] (LEN) include TFI + (CC+1)
-    len = abtRxBuf[2] - 2;
+    // pbtFrame[2] (LEN) include TFI + (CC+1)
+    len = pbtFrame[2] - 2;
+    szHeader = 4;
   }
 
   if (len > szDataLen) {
@@ -504,42 +613,38 @@ pn532_spi_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int
     pnd->last_error = NFC_EIO;
     goto error;
   }
+  if (len > PN53x_EXTENDED_FRAME__DATA_MAX_LEN) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to receive data: frame too long. (len: %zu)", len);
+    pnd->last_error = NFC_EIO;
+    goto error;
+  }
 
-  // TFI + PD0 (CC+1)
-
-  pnd->last_error = pn532_spi_receive_next_chunk(pnd, abtRxBuf, 2);
+  // Header, TFI + PD0 (CC+1), data, DCS and postamble
+  const size_t szFrame = szHeader + 2 + len + 2;
+  if (szFrame > szFrameRead) {
+    pnd->last_error = pn532_spi_read_frame(pnd, pbtFrame + szFrameRead, szFrame - szFrameRead, false);
 
-  if (pnd->last_error != 0) {
-    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
-    goto error;
+    if (pnd->last_error != 0) {
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
+      goto error;
+    }
   }
 
-  if (abtRxBuf[0] != 0xD5) {
+  const uint8_t *pbtTfi = pbtFrame + szHeader;
+  if (pbtTfi[0] != 0xD5) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "TFI Mismatch");
     pnd->last_error = NFC_EIO;
     goto error;
   }
 
-  if (abtRxBuf[1] != CHIP_DATA(pnd)->last_command + 1) {
+  if (pbtTfi[1] != CHIP_DATA(pnd)->last_command + 1) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Command Code verification failed");
     pnd->last_error = NFC_EIO;
     goto error;
   }
 
   if (len) {
-    pnd->last_error = pn532_spi_receive_next_chunk(pnd, pbtData, len);
-
-    if (pnd->last_error != 0) {
-      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
-      goto error;
-    }
-  }
-
-  pnd->last_error = pn532_spi_receive_next_chunk(pnd, abtRxBuf, 2);
-
-  if (pnd->last_error != 0) {
-    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
-    goto error;
+    memcpy(pbtData, pbtTfi + 2, len);
   }
 
   uint8_t btDCS = (256 - 0xD5);
@@ -548,13 +653,13 @@ pn532_spi_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int
     btDCS -= pbtData[szPos];
   }
 
-  if (btDCS != abtRxBuf[0]) {
+  if (btDCS != pbtTfi[2 + len]) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Data checksum mismatch");
     pnd->last_error = NFC_EIO;
     goto error;
   }
 
-  if (0x00 != abtRxBuf[1]) {
+  if (0x00 != pbtTfi[2 + len + 1]) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Frame postamble mismatch");
     pnd->last_error = NFC_EIO;
     goto error;
@@ -601,7 +706,8 @@ pn532_spi_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int
     return pnd->last_error;
   }
 
-  res = spi_send(DRIVER_DATA(pnd)->port, abtFrame, szFrame, true);
+  // szFrame does not count the DATAWRITE byte
+  res = spi_send(DRIVER_DATA(pnd)->port, abtFrame, szFrame + 1, true);
   if (res != 0) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to transmit data. (TX)");
     pnd->last_error = res;
@@ -659,6 +765,36 @@ pn532_spi_abort_command(nfc_device *pnd)
   return NFC_SUCCESS;
 }
 
+static int
+pn532_spi_get_pollfd(nfc_device *pnd)
+{
+  // Without an IRQ line the event loop has to poll pn532_spi_async_ready()
+  if (DRIVER_DATA(pnd)->irq == INVALID_GPIO_IRQ)
+    return NFC_EDEVNOTSUPP;
+  return gpio_irq_get_fd(DRIVER_DATA(pnd)->irq);
+}
+
+static int
+pn532_spi_async_ready(nfc_device *pnd)
+{
+  int res;
+
+  if (DRIVER_DATA(pnd)->irq != INVALID_GPIO_IRQ) {
+    // Consume the edge that woke the loop up, the status byte tells the rest
+    if (((res = gpio_irq_wait(DRIVER_DATA(pnd)->irq, 0)) < 0) && (res != NFC_ETIMEOUT))
+      return res;
+  }
+  if ((res = pn532_spi_read_spi_status(pnd)) < 0)
+    return res;
+  return res == 0x01;
+}
+
+static int
+pn532_spi_async_cancel(nfc_device *pnd)
+{
+  return pn532_spi_ack(pnd);
+}
+
 const struct pn53x_io pn532_spi_io = {
   .send       = pn532_spi_send,
   .receive    = pn532_spi_receive,
@@ -675,6 +811,8 @@ const struct nfc_driver pn532_spi_driver = {
   .initiator_init                   = pn53x_initiator_init,
   .initiator_init_secure_element    = pn532_initiator_init_secure_element,
   .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_inventory              = pn53x_initiator_inventory,
   .initiator_poll_target            = pn53x_initiator_poll_target,
   .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
   .initiator_deselect_target        = pn53x_initiator_deselect_target,
@@ -692,6 +830,8 @@ const struct nfc_driver pn532_spi_driver = {
 
   .device_set_property_bool     = pn53x_set_property_bool,
   .device_set_property_int      = pn53x_set_property_int,
+  .device_begin_properties      = pn53x_begin_properties,
+  .device_commit_properties     = pn53x_commit_properties,
   .get_supported_modulation     = pn53x_get_supported_modulation,
   .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
   .device_get_information_about = pn53x_get_information_about,
@@ -699,5 +839,11 @@ const struct nfc_driver pn532_spi_driver = {
   .abort_command  = pn532_spi_abort_command,
   .idle           = pn53x_idle,
   .powerdown      = pn53x_PowerDown,
+
+  .get_pollfd     = pn532_spi_get_pollfd,
+  .async_submit   = pn53x_async_submit,
+  .async_ready    = pn532_spi_async_ready,
+  .async_complete = pn53x_async_complete,
+  .async_cancel   = pn532_spi_async_cancel,
 };
 
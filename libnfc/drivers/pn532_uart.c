@@ -58,6 +58,7 @@
 const struct pn53x_io pn532_uart_io;
 struct pn532_uart_data {
   serial_port port;
+  bool    rx_dirty;  // An exchange was left unfinished, stale bytes may be pending
 #ifndef WIN32
   int     iAbortFds[2];
 #else
@@ -117,6 +118,7 @@ pn532_uart_scan(const nfc_context *context, nfc_connstring connstrings[], const
         return 0;
       }
       DRIVER_DATA(pnd)->port = sp;
+      DRIVER_DATA(pnd)->rx_dirty = false;
 
       // Alloc and init chip's data
       if (pn53x_data_new(pnd, &pn532_uart_io) == NULL) {
@@ -259,6 +261,7 @@ pn532_uart_open(const nfc_context *context, const nfc_connstring connstring)
     return NULL;
   }
   DRIVER_DATA(pnd)->port = sp;
+  DRIVER_DATA(pnd)->rx_dirty = false;
 
   // Alloc and init chip's data
   if (pn53x_data_new(pnd, &pn532_uart_io) == NULL) {
@@ -314,8 +317,13 @@ static int
 pn532_uart_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int timeout)
 {
   int res = 0;
-  // Before sending anything, we need to discard from any junk bytes
-  uart_flush_input(DRIVER_DATA(pnd)->port, false);
+  // Before sending anything, we need to discard from any junk bytes, which
+  // can only be there if a previous exchange did not complete: a reply that
+  // was parsed to its postamble leaves nothing behind
+  if (DRIVER_DATA(pnd)->rx_dirty) {
+    uart_flush_input(DRIVER_DATA(pnd)->port, false);
+    DRIVER_DATA(pnd)->rx_dirty = false;
+  }
 
   switch (CHIP_DATA(pnd)->power_mode) {
     case LOWVBAT: {
@@ -351,30 +359,44 @@ pn532_uart_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, in
   res = uart_send(DRIVER_DATA(pnd)->port, abtFrame, szFrame, timeout);
   if (res != 0) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to transmit data. (TX)");
+    DRIVER_DATA(pnd)->rx_dirty = true;
     pnd->last_error = res;
     return pnd->last_error;
   }
 
-  uint8_t abtRxBuf[PN53x_ACK_FRAME__LEN];
-  res = uart_receive(DRIVER_DATA(pnd)->port, abtRxBuf, sizeof(abtRxBuf), 0, timeout);
-  if (res != 0) {
+  // The ACK is consumed from the port's receive buffer, where the response
+  // frame that often comes in the same read(2) stays for pn532_uart_receive()
+  const uint8_t *pbtAck;
+  res = uart_peek(DRIVER_DATA(pnd)->port, &pbtAck, PN53x_ACK_FRAME__LEN, 0, timeout);
+  if (res < 0) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s", "Unable to read ACK");
+    DRIVER_DATA(pnd)->rx_dirty = true;
     pnd->last_error = res;
     return pnd->last_error;
   }
 
-  if (pn53x_check_ack_frame(pnd, abtRxBuf, sizeof(abtRxBuf)) == 0) {
+  if (pn53x_check_ack_frame(pnd, pbtAck, PN53x_ACK_FRAME__LEN) == 0) {
     // The PN53x is running the sent command
+    uart_skip(DRIVER_DATA(pnd)->port, PN53x_ACK_FRAME__LEN);
   } else {
+    DRIVER_DATA(pnd)->rx_dirty = true;
     return pnd->last_error;
   }
   return NFC_SUCCESS;
 }
 
+/*
+ * The reply is parsed in place from the port's receive buffer: uart_peek()
+ * only reads from the port when the bytes the parser needs next are not
+ * buffered yet, so a frame delivered in one burst costs one read(2) instead
+ * of one per frame field.
+ */
 static int
 pn532_uart_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int timeout)
 {
-  uint8_t  abtRxBuf[5];
+  serial_port sp = DRIVER_DATA(pnd)->port;
+  const uint8_t *pbtFrame;
+  size_t szHeader;
   size_t len;
   void *abort_p = NULL;
 
@@ -384,9 +406,11 @@ pn532_uart_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, in
   abort_p = (void *) & (DRIVER_DATA(pnd)->abort_flag);
 #endif
 
-  pnd->last_error = uart_receive(DRIVER_DATA(pnd)->port, abtRxBuf, 5, abort_p, timeout);
+  // Preamble + start code + LEN + LCS
+  pnd->last_error = uart_peek(sp, &pbtFrame, 5, abort_p, timeout);
 
   if (abort_p && (NFC_EOPABORTED == pnd->last_error)) {
+    DRIVER_DATA(pnd)->rx_dirty = true;
     pn532_uart_ack(pnd);
     return NFC_EOPABORTED;
   }
@@ -396,43 +420,44 @@ pn532_uart_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, in
   }
 
   const uint8_t pn53x_preamble[3] = { 0x00, 0x00, 0xff };
-  if (0 != (memcmp(abtRxBuf, pn53x_preamble, 3))) {
+  if (0 != (memcmp(pbtFrame, pn53x_preamble, 3))) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Frame preamble+start code mismatch");
     pnd->last_error = NFC_EIO;
     goto error;
   }
 
-  if ((0x01 == abtRxBuf[3]) && (0xff == abtRxBuf[4])) {
+  if ((0x01 == pbtFrame[3]) && (0xff == pbtFrame[4])) {
     // Error frame
-    uart_receive(DRIVER_DATA(pnd)->port, abtRxBuf, 3, 0, timeout);
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Application level error detected");
     pnd->last_error = NFC_EIO;
     goto error;
-  } else if ((0xff == abtRxBuf[3]) && (0xff == abtRxBuf[4])) {
+  } else if ((0xff == pbtFrame[3]) && (0xff == pbtFrame[4])) {
     // Extended frame
-    pnd->last_error = uart_receive(DRIVER_DATA(pnd)->port, abtRxBuf, 3, 0, timeout);
-    if (pnd->last_error != 0) {
+    pnd->last_error = uart_peek(sp, &pbtFrame, 8, 0, timeout);
+    if (pnd->last_error < 0) {
       log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
       goto error;
     }
-    // (abtRxBuf[0] << 8) + abtRxBuf[1] (LEN) include TFI + (CC+1)
-    len = (abtRxBuf[0] << 8) + abtRxBuf[1] - 2;
-    if (((abtRxBuf[0] + abtRxBuf[1] + abtRxBuf[2]) % 256) != 0) {
+    // (pbtFrame[5] << 8) + pbtFrame[6] (LEN) include TFI + (CC+1)
+    len = (pbtFrame[5] << 8) + pbtFrame[6] - 2;
+    if (((pbtFrame[5] + pbtFrame[6] + pbtFrame[7]) % 256) != 0) {
       log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Length checksum mismatch");
       pnd->last_error = NFC_EIO;
       goto error;
     }
+    szHeader = 8;
   } else {
     // Normal frame
-    if (256 != (abtRxBuf[3] + abtRxBuf[4])) {
+    if (256 != (pbtFrame[3] + pbtFrame[4])) {
       // TODO: Retry
       log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Length checksum mismatch");
       pnd->last_error = NFC_EIO;
       goto error;
     }
 
-    // abtRxBuf[3] (LEN) include TFI + (CC+1)
-    len = abtRxBuf[3] - 2;
+    // pbtFrame[3] (LEN) include TFI + (CC+1)
+    len = pbtFrame[3] - 2;
+    szHeader = 5;
   }
 
   if (len > szDataLen) {
@@ -441,60 +466,53 @@ pn532_uart_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, in
     goto error;
   }
 
-  // TFI + PD0 (CC+1)
-  pnd->last_error = uart_receive(DRIVER_DATA(pnd)->port, abtRxBuf, 2, 0, timeout);
-  if (pnd->last_error != 0) {
+  // Header + TFI + PD0 (CC+1) + data + DCS + postamble
+  const size_t szFrame = szHeader + 2 + len + 2;
+  pnd->last_error = uart_peek(sp, &pbtFrame, szFrame, 0, timeout);
+  if (pnd->last_error < 0) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
     goto error;
   }
+  const uint8_t *pbtBody = pbtFrame + szHeader;
 
-  if (abtRxBuf[0] != 0xD5) {
+  if (pbtBody[0] != 0xD5) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "TFI Mismatch");
     pnd->last_error = NFC_EIO;
     goto error;
   }
 
-  if (abtRxBuf[1] != CHIP_DATA(pnd)->last_command + 1) {
+  if (pbtBody[1] != CHIP_DATA(pnd)->last_command + 1) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Command Code verification failed");
     pnd->last_error = NFC_EIO;
     goto error;
   }
 
-  if (len) {
-    pnd->last_error = uart_receive(DRIVER_DATA(pnd)->port, pbtData, len, 0, timeout);
-    if (pnd->last_error != 0) {
-      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
-      goto error;
-    }
-  }
-
-  pnd->last_error = uart_receive(DRIVER_DATA(pnd)->port, abtRxBuf, 2, 0, timeout);
-  if (pnd->last_error != 0) {
-    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to receive data. (RX)");
-    goto error;
-  }
-
   uint8_t btDCS = (256 - 0xD5);
   btDCS -= CHIP_DATA(pnd)->last_command + 1;
   for (size_t szPos = 0; szPos < len; szPos++) {
-    btDCS -= pbtData[szPos];
+    btDCS -= pbtBody[2 + szPos];
   }
 
-  if (btDCS != abtRxBuf[0]) {
+  if (btDCS != pbtBody[2 + len]) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Data checksum mismatch");
     pnd->last_error = NFC_EIO;
     goto error;
   }
 
-  if (0x00 != abtRxBuf[1]) {
+  if (0x00 != pbtBody[2 + len + 1]) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Frame postamble mismatch");
     pnd->last_error = NFC_EIO;
     goto error;
   }
+
+  memcpy(pbtData, pbtBody + 2, len);
+  uart_skip(sp, szFrame);
   // The PN53x command is done and we successfully received the reply
+  pnd->last_error = 0;
   return len;
 error:
-  uart_flush_input(DRIVER_DATA(pnd)->port, true);
+  uart_flush_input(sp, true);
+  DRIVER_DATA(pnd)->rx_dirty = true;
   return pnd->last_error;
 }
 
@@ -526,6 +544,54 @@ pn532_uart_abort_command(nfc_device *pnd)
   return NFC_SUCCESS;
 }
 
+static int
+pn532_uart_get_pollfd(nfc_device *pnd)
+{
+  return uart_get_fd(DRIVER_DATA(pnd)->port);
+}
+
+/*
+ * The response is ready once the whole frame is buffered, so that
+ * pn532_uart_receive() does not wait for the tail of a long frame at low baud
+ * rates. Anything that is not the start of a frame is reported ready too, for
+ * pn532_uart_receive() to report the error.
+ */
+static int
+pn532_uart_async_ready(nfc_device *pnd)
+{
+  const uint8_t *pbtFrame;
+  size_t szFrame;
+  int res;
+
+  if ((res = uart_poll(DRIVER_DATA(pnd)->port, &pbtFrame)) < 5)
+    return (res < 0) ? res : 0;
+
+  const uint8_t pn53x_preamble[3] = { 0x00, 0x00, 0xff };
+  if (0 != (memcmp(pbtFrame, pn53x_preamble, 3)))
+    return 1;
+  if ((0x01 == pbtFrame[3]) && (0xff == pbtFrame[4])) {
+    // Error frame
+    szFrame = 8;
+  } else if ((0xff == pbtFrame[3]) && (0xff == pbtFrame[4])) {
+    // Extended frame
+    if (res < 8)
+      return 0;
+    szFrame = 8 + ((pbtFrame[5] << 8) + pbtFrame[6]) + 2;
+  } else {
+    // Normal frame
+    szFrame = 5 + pbtFrame[3] + 2;
+  }
+  return (size_t)res >= MIN(szFrame, UART_RX_BUFFER_LEN);
+}
+
+static int
+pn532_uart_async_cancel(nfc_device *pnd)
+{
+  // An ACK frame aborts the running command, whatever it already sent is flushed before the next one
+  DRIVER_DATA(pnd)->rx_dirty = true;
+  return pn532_uart_ack(pnd);
+}
+
 const struct pn53x_io pn532_uart_io = {
   .send       = pn532_uart_send,
   .receive    = pn532_uart_receive,
@@ -542,6 +608,8 @@ const struct nfc_driver pn532_uart_driver = {
   .initiator_init                   = pn53x_initiator_init,
   .initiator_init_secure_element    = pn532_initiator_init_secure_element,
   .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_inventory              = pn53x_initiator_inventory,
   .initiator_poll_target            = pn53x_initiator_poll_target,
   .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
   .initiator_deselect_target        = pn53x_initiator_deselect_target,
@@ -559,6 +627,8 @@ const struct nfc_driver pn532_uart_driver = {
 
   .device_set_property_bool     = pn53x_set_property_bool,
   .device_set_property_int      = pn53x_set_property_int,
+  .device_begin_properties      = pn53x_begin_properties,
+  .device_commit_properties     = pn53x_commit_properties,
   .get_supported_modulation     = pn53x_get_supported_modulation,
   .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
   .device_get_information_about = pn53x_get_information_about,
@@ -566,5 +636,11 @@ const struct nfc_driver pn532_uart_driver = {
   .abort_command  = pn532_uart_abort_command,
   .idle           = pn53x_idle,
   .powerdown      = pn53x_PowerDown,
+
+  .get_pollfd     = pn532_uart_get_pollfd,
+  .async_submit   = pn53x_async_submit,
+  .async_ready    = pn532_uart_async_ready,
+  .async_complete = pn53x_async_complete,
+  .async_cancel   = pn532_uart_async_cancel,
 };
 
@@ -0,0 +1,267 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn53x_sim.c
+ * @brief Driver for a simulated PN53x and its virtual tags
+ *
+ * The device is opened with "pn53x_sim[:<chip>[:<tags>]]" where chip is
+ * pn532 (default) or pn533 and tags is a comma separated list of virtual tags
+ * placed in the field: mfc1k (default), mful, iso14443-4, felica, jewel,
+ * st25tb or none. Eg. "pn53x_sim:pn533:mfc1k,mful,felica".
+ *
+ * Commands are answered synchronously by the software model of the chip,
+ * which makes the driver suitable for tests and benchmarks without hardware.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "pn53x_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "drivers.h"
+#include "nfc-internal.h"
+#include "chips/pn53x.h"
+#include "chips/pn53x-internal.h"
+
+#define PN53X_SIM_DRIVER_NAME "pn53x_sim"
+#define PN53X_SIM_DEFAULT_TAGS "mfc1k"
+
+#define LOG_CATEGORY "libnfc.driver.pn53x_sim"
+#define LOG_GROUP    NFC_LOG_GROUP_DRIVER
+
+// Internal data structs
+const struct pn53x_io pn53x_sim_io;
+struct pn53x_sim_data {
+  struct pn53x_sim *sim;
+  // Response to the last command, or error
+  uint8_t abtRx[PN53x_EXTENDED_FRAME__DATA_MAX_LEN];
+  int res;
+};
+
+#define DRIVER_DATA(pnd) ((struct pn53x_sim_data*)(pnd->driver_data))
+
+struct pn53x_sim *
+pn53x_sim_device_get(nfc_device *pnd)
+{
+  if (pnd->driver != &pn53x_sim_driver)
+    return NULL;
+  return DRIVER_DATA(pnd)->sim;
+}
+
+static void
+pn53x_sim_close(nfc_device *pnd)
+{
+  pn53x_idle(pnd);
+
+  pn53x_sim_free(DRIVER_DATA(pnd)->sim);
+  pn53x_data_free(pnd);
+  nfc_device_free(pnd);
+}
+
+static nfc_device *
+pn53x_sim_open(const nfc_context *context, const nfc_connstring connstring)
+{
+  char *chip_s;
+  char *tags_s;
+  int connstring_decode_level = connstring_decode(connstring, PN53X_SIM_DRIVER_NAME, NULL, &chip_s, &tags_s);
+  if (connstring_decode_level < 1) {
+    return NULL;
+  }
+
+  pn53x_type type = PN532;
+  if ((connstring_decode_level >= 2) && (strcmp(chip_s, "pn533") == 0)) {
+    type = PN533;
+  } else if ((connstring_decode_level >= 2) && (strcmp(chip_s, "pn532") != 0)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unknown simulated chip: %s", chip_s);
+    free(chip_s);
+    free(tags_s);
+    return NULL;
+  }
+  free(chip_s);
+
+  struct pn53x_sim *sim = pn53x_sim_new(type);
+  if (!sim) {
+    perror("malloc");
+    free(tags_s);
+    return NULL;
+  }
+  const char *tags = (connstring_decode_level >= 3) ? tags_s : PN53X_SIM_DEFAULT_TAGS;
+  int res = (strcmp(tags, "none") == 0) ? NFC_SUCCESS : pn53x_sim_add_tags(sim, tags);
+  free(tags_s);
+  if (res < 0) {
+    pn53x_sim_free(sim);
+    return NULL;
+  }
+
+  nfc_device *pnd = nfc_device_new(context, connstring);
+  if (!pnd) {
+    perror("malloc");
+    pn53x_sim_free(sim);
+    return NULL;
+  }
+  snprintf(pnd->name, sizeof(pnd->name), "%s simulator", (type == PN533) ? "PN533" : "PN532");
+
+  pnd->driver_data = malloc(sizeof(struct pn53x_sim_data));
+  if (!pnd->driver_data) {
+    perror("malloc");
+    pn53x_sim_free(sim);
+    nfc_device_free(pnd);
+    return NULL;
+  }
+  DRIVER_DATA(pnd)->sim = sim;
+  DRIVER_DATA(pnd)->res = NFC_EIO;
+
+  // Alloc and init chip's data
+  if (pn53x_data_new(pnd, &pn53x_sim_io) == NULL) {
+    perror("malloc");
+    pn53x_sim_free(sim);
+    nfc_device_free(pnd);
+    return NULL;
+  }
+  pnd->driver = &pn53x_sim_driver;
+
+  if (pn53x_init(pnd) < 0) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to initialize simulated device");
+    pn53x_sim_close(pnd);
+    return NULL;
+  }
+  return pnd;
+}
+
+static int
+pn53x_sim_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int timeout)
+{
+  (void) timeout;
+  struct pn53x_sim_data *data = DRIVER_DATA(pnd);
+
+  LOG_HEX(NFC_LOG_GROUP_COM, "TX", pbtData, szData);
+  data->res = pn53x_sim_command(data->sim, pbtData, szData, data->abtRx, sizeof(data->abtRx));
+  return NFC_SUCCESS;
+}
+
+static int
+pn53x_sim_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int timeout)
+{
+  (void) timeout;
+  struct pn53x_sim_data *data = DRIVER_DATA(pnd);
+  const int res = data->res;
+
+  data->res = NFC_EIO;
+  if (res < 0) {
+    return pnd->last_error = res;
+  }
+  if ((size_t)res > szDataLen) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to receive data: buffer too small. (szDataLen: %" PRIuPTR ", len: %d)", szDataLen, res);
+    return pnd->last_error = NFC_EOVFLOW;
+  }
+  memcpy(pbtData, data->abtRx, res);
+  LOG_HEX(NFC_LOG_GROUP_COM, "RX", pbtData, res);
+  return res;
+}
+
+static int
+pn53x_sim_abort_command(nfc_device *pnd)
+{
+  // Commands are answered as soon as they are sent, there is nothing to abort
+  (void) pnd;
+  return NFC_SUCCESS;
+}
+
+static int
+pn53x_sim_async_ready(nfc_device *pnd)
+{
+  // The response is computed by pn53x_sim_send()
+  (void) pnd;
+  return 1;
+}
+
+static int
+pn53x_sim_async_cancel(nfc_device *pnd)
+{
+  DRIVER_DATA(pnd)->res = NFC_EIO;
+  return NFC_SUCCESS;
+}
+
+const struct pn53x_io pn53x_sim_io = {
+  .send       = pn53x_sim_send,
+  .receive    = pn53x_sim_receive,
+};
+
+const struct nfc_driver pn53x_sim_driver = {
+  .name                             = PN53X_SIM_DRIVER_NAME,
+  .scan_type                        = NOT_AVAILABLE,
+  .scan                             = NULL,
+  .open                             = pn53x_sim_open,
+  .close                            = pn53x_sim_close,
+  .strerror                         = pn53x_strerror,
+
+  .initiator_init                   = pn53x_initiator_init,
+  .initiator_init_secure_element    = NULL,
+  .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_inventory              = pn53x_initiator_inventory,
+  .initiator_poll_target            = pn53x_initiator_poll_target,
+  .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
+  .initiator_deselect_target        = pn53x_initiator_deselect_target,
+  .initiator_transceive_bytes       = pn53x_initiator_transceive_bytes,
+  .initiator_transceive_bits        = pn53x_initiator_transceive_bits,
+  .initiator_transceive_bytes_timed = pn53x_initiator_transceive_bytes_timed,
+  .initiator_transceive_bits_timed  = pn53x_initiator_transceive_bits_timed,
+  .initiator_target_is_present      = pn53x_initiator_target_is_present,
+
+  .target_init           = pn53x_target_init,
+  .target_send_bytes     = pn53x_target_send_bytes,
+  .target_receive_bytes  = pn53x_target_receive_bytes,
+  .target_send_bits      = pn53x_target_send_bits,
+  .target_receive_bits   = pn53x_target_receive_bits,
+
+  .device_set_property_bool     = pn53x_set_property_bool,
+  .device_set_property_int      = pn53x_set_property_int,
+  .device_begin_properties      = pn53x_begin_properties,
+  .device_commit_properties     = pn53x_commit_properties,
+  .get_supported_modulation     = pn53x_get_supported_modulation,
+  .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
+  .device_get_information_about = pn53x_get_information_about,
+
+  .abort_command  = pn53x_sim_abort_command,
+  .idle           = pn53x_idle,
+  .powerdown      = pn53x_PowerDown,
+
+  .async_submit   = pn53x_async_submit,
+  .async_ready    = pn53x_sim_async_ready,
+  .async_complete = pn53x_async_complete,
+  .async_cancel   = pn53x_sim_async_cancel,
+};
@@ -0,0 +1,44 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file pn53x_sim.h
+ * @brief Driver for a simulated PN53x and its virtual tags
+ */
+
+#ifndef __NFC_DRIVER_PN53X_SIM_H__
+#define __NFC_DRIVER_PN53X_SIM_H__
+
+#include <nfc/nfc-types.h>
+
+#include "chips/pn53x-sim.h"
+
+extern const struct nfc_driver pn53x_sim_driver;
+
+struct pn53x_sim *pn53x_sim_device_get(nfc_device *pnd);
+
+#endif // ! __NFC_DRIVER_PN53X_SIM_H__
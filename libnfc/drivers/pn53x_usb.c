@@ -294,7 +294,8 @@ pn53x_usb_scan(const nfc_context *context, nfc_connstring connstrings[], const s
 {
   (void)context;
 
-  usb_prepare();
+  // Keep the bus list from being refreshed by another thread while we walk it
+  usb_busses_lock();
 
   size_t device_found = 0;
   uint32_t uiBusIndex = 0;
@@ -323,22 +324,25 @@ pn53x_usb_scan(const nfc_context *context, nfc_connstring connstrings[], const s
             }
           }
 
-          usb_dev_handle *udev = usb_open(dev);
-          if (udev == NULL)
-            continue;
+          // A device we hold is in use, but by us: no need to open it
+          if (!usb_probe_claimed(dev)) {
+            usb_dev_handle *udev = usb_open(dev);
+            if (udev == NULL)
+              continue;
 
-          // Set configuration
-          int res = usb_set_configuration(udev, 1);
-          if (res < 0) {
-            log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to set USB configuration (%s)", _usb_strerror(res));
+            // Set configuration
+            int res = usb_set_configuration(udev, 1);
+            if (res < 0) {
+              log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to set USB configuration (%s)", _usb_strerror(res));
+              usb_close(udev);
+              // we failed to use the device
+              continue;
+            }
             usb_close(udev);
-            // we failed to use the device
-            continue;
           }
 
           // pn53x_usb_get_usb_device_name (dev, udev, pnddDevices[device_found].acDevice, sizeof (pnddDevices[device_found].acDevice));
           log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "device found: Bus %s Device %s", bus->dirname, dev->filename);
-          usb_close(udev);
           if (snprintf(connstrings[device_found], sizeof(nfc_connstring), "%s:%s:%s", PN53X_USB_DRIVER_NAME, bus->dirname, dev->filename) >= (int)sizeof(nfc_connstring)) {
             // truncation occurred, skipping that one
             continue;
@@ -346,6 +350,7 @@ pn53x_usb_scan(const nfc_context *context, nfc_connstring connstrings[], const s
           device_found++;
           // Test if we reach the maximum "wanted" devices
           if (device_found == connstrings_len) {
+            usb_busses_unlock();
             return device_found;
           }
         }
@@ -353,6 +358,7 @@ pn53x_usb_scan(const nfc_context *context, nfc_connstring connstrings[], const s
     }
   }
 
+  usb_busses_unlock();
   return device_found;
 }
 
@@ -409,7 +415,7 @@ pn53x_usb_open(const nfc_context *context, const nfc_connstring connstring)
   struct usb_bus *bus;
   struct usb_device *dev;
 
-  usb_prepare();
+  usb_busses_lock();
 
   for (bus = usb_get_busses(); bus; bus = bus->next) {
     if (connstring_decode_level > 1)  {
@@ -445,7 +451,7 @@ pn53x_usb_open(const nfc_context *context, const nfc_connstring connstring)
         }
         usb_close(data.pudh);
         // we failed to use the specified device
-        goto free_mem;
+        goto unlock;
       }
 
       res = usb_claim_interface(data.pudh, 0);
@@ -453,7 +459,7 @@ pn53x_usb_open(const nfc_context *context, const nfc_connstring connstring)
         log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to claim USB interface (%s)", _usb_strerror(res));
         usb_close(data.pudh);
         // we failed to use the specified device
-        goto free_mem;
+        goto unlock;
       }
       data.model = pn53x_usb_get_device_model(dev->descriptor.idVendor, dev->descriptor.idProduct);
       // Allocate memory for the device info and specification, fill it and return the info
@@ -511,16 +517,19 @@ pn53x_usb_open(const nfc_context *context, const nfc_connstring connstring)
         goto error;
       }
       DRIVER_DATA(pnd)->abort_flag = false;
-      goto free_mem;
+      usb_probe_claim(dev);
+      goto unlock;
     }
   }
   // We ran out of devices before the index required
-  goto free_mem;
+  goto unlock;
 
 error:
   // Free allocated structure on error.
   nfc_device_free(pnd);
   pnd = NULL;
+unlock:
+  usb_busses_unlock();
 free_mem:
   free(desc.dirname);
   free(desc.filename);
@@ -543,6 +552,9 @@ pn53x_usb_close(nfc_device *pnd)
 
   pn53x_idle(pnd);
 
+  // Scans have to open the device again to tell if another process took it
+  usb_probe_release(usb_device(DRIVER_DATA(pnd)->pudh));
+
   int res;
   if ((res = usb_release_interface(DRIVER_DATA(pnd)->pudh, 0)) < 0) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to release USB interface (%s)", _usb_strerror(res));
@@ -881,6 +893,8 @@ const struct nfc_driver pn53x_usb_driver = {
   .initiator_init                   = pn53x_initiator_init,
   .initiator_init_secure_element    = NULL, // No secure-element support
   .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_inventory              = pn53x_initiator_inventory,
   .initiator_poll_target            = pn53x_initiator_poll_target,
   .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
   .initiator_deselect_target        = pn53x_initiator_deselect_target,
@@ -898,6 +912,8 @@ const struct nfc_driver pn53x_usb_driver = {
 
   .device_set_property_bool     = pn53x_usb_set_property_bool,
   .device_set_property_int      = pn53x_set_property_int,
+  .device_begin_properties      = pn53x_begin_properties,
+  .device_commit_properties     = pn53x_commit_properties,
   .get_supported_modulation     = pn53x_usb_get_supported_modulation,
   .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
   .device_get_information_about = pn53x_get_information_about,
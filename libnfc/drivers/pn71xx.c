@@ -38,12 +38,41 @@ const nfc_baud_rate pn71xx_dep_supported_baud_rates[] = { NBR_424, NBR_212, NBR_
 const nfc_baud_rate pn71xx_jewel_supported_baud_rates[] = { NBR_847, NBR_424, NBR_212, NBR_106, 0 };
 const nfc_baud_rate pn71xx_iso14443b_supported_baud_rates[] = { NBR_847, NBR_424, NBR_212, NBR_106, 0 };
 
-static nfcTagCallback_t TagCB;
-static nfc_tag_info_t *TagInfo = NULL;
+struct pn71xx_data {
+  bool bTagPresent;
+  nfc_tag_info_t tagInfo;
+};
+
+#define DRIVER_DATA(pnd) ((struct pn71xx_data*)(pnd->driver_data))
 
 static void onTagArrival(nfc_tag_info_t *pTagInfo);
 static void onTagDeparture(void);
 
+static nfcTagCallback_t TagCB = {
+  .onTagArrival = onTagArrival,
+  .onTagDeparture = onTagDeparture,
+};
+
+// libnfc-nci drives a single controller per process and its tag callbacks
+// carry no user pointer: events are routed to the one opened device, and the
+// tag snapshot is only touched with pn71xx_lock held.
+static nfc_mutex pn71xx_lock = NFC_MUTEX_INITIALIZER;
+static nfc_device *pn71xx_device = NULL;
+
+static bool
+pn71xx_get_tag(nfc_device *pnd, nfc_tag_info_t *pTagInfo)
+{
+  bool bPresent;
+
+  nfc_mutex_lock(&pn71xx_lock);
+  bPresent = DRIVER_DATA(pnd)->bTagPresent;
+  if (bPresent && pTagInfo)
+    memcpy(pTagInfo, &DRIVER_DATA(pnd)->tagInfo, sizeof(nfc_tag_info_t));
+  nfc_mutex_unlock(&pn71xx_lock);
+
+  return bPresent;
+}
+
 /** ------------------------------------------------------------------------ */
 /** ------------------------------------------------------------------------ */
 /**
@@ -81,6 +110,11 @@ pn71xx_close(nfc_device *pnd)
   nfcManager_disableDiscovery();
   nfcManager_deregisterTagCallback();
   nfcManager_doDeinitialize();
+
+  nfc_mutex_lock(&pn71xx_lock);
+  pn71xx_device = NULL;
+  nfc_mutex_unlock(&pn71xx_lock);
+
   nfc_device_free(pnd);
   pnd = NULL;
 }
@@ -105,12 +139,28 @@ pn71xx_open(const nfc_context *context, const nfc_connstring connstring)
     return NULL;
   }
 
+  pnd->driver_data = malloc(sizeof(struct pn71xx_data));
+  if (!pnd->driver_data) {
+    perror("malloc");
+    nfc_device_free(pnd);
+    return NULL;
+  }
+  DRIVER_DATA(pnd)->bTagPresent = false;
+
   pnd->driver = &pn71xx_driver;
   strcpy(pnd->name, "pn71xx-device");
   strcpy(pnd->connstring, connstring);
 
-  TagCB.onTagArrival = onTagArrival;
-  TagCB.onTagDeparture = onTagDeparture;
+  nfc_mutex_lock(&pn71xx_lock);
+  if (pn71xx_device) {
+    nfc_mutex_unlock(&pn71xx_lock);
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "pn71xx device is already opened");
+    nfc_device_free(pnd);
+    return NULL;
+  }
+  pn71xx_device = pnd;
+  nfc_mutex_unlock(&pn71xx_lock);
+
   nfcManager_registerTagCallback(&TagCB);
 
   nfcManager_enableDiscovery(DEFAULT_NFA_TECH_MASK, 1, 0, 0);
@@ -248,18 +298,24 @@ static void onTagArrival(nfc_tag_info_t *pTagInfo)
 {
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "tag found");
 
-  TagInfo = malloc(sizeof(nfc_tag_info_t));
-  memcpy(TagInfo, pTagInfo, sizeof(nfc_tag_info_t));
+  nfc_mutex_lock(&pn71xx_lock);
+  if (pn71xx_device) {
+    memcpy(&DRIVER_DATA(pn71xx_device)->tagInfo, pTagInfo, sizeof(nfc_tag_info_t));
+    DRIVER_DATA(pn71xx_device)->bTagPresent = true;
+  }
+  nfc_mutex_unlock(&pn71xx_lock);
 
-  PrintTagInfo(TagInfo);
+  PrintTagInfo(pTagInfo);
 }
 
 static void onTagDeparture(void)
 {
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "tag lost");
 
-  free(TagInfo);
-  TagInfo = NULL;
+  nfc_mutex_lock(&pn71xx_lock);
+  if (pn71xx_device)
+    DRIVER_DATA(pn71xx_device)->bTagPresent = false;
+  nfc_mutex_unlock(&pn71xx_lock);
 }
 
 static int
@@ -279,7 +335,8 @@ pn71xx_initiator_select_passive_target(struct nfc_device *pnd,
 
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "select_passive_target");
 
-  if (TagInfo) {
+  nfc_tag_info_t tagInfo;
+  if (pn71xx_get_tag(pnd, &tagInfo)) {
 
     nfc_target nttmp;
     memset(&nttmp, 0x00, sizeof(nfc_target));
@@ -290,11 +347,11 @@ pn71xx_initiator_select_passive_target(struct nfc_device *pnd,
 
     switch (nm.nmt) {
       case NMT_ISO14443A:
-        if (IsTechnology(TagInfo, nm.nmt)) {
+        if (IsTechnology(&tagInfo, nm.nmt)) {
           maxLen = 10;
           uidPtr = nttmp.nti.nai.abtUid;
 
-          if (TagInfo->technology == TARGET_TYPE_MIFARE_CLASSIC) {
+          if (tagInfo.technology == TARGET_TYPE_MIFARE_CLASSIC) {
             nttmp.nti.nai.btSak = 0x08;
           } else {
             // make hardcoded desfire for freefare lib check
@@ -306,42 +363,42 @@ pn71xx_initiator_select_passive_target(struct nfc_device *pnd,
         break;
 
       case NMT_ISO14443B:
-        if (IsTechnology(TagInfo, nm.nmt)) {
+        if (IsTechnology(&tagInfo, nm.nmt)) {
           maxLen = 4;
           uidPtr = nttmp.nti.nbi.abtPupi;
         }
         break;
 
       case NMT_ISO14443BI:
-        if (IsTechnology(TagInfo, nm.nmt)) {
+        if (IsTechnology(&tagInfo, nm.nmt)) {
           maxLen = 4;
           uidPtr = nttmp.nti.nii.abtDIV;
         }
         break;
 
       case NMT_ISO14443B2SR:
-        if (IsTechnology(TagInfo, nm.nmt)) {
+        if (IsTechnology(&tagInfo, nm.nmt)) {
           maxLen = 8;
           uidPtr = nttmp.nti.nsi.abtUID;
         }
         break;
 
       case NMT_ISO14443B2CT:
-        if (IsTechnology(TagInfo, nm.nmt)) {
+        if (IsTechnology(&tagInfo, nm.nmt)) {
           maxLen = 4;
           uidPtr = nttmp.nti.nci.abtUID;
         }
         break;
 
       case NMT_FELICA:
-        if (IsTechnology(TagInfo, nm.nmt)) {
+        if (IsTechnology(&tagInfo, nm.nmt)) {
           maxLen = 8;
           uidPtr = nttmp.nti.nfi.abtId;
         }
         break;
 
       case NMT_JEWEL:
-        if (IsTechnology(TagInfo, nm.nmt)) {
+        if (IsTechnology(&tagInfo, nm.nmt)) {
           maxLen = 4;
           uidPtr = nttmp.nti.nji.btId;
         }
@@ -351,10 +408,10 @@ pn71xx_initiator_select_passive_target(struct nfc_device *pnd,
         return 0;
     }
 
-    if (uidPtr && TagInfo->uid_length) {
+    if (uidPtr && tagInfo.uid_length) {
       log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "target found");
-      int len = TagInfo->uid_length > maxLen ? maxLen : TagInfo->uid_length;
-      memcpy(uidPtr, TagInfo->uid, len);
+      int len = tagInfo.uid_length > maxLen ? maxLen : tagInfo.uid_length;
+      memcpy(uidPtr, tagInfo.uid, len);
       if (nm.nmt == NMT_ISO14443A)
         nttmp.nti.nai.szUidLen = len;
 
@@ -385,13 +442,14 @@ pn71xx_initiator_transceive_bytes(struct nfc_device *pnd, const uint8_t *pbtTx,
   if (pnd == NULL) return NFC_EIO;
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "transceive_bytes  timeout=%d", timeout);
 
-  if (!TagInfo) return NFC_EINVARG;
+  nfc_tag_info_t tagInfo;
+  if (!pn71xx_get_tag(pnd, &tagInfo)) return NFC_EINVARG;
 
   char buffer[500];
   BufferPrintBytes(buffer, sizeof(buffer), pbtTx, szTx);
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "===> %s", buffer);
 
-  int received = nfcTag_transceive(TagInfo->handle, (uint8_t *) pbtTx, szTx, pbtRx, szRx, 500);
+  int received = nfcTag_transceive(tagInfo.handle, (uint8_t *) pbtTx, szTx, pbtRx, szRx, 500);
   if (received <= 0)
     return NFC_EIO;
 
@@ -401,39 +459,11 @@ pn71xx_initiator_transceive_bytes(struct nfc_device *pnd, const uint8_t *pbtTx,
   return received;
 }
 
-static int
-pn71xx_initiator_poll_target(struct nfc_device *pnd,
-                             const nfc_modulation *pnmModulations, const size_t szModulations,
-                             const uint8_t uiPollNr, const uint8_t uiPeriod,
-                             nfc_target *pnt)
-{
-  static int periodFactor = 150000;
-  int period = uiPeriod * periodFactor;
-
-  if (pnd == NULL) return 0;
-
-  for (int j = 0; j < uiPollNr; j++) {
-    for (unsigned int i = 0; i < szModulations; i++) {
-      const nfc_modulation nm = pnmModulations[i];
-
-      nfc_target nt;
-      int res = pn71xx_initiator_select_passive_target(pnd, nm, 0, 0, &nt);
-      if (res > 0 && pnt) {
-        memcpy(pnt, &nt, sizeof(nfc_target));
-        return res;
-      }
-    }
-    usleep(period);
-  }
-
-  return 0;
-}
-
 static int
 pn71xx_initiator_target_is_present(struct nfc_device *pnd, const nfc_target *pnt)
 {
   if ((pnd == NULL) || (pnt == NULL)) return 1;
-  return !TagInfo;
+  return !pn71xx_get_tag(pnd, NULL);
 }
 
 
@@ -561,7 +591,7 @@ const struct nfc_driver pn71xx_driver = {
   .initiator_init                   = pn71xx_initiator_init,
   .initiator_init_secure_element    = NULL,
   .initiator_select_passive_target  = pn71xx_initiator_select_passive_target,
-  .initiator_poll_target            = pn71xx_initiator_poll_target,
+  .initiator_poll_target            = NULL,
   .initiator_select_dep_target      = NULL,
   .initiator_deselect_target        = pn71xx_initiator_deselect_target,
   .initiator_transceive_bytes       = pn71xx_initiator_transceive_bytes,
@@ -0,0 +1,251 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file replay.c
+ * @brief Driver playing back a PN53x binary trace as a device
+ *
+ * Traces are recorded by the PN53x chip layer when trace_path is set (see
+ * libnfc.conf.sample), the device is then opened with "replay:<trace file>".
+ *
+ * Each command sent by the library is matched with the next identical
+ * recorded command, and answered with the response recorded right after it.
+ * Recorded frames which are not requested (eg. a wake up sequence specific to
+ * the original driver) are skipped, so a trace captured with any PN53x driver
+ * can be played back. A command which was not recorded fails with NFC_EIO, so
+ * a session diverging from the recorded one is reported. Frames are answered
+ * immediately, recorded timings are not reproduced.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "drivers.h"
+#include "nfc-internal.h"
+#include "chips/pn53x.h"
+#include "chips/pn53x-internal.h"
+#include "chips/pn53x-trace.h"
+
+#define REPLAY_DRIVER_NAME "replay"
+
+#define LOG_CATEGORY "libnfc.driver.replay"
+#define LOG_GROUP    NFC_LOG_GROUP_DRIVER
+
+// Internal data structs
+const struct pn53x_io replay_io;
+struct replay_data {
+  struct pn53x_trace_frame *frames;
+  size_t frame_count;
+  // Index of the next frame to play
+  size_t next;
+};
+
+#define DRIVER_DATA(pnd) ((struct replay_data*)(pnd->driver_data))
+
+static void
+replay_close(nfc_device *pnd)
+{
+  pn53x_idle(pnd);
+
+  free(DRIVER_DATA(pnd)->frames);
+  pn53x_data_free(pnd);
+  nfc_device_free(pnd);
+}
+
+static nfc_device *
+replay_open(const nfc_context *context, const nfc_connstring connstring)
+{
+  const size_t szPrefix = strlen(REPLAY_DRIVER_NAME ":");
+  if ((strncmp(connstring, REPLAY_DRIVER_NAME ":", szPrefix) != 0) || (connstring[szPrefix] == '\0')) {
+    return NULL;
+  }
+  const char *path = connstring + szPrefix;
+
+  nfc_connstring traced_connstring;
+  struct pn53x_trace_frame *frames;
+  size_t frame_count;
+  if (pn53x_trace_load(path, traced_connstring, &frames, &frame_count) < 0) {
+    return NULL;
+  }
+
+  nfc_device *pnd = nfc_device_new(context, connstring);
+  if (!pnd) {
+    perror("malloc");
+    free(frames);
+    return NULL;
+  }
+  snprintf(pnd->name, sizeof(pnd->name), "%s:%.*s", REPLAY_DRIVER_NAME, (int)(sizeof(pnd->name) - sizeof(REPLAY_DRIVER_NAME ":")), traced_connstring);
+
+  pnd->driver_data = malloc(sizeof(struct replay_data));
+  if (!pnd->driver_data) {
+    perror("malloc");
+    free(frames);
+    nfc_device_free(pnd);
+    return NULL;
+  }
+  DRIVER_DATA(pnd)->frames = frames;
+  DRIVER_DATA(pnd)->frame_count = frame_count;
+  DRIVER_DATA(pnd)->next = 0;
+
+  // Alloc and init chip's data
+  if (pn53x_data_new(pnd, &replay_io) == NULL) {
+    perror("malloc");
+    free(frames);
+    nfc_device_free(pnd);
+    return NULL;
+  }
+  pnd->driver = &replay_driver;
+
+  // Chip type is set by pn53x_init() from the recorded GetFirmwareVersion reply
+  if (pn53x_init(pnd) < 0) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to initialize device from trace");
+    replay_close(pnd);
+    return NULL;
+  }
+  return pnd;
+}
+
+static int
+replay_send(nfc_device *pnd, const uint8_t *pbtData, const size_t szData, int timeout)
+{
+  (void) timeout;
+  struct replay_data *data = DRIVER_DATA(pnd);
+
+  size_t n;
+  bool bCommandFound = false;
+  for (n = data->next; n < data->frame_count; n++) {
+    const struct pn53x_trace_frame *frame = data->frames + n;
+    if ((frame->direction != PN53X_TRACE_TX) || (frame->command != pbtData[0]))
+      continue;
+    bCommandFound = true;
+    if ((frame->len == szData) && (memcmp(frame->data, pbtData, szData) == 0))
+      break;
+  }
+  if (n == data->frame_count) {
+    if (bCommandFound) {
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Command %02x diverges from the recorded ones", pbtData[0]);
+    } else {
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "No more recorded frame for command %02x", pbtData[0]);
+    }
+    LOG_HEX(NFC_LOG_GROUP_COM, "TX", pbtData, szData);
+    return pnd->last_error = NFC_EIO;
+  }
+  if (n != data->next) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%" PRIuPTR " recorded frame(s) skipped", n - data->next);
+  }
+  const struct pn53x_trace_frame *frame = data->frames + n;
+  LOG_HEX(NFC_LOG_GROUP_COM, "TX", pbtData, szData);
+  data->next = n + 1;
+  return (frame->result < 0) ? frame->result : NFC_SUCCESS;
+}
+
+static int
+replay_receive(nfc_device *pnd, uint8_t *pbtData, const size_t szDataLen, int timeout)
+{
+  (void) timeout;
+  struct replay_data *data = DRIVER_DATA(pnd);
+
+  if ((data->next == data->frame_count) || (data->frames[data->next].direction != PN53X_TRACE_RX)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "No recorded response");
+    return pnd->last_error = NFC_EIO;
+  }
+  const struct pn53x_trace_frame *frame = data->frames + data->next++;
+  if (frame->result < 0) {
+    return pnd->last_error = frame->result;
+  }
+  if (frame->len > szDataLen) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to receive data: buffer too small. (szDataLen: %" PRIuPTR ", len: %" PRIu16 ")", szDataLen, frame->len);
+    return pnd->last_error = NFC_EOVFLOW;
+  }
+  memcpy(pbtData, frame->data, frame->len);
+  LOG_HEX(NFC_LOG_GROUP_COM, "RX", pbtData, frame->len);
+  return frame->len;
+}
+
+static int
+replay_abort_command(nfc_device *pnd)
+{
+  // Recorded frames are answered immediately, there is nothing to abort
+  (void) pnd;
+  return NFC_SUCCESS;
+}
+
+const struct pn53x_io replay_io = {
+  .send       = replay_send,
+  .receive    = replay_receive,
+};
+
+const struct nfc_driver replay_driver = {
+  .name                             = REPLAY_DRIVER_NAME,
+  .scan_type                        = NOT_AVAILABLE,
+  .scan                             = NULL,
+  .open                             = replay_open,
+  .close                            = replay_close,
+  .strerror                         = pn53x_strerror,
+
+  .initiator_init                   = pn53x_initiator_init,
+  .initiator_init_secure_element    = NULL,
+  .initiator_select_passive_target  = pn53x_initiator_select_passive_target,
+  .initiator_list_passive_targets   = pn53x_initiator_list_passive_targets,
+  .initiator_inventory              = pn53x_initiator_inventory,
+  .initiator_poll_target            = pn53x_initiator_poll_target,
+  .initiator_select_dep_target      = pn53x_initiator_select_dep_target,
+  .initiator_deselect_target        = pn53x_initiator_deselect_target,
+  .initiator_transceive_bytes       = pn53x_initiator_transceive_bytes,
+  .initiator_transceive_bits        = pn53x_initiator_transceive_bits,
+  .initiator_transceive_bytes_timed = pn53x_initiator_transceive_bytes_timed,
+  .initiator_transceive_bits_timed  = pn53x_initiator_transceive_bits_timed,
+  .initiator_target_is_present      = pn53x_initiator_target_is_present,
+
+  .target_init           = pn53x_target_init,
+  .target_send_bytes     = pn53x_target_send_bytes,
+  .target_receive_bytes  = pn53x_target_receive_bytes,
+  .target_send_bits      = pn53x_target_send_bits,
+  .target_receive_bits   = pn53x_target_receive_bits,
+
+  .device_set_property_bool     = pn53x_set_property_bool,
+  .device_set_property_int      = pn53x_set_property_int,
+  .device_begin_properties      = pn53x_begin_properties,
+  .device_commit_properties     = pn53x_commit_properties,
+  .get_supported_modulation     = pn53x_get_supported_modulation,
+  .get_supported_baud_rate      = pn53x_get_supported_baud_rate,
+  .device_get_information_about = pn53x_get_information_about,
+
+  .abort_command  = replay_abort_command,
+  .idle           = pn53x_idle,
+  .powerdown      = pn53x_PowerDown,
+};
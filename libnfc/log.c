@@ -54,55 +54,87 @@ log_priority_to_str(const int priority)
 
 #include "log-internal.h"
 
+// Default log level until a context is initialized
+#ifdef DEBUG
+uint32_t log_default_level = 3;
+#else
+uint32_t log_default_level = 1;
+#endif
+
+LOG_THREAD_LOCAL struct log_scope log_thread_scope = { false, 0 };
+
+// Contexts alive, only the first one sets the default level
+static uint32_t log_context_count = 0;
+
+#if defined(__GNUC__)
+#  define log_default_level_store(level) __atomic_store_n(&log_default_level, (level), __ATOMIC_RELAXED)
+#  define log_context_count_add(n) __atomic_fetch_add(&log_context_count, (n), __ATOMIC_RELAXED)
+#else
+#  define log_default_level_store(level) (*(volatile uint32_t *) &log_default_level = (level))
+#  define log_context_count_add(n) ((log_context_count += (n)) - (n))
+#endif
+
 void
 log_init(const nfc_context *context)
 {
-#ifdef ENVVARS
-  char str[32];
-  sprintf(str, "%"PRIu32, context->log_level);
-  setenv("LIBNFC_LOG_LEVEL", str, 1);
-#else
-  (void)context;
-#endif
+  // context->log_level has already been resolved from conf files and
+  // LIBNFC_LOG_LEVEL by nfc_context_new(). Other contexts do not override the
+  // default, their level applies to their devices through log_scope_enter().
+  if (log_context_count_add(1) == 0)
+    log_default_level_store(context->log_level);
 }
 
 void
 log_exit(void)
 {
+  log_context_count_add((uint32_t) -1);
+}
+
+uint32_t
+log_get_level(void)
+{
+  return log_thread_scope.bSet ? log_thread_scope.level : log_default_level_load();
 }
 
 void
-log_put(const uint8_t group, const char *category, const uint8_t priority, const char *format, ...)
+log_set_level(const uint32_t level)
 {
-  char *env_log_level = NULL;
-#ifdef ENVVARS
-  env_log_level = getenv("LIBNFC_LOG_LEVEL");
-#endif
-  uint32_t log_level;
-  if (NULL == env_log_level) {
-    // LIBNFC_LOG_LEVEL is not set
-#ifdef DEBUG
-    log_level = 3;
-#else
-    log_level = 1;
-#endif
-  } else {
-    log_level = atoi(env_log_level);
-  }
+  log_default_level_store(level);
+}
 
-  //  printf("log_level = %"PRIu32" group = %"PRIu8" priority = %"PRIu8"\n", log_level, group, priority);
-  if (log_level) { // If log is not disabled by log_level=none
-    if (((log_level & 0x00000003) >= priority) ||   // Global log level
-        (((log_level >> (group * 2)) & 0x00000003) >= priority)) { // Group log level
-
-      va_list va;
-      va_start(va, format);
-      log_put_internal("%s\t%s\t", log_priority_to_str(priority), category);
-      log_vput_internal(format, va);
-      log_put_internal("\n");
-      va_end(va);
-    }
+/*
+ * Use level for the log sites of the calling thread until log_scope_leave().
+ * Unless bForce is set, a level already set by an enclosing scope is kept, so
+ * that a device operation called from a silenced probe stays silent.
+ */
+void
+log_scope_enter(struct log_scope *pSaved, const uint32_t level, const bool bForce)
+{
+  *pSaved = log_thread_scope;
+  if (bForce || !log_thread_scope.bSet) {
+    log_thread_scope.bSet = true;
+    log_thread_scope.level = level;
   }
 }
 
+void
+log_scope_leave(const struct log_scope *pSaved)
+{
+  log_thread_scope = *pSaved;
+}
+
+void
+log_put_message(const uint8_t group, const char *category, const uint8_t priority, const char *format, ...)
+{
+  if (!log_enabled(group, priority))
+    return;
+
+  va_list va;
+  va_start(va, format);
+  log_put_internal("%s\t%s\t", log_priority_to_str(priority), category);
+  log_vput_internal(format, va);
+  log_put_internal("\n");
+  va_end(va);
+}
+
 #endif // LOG
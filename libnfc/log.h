@@ -61,6 +61,24 @@
 //int log_priority_to_int(const char* priority);
 const char *log_priority_to_str(const int priority);
 
+/*
+  Log level of a thread: set while the thread works for a context or a device,
+  see log_scope_enter(), otherwise log sites use the process default level.
+*/
+struct log_scope {
+  bool     bSet;
+  uint32_t level;
+};
+
+/*
+  Log sites whose priority is above LOG_PRIORITY_MAX are removed at compile
+  time, eg. building with -DLOG_PRIORITY_MAX=NFC_LOG_PRIORITY_INFO drops all
+  debug messages (and LOG_HEX dumps) from a release build.
+*/
+#ifndef LOG_PRIORITY_MAX
+#  define LOG_PRIORITY_MAX NFC_LOG_PRIORITY_DEBUG
+#endif
+
 #if defined LOG
 
 #  ifndef __has_attribute
@@ -71,17 +89,63 @@ const char *log_priority_to_str(const int priority);
 #    define __has_attribute_format 1
 #  endif
 
+#  if defined(_MSC_VER)
+#    define LOG_THREAD_LOCAL __declspec(thread)
+#  else
+#    define LOG_THREAD_LOCAL __thread
+#  endif
+
+// Default log level, set by the first context or log_set_level(), never read it directly
+extern uint32_t log_default_level;
+// Level of the calling thread, see log_scope_enter(), never read it directly
+extern LOG_THREAD_LOCAL struct log_scope log_thread_scope;
+
+#  if defined(__GNUC__)
+#    define log_default_level_load() __atomic_load_n(&log_default_level, __ATOMIC_RELAXED)
+#  else
+#    define log_default_level_load() (*(volatile uint32_t *) &log_default_level)
+#  endif
+
 void log_init(const nfc_context *context);
 void log_exit(void);
-void log_put(const uint8_t group, const char *category, const uint8_t priority, const char *format, ...)
+uint32_t log_get_level(void);
+void log_set_level(const uint32_t level);
+void log_scope_enter(struct log_scope *pSaved, const uint32_t level, const bool bForce);
+void log_scope_leave(const struct log_scope *pSaved);
+void log_put_message(const uint8_t group, const char *category, const uint8_t priority, const char *format, ...)
 #  if __has_attribute_format
 __attribute__((format(printf, 4, 5)))
 #  endif
 ;
+
+/**
+ * @brief Tell if a message of given group and priority would be printed
+ * This is cheap enough to be called in front of every log site.
+ */
+static inline bool
+log_enabled(const uint8_t group, const uint8_t priority)
+{
+  if (priority > LOG_PRIORITY_MAX)
+    return false;
+  const uint32_t level = log_thread_scope.bSet ? log_thread_scope.level : log_default_level_load();
+  return (level != 0) && // If log is not disabled by log_level=none
+         (((level & 0x00000003) >= priority) ||   // Global log level
+          (((level >> (group * 2)) & 0x00000003) >= priority)); // Group log level
+}
+
+#  define log_put(group, category, priority, ...) do { \
+    if (log_enabled(group, priority)) \
+      log_put_message(group, category, priority, __VA_ARGS__); \
+  } while (0)
 #else
 // No logging
 #define log_init(nfc_context) ((void) 0)
 #define log_exit() ((void) 0)
+#define log_get_level() ((uint32_t) 0)
+#define log_set_level(level) ((void) 0)
+#define log_scope_enter(pSaved, level, bForce) ((void) (pSaved))
+#define log_scope_leave(pSaved) ((void) (pSaved))
+#define log_enabled(group, priority) (false)
 #define log_put(group, category, priority, format, ...) do {} while (0)
 
 #endif // LOG
@@ -90,6 +154,7 @@ __attribute__((format(printf, 4, 5)))
  * @macro LOG_HEX
  * @brief Log a byte-array in hexadecimal format
  * Max values:  pcTag of 121 bytes + ": " + 300 bytes of data+ "\0" => acBuf of 1024 bytes
+ * Nothing is formatted unless the debug priority is enabled for this group.
  */
 #  ifdef LOG
 #    define LOG_HEX(group, pcTag, pbtData, szBytes) do { \
@@ -102,13 +167,17 @@ __attribute__((format(printf, 4, 5)))
       abort(); \
       break; \
     } \
+    if (!log_enabled(group, NFC_LOG_PRIORITY_DEBUG)) \
+      break; \
     snprintf (__acBuf + __szBuf, sizeof(__acBuf) - __szBuf, "%s: ", pcTag); \
     __szBuf += strlen (pcTag) + 2; \
-    for (__szPos=0; (__szPos < (size_t)(szBytes)) && (__szBuf < sizeof(__acBuf)); __szPos++) { \
-      snprintf (__acBuf + __szBuf, sizeof(__acBuf) - __szBuf, "%02x ",((uint8_t *)(pbtData))[__szPos]); \
-      __szBuf += 3; \
+    for (__szPos=0; (__szPos < (size_t)(szBytes)) && (__szBuf + 4 <= sizeof(__acBuf)); __szPos++) { \
+      __acBuf[__szBuf++] = "0123456789abcdef"[((uint8_t *)(pbtData))[__szPos] >> 4]; \
+      __acBuf[__szBuf++] = "0123456789abcdef"[((uint8_t *)(pbtData))[__szPos] & 0x0f]; \
+      __acBuf[__szBuf++] = ' '; \
     } \
-    log_put (group, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s", __acBuf); \
+    __acBuf[MIN(__szBuf, sizeof(__acBuf) - 1)] = '\0'; \
+    log_put_message (group, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s", __acBuf); \
   } while (0);
 #  else
 #    define LOG_HEX(group, pcTag, pbtData, szBytes) do { \
@@ -31,6 +31,7 @@
 #ifndef _LIBNFC_MIRROR_SUBR_H_
 #  define _LIBNFC_MIRROR_SUBR_H_
 
+#  include <stddef.h>
 #  include <stdint.h>
 
 #  include <nfc/nfc-types.h>
@@ -39,5 +40,6 @@
 uint8_t  mirror(uint8_t bt);
 uint32_t mirror32(uint32_t ui32Bits);
 uint64_t mirror64(uint64_t ui64Bits);
+void     mirror_bytes(uint8_t *pbtDst, const uint8_t *pbtSrc, size_t szLen);
 
 #endif // _LIBNFC_MIRROR_SUBR_H_
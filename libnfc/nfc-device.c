@@ -63,6 +63,8 @@ nfc_device_new(const nfc_context *context, const nfc_connstring connstring)
   memcpy(res->connstring, connstring, sizeof(res->connstring));
   res->driver_data = NULL;
   res->chip_data   = NULL;
+  memset(&res->async, 0, sizeof(res->async));
+  memset(&res->poll, 0, sizeof(res->poll));
 
   return res;
 }
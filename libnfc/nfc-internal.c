@@ -82,11 +82,14 @@ nfc_context_new(void)
   // Set default context values
   res->allow_autoscan = true;
   res->allow_intrusive_scan = false;
+  res->scan_timeout = 0;
+  res->late_scans = NULL;
 #ifdef DEBUG
   res->log_level = 3;
 #else
   res->log_level = 1;
 #endif
+  strcpy(res->trace_path, "");
 
   // Clear user defined devices array
   for (int i = 0; i < MAX_USER_DEFINED_DEVICES; i++) {
@@ -133,15 +136,30 @@ nfc_context_new(void)
   envvar = getenv("LIBNFC_INTRUSIVE_SCAN");
   string_as_boolean(envvar, &(res->allow_intrusive_scan));
 
+  // Scan deadline
+  envvar = getenv("LIBNFC_SCAN_TIMEOUT");
+  if (envvar) {
+    res->scan_timeout = atoi(envvar);
+  }
+
   // log level
   envvar = getenv("LIBNFC_LOG_LEVEL");
   if (envvar) {
     res->log_level = atoi(envvar);
   }
+
+  // trace path
+  envvar = getenv("LIBNFC_TRACE_PATH");
+  if (envvar) {
+    strncpy(res->trace_path, envvar, sizeof(res->trace_path));
+    res->trace_path[sizeof(res->trace_path) - 1] = '\0';
+  }
 #endif // ENVVARS
 
   // Initialize log before use it...
   log_init(res);
+  struct log_scope scope;
+  log_scope_enter(&scope, res->log_level, true);
 
   // Debug context state
 #if defined DEBUG
@@ -151,11 +169,18 @@ nfc_context_new(void)
 #endif
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "allow_autoscan is set to %s", (res->allow_autoscan) ? "true" : "false");
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "allow_intrusive_scan is set to %s", (res->allow_intrusive_scan) ? "true" : "false");
+  if (res->scan_timeout > 0) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "scan_timeout is set to %d ms", res->scan_timeout);
+  }
+  if (res->trace_path[0]) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "trace_path is set to %s", res->trace_path);
+  }
 
   log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%d device(s) defined by user", res->user_defined_device_count);
   for (uint32_t i = 0; i < res->user_defined_device_count; i++) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "  #%d name: \"%s\", connstring: \"%s\"", i, res->user_defined_devices[i].name, res->user_defined_devices[i].connstring);
   }
+  log_scope_leave(&scope);
   return res;
 }
 
@@ -198,6 +223,34 @@ prepare_initiator_data(const nfc_modulation nm, uint8_t **ppbtInitiatorData, siz
   }
 }
 
+/*
+ * Initiator data to list up to szTargets targets: FeliCa cards are asked to
+ * answer in one of 4, 8 or 16 time slots (the Time Slot Number is the count
+ * minus one), about two per expected card, so that a polling tells several
+ * of them apart instead of having their answers collide.
+ */
+void
+prepare_initiator_list_data(const nfc_modulation nm, const size_t szTargets, uint8_t **ppbtInitiatorData, size_t *pszInitiatorData)
+{
+  static const char *apcFelicaPollings[] = {
+    "\x00\xff\xff\x01\x03",
+    "\x00\xff\xff\x01\x07",
+    "\x00\xff\xff\x01\x0f",
+  };
+
+  if (nm.nmt != NMT_FELICA) {
+    prepare_initiator_data(nm, ppbtInitiatorData, pszInitiatorData);
+    return;
+  }
+  // Even when a single card is asked for, others in the field would collide with it in a single slot
+  size_t n = 0;
+  while ((n < 2) && (((size_t) 4 << n) < 2 * szTargets)) {
+    n++;
+  }
+  *ppbtInitiatorData = (uint8_t *) apcFelicaPollings[n];
+  *pszInitiatorData = 5;
+}
+
 int
 connstring_decode(const nfc_connstring connstring, const char *driver_name, const char *bus_name, char **pparam1, char **pparam2)
 {
@@ -37,18 +37,36 @@
 #if !defined(_MSC_VER)
 #  include <sys/time.h>
 #endif
+#if defined(_WIN32)
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
 
 #include "nfc/nfc.h"
 
 #include "log.h"
 
+/**
+ * @macro HAL_SCOPE
+ * @brief Run a statement calling into the driver of pnd at the log level of its context.
+ */
+#define HAL_SCOPE( STATEMENT ) do { \
+    struct log_scope __log_scope; \
+    log_scope_enter(&__log_scope, pnd->context->log_level, false); \
+    STATEMENT; \
+    log_scope_leave(&__log_scope); \
+  } while (0)
+
 /**
  * @macro HAL
  * @brief Execute corresponding driver function if exists.
  */
 #define HAL( FUNCTION, ... ) pnd->last_error = 0; \
   if (pnd->driver->FUNCTION) { \
-    return pnd->driver->FUNCTION( __VA_ARGS__ ); \
+    int __res; \
+    HAL_SCOPE(__res = pnd->driver->FUNCTION( __VA_ARGS__ )); \
+    return __res; \
   } else { \
     pnd->last_error = NFC_EDEVNOTSUPP; \
     return false; \
@@ -61,6 +79,22 @@
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
 #endif
 
+/*
+ * Statically initialized mutex guarding the little process-wide state libnfc
+ * keeps (driver registry, single-instance drivers).
+ */
+#if defined(_WIN32)
+typedef SRWLOCK nfc_mutex;
+#  define NFC_MUTEX_INITIALIZER SRWLOCK_INIT
+#  define nfc_mutex_lock(m) AcquireSRWLockExclusive(m)
+#  define nfc_mutex_unlock(m) ReleaseSRWLockExclusive(m)
+#else
+typedef pthread_mutex_t nfc_mutex;
+#  define NFC_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#  define nfc_mutex_lock(m) pthread_mutex_lock(m)
+#  define nfc_mutex_unlock(m) pthread_mutex_unlock(m)
+#endif
+
 /*
  * Buffer management macros.
  *
@@ -121,6 +155,62 @@ typedef enum {
   NOT_AVAILABLE,
 } scan_type_enum;
 
+/**
+ * @struct nfc_async_op
+ * @brief Operation submitted to a driver on behalf of an event loop
+ *
+ * Arguments are those of the blocking counterpart of \a op. Transmitted data
+ * is only read by async_submit(), while received data and \a pnt are written
+ * by async_complete() and must stay valid until then.
+ */
+struct nfc_async_op {
+  nfc_loop_op op;
+  nfc_modulation nm;
+  uint8_t abtInit[12];
+  size_t szInit;
+  nfc_target *pnt;
+  const uint8_t *pbtTx;
+  size_t szTx;
+  uint8_t *pbtRx;
+  size_t szRx;
+  /** Timeout in ms, 0 for none; async_submit() resolves -1 to the driver's default */
+  int timeout;
+  void *user_data;
+};
+
+/**
+ * @struct nfc_async
+ * @brief Asynchronous operation of a device, see nfc-loop.c
+ */
+struct nfc_async {
+  /** An operation is in flight, until its completion has been delivered */
+  bool    busy;
+  /** Cancelled, completes with NFC_EOPABORTED */
+  bool    aborted;
+  struct nfc_async_op op;
+  /** NULL for operations submitted to an event loop */
+  nfc_async_callback cb;
+  /** Readable when a response may be pending, -1 if the device is polled */
+  int     fd;
+  /** Monotonic times in us, 0 for none */
+  int64_t deadline;
+  int64_t next_poll;
+  int64_t poll_interval;
+  /** Event loop the device has been added to */
+  nfc_loop *loop;
+};
+
+#define NFC_POLL_MAX_MODULATIONS 16
+
+/**
+ * @struct nfc_poll_scheduler
+ * @brief Polling statistics of a device, see nfc_initiator_poll_target()
+ */
+struct nfc_poll_scheduler {
+  nfc_poll_stats stats[NFC_POLL_MAX_MODULATIONS];
+  size_t  szStats;
+};
+
 struct nfc_driver {
   const char *name;
   const scan_type_enum scan_type;
@@ -132,6 +222,10 @@ struct nfc_driver {
   int (*initiator_init)(struct nfc_device *pnd);
   int (*initiator_init_secure_element)(struct nfc_device *pnd);
   int (*initiator_select_passive_target)(struct nfc_device *pnd,  const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target *pnt);
+  // Lists up to szTargets targets with one command (one inventory for ST SRx) and releases them, NFC_ENOTIMPL when nm can't be listed so
+  int (*initiator_list_passive_targets)(struct nfc_device *pnd, const nfc_modulation nm, const uint8_t *pbtInitData, const size_t szInitData, nfc_target ant[], const size_t szTargets);
+  // Walks the ISO/IEC 14443A anticollision tree with raw frames, counting them in *pszRoundTrips
+  int (*initiator_inventory)(struct nfc_device *pnd, const nfc_modulation nm, nfc_target ant[], const size_t szTargets, size_t *pszRoundTrips);
   int (*initiator_poll_target)(struct nfc_device *pnd, const nfc_modulation *pnmModulations, const size_t szModulations, const uint8_t uiPollNr, const uint8_t btPeriod, nfc_target *pnt);
   int (*initiator_select_dep_target)(struct nfc_device *pnd, const nfc_dep_mode ndm, const nfc_baud_rate nbr, const nfc_dep_info *pndiInitiator, nfc_target *pnt, const int timeout);
   int (*initiator_deselect_target)(struct nfc_device *pnd);
@@ -149,6 +243,8 @@ struct nfc_driver {
 
   int (*device_set_property_bool)(struct nfc_device *pnd, const nfc_property property, const bool bEnable);
   int (*device_set_property_int)(struct nfc_device *pnd, const nfc_property property, const int value);
+  int (*device_begin_properties)(struct nfc_device *pnd);
+  int (*device_commit_properties)(struct nfc_device *pnd);
   int (*get_supported_modulation)(struct nfc_device *pnd, const nfc_mode mode, const nfc_modulation_type **const supported_mt);
   int (*get_supported_baud_rate)(struct nfc_device *pnd, const nfc_mode mode, const nfc_modulation_type nmt, const nfc_baud_rate **const supported_br);
   int (*device_get_information_about)(struct nfc_device *pnd, char **buf);
@@ -156,6 +252,13 @@ struct nfc_driver {
   int (*abort_command)(struct nfc_device *pnd);
   int (*idle)(struct nfc_device *pnd);
   int (*powerdown)(struct nfc_device *pnd);
+
+  // Event loop support, see nfc-loop.c
+  int (*get_pollfd)(struct nfc_device *pnd);
+  int (*async_submit)(struct nfc_device *pnd, struct nfc_async_op *op);
+  int (*async_ready)(struct nfc_device *pnd);
+  int (*async_complete)(struct nfc_device *pnd, struct nfc_async_op *op, int timeout);
+  int (*async_cancel)(struct nfc_device *pnd);
 };
 
 #  define DEVICE_NAME_LENGTH  256
@@ -174,10 +277,18 @@ struct nfc_user_defined_device {
  * @brief NFC library context
  * Struct which contains internal options, references, pointers, etc. used by library
  */
+struct nfc_scan_job;
+
 struct nfc_context {
   bool allow_autoscan;
   bool allow_intrusive_scan;
+  /** Time in ms a driver scan or device probe gets in nfc_list_devices(), 0 waits for all of them */
+  int scan_timeout;
+  /** Scans which missed their deadline, joined by later nfc_list_devices() calls or nfc_exit() */
+  struct nfc_scan_job *late_scans;
   uint32_t  log_level;
+  /** Prefix of PN53x binary trace files, empty when tracing is disabled */
+  char trace_path[DEVICE_NAME_LENGTH];
   struct nfc_user_defined_device user_defined_devices[MAX_USER_DEFINED_DEVICES];
   unsigned int user_defined_device_count;
 };
@@ -214,6 +325,10 @@ struct nfc_device {
   uint8_t  btSupportByte;
   /** Last reported error */
   int     last_error;
+  /** Asynchronous operation */
+  struct nfc_async async;
+  /** Modulations polled so far */
+  struct nfc_poll_scheduler poll;
 };
 
 nfc_device *nfc_device_new(const nfc_context *context, const nfc_connstring connstring);
@@ -224,6 +339,11 @@ void string_as_boolean(const char *s, bool *value);
 void iso14443_cascade_uid(const uint8_t abtUID[], const size_t szUID, uint8_t *pbtCascadedUID, size_t *pszCascadedUID);
 
 void prepare_initiator_data(const nfc_modulation nm, uint8_t **ppbtInitiatorData, size_t *pszInitiatorData);
+void prepare_initiator_list_data(const nfc_modulation nm, const size_t szTargets, uint8_t **ppbtInitiatorData, size_t *pszInitiatorData);
+
+int nfc_device_validate_modulation(nfc_device *pnd, const nfc_mode mode, const nfc_modulation *nm);
+
+void nfc_device_close_async(nfc_device *pnd);
 
 int connstring_decode(const nfc_connstring connstring, const char *driver_name, const char *bus_name, char **pparam1, char **pparam2);
 
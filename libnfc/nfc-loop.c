@@ -0,0 +1,1007 @@
+/*-
+ * Free/Libre Near Field Communication (NFC) library
+ *
+ * Libnfc historical contributors:
+ * Copyright (C) 2009      Roel Verdult
+ * Copyright (C) 2009-2013 Romuald Conty
+ * Copyright (C) 2010-2012 Romain Tartière
+ * Copyright (C) 2010-2013 Philippe Teuwen
+ * Copyright (C) 2012-2013 Ludovic Rousseau
+ * See AUTHORS file for a more comprehensive list of contributors.
+ * Additional contributors of this file:
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ *
+ */
+
+/**
+ * @file nfc-loop.c
+ * @brief Asynchronous operations and event loop driving many NFC devices from a single thread
+ */
+/**
+ * @defgroup loop  Asynchronous operations and event loop
+ * The functionality documented below lets a thread go on with its own work,
+ * or drive many devices, while the devices exchange with their targets.
+ *
+ * An asynchronous operation costs the host the time to send its command frame
+ * and get it acknowledged, then the device is waited for through its pollable
+ * file descriptor (see nfc_device_get_pollfd()) or, if it has none, by polling
+ * it with growing intervals. A device has at most one operation in flight.
+ *
+ * Operations submitted with a completion callback, such as
+ * nfc_initiator_transceive_bytes_async(), are completed by
+ * nfc_device_process_async(), or by nfc_loop_run() if the device has been
+ * added to an \a nfc_loop. Operations submitted to an \a nfc_loop, such as
+ * nfc_loop_initiator_transceive_bytes(), are reported by nfc_loop_run(). The
+ * loop's own file descriptor (see nfc_loop_get_fd()) becomes readable whenever
+ * nfc_loop_run() has something to do, so the loop can be nested in an
+ * application's poll(2) or epoll(7) loop.
+ *
+ * This is implemented with poll(2), epoll(7) and timerfd_create(2). A loop
+ * and its devices must be used from a single thread at a time, and a device
+ * must not be used by blocking functions while one of its operations is in
+ * flight. Callbacks may submit new operations but must not free the loop.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_TIMERFD_H)
+#  include <poll.h>
+#  include <sys/epoll.h>
+#  include <sys/timerfd.h>
+#  define NFC_LOOP_ENABLED
+#endif
+
+#include <nfc/nfc.h>
+
+#include "nfc-internal.h"
+
+#define LOG_CATEGORY "libnfc.loop"
+#define LOG_GROUP    NFC_LOG_GROUP_GENERAL
+
+/*
+ * Devices without a pollable file descriptor are asked whether their response
+ * is ready with intervals growing by half from NFC_LOOP_POLL_MIN_US up to
+ * NFC_LOOP_POLL_MAX_US, as pn532_spi does when it waits by itself.
+ */
+#define NFC_LOOP_POLL_MIN_US  100
+#define NFC_LOOP_POLL_MAX_US  2000
+#define NFC_LOOP_MAX_EVENTS   32
+
+#ifdef NFC_LOOP_ENABLED
+
+static void
+nfc_async_op_select_passive_target(struct nfc_async_op *op, const nfc_modulation nm, nfc_target *pnt,
+                                   int timeout, void *user_data)
+{
+  op->op = NLO_INITIATOR_SELECT_PASSIVE_TARGET;
+  op->nm = nm;
+  op->pnt = pnt;
+  op->timeout = timeout;
+  op->user_data = user_data;
+}
+
+static void
+nfc_async_op_transceive_bytes(struct nfc_async_op *op, const uint8_t *pbtTx, const size_t szTx,
+                              uint8_t *pbtRx, const size_t szRx, int timeout, void *user_data)
+{
+  memset(op, 0, sizeof(*op));
+  op->op = NLO_INITIATOR_TRANSCEIVE_BYTES;
+  op->pbtTx = pbtTx;
+  op->szTx = szTx;
+  op->pbtRx = pbtRx;
+  op->szRx = szRx;
+  op->timeout = timeout;
+  op->user_data = user_data;
+}
+
+static void
+nfc_async_op_receive_bytes(struct nfc_async_op *op, uint8_t *pbtRx, const size_t szRx, int timeout, void *user_data)
+{
+  memset(op, 0, sizeof(*op));
+  op->op = NLO_TARGET_RECEIVE_BYTES;
+  op->pbtRx = pbtRx;
+  op->szRx = szRx;
+  op->timeout = timeout;
+  op->user_data = user_data;
+}
+
+struct nfc_loop_device {
+  nfc_device *pnd;
+  /** Watched by the loop, -1 if the device is polled */
+  int     fd;
+  /** async_ready() is to be called at the next nfc_loop_run() */
+  bool    check;
+};
+
+struct nfc_loop {
+  nfc_context *context;
+  int     epfd;
+  /** Wakes the loop up for deadlines and polled devices */
+  int     tfd;
+  struct nfc_loop_device **devices;
+  size_t  szDevices;
+};
+
+static int64_t
+nfc_loop_now_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static struct nfc_loop_device *
+nfc_loop_find(const nfc_loop *loop, const nfc_device *pnd)
+{
+  for (size_t i = 0; i < loop->szDevices; i++) {
+    if (loop->devices[i]->pnd == pnd)
+      return loop->devices[i];
+  }
+  return NULL;
+}
+
+/*
+ * Arm the timer for the earliest of the pending checks, poll times and
+ * deadlines, so that the epoll file descriptor alone tells when to run.
+ */
+static void
+nfc_loop_arm(nfc_loop *loop)
+{
+  int64_t wake = 0;
+  const int64_t now = nfc_loop_now_us();
+
+  for (size_t i = 0; i < loop->szDevices; i++) {
+    const struct nfc_loop_device *d = loop->devices[i];
+    const struct nfc_async *pa = &d->pnd->async;
+    if (!pa->busy)
+      continue;
+    if (d->check || pa->aborted) {
+      wake = now;
+      break;
+    }
+    if ((pa->fd < 0) && ((wake == 0) || (pa->next_poll < wake)))
+      wake = pa->next_poll;
+    if (pa->deadline && ((wake == 0) || (pa->deadline < wake)))
+      wake = pa->deadline;
+  }
+
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  if (wake) {
+    // A zero it_value disarms the timer, expire as soon as possible instead
+    const int64_t delay = MAX(wake - now, 1);
+    its.it_value.tv_sec = delay / 1000000;
+    its.it_value.tv_nsec = (delay % 1000000) * 1000;
+  }
+  timerfd_settime(loop->tfd, 0, &its, NULL);
+}
+
+/*
+ * Have nfc_loop_run() look at a device which has something new.
+ */
+static void
+nfc_loop_notify(nfc_loop *loop, const nfc_device *pnd)
+{
+  struct nfc_loop_device *d = nfc_loop_find(loop, pnd);
+  if (d) {
+    d->check = true;
+    nfc_loop_arm(loop);
+  }
+}
+
+static int
+nfc_async_submit(nfc_device *pnd, struct nfc_async_op *op, nfc_async_callback cb)
+{
+  struct nfc_async *pa = &pnd->async;
+  int res;
+
+  if (!pnd->driver->async_submit) {
+    pnd->last_error = NFC_EDEVNOTSUPP;
+    return pnd->last_error;
+  }
+  // One operation at a time per device
+  if (pa->busy) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  pnd->last_error = 0;
+  HAL_SCOPE(res = pnd->driver->async_submit(pnd, op));
+  if (res < 0)
+    return res;
+
+  pa->op = *op;
+  pa->cb = cb;
+  pa->busy = true;
+  pa->aborted = false;
+  if ((pa->fd = nfc_device_get_pollfd(pnd)) < 0)
+    pa->fd = -1;
+  pnd->last_error = 0;
+  const int64_t now = nfc_loop_now_us();
+  pa->deadline = (op->timeout > 0) ? now + (int64_t)op->timeout * 1000 : 0;
+  pa->poll_interval = NFC_LOOP_POLL_MIN_US;
+  pa->next_poll = now + pa->poll_interval;
+  // The response may already be there, or buffered by the driver
+  if (pa->loop)
+    nfc_loop_notify(pa->loop, pnd);
+  return NFC_SUCCESS;
+}
+
+/*
+ * Ask the driver whether the response of the operation in flight is there,
+ * if \a check or when a polled device is due, and complete the operation if
+ * so, or if it was cancelled or its deadline passed. Returns true once the
+ * operation is completed, its result being stored in \a pres.
+ */
+static bool
+nfc_async_step(nfc_device *pnd, const bool check, int *pres)
+{
+  struct nfc_async *pa = &pnd->async;
+  int64_t now = nfc_loop_now_us();
+  int res = 0;
+
+  if (pa->aborted) {
+    pa->busy = false;
+    pnd->last_error = NFC_EOPABORTED;
+    *pres = NFC_EOPABORTED;
+    return true;
+  }
+  if (check || ((pa->fd < 0) && (now >= pa->next_poll))) {
+    HAL_SCOPE(res = pnd->driver->async_ready(pnd));
+    if (res == 0) {
+      now = nfc_loop_now_us();
+      if (pa->fd < 0) {
+        pa->next_poll = now + pa->poll_interval;
+        pa->poll_interval = MIN(pa->poll_interval + pa->poll_interval / 2, NFC_LOOP_POLL_MAX_US);
+      }
+    }
+  }
+  if (res > 0) {
+    // Give the driver what is left of the timeout for the rest of the frame
+    const int timeout = pa->deadline ? (int)MAX((pa->deadline - now) / 1000, 1) : 0;
+    HAL_SCOPE(*pres = pnd->driver->async_complete(pnd, &pa->op, timeout));
+  } else if (res < 0) {
+    HAL_SCOPE(pnd->driver->async_cancel(pnd));
+    pnd->last_error = res;
+    *pres = res;
+  } else if (pa->deadline && (now >= pa->deadline)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s: timeout", pnd->name);
+    HAL_SCOPE(pnd->driver->async_cancel(pnd));
+    pnd->last_error = NFC_ETIMEOUT;
+    *pres = NFC_ETIMEOUT;
+  } else {
+    return false;
+  }
+  pa->busy = false;
+  return true;
+}
+
+/*
+ * Call the completion callback, which may submit the next operation.
+ */
+static void
+nfc_async_callback_call(nfc_device *pnd, const int res)
+{
+  const nfc_async_callback cb = pnd->async.cb;
+  void *user_data = pnd->async.op.user_data;
+  cb(pnd, res, user_data);
+}
+
+/**
+ * @ingroup initiator
+ * @brief Send data to target then retrieve data from target, without waiting for the answer
+ * @return Returns 0 when submitted, otherwise returns libnfc's error code
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pbtTx contains a byte array of the frame that needs to be transmitted, copied on submission
+ * @param szTx contains the length in bytes.
+ * @param[out] pbtRx response from the target, must stay valid until completion
+ * @param szRx size of \a pbtRx
+ * @param timeout in milliseconds, 0 for no timeout, -1 for the default one
+ * @param cb completion callback, given the result of nfc_initiator_transceive_bytes()
+ * @param user_data pointer given back to \a cb
+ *
+ * The callback is called from nfc_device_process_async(), or from nfc_loop_run() if the device has been
+ * added to an event loop.
+ */
+int
+nfc_initiator_transceive_bytes_async(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx,
+                                     const size_t szRx, int timeout, nfc_async_callback cb, void *user_data)
+{
+  struct nfc_async_op op;
+
+  if (!cb) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  nfc_async_op_transceive_bytes(&op, pbtTx, szTx, pbtRx, szRx, timeout, user_data);
+  return nfc_async_submit(pnd, &op, cb);
+}
+
+/**
+ * @ingroup target
+ * @brief Receive bytes/frames from the initiator, without waiting for them
+ * @return Returns 0 when submitted, otherwise returns libnfc's error code
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param[out] pbtRx received bytes, must stay valid until completion
+ * @param szRx size of \a pbtRx
+ * @param timeout in milliseconds, 0 for no timeout, -1 for the default one
+ * @param cb completion callback, given the result of nfc_target_receive_bytes()
+ * @param user_data pointer given back to \a cb
+ *
+ * The callback is called from nfc_device_process_async(), or from nfc_loop_run() if the device has been
+ * added to an event loop.
+ */
+int
+nfc_target_receive_bytes_async(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int timeout,
+                               nfc_async_callback cb, void *user_data)
+{
+  struct nfc_async_op op;
+
+  if (!cb) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  nfc_async_op_receive_bytes(&op, pbtRx, szRx, timeout, user_data);
+  return nfc_async_submit(pnd, &op, cb);
+}
+
+/**
+ * @ingroup loop
+ * @brief Wait for the asynchronous operation of a device to complete
+ * @return Returns 1 if the operation completed and its callback was called, 0 if it is still in flight or if
+ * there is none, otherwise returns libnfc's error code
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param timeout in milliseconds: 0 to return at once, negative to wait until the operation completes
+ *
+ * Operations submitted to an event loop are completed by nfc_loop_run() instead.
+ */
+int
+nfc_device_process_async(nfc_device *pnd, int timeout)
+{
+  struct nfc_async *pa = &pnd->async;
+  const int64_t end = (timeout > 0) ? nfc_loop_now_us() + (int64_t)timeout * 1000 : 0;
+  int res;
+
+  pnd->last_error = 0;
+  if (!pa->busy)
+    return 0;
+  if (!pa->cb) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+
+  for (;;) {
+    if (nfc_async_step(pnd, true, &res)) {
+      nfc_async_callback_call(pnd, res);
+      return 1;
+    }
+    const int64_t now = nfc_loop_now_us();
+    if ((timeout == 0) || ((timeout > 0) && (now >= end)))
+      return 0;
+
+    int64_t wake = pa->deadline;
+    if ((timeout > 0) && ((wake == 0) || (end < wake)))
+      wake = end;
+    if (pa->fd >= 0) {
+      struct pollfd pfd = { .fd = pa->fd, .events = POLLIN };
+      const int ms = wake ? (int)MAX((wake - now + 999) / 1000, 0) : -1;
+      if ((poll(&pfd, 1, ms) < 0) && (errno != EINTR)) {
+        log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "poll: %s", strerror(errno));
+        pnd->last_error = NFC_EIO;
+        return pnd->last_error;
+      }
+    } else {
+      if ((wake == 0) || (pa->next_poll < wake))
+        wake = pa->next_poll;
+      if (wake > now) {
+        const struct timespec ts = { .tv_sec = (wake - now) / 1000000, .tv_nsec = ((wake - now) % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+      }
+    }
+  }
+}
+
+/**
+ * @ingroup loop
+ * @brief Cancel the asynchronous operation of a device
+ * @return Returns 0 on success, otherwise returns libnfc's error code
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ *
+ * The device is told to abort the command. The operation then completes with NFC_EOPABORTED, through the
+ * next nfc_device_process_async() or nfc_loop_run() call as usual.
+ */
+int
+nfc_device_cancel_async(nfc_device *pnd)
+{
+  struct nfc_async *pa = &pnd->async;
+  int res;
+
+  if (!pa->busy || pa->aborted) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  pnd->last_error = 0;
+  HAL_SCOPE(res = pnd->driver->async_cancel(pnd));
+  pa->aborted = true;
+  if (pa->loop)
+    nfc_loop_notify(pa->loop, pnd);
+  return (res < 0) ? res : NFC_SUCCESS;
+}
+
+void
+nfc_device_close_async(nfc_device *pnd)
+{
+  struct nfc_async *pa = &pnd->async;
+
+  if (pa->loop)
+    nfc_loop_remove_device(pa->loop, pnd);
+  if (pa->busy && !pa->aborted)
+    HAL_SCOPE(pnd->driver->async_cancel(pnd));
+  pa->busy = false;
+}
+
+/**
+ * @ingroup loop
+ * @brief Create an event loop
+ * @return Returns a new \a nfc_loop, or NULL on failure
+ *
+ * @param context The context which the devices added to the loop belong to
+ */
+nfc_loop *
+nfc_loop_new(nfc_context *context)
+{
+  nfc_loop *loop = malloc(sizeof(*loop));
+  if (!loop) {
+    perror("malloc");
+    return NULL;
+  }
+  loop->context = context;
+  loop->devices = NULL;
+  loop->szDevices = 0;
+  loop->tfd = -1;
+
+  if ((loop->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to create event loop: %s", strerror(errno));
+    free(loop);
+    return NULL;
+  }
+  struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+  if (((loop->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) ||
+      (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->tfd, &ev) < 0)) {
+    log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to create event loop timer: %s", strerror(errno));
+    nfc_loop_free(loop);
+    return NULL;
+  }
+  return loop;
+}
+
+/**
+ * @ingroup loop
+ * @brief Free an event loop
+ *
+ * @param loop \a nfc_loop to free
+ *
+ * The devices are removed from the loop, see nfc_loop_remove_device(), but not closed.
+ */
+void
+nfc_loop_free(nfc_loop *loop)
+{
+  if (!loop)
+    return;
+  while (loop->szDevices)
+    nfc_loop_remove_device(loop, loop->devices[0]->pnd);
+  free(loop->devices);
+  if (loop->tfd >= 0)
+    close(loop->tfd);
+  close(loop->epfd);
+  free(loop);
+}
+
+/**
+ * @ingroup loop
+ * @brief Get the file descriptor of an event loop
+ * @return Returns a file descriptor which becomes readable when nfc_loop_run() has some work to do
+ *
+ * @param loop \a nfc_loop
+ */
+int
+nfc_loop_get_fd(const nfc_loop *loop)
+{
+  return loop->epfd;
+}
+
+/**
+ * @ingroup loop
+ * @brief Add a device to an event loop
+ * @return Returns 0 on success, otherwise returns libnfc's error code
+ *
+ * @param loop \a nfc_loop
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ *
+ * NFC_EDEVNOTSUPP is returned if the device's driver does not support asynchronous operations.
+ */
+int
+nfc_loop_add_device(nfc_loop *loop, nfc_device *pnd)
+{
+  if (!pnd->driver->async_submit) {
+    pnd->last_error = NFC_EDEVNOTSUPP;
+    return pnd->last_error;
+  }
+  if (pnd->async.loop) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+
+  struct nfc_loop_device **devices = realloc(loop->devices, (loop->szDevices + 1) * sizeof(*devices));
+  if (!devices) {
+    perror("realloc");
+    return pnd->last_error = NFC_ESOFT;
+  }
+  loop->devices = devices;
+
+  struct nfc_loop_device *d = calloc(1, sizeof(*d));
+  if (!d) {
+    perror("malloc");
+    return pnd->last_error = NFC_ESOFT;
+  }
+  d->pnd = pnd;
+  d->fd = nfc_device_get_pollfd(pnd);
+  if (d->fd >= 0) {
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = d };
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, d->fd, &ev) < 0) {
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "Unable to watch %s: %s", pnd->name, strerror(errno));
+      free(d);
+      return pnd->last_error = NFC_EIO;
+    }
+  } else {
+    d->fd = -1;
+  }
+  loop->devices[loop->szDevices++] = d;
+  pnd->async.loop = loop;
+  // Take over an operation already in flight
+  d->check = pnd->async.busy;
+  nfc_loop_arm(loop);
+  pnd->last_error = 0;
+  return NFC_SUCCESS;
+}
+
+/**
+ * @ingroup loop
+ * @brief Remove a device from an event loop
+ * @return Returns 0 on success, otherwise returns libnfc's error code
+ *
+ * @param loop \a nfc_loop
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ *
+ * An operation submitted to the loop and still in flight is cancelled without being reported, while an
+ * operation submitted with a callback stays in flight, see nfc_device_process_async().
+ */
+int
+nfc_loop_remove_device(nfc_loop *loop, nfc_device *pnd)
+{
+  for (size_t i = 0; i < loop->szDevices; i++) {
+    struct nfc_loop_device *d = loop->devices[i];
+    if (d->pnd != pnd)
+      continue;
+    struct nfc_async *pa = &pnd->async;
+    if (pa->busy && !pa->cb) {
+      if (!pa->aborted)
+        HAL_SCOPE(pnd->driver->async_cancel(pnd));
+      pa->busy = false;
+    }
+    pa->loop = NULL;
+    if (d->fd >= 0)
+      epoll_ctl(loop->epfd, EPOLL_CTL_DEL, d->fd, NULL);
+    free(d);
+    loop->devices[i] = loop->devices[--loop->szDevices];
+    nfc_loop_arm(loop);
+    return NFC_SUCCESS;
+  }
+  pnd->last_error = NFC_EINVARG;
+  return pnd->last_error;
+}
+
+static int
+nfc_loop_submit(nfc_loop *loop, nfc_device *pnd, struct nfc_async_op *op)
+{
+  if (pnd->async.loop != loop) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  return nfc_async_submit(pnd, op, NULL);
+}
+
+/**
+ * @ingroup loop
+ * @brief Submit nfc_initiator_select_passive_target() to an event loop
+ * @return Returns 0 when submitted, otherwise returns libnfc's error code
+ *
+ * @param loop \a nfc_loop the device has been added to
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param nm desired modulation
+ * @param pbtInitData optional initiator data, NULL for using the default values.
+ * @param szInitData length of initiator data \a pbtInitData.
+ * @param[out] pnt \a nfc_target struct pointer which will filled if available, must stay valid until completion
+ * @param timeout in milliseconds, 0 for no timeout, -1 for the default one of nfc_initiator_select_passive_target()
+ * @param user_data pointer given back with the completion
+ *
+ * Only modulations which the device selects with a single command are supported.
+ * The completion result is the one of nfc_initiator_select_passive_target().
+ */
+int
+nfc_loop_initiator_select_passive_target(nfc_loop *loop, nfc_device *pnd, const nfc_modulation nm,
+                                         const uint8_t *pbtInitData, const size_t szInitData,
+                                         nfc_target *pnt, int timeout, void *user_data)
+{
+  struct nfc_async_op op;
+  uint8_t *pbtInit = NULL;
+  size_t szInit = 0;
+  int res;
+
+  if ((res = nfc_device_validate_modulation(pnd, N_INITIATOR, &nm)) != NFC_SUCCESS)
+    return res;
+  memset(&op, 0, sizeof(op));
+  if (szInitData == 0) {
+    // Provide default values, if any
+    prepare_initiator_data(nm, &pbtInit, &szInit);
+    memcpy(op.abtInit, pbtInit, szInit);
+    op.szInit = szInit;
+  } else if (szInitData > sizeof(op.abtInit) - ((nm.nmt == NMT_ISO14443A) ? 2 : 0)) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  } else if (nm.nmt == NMT_ISO14443A) {
+    iso14443_cascade_uid(pbtInitData, szInitData, op.abtInit, &op.szInit);
+  } else {
+    memcpy(op.abtInit, pbtInitData, szInitData);
+    op.szInit = szInitData;
+  }
+  nfc_async_op_select_passive_target(&op, nm, pnt, timeout, user_data);
+  return nfc_loop_submit(loop, pnd, &op);
+}
+
+/**
+ * @ingroup loop
+ * @brief Submit nfc_initiator_transceive_bytes() to an event loop
+ * @return Returns 0 when submitted, otherwise returns libnfc's error code
+ *
+ * @param loop \a nfc_loop the device has been added to
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param pbtTx contains a byte array of the frame that needs to be transmitted, copied on submission
+ * @param szTx contains the length in bytes.
+ * @param[out] pbtRx response from the target, must stay valid until completion
+ * @param szRx size of \a pbtRx
+ * @param timeout in milliseconds, 0 for no timeout, -1 for the default one
+ * @param user_data pointer given back with the completion
+ *
+ * The completion result is the one of nfc_initiator_transceive_bytes().
+ */
+int
+nfc_loop_initiator_transceive_bytes(nfc_loop *loop, nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx,
+                                    uint8_t *pbtRx, const size_t szRx, int timeout, void *user_data)
+{
+  struct nfc_async_op op;
+
+  nfc_async_op_transceive_bytes(&op, pbtTx, szTx, pbtRx, szRx, timeout, user_data);
+  return nfc_loop_submit(loop, pnd, &op);
+}
+
+/**
+ * @ingroup loop
+ * @brief Submit nfc_target_receive_bytes() to an event loop
+ * @return Returns 0 when submitted, otherwise returns libnfc's error code
+ *
+ * @param loop \a nfc_loop the device has been added to
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param[out] pbtRx received bytes, must stay valid until completion
+ * @param szRx size of \a pbtRx
+ * @param timeout in milliseconds, 0 for no timeout, -1 for the default one
+ * @param user_data pointer given back with the completion
+ *
+ * The completion result is the one of nfc_target_receive_bytes().
+ */
+int
+nfc_loop_target_receive_bytes(nfc_loop *loop, nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int timeout, void *user_data)
+{
+  struct nfc_async_op op;
+
+  nfc_async_op_receive_bytes(&op, pbtRx, szRx, timeout, user_data);
+  return nfc_loop_submit(loop, pnd, &op);
+}
+
+/*
+ * Complete the operations whose response is ready, which were cancelled or
+ * whose deadline passed. Returns the number of completed operations, of which
+ * *pszStored went to \a completions, the others to their callback.
+ */
+static size_t
+nfc_loop_collect(nfc_loop *loop, nfc_loop_completion completions[], const size_t szCompletions, size_t *pszStored)
+{
+  size_t szDone = 0;
+
+  *pszStored = 0;
+  for (size_t i = 0; i < loop->szDevices; i++) {
+    struct nfc_loop_device *d = loop->devices[i];
+    nfc_device *pnd = d->pnd;
+    int res;
+
+    if (!pnd->async.busy)
+      continue;
+    // Left for the next run when there is no room to report it
+    if (!pnd->async.cb && (*pszStored == szCompletions))
+      continue;
+    const bool check = d->check;
+    d->check = false;
+    if (!nfc_async_step(pnd, check, &res))
+      continue;
+    szDone++;
+    if (pnd->async.cb) {
+      nfc_async_callback_call(pnd, res);
+    } else {
+      nfc_loop_completion *pnc = &completions[(*pszStored)++];
+      pnc->pnd = pnd;
+      pnc->op = pnd->async.op.op;
+      pnc->res = res;
+      pnc->user_data = pnd->async.op.user_data;
+    }
+  }
+  return szDone;
+}
+
+/**
+ * @ingroup loop
+ * @brief Wait for operations to complete
+ * @return Returns the number of completions stored in \a completions, otherwise returns libnfc's error code
+ *
+ * @param loop \a nfc_loop
+ * @param[out] completions array receiving the completed operations
+ * @param szCompletions size of \a completions
+ * @param timeout in milliseconds: 0 to return at once, negative to wait until some operation completes
+ *
+ * Operations submitted with a callback have it called instead of being stored in \a completions, so 0 is
+ * returned when only callbacks were called, when \a timeout expired first, or when no operation is in flight.
+ */
+int
+nfc_loop_run(nfc_loop *loop, nfc_loop_completion completions[], const size_t szCompletions, int timeout)
+{
+  struct epoll_event events[NFC_LOOP_MAX_EVENTS];
+  const int64_t end = (timeout > 0) ? nfc_loop_now_us() + (int64_t)timeout * 1000 : 0;
+  size_t szStored = 0;
+
+  if (szCompletions == 0)
+    return NFC_EINVARG;
+
+  for (;;) {
+    bool busy = false;
+    for (size_t i = 0; i < loop->szDevices; i++)
+      busy |= loop->devices[i]->pnd->async.busy;
+    if (!busy)
+      return 0;
+
+    int wait = timeout;
+    if (timeout > 0)
+      wait = (int)MAX((end - nfc_loop_now_us() + 999) / 1000, 0);
+
+    int n = epoll_wait(loop->epfd, events, NFC_LOOP_MAX_EVENTS, wait);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "epoll_wait: %s", strerror(errno));
+      return NFC_EIO;
+    }
+    for (int i = 0; i < n; i++) {
+      struct nfc_loop_device *d = events[i].data.ptr;
+      if (d) {
+        d->check = true;
+      } else {
+        uint64_t expirations;
+        if (read(loop->tfd, &expirations, sizeof(expirations)) < 0) {
+          // Nothing to do, the timer is re-armed below anyway
+        }
+      }
+    }
+
+    const size_t szDone = nfc_loop_collect(loop, completions, szCompletions, &szStored);
+    nfc_loop_arm(loop);
+    if (szDone > 0)
+      return (int)szStored;
+    if ((timeout == 0) || ((timeout > 0) && (nfc_loop_now_us() >= end)))
+      return 0;
+  }
+}
+
+/**
+ * @ingroup loop
+ * @brief Get the pollable file descriptor of a device
+ * @return Returns a file descriptor which becomes readable when a response may be pending, otherwise returns libnfc's error code
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ *
+ * NFC_EDEVNOTSUPP is returned for devices which can only be polled, such as
+ * PN532 on I2C or on SPI without an IRQ line.
+ */
+int
+nfc_device_get_pollfd(nfc_device *pnd)
+{
+  pnd->last_error = 0;
+  if (!pnd->driver->get_pollfd) {
+    pnd->last_error = NFC_EDEVNOTSUPP;
+    return pnd->last_error;
+  }
+  int res;
+  HAL_SCOPE(res = pnd->driver->get_pollfd(pnd));
+  return res;
+}
+
+#else // NFC_LOOP_ENABLED
+
+int
+nfc_initiator_transceive_bytes_async(nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx, uint8_t *pbtRx,
+                                     const size_t szRx, int timeout, nfc_async_callback cb, void *user_data)
+{
+  (void) pbtTx;
+  (void) szTx;
+  (void) pbtRx;
+  (void) szRx;
+  (void) timeout;
+  (void) cb;
+  (void) user_data;
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
+}
+
+int
+nfc_target_receive_bytes_async(nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int timeout,
+                               nfc_async_callback cb, void *user_data)
+{
+  (void) pbtRx;
+  (void) szRx;
+  (void) timeout;
+  (void) cb;
+  (void) user_data;
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
+}
+
+int
+nfc_device_process_async(nfc_device *pnd, int timeout)
+{
+  (void) timeout;
+  pnd->last_error = 0;
+  return 0;
+}
+
+int
+nfc_device_cancel_async(nfc_device *pnd)
+{
+  pnd->last_error = NFC_EINVARG;
+  return pnd->last_error;
+}
+
+void
+nfc_device_close_async(nfc_device *pnd)
+{
+  (void) pnd;
+}
+
+
+nfc_loop *
+nfc_loop_new(nfc_context *context)
+{
+  (void) context;
+  log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "The event loop is not supported on this platform");
+  return NULL;
+}
+
+void
+nfc_loop_free(nfc_loop *loop)
+{
+  (void) loop;
+}
+
+int
+nfc_loop_get_fd(const nfc_loop *loop)
+{
+  (void) loop;
+  return NFC_EDEVNOTSUPP;
+}
+
+int
+nfc_loop_add_device(nfc_loop *loop, nfc_device *pnd)
+{
+  (void) loop;
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
+}
+
+int
+nfc_loop_remove_device(nfc_loop *loop, nfc_device *pnd)
+{
+  (void) loop;
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
+}
+
+int
+nfc_loop_initiator_select_passive_target(nfc_loop *loop, nfc_device *pnd, const nfc_modulation nm,
+                                         const uint8_t *pbtInitData, const size_t szInitData,
+                                         nfc_target *pnt, int timeout, void *user_data)
+{
+  (void) loop;
+  (void) nm;
+  (void) pbtInitData;
+  (void) szInitData;
+  (void) pnt;
+  (void) timeout;
+  (void) user_data;
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
+}
+
+int
+nfc_loop_initiator_transceive_bytes(nfc_loop *loop, nfc_device *pnd, const uint8_t *pbtTx, const size_t szTx,
+                                    uint8_t *pbtRx, const size_t szRx, int timeout, void *user_data)
+{
+  (void) loop;
+  (void) pbtTx;
+  (void) szTx;
+  (void) pbtRx;
+  (void) szRx;
+  (void) timeout;
+  (void) user_data;
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
+}
+
+int
+nfc_loop_target_receive_bytes(nfc_loop *loop, nfc_device *pnd, uint8_t *pbtRx, const size_t szRx, int timeout, void *user_data)
+{
+  (void) loop;
+  (void) pbtRx;
+  (void) szRx;
+  (void) timeout;
+  (void) user_data;
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
+}
+
+int
+nfc_loop_run(nfc_loop *loop, nfc_loop_completion completions[], const size_t szCompletions, int timeout)
+{
+  (void) loop;
+  (void) completions;
+  (void) szCompletions;
+  (void) timeout;
+  return NFC_EDEVNOTSUPP;
+}
+
+int
+nfc_device_get_pollfd(nfc_device *pnd)
+{
+  pnd->last_error = NFC_EDEVNOTSUPP;
+  return pnd->last_error;
+}
+
+#endif // NFC_LOOP_ENABLED
@@ -34,6 +34,17 @@
  * This page details how to initialize and deinitialize libnfc. Initialization
  * must be performed before using any libnfc functionality, and similarly you
  * must not call any libnfc functions after deinitialization.
+ *
+ * Thread safety: libnfc keeps no per-process state tied to a device, so
+ * different \a nfc_device may be driven concurrently from different threads,
+ * whether they were opened from the same \a nfc_context or not. A given
+ * \a nfc_device, like a given \a nfc_context, must only be used by one thread
+ * at a time. nfc_init(), nfc_exit() and nfc_register_driver() may be called
+ * from any thread. Each device logs at the level of the context it was opened
+ * from, and messages not tied to a device use the level of the first context
+ * initialized while none was alive. Drivers built on libusb-0.1 share its
+ * process-wide bus list, which they lock while they scan or open devices, and
+ * the pn71xx driver can only open a single device per process.
  */
 /**
  * @defgroup dev NFC Device/Hardware manipulation
@@ -81,6 +92,8 @@
 #include <stddef.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <time.h>
 
 #include <nfc/nfc.h>
 
@@ -128,6 +141,14 @@
 #  include "drivers/pn71xx.h"
 #endif /* DRIVER_PN71XX_ENABLED */
 
+#if defined (DRIVER_REPLAY_ENABLED)
+#  include "drivers/replay.h"
+#endif /* DRIVER_REPLAY_ENABLED */
+
+#if defined (DRIVER_PN53X_SIM_ENABLED)
+#  include "drivers/pn53x_sim.h"
+#endif /* DRIVER_PN53X_SIM_ENABLED */
+
 
 #define LOG_CATEGORY "libnfc.general"
 #define LOG_GROUP    NFC_LOG_GROUP_GENERAL
@@ -137,7 +158,309 @@ struct nfc_driver_list {
   const struct nfc_driver *driver;
 };
 
-const struct nfc_driver_list *nfc_drivers = NULL;
+// Built-in drivers, in search order
+static const struct nfc_driver *const nfc_builtin_drivers[] = {
+#if defined (DRIVER_PN53X_SIM_ENABLED)
+  &pn53x_sim_driver,
+#endif /* DRIVER_PN53X_SIM_ENABLED */
+#if defined (DRIVER_REPLAY_ENABLED)
+  &replay_driver,
+#endif /* DRIVER_REPLAY_ENABLED */
+#if defined (DRIVER_PN71XX_ENABLED)
+  &pn71xx_driver,
+#endif /* DRIVER_PN71XX_ENABLED */
+#if defined (DRIVER_ARYGON_ENABLED)
+  &arygon_driver,
+#endif /* DRIVER_ARYGON_ENABLED */
+#if defined (DRIVER_PN532_I2C_ENABLED)
+  &pn532_i2c_driver,
+#endif /* DRIVER_PN532_I2C_ENABLED */
+#if defined (DRIVER_PN532_SPI_ENABLED)
+  &pn532_spi_driver,
+#endif /* DRIVER_PN532_SPI_ENABLED */
+#if defined (DRIVER_PN532_UART_ENABLED)
+  &pn532_uart_driver,
+#endif /* DRIVER_PN532_UART_ENABLED */
+#if defined (DRIVER_ACR122S_ENABLED)
+  &acr122s_driver,
+#endif /* DRIVER_ACR122S_ENABLED */
+#if defined (DRIVER_ACR122_USB_ENABLED)
+  &acr122_usb_driver,
+#endif /* DRIVER_ACR122_USB_ENABLED */
+#if defined (DRIVER_ACR122_PCSC_ENABLED)
+  &acr122_pcsc_driver,
+#endif /* DRIVER_ACR122_PCSC_ENABLED */
+#if defined (DRIVER_PCSC_ENABLED)
+  &pcsc_driver,
+#endif /* DRIVER_PCSC_ENABLED */
+#if defined (DRIVER_PN53X_USB_ENABLED)
+  &pn53x_usb_driver,
+#endif /* DRIVER_PN53X_USB_ENABLED */
+  NULL
+};
+
+// Drivers added with nfc_register_driver(), searched before the built-in ones.
+// While a context is alive the list only grows by its head and its nodes are
+// never modified nor freed, so a reader only needs the lock to fetch the head.
+// The last nfc_exit() frees it.
+static const struct nfc_driver_list *nfc_drivers = NULL;
+static size_t nfc_contexts = 0;
+static nfc_mutex nfc_drivers_lock = NFC_MUTEX_INITIALIZER;
+
+struct nfc_driver_iter {
+  const struct nfc_driver_list *pndl;
+  size_t szBuiltin;
+};
+
+static void
+nfc_driver_iter_init(struct nfc_driver_iter *iter)
+{
+  nfc_mutex_lock(&nfc_drivers_lock);
+  iter->pndl = nfc_drivers;
+  nfc_mutex_unlock(&nfc_drivers_lock);
+  iter->szBuiltin = 0;
+}
+
+static const struct nfc_driver *
+nfc_driver_iter_next(struct nfc_driver_iter *iter)
+{
+  if (iter->pndl) {
+    const struct nfc_driver *ndr = iter->pndl->driver;
+    iter->pndl = iter->pndl->next;
+    return ndr;
+  }
+  if (nfc_builtin_drivers[iter->szBuiltin])
+    return nfc_builtin_drivers[iter->szBuiltin++];
+  return NULL;
+}
+
+/*
+ * nfc_list_devices() runs each driver scan and each optional device probe as a
+ * job on its own thread, so slow serial or USB probes overlap instead of
+ * adding up. Intrusive drivers all probe the same serial, SPI and I2C ports,
+ * which can't be claimed atomically, so they share a single job and scan one
+ * after the other. Results are merged in driver order once all jobs are done
+ * or their deadline passed. A late job keeps running: it owns its results
+ * buffer and is only joined afterwards, so it never writes to the caller's
+ * array.
+ */
+struct nfc_scan_slot {
+  const struct nfc_driver *ndr;
+  // Position of the driver in the scan order
+  size_t order;
+  size_t found;
+};
+
+struct nfc_scan_job {
+  struct nfc_scan_job *next;
+  nfc_context *context;
+  // Drivers to scan with, one after the other, or none to silently probe connstrings[0] with nfc_open()
+  size_t szSlots;
+  struct nfc_scan_slot *slots;
+  size_t found;
+  bool done;
+#if !defined(_WIN32)
+  bool threaded;
+  pthread_t thread;
+#endif
+  size_t connstrings_len;
+  nfc_connstring connstrings[];
+};
+
+#if !defined(_WIN32)
+static pthread_mutex_t nfc_scan_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t nfc_scan_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+static struct nfc_scan_job *
+nfc_scan_job_new(nfc_context *context, const size_t szDrivers, const size_t connstrings_len)
+{
+  struct nfc_scan_job *job = malloc(sizeof(struct nfc_scan_job) + connstrings_len * sizeof(nfc_connstring));
+  if (!job) {
+    perror("malloc");
+    return NULL;
+  }
+  job->slots = NULL;
+  if (szDrivers && !(job->slots = malloc(szDrivers * sizeof(struct nfc_scan_slot)))) {
+    perror("malloc");
+    free(job);
+    return NULL;
+  }
+  job->next = NULL;
+  job->context = context;
+  job->szSlots = 0;
+  job->found = 0;
+  job->done = false;
+#if !defined(_WIN32)
+  job->threaded = false;
+#endif
+  job->connstrings_len = connstrings_len;
+  return job;
+}
+
+// The job must have been created for enough drivers
+static void
+nfc_scan_job_add(struct nfc_scan_job *job, const struct nfc_driver *ndr, const size_t order)
+{
+  job->slots[job->szSlots].ndr = ndr;
+  job->slots[job->szSlots].order = order;
+  job->slots[job->szSlots].found = 0;
+  job->szSlots++;
+}
+
+static const char *
+nfc_scan_job_name(const struct nfc_scan_job *job)
+{
+  if (job->szSlots == 0)
+    return job->connstrings[0];
+  return (job->szSlots == 1) ? job->slots[0].ndr->name : "intrusive drivers";
+}
+
+static void *
+nfc_scan_job_run(void *arg)
+{
+  struct nfc_scan_job *job = arg;
+  struct log_scope scope;
+  size_t found = 0;
+
+  if (job->szSlots) {
+    log_scope_enter(&scope, job->context->log_level, false);
+    for (size_t i = 0; (i < job->szSlots) && (found < job->connstrings_len); i++) {
+      job->slots[i].found = job->slots[i].ndr->scan(job->context, job->connstrings + found, job->connstrings_len - found);
+      found += job->slots[i].found;
+    }
+  } else {
+    // Optional devices may well be missing, don't report it
+    log_scope_enter(&scope, 0, true);
+    nfc_device *pnd = nfc_open(job->context, job->connstrings[0]);
+    found = pnd ? 1 : 0;
+    nfc_close(pnd);
+  }
+  log_scope_leave(&scope);
+
+#if !defined(_WIN32)
+  pthread_mutex_lock(&nfc_scan_lock);
+  job->found = found;
+  job->done = true;
+  pthread_cond_broadcast(&nfc_scan_cond);
+  pthread_mutex_unlock(&nfc_scan_lock);
+#else
+  job->found = found;
+  job->done = true;
+#endif
+  return NULL;
+}
+
+static void
+nfc_scan_job_start(struct nfc_scan_job *job)
+{
+#if !defined(_WIN32)
+  if (pthread_create(&job->thread, NULL, nfc_scan_job_run, job) == 0) {
+    job->threaded = true;
+    return;
+  }
+  log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s", "Unable to start a scan thread, scanning in place");
+#endif
+  // No thread, the job is done once we return
+  nfc_scan_job_run(job);
+}
+
+static void
+nfc_scan_job_free(struct nfc_scan_job *job)
+{
+#if !defined(_WIN32)
+  if (job->threaded)
+    pthread_join(job->thread, NULL);
+#endif
+  free(job->slots);
+  free(job);
+}
+
+/*
+ * Wait for jobs until they are all done or the context scan deadline passed.
+ * Late jobs are moved to context->late_scans and their slot set to NULL.
+ */
+static void
+nfc_scan_jobs_wait(nfc_context *context, struct nfc_scan_job **jobs, const size_t szJobs)
+{
+#if !defined(_WIN32)
+  struct timespec deadline;
+  bool timed_out = false;
+
+  if (context->scan_timeout > 0) {
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += context->scan_timeout / 1000;
+    deadline.tv_nsec += (long)(context->scan_timeout % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+  }
+
+  pthread_mutex_lock(&nfc_scan_lock);
+  for (size_t i = 0; i < szJobs; i++) {
+    if (!jobs[i])
+      continue;
+    while (!jobs[i]->done && !timed_out) {
+      if (context->scan_timeout > 0)
+        timed_out = (pthread_cond_timedwait(&nfc_scan_cond, &nfc_scan_lock, &deadline) == ETIMEDOUT);
+      else
+        pthread_cond_wait(&nfc_scan_cond, &nfc_scan_lock);
+    }
+    if (!jobs[i]->done) {
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_INFO, "%s did not answer within %d ms, ignored", nfc_scan_job_name(jobs[i]), context->scan_timeout);
+      jobs[i]->next = context->late_scans;
+      context->late_scans = jobs[i];
+      jobs[i] = NULL;
+    }
+  }
+  pthread_mutex_unlock(&nfc_scan_lock);
+#else
+  // Jobs run in place
+  (void) context;
+  (void) jobs;
+  (void) szJobs;
+#endif
+}
+
+/*
+ * Join late jobs which are done, or all of them when wait is set.
+ */
+static void
+nfc_scan_jobs_reap(nfc_context *context, const bool wait)
+{
+  struct nfc_scan_job **pjob = &context->late_scans;
+  while (*pjob) {
+    struct nfc_scan_job *job = *pjob;
+    bool done;
+#if !defined(_WIN32)
+    pthread_mutex_lock(&nfc_scan_lock);
+    done = job->done;
+    pthread_mutex_unlock(&nfc_scan_lock);
+#else
+    done = job->done;
+#endif
+    if (done || wait) {
+      *pjob = job->next;
+      nfc_scan_job_free(job);
+    } else {
+      pjob = &job->next;
+    }
+  }
+}
+
+// Tell if a late scan still uses the driver, or the ports of an intrusive one
+static bool
+nfc_scan_jobs_pending(const nfc_context *context, const struct nfc_driver *ndr)
+{
+  for (const struct nfc_scan_job *job = context->late_scans; job; job = job->next) {
+    for (size_t i = 0; i < job->szSlots; i++) {
+      if ((job->slots[i].ndr == ndr) || ((ndr->scan_type == INTRUSIVE) && (job->slots[i].ndr->scan_type == INTRUSIVE)))
+        return true;
+    }
+  }
+  return false;
+}
 
 // descritions for debugging
 const char *nfc_property_name[] = {
@@ -158,50 +481,15 @@ const char *nfc_property_name[] = {
   "NP_FORCE_SPEED_106"
 };
 
-static void
-nfc_drivers_init(void)
-{
-#if defined (DRIVER_PN53X_USB_ENABLED)
-  nfc_register_driver(&pn53x_usb_driver);
-#endif /* DRIVER_PN53X_USB_ENABLED */
-#if defined (DRIVER_PCSC_ENABLED)
-  nfc_register_driver(&pcsc_driver);
-#endif /* DRIVER_ACR122_PCSC_ENABLED */
-#if defined (DRIVER_ACR122_PCSC_ENABLED)
-  nfc_register_driver(&acr122_pcsc_driver);
-#endif /* DRIVER_ACR122_PCSC_ENABLED */
-#if defined (DRIVER_ACR122_USB_ENABLED)
-  nfc_register_driver(&acr122_usb_driver);
-#endif /* DRIVER_ACR122_USB_ENABLED */
-#if defined (DRIVER_ACR122S_ENABLED)
-  nfc_register_driver(&acr122s_driver);
-#endif /* DRIVER_ACR122S_ENABLED */
-#if defined (DRIVER_PN532_UART_ENABLED)
-  nfc_register_driver(&pn532_uart_driver);
-#endif /* DRIVER_PN532_UART_ENABLED */
-#if defined (DRIVER_PN532_SPI_ENABLED)
-  nfc_register_driver(&pn532_spi_driver);
-#endif /* DRIVER_PN532_SPI_ENABLED */
-#if defined (DRIVER_PN532_I2C_ENABLED)
-  nfc_register_driver(&pn532_i2c_driver);
-#endif /* DRIVER_PN532_I2C_ENABLED */
-#if defined (DRIVER_ARYGON_ENABLED)
-  nfc_register_driver(&arygon_driver);
-#endif /* DRIVER_ARYGON_ENABLED */
-#if defined (DRIVER_PN71XX_ENABLED)
-  nfc_register_driver(&pn71xx_driver);
-#endif /* DRIVER_PN71XX_ENABLED */
-}
-
-static int
-nfc_device_validate_modulation(nfc_device *pnd, const nfc_mode mode, const nfc_modulation *nm);
-
 /** @ingroup lib
  * @brief Register an NFC device driver with libnfc.
  * This function registers a driver with libnfc, the caller is responsible of managing the lifetime of the
  * driver and make sure that any resources associated with the driver are available after registration.
+ * Registered drivers are searched before the built-in ones and stay registered until the last context is
+ * released by nfc_exit(). This function is thread-safe.
  * @param pnd Pointer to an NFC device driver to be registered.
  * @retval NFC_SUCCESS If the driver registration succeeds.
+ * @retval NFC_EINVARG If the driver, or another one with the same name, is already registered.
  */
 int
 nfc_register_driver(const struct nfc_driver *ndr)
@@ -216,8 +504,18 @@ nfc_register_driver(const struct nfc_driver *ndr)
     return NFC_ESOFT;
 
   pndl->driver = ndr;
+  nfc_mutex_lock(&nfc_drivers_lock);
+  for (const struct nfc_driver_list *p = nfc_drivers; p; p = p->next) {
+    if ((p->driver == ndr) || (strcmp(p->driver->name, ndr->name) == 0)) {
+      nfc_mutex_unlock(&nfc_drivers_lock);
+      free(pndl);
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s driver is already registered", ndr->name);
+      return NFC_EINVARG;
+    }
+  }
   pndl->next = nfc_drivers;
   nfc_drivers = pndl;
+  nfc_mutex_unlock(&nfc_drivers_lock);
 
   return NFC_SUCCESS;
 }
@@ -235,8 +533,9 @@ nfc_init(nfc_context **context)
     perror("malloc");
     return;
   }
-  if (!nfc_drivers)
-    nfc_drivers_init();
+  nfc_mutex_lock(&nfc_drivers_lock);
+  nfc_contexts++;
+  nfc_mutex_unlock(&nfc_drivers_lock);
 }
 
 /** @ingroup lib
@@ -247,13 +546,23 @@ nfc_init(nfc_context **context)
 void
 nfc_exit(nfc_context *context)
 {
-  while (nfc_drivers) {
-    struct nfc_driver_list *pndl = (struct nfc_driver_list *) nfc_drivers;
-    nfc_drivers = pndl->next;
-    free(pndl);
-  }
-
+  // Scans which missed their deadline still use the context
+  nfc_scan_jobs_reap(context, true);
   nfc_context_free(context);
+
+  // No driver iteration can be in progress once the last context is gone
+  const struct nfc_driver_list *pndl = NULL;
+  nfc_mutex_lock(&nfc_drivers_lock);
+  if (--nfc_contexts == 0) {
+    pndl = nfc_drivers;
+    nfc_drivers = NULL;
+  }
+  nfc_mutex_unlock(&nfc_drivers_lock);
+  while (pndl) {
+    const struct nfc_driver_list *next = pndl->next;
+    free((struct nfc_driver_list *) pndl);
+    pndl = next;
+  }
 }
 
 /** @ingroup dev
@@ -289,25 +598,26 @@ nfc_open(nfc_context *context, const nfc_connstring connstring)
   }
 
   // Search through the device list for an available device
-  const struct nfc_driver_list *pndl = nfc_drivers;
-  while (pndl) {
-    const struct nfc_driver *ndr = pndl->driver;
-
+  struct nfc_driver_iter iter;
+  const struct nfc_driver *ndr;
+  nfc_driver_iter_init(&iter);
+  while ((ndr = nfc_driver_iter_next(&iter))) {
     // Specific device is requested: using device description
     if (0 != strncmp(ndr->name, ncs, strlen(ndr->name))) {
       // Check if connstring driver is usb -> accept any driver *_usb
       if ((0 != strncmp("usb", ncs, strlen("usb"))) || 0 != strncmp("_usb", ndr->name + (strlen(ndr->name) - 4), 4)) {
-        pndl = pndl->next;
         continue;
       }
     }
 
+    struct log_scope scope;
+    log_scope_enter(&scope, context->log_level, false);
     pnd = ndr->open(context, ncs);
+    log_scope_leave(&scope);
     // Test if the opening was successful
     if (pnd == NULL) {
       if (0 == strncmp("usb", ncs, strlen("usb"))) {
         // We've to test the other usb drivers before giving up
-        pndl = pndl->next;
         continue;
       }
       log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "Unable to open \"%s\".", ncs);
@@ -334,13 +644,17 @@ nfc_open(nfc_context *context, const nfc_connstring connstring)
  * @param pnd \a nfc_device struct pointer that represent currently used device
  *
  * Initiator's selected tag is closed and the device, including allocated \a nfc_device struct, is released.
+ * The device leaves its event loop, if any, and an asynchronous operation still in flight is dropped without
+ * being completed.
  */
 void
 nfc_close(nfc_device *pnd)
 {
   if (pnd) {
+    // Leave its event loop and drop any operation in flight
+    nfc_device_close_async(pnd);
     // Close, clean up and release the device
-    pnd->driver->close(pnd);
+    HAL_SCOPE(pnd->driver->close(pnd));
   }
 }
 
@@ -351,79 +665,125 @@ nfc_close(nfc_device *pnd)
  * @param connstrings array of \a nfc_connstring.
  * @param connstrings_len size of the \a connstrings array.
  *
+ * Drivers are scanned, and optional user-defined devices probed, in parallel; intrusive drivers, which probe
+ * the same serial ports, are scanned one after the other. Devices are listed in the same order as a sequential
+ * scan would list them. When the \e scan_timeout option (or \e LIBNFC_SCAN_TIMEOUT environment variable) is
+ * set, devices found by drivers which take longer than this many milliseconds are not listed; such drivers are
+ * skipped by further calls until their scan ends.
  */
 size_t
 nfc_list_devices(nfc_context *context, nfc_connstring connstrings[], const size_t connstrings_len)
 {
   size_t device_found = 0;
 
+  // Forget about late scans of previous calls which are done by now
+  nfc_scan_jobs_reap(context, false);
+
 #ifdef CONFFILES
   // Load manually configured devices (from config file and env variables)
   // TODO From env var...
+  struct nfc_scan_job *probes[MAX_USER_DEFINED_DEVICES] = { NULL };
+
+  // Optional devices are probed all at once
   for (uint32_t i = 0; i < context->user_defined_device_count; i++) {
     if (context->user_defined_devices[i].optional) {
-      // let's make sure the device exists
-      nfc_device *pnd = NULL;
-
-#ifdef ENVVARS
-      char *env_log_level = getenv("LIBNFC_LOG_LEVEL");
-      char *old_env_log_level = NULL;
-      // do it silently
-      if (env_log_level) {
-        if ((old_env_log_level = malloc(strlen(env_log_level) + 1)) == NULL) {
-          log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_ERROR, "%s", "Unable to malloc()");
-          return 0;
-        }
-        strcpy(old_env_log_level, env_log_level);
-      }
-      setenv("LIBNFC_LOG_LEVEL", "0", 1);
-#endif // ENVVARS
-
-      pnd = nfc_open(context, context->user_defined_devices[i].connstring);
-
-#ifdef ENVVARS
-      if (old_env_log_level) {
-        setenv("LIBNFC_LOG_LEVEL", old_env_log_level, 1);
-        free(old_env_log_level);
-      } else {
-        unsetenv("LIBNFC_LOG_LEVEL");
+      if ((probes[i] = nfc_scan_job_new(context, 0, 1))) {
+        memcpy(probes[i]->connstrings[0], context->user_defined_devices[i].connstring, sizeof(nfc_connstring));
+        nfc_scan_job_start(probes[i]);
       }
-#endif // ENVVARS
+    }
+  }
+  nfc_scan_jobs_wait(context, probes, context->user_defined_device_count);
 
-      if (pnd) {
-        nfc_close(pnd);
+  for (uint32_t i = 0; i < context->user_defined_device_count && device_found < connstrings_len; i++) {
+    if (context->user_defined_devices[i].optional) {
+      // let's make sure the device exists
+      if (probes[i] && probes[i]->found) {
         log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "User device %s found", context->user_defined_devices[i].name);
         strcpy((char *)(connstrings + device_found), context->user_defined_devices[i].connstring);
         device_found ++;
-        if (device_found == connstrings_len)
-          break;
       }
     } else {
       // manual choice is not marked as optional so let's take it blindly
       strcpy((char *)(connstrings + device_found), context->user_defined_devices[i].connstring);
       device_found++;
-      if (device_found >= connstrings_len)
-        return device_found;
     }
   }
+  for (uint32_t i = 0; i < context->user_defined_device_count; i++) {
+    if (probes[i])
+      nfc_scan_job_free(probes[i]);
+  }
+  if (device_found >= connstrings_len)
+    return device_found;
 #endif // CONFFILES
 
   // Device auto-detection
   if (context->allow_autoscan) {
-    const struct nfc_driver_list *pndl = nfc_drivers;
-    while (pndl) {
-      const struct nfc_driver *ndr = pndl->driver;
+    struct nfc_driver_iter iter;
+    const struct nfc_driver *ndr;
+    size_t szJobs = 0;
+
+    nfc_driver_iter_init(&iter);
+    struct nfc_driver_iter count = iter;
+    while (nfc_driver_iter_next(&count))
+      szJobs++;
+
+    // One job per driver, but a single one for all intrusive drivers, stored last
+    struct nfc_scan_job **jobs = NULL;
+    if (szJobs && !(jobs = calloc(szJobs + 1, sizeof(struct nfc_scan_job *)))) {
+      perror("malloc");
+      return device_found;
+    }
+    struct nfc_scan_job **bus = &jobs[szJobs];
+    for (size_t i = 0; (ndr = nfc_driver_iter_next(&iter)); i++) {
       if ((ndr->scan_type == NOT_INTRUSIVE) || ((context->allow_intrusive_scan) && (ndr->scan_type == INTRUSIVE))) {
-        size_t _device_found = ndr->scan(context, connstrings + (device_found), connstrings_len - (device_found));
-        log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%ld device(s) found using %s driver", (unsigned long) _device_found, ndr->name);
-        if (_device_found > 0) {
-          device_found += _device_found;
-          if (device_found == connstrings_len)
-            break;
+        if (nfc_scan_jobs_pending(context, ndr)) {
+          log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%s driver is still busy with a previous scan, skipped", ndr->name);
+          continue;
+        }
+        if (ndr->scan_type == INTRUSIVE) {
+          if (!*bus)
+            *bus = nfc_scan_job_new(context, szJobs, connstrings_len - device_found);
+          if (*bus)
+            nfc_scan_job_add(*bus, ndr, i);
+        } else if ((jobs[i] = nfc_scan_job_new(context, 1, connstrings_len - device_found))) {
+          nfc_scan_job_add(jobs[i], ndr, i);
+          nfc_scan_job_start(jobs[i]);
         }
       } // scan_type is INTRUSIVE but not allowed or NOT_AVAILABLE
-      pndl = pndl->next;
     }
+    if (*bus)
+      nfc_scan_job_start(*bus);
+    nfc_scan_jobs_wait(context, jobs, szJobs + 1);
+
+    // Merge in driver order, whatever order the scans completed in
+    size_t szBusSlot = 0;
+    size_t szBusFound = 0;
+    for (size_t i = 0; i < szJobs; i++) {
+      const struct nfc_scan_job *job = jobs[i];
+      const struct nfc_scan_slot *slot;
+      size_t offset = 0;
+      if (job) {
+        slot = &job->slots[0];
+      } else if (*bus && (szBusSlot < (*bus)->szSlots) && ((*bus)->slots[szBusSlot].order == i)) {
+        job = *bus;
+        slot = &job->slots[szBusSlot++];
+        offset = szBusFound;
+        szBusFound += slot->found;
+      } else {
+        continue;
+      }
+      log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_DEBUG, "%ld device(s) found using %s driver", (unsigned long) slot->found, slot->ndr->name);
+      for (size_t j = 0; j < slot->found && device_found < connstrings_len; j++) {
+        memcpy(connstrings[device_found], job->connstrings[offset + j], sizeof(nfc_connstring));
+        device_found++;
+      }
+    }
+    for (size_t i = 0; i <= szJobs; i++) {
+      if (jobs[i])
+        nfc_scan_job_free(jobs[i]);
+    }
+    free(jobs);
   } else if (context->user_defined_device_count == 0) {
     log_put(LOG_GROUP, LOG_CATEGORY, NFC_LOG_PRIORITY_INFO, "Warning: %s", "user must specify device(s) manually when autoscan is disabled");
   }
@@ -469,6 +829,71 @@ nfc_device_set_property_bool(nfc_device *pnd, const nfc_property property, const
   HAL(device_set_property_bool, pnd, property, bEnable);
 }
 
+/** @ingroup properties
+ * @brief Start a batch of property changes
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ *
+ * Following nfc_device_set_property_bool() and nfc_device_set_property_int()
+ * calls are recorded and only applied by nfc_device_commit_properties(),
+ * which sends the device as few commands as possible and skips values
+ * already in effect. Nothing but property changes may be requested from the
+ * device until then. Batches can be nested, changes are applied by the
+ * outermost commit.
+ *
+ * Devices which can't batch changes apply them as they are set.
+ */
+int
+nfc_device_begin_properties(nfc_device *pnd)
+{
+  if (!pnd->driver->device_begin_properties) {
+    // Changes are applied as they are set
+    return NFC_SUCCESS;
+  }
+  HAL(device_begin_properties, pnd);
+}
+
+/** @ingroup properties
+ * @brief Apply the property changes recorded since nfc_device_begin_properties()
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ *
+ * If a change can't be applied, the remaining ones are dropped and the batch
+ * is closed anyway.
+ */
+int
+nfc_device_commit_properties(nfc_device *pnd)
+{
+  if (!pnd->driver->device_commit_properties) {
+    // Changes have already been applied
+    return NFC_SUCCESS;
+  }
+  HAL(device_commit_properties, pnd);
+}
+
+static int
+nfc_initiator_init_properties(nfc_device *pnd)
+{
+  int res = 0;
+  // Let the device try forever to find a target/tag
+  if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, true)) < 0)
+    return res;
+  // Activate auto ISO14443-4 switching by default
+  if ((res = nfc_device_set_property_bool(pnd, NP_AUTO_ISO14443_4, true)) < 0)
+    return res;
+  // Force 14443-A mode
+  if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_ISO14443_A, true)) < 0)
+    return res;
+  // Force speed at 106kbps
+  if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_SPEED_106, true)) < 0)
+    return res;
+  // Disallow invalid frame
+  if ((res = nfc_device_set_property_bool(pnd, NP_ACCEPT_INVALID_FRAMES, false)) < 0)
+    return res;
+  // Disallow multiple frames
+  return nfc_device_set_property_bool(pnd, NP_ACCEPT_MULTIPLE_FRAMES, false);
+}
+
 /** @ingroup initiator
  * @brief Initialize NFC device as initiator (reader)
  * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
@@ -499,24 +924,37 @@ nfc_initiator_init(nfc_device *pnd)
   // Enable field so more power consuming cards can power themselves up
   if ((res = nfc_device_set_property_bool(pnd, NP_ACTIVATE_FIELD, true)) < 0)
     return res;
-  // Let the device try forever to find a target/tag
-  if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, true)) < 0)
-    return res;
-  // Activate auto ISO14443-4 switching by default
-  if ((res = nfc_device_set_property_bool(pnd, NP_AUTO_ISO14443_4, true)) < 0)
-    return res;
-  // Force 14443-A mode
-  if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_ISO14443_A, true)) < 0)
-    return res;
-  // Force speed at 106kbps
-  if ((res = nfc_device_set_property_bool(pnd, NP_FORCE_SPEED_106, true)) < 0)
-    return res;
-  // Disallow invalid frame
-  if ((res = nfc_device_set_property_bool(pnd, NP_ACCEPT_INVALID_FRAMES, false)) < 0)
+  return nfc_initiator_reset(pnd);
+}
+
+/** @ingroup initiator
+ * @brief Return NFC device to the initiator state set by nfc_initiator_init()
+ * @return Returns 0 on success, otherwise returns libnfc's error code (negative value)
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ *
+ * This is a soft reset meant to be called between cards: the properties are
+ * set back as nfc_initiator_init() does, but the RF field is left as it is.
+ * Settings still in effect, e.g. after reading an ISO14443-A tag, are not sent
+ * again, so this usually costs one or two frames, if any.
+ *
+ * @note A target which has been deselected or halted stays silent until the RF
+ * field is cycled, use nfc_initiator_init() when such a target has to be found
+ * again.
+ */
+int
+nfc_initiator_reset(nfc_device *pnd)
+{
+  int res = 0;
+  // Properties are sent together
+  if ((res = nfc_device_begin_properties(pnd)) < 0)
     return res;
-  // Disallow multiple frames
-  if ((res = nfc_device_set_property_bool(pnd, NP_ACCEPT_MULTIPLE_FRAMES, false)) < 0)
+  res = nfc_initiator_init_properties(pnd);
+  // The batch is closed even when a property could not be set
+  const int res_commit = nfc_device_commit_properties(pnd);
+  if (res < 0)
     return res;
+  if (res_commit < 0)
+    return res_commit;
   HAL(initiator_init, pnd);
 }
 
@@ -548,7 +986,9 @@ nfc_initiator_init_secure_element(nfc_device *pnd)
  * - for an ISO/IEC 14443 type B modulation, pbbInitData contains Application Family Identifier (AFI) (see ISO/IEC 14443-3)
         and optionally a second byte = 0x01 if you want to use probabilistic approach instead of timeslot approach;
  * - for a FeliCa modulation, pbbInitData contains a 5-byte polling payload (see ISO/IEC 18092 11.2.2.5).
- * - for ISO14443B', ASK CTx and ST SRx, see corresponding standards
+ * - for ISO14443B', ASK CTx and ST SRx, see corresponding standards;
+ * - for ST SRx, pbtInitData may also hold the 8 bytes UID of a tag listed by
+ *   nfc_initiator_list_passive_targets() since the field was switched on, to select it again;
  * - if NULL, default values adequate for the chosen modulation will be used.
  *
  * @param[out] pnt \a nfc_target struct pointer which will filled if available
@@ -576,19 +1016,99 @@ nfc_initiator_select_passive_target(nfc_device *pnd,
   if (szInitData == 0) {
     // Provide default values, if any
     prepare_initiator_data(nm, &abtInit, &szInit);
-    free(abtTmpInit);
   } else if (nm.nmt == NMT_ISO14443A) {
     abtInit = abtTmpInit;
     iso14443_cascade_uid(pbtInitData, szInitData, abtInit, &szInit);
   } else {
     abtInit = abtTmpInit;
     memcpy(abtInit, pbtInitData, szInitData);
-    free(abtTmpInit);
     szInit = szInitData;
   }
-  HAL(initiator_select_passive_target, pnd, nm, abtInit, szInit, pnt);
-
+  // Initiator data may live in abtTmpInit, which is released once the driver is done with it
+  pnd->last_error = 0;
+  if (pnd->driver->initiator_select_passive_target) {
+    HAL_SCOPE(res = pnd->driver->initiator_select_passive_target(pnd, nm, abtInit, szInit, pnt));
+  } else {
+    pnd->last_error = NFC_EDEVNOTSUPP;
+    res = false;
+  }
   free(abtTmpInit);
+  return res;
+}
+
+/*
+ * Targets listed by nfc_initiator_list_passive_targets() are told apart by
+ * their modulation type and identifier. Both are hashed (FNV-1a) into a key,
+ * so a new target is checked against the known ones by comparing integers;
+ * identifiers are only compared when keys match.
+ */
+static const uint8_t *
+nfc_target_id(const nfc_target *pnt, size_t *pszId)
+{
+  switch (pnt->nm.nmt) {
+    case NMT_ISO14443A:
+      *pszId = pnt->nti.nai.szUidLen;
+      return pnt->nti.nai.abtUid;
+    case NMT_FELICA:
+      *pszId = sizeof(pnt->nti.nfi.abtId);
+      return pnt->nti.nfi.abtId;
+    case NMT_ISO14443B:
+      *pszId = sizeof(pnt->nti.nbi.abtPupi);
+      return pnt->nti.nbi.abtPupi;
+    case NMT_ISO14443BI:
+      *pszId = sizeof(pnt->nti.nii.abtDIV);
+      return pnt->nti.nii.abtDIV;
+    case NMT_ISO14443B2SR:
+      *pszId = sizeof(pnt->nti.nsi.abtUID);
+      return pnt->nti.nsi.abtUID;
+    case NMT_ISO14443B2CT:
+      *pszId = sizeof(pnt->nti.nci.abtUID);
+      return pnt->nti.nci.abtUID;
+    case NMT_ISO14443BICLASS:
+      *pszId = sizeof(pnt->nti.nhi.abtUID);
+      return pnt->nti.nhi.abtUID;
+    case NMT_JEWEL:
+      *pszId = sizeof(pnt->nti.nji.btId);
+      return pnt->nti.nji.btId;
+    case NMT_DEP:
+      *pszId = sizeof(pnt->nti.ndi.abtNFCID3);
+      return pnt->nti.ndi.abtNFCID3;
+    case NMT_BARCODE:
+      *pszId = pnt->nti.nti.szDataLen;
+      return pnt->nti.nti.abtData;
+  }
+  *pszId = sizeof(pnt->nti);
+  return (const uint8_t *) &(pnt->nti);
+}
+
+static uint64_t
+nfc_target_key(const nfc_target *pnt)
+{
+  size_t szId;
+  const uint8_t *pbtId = nfc_target_id(pnt, &szId);
+  uint64_t ui64Key = 0xcbf29ce484222325ULL;
+  ui64Key = (ui64Key ^ (uint8_t) pnt->nm.nmt) * 0x100000001b3ULL;
+  for (size_t n = 0; n < szId; n++) {
+    ui64Key = (ui64Key ^ pbtId[n]) * 0x100000001b3ULL;
+  }
+  return ui64Key;
+}
+
+static bool
+nfc_target_seen(const nfc_target ant[], const uint64_t aui64Keys[], const size_t szTargets,
+                const nfc_target *pnt, const uint64_t ui64Key)
+{
+  size_t szId;
+  const uint8_t *pbtId = nfc_target_id(pnt, &szId);
+  for (size_t i = 0; i < szTargets; i++) {
+    if (aui64Keys[i] != ui64Key)
+      continue;
+    size_t szSeenId;
+    const uint8_t *pbtSeenId = nfc_target_id(&(ant[i]), &szSeenId);
+    if ((ant[i].nm.nmt == pnt->nm.nmt) && (szSeenId == szId) && (memcmp(pbtSeenId, pbtId, szId) == 0))
+      return true;
+  }
+  return false;
 }
 
 /** @ingroup initiator
@@ -612,7 +1132,6 @@ nfc_initiator_list_passive_targets(nfc_device *pnd,
                                    const nfc_modulation nm,
                                    nfc_target ant[], const size_t szTargets)
 {
-  nfc_target nt;
   size_t  szTargetFound = 0;
   uint8_t *pbtInitData = NULL;
   size_t  szInitDataLen = 0;
@@ -620,39 +1139,92 @@ nfc_initiator_list_passive_targets(nfc_device *pnd,
 
   pnd->last_error = 0;
 
+  uint64_t *pui64Keys = malloc(szTargets * sizeof(uint64_t));
+  if ((szTargets > 0) && (pui64Keys == NULL)) {
+    pnd->last_error = NFC_ESOFT;
+    return pnd->last_error;
+  }
+
   // Let the reader only try once to find a tag
   bool bInfiniteSelect = pnd->bInfiniteSelect;
   if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, false)) < 0) {
+    free(pui64Keys);
     return res;
   }
 
-  prepare_initiator_data(nm, &pbtInitData, &szInitDataLen);
+  prepare_initiator_list_data(nm, szTargets, &pbtInitData, &szInitDataLen);
 
-  while (nfc_initiator_select_passive_target(pnd, nm, pbtInitData, szInitDataLen, &nt) > 0) {
-    size_t i;
-    bool seen = false;
-    // Check if we've already seen this tag
-    for (i = 0; i < szTargetFound; i++) {
-      if (memcmp(&(ant[i]), &nt, sizeof(nfc_target)) == 0) {
-        seen = true;
-      }
+  // FeliCa cards can't be halted, they answer every polling in a random time slot
+  const bool bPolling = (nm.nmt == NMT_FELICA);
+  size_t szIdlePollings = 0;
+
+  while (szTargetFound < szTargets) {
+    // ST SRx tags are all listed by one slot inventory, other targets two at a time
+    const size_t szRound = (nm.nmt == NMT_ISO14443B2SR) ? (szTargets - szTargetFound) : MIN(szTargets - szTargetFound, 2);
+    bool bReleased = true;
+    res = NFC_ENOTIMPL;
+    if (pnd->driver->initiator_list_passive_targets) {
+      // Several targets per command, released by the driver
+      HAL_SCOPE(res = pnd->driver->initiator_list_passive_targets(pnd, nm, pbtInitData, szInitDataLen, ant + szTargetFound, szRound));
+    }
+    if (res == NFC_ENOTIMPL) {
+      res = nfc_initiator_select_passive_target(pnd, nm, pbtInitData, szInitDataLen, ant + szTargetFound);
+      bReleased = false;
     }
-    if (seen) {
+    if ((res < 0) || ((res == 0) && !bPolling)) {
       break;
     }
-    memcpy(&(ant[szTargetFound]), &nt, sizeof(nfc_target));
-    szTargetFound++;
+    // New targets are written after the known ones, which they are checked against
+    const size_t szRoundFirst = szTargetFound;
+    size_t n;
+    for (n = 0; n < (size_t) res; n++) {
+      nfc_target *pnt = &(ant[szRoundFirst + n]);
+      const uint64_t ui64Key = nfc_target_key(pnt);
+      // Check if we've already seen this tag
+      if (nfc_target_seen(ant, pui64Keys, szTargetFound, pnt, ui64Key)) {
+        if (bPolling) {
+          continue;
+        }
+        break;
+      }
+      if (pnt != &(ant[szTargetFound])) {
+        memcpy(&(ant[szTargetFound]), pnt, sizeof(nfc_target));
+      }
+      pui64Keys[szTargetFound] = ui64Key;
+      szTargetFound++;
+    }
     if (szTargets == szTargetFound) {
       break;
     }
-    nfc_initiator_deselect_target(pnd);
-    // deselect has no effect on FeliCa, Jewel and Thinfilm cards so we'll stop after one...
+    if (bPolling) {
+      // The chip reports two cards per polling at most: poll again until as many pollings
+      // in a row as cards found (two at least) bring no new one
+      szIdlePollings = (szTargetFound > szRoundFirst) ? 0 : (szIdlePollings + 1);
+      if (szIdlePollings >= MAX(szTargetFound, 2)) {
+        break;
+      }
+      continue;
+    }
+    if (n < (size_t) res) {
+      break;
+    }
+    if (bReleased) {
+      if ((size_t) res < szRound) {
+        // No other target answered
+        break;
+      }
+    } else {
+      nfc_initiator_deselect_target(pnd);
+    }
+    // deselect has no effect on Jewel and Thinfilm cards so we'll stop after one...
     // ISO/IEC 14443 B' cards are polled at 100% probability so it's not possible to detect correctly two cards at the same time
-    if ((nm.nmt == NMT_FELICA) || (nm.nmt == NMT_JEWEL) || (nm.nmt == NMT_BARCODE) ||
+    // ST SRx tags were all found by the first round, or only one can be seen without a slot inventory
+    if ((nm.nmt == NMT_JEWEL) || (nm.nmt == NMT_BARCODE) ||
         (nm.nmt == NMT_ISO14443BI) || (nm.nmt == NMT_ISO14443B2SR) || (nm.nmt == NMT_ISO14443B2CT)) {
       break;
     }
   }
+  free(pui64Keys);
   if (bInfiniteSelect) {
     if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, true)) < 0) {
       return res;
@@ -661,6 +1233,220 @@ nfc_initiator_list_passive_targets(nfc_device *pnd,
   return szTargetFound;
 }
 
+/** @ingroup initiator
+ * @brief Inventory ISO/IEC 14443A tags with the bit oriented anticollision
+ * @return Returns the number of targets found on success, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param nm desired modulation, only ISO/IEC 14443A at 106 kbps is supported
+ * @param[out] ant array of \a nfc_target that will be filled with targets info
+ * @param szTargets size of \a ant (will be the max targets listed)
+ * @param[out] pszRoundTrips number of frames exchanged with the tags, can be NULL
+ *
+ * Unlike nfc_initiator_list_passive_targets(), which lets the chip pick one
+ * tag per command, the SELECT/NVB anticollision tree is walked by libnfc itself
+ * with raw frames, splitting on each collided UID bit. Every tag found is
+ * halted (HLTA), so it keeps silent until the field is cycled or a WUPA is sent.
+ *
+ * @note The ATQA reported is the one answered by all the tags at once and ISO/IEC
+ * 14443-4 tags are not activated (no ATS).
+ */
+int
+nfc_initiator_inventory(nfc_device *pnd, const nfc_modulation nm,
+                        nfc_target ant[], const size_t szTargets, size_t *pszRoundTrips)
+{
+  HAL(initiator_inventory, pnd, nm, ant, szTargets, pszRoundTrips);
+}
+
+static int64_t
+nfc_poll_now_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Modulations sharing a framing and a baud rate are polled with the same chip settings
+static int
+nfc_poll_group(const nfc_modulation nm)
+{
+  int iFraming = 0;
+  switch (nm.nmt) {
+    case NMT_ISO14443A:
+    case NMT_JEWEL:
+    case NMT_BARCODE:
+      iFraming = 0;
+      break;
+    case NMT_ISO14443B:
+    case NMT_ISO14443BI:
+    case NMT_ISO14443B2SR:
+    case NMT_ISO14443B2CT:
+    case NMT_ISO14443BICLASS:
+      iFraming = 1;
+      break;
+    case NMT_FELICA:
+      iFraming = 2;
+      break;
+    case NMT_DEP:
+      iFraming = (nm.nbr == NBR_106) ? 0 : 2;
+      break;
+  }
+  return (iFraming << 4) | (int) nm.nbr;
+}
+
+static nfc_poll_stats *
+nfc_poll_stats_find(nfc_device *pnd, const nfc_modulation nm)
+{
+  struct nfc_poll_scheduler *ps = &pnd->poll;
+  for (size_t n = 0; n < ps->szStats; n++) {
+    if ((ps->stats[n].nm.nmt == nm.nmt) && (ps->stats[n].nm.nbr == nm.nbr))
+      return &(ps->stats[n]);
+  }
+  if (ps->szStats == NFC_POLL_MAX_MODULATIONS)
+    return NULL;
+  nfc_poll_stats *pst = &(ps->stats[ps->szStats++]);
+  memset(pst, 0, sizeof(*pst));
+  pst->nm = nm;
+  return pst;
+}
+
+// Hit rate and latency are moving averages over about the last eight attempts
+static void
+nfc_poll_stats_update(nfc_device *pnd, const nfc_modulation nm, const bool bHit, const int64_t i64Latency)
+{
+  nfc_poll_stats *pst = nfc_poll_stats_find(pnd, nm);
+  if (!pst)
+    return;
+  pst->uiAttempts++;
+  if (bHit)
+    pst->uiHits++;
+  const int64_t i64Rate = bHit ? 65536 : 0;
+  pst->uiHitRate = (uint32_t)((int64_t) pst->uiHitRate + (i64Rate - (int64_t) pst->uiHitRate) / 8);
+  if (i64Latency < 0)
+    return;
+  pst->uiLastLatency = (uint32_t) MIN(i64Latency, UINT32_MAX);
+  if (pst->uiAttempts == 1) {
+    pst->uiMeanLatency = pst->uiLastLatency;
+  } else {
+    pst->uiMeanLatency = (uint32_t)((int64_t) pst->uiMeanLatency + ((int64_t) pst->uiLastLatency - (int64_t) pst->uiMeanLatency) / 8);
+  }
+}
+
+/*
+ * Poll order: the groups of modulations sharing chip settings are taken as a
+ * whole, the one with the best recent hit rate first, and so are the
+ * modulations within a group. Ties keep the order given by the caller.
+ */
+static void
+nfc_poll_schedule(nfc_device *pnd, const nfc_modulation *pnmModulations, const size_t szModulations, nfc_modulation *pnmScheduled)
+{
+  size_t aszFirst[NFC_POLL_MAX_MODULATIONS];
+  uint32_t auiRate[NFC_POLL_MAX_MODULATIONS];
+  uint64_t aui64GroupRate[NFC_POLL_MAX_MODULATIONS];
+  size_t aszOrder[NFC_POLL_MAX_MODULATIONS];
+
+  for (size_t n = 0; n < szModulations; n++) {
+    const nfc_poll_stats *pst = nfc_poll_stats_find(pnd, pnmModulations[n]);
+    auiRate[n] = pst ? pst->uiHitRate : 0;
+    aszFirst[n] = n;
+    for (size_t i = 0; i < n; i++) {
+      if (nfc_poll_group(pnmModulations[i]) == nfc_poll_group(pnmModulations[n])) {
+        aszFirst[n] = aszFirst[i];
+        break;
+      }
+    }
+    aui64GroupRate[n] = 0;
+  }
+  for (size_t n = 0; n < szModulations; n++) {
+    aui64GroupRate[aszFirst[n]] += auiRate[n];
+  }
+  // Insertion sort, there are only a handful of modulations
+  for (size_t n = 0; n < szModulations; n++) {
+    size_t i = n;
+    while (i > 0) {
+      const size_t a = aszOrder[i - 1];
+      const uint64_t ui64GroupA = aui64GroupRate[aszFirst[a]];
+      const uint64_t ui64GroupN = aui64GroupRate[aszFirst[n]];
+      if ((ui64GroupA > ui64GroupN) ||
+          ((ui64GroupA == ui64GroupN) && (aszFirst[a] < aszFirst[n])) ||
+          ((aszFirst[a] == aszFirst[n]) && (auiRate[a] >= auiRate[n])))
+        break;
+      aszOrder[i] = a;
+      i--;
+    }
+    aszOrder[i] = n;
+  }
+  for (size_t n = 0; n < szModulations; n++) {
+    pnmScheduled[n] = pnmModulations[aszOrder[n]];
+  }
+}
+
+static int
+nfc_initiator_poll_target_soft(nfc_device *pnd,
+                               const nfc_modulation *pnmModulations, const size_t szModulations,
+                               const uint8_t uiPollNr, const uint8_t uiPeriod,
+                               nfc_target *pnt)
+{
+  nfc_modulation anmScheduled[NFC_POLL_MAX_MODULATIONS];
+  int res = 0;
+  int result = 0;
+
+  if (!pnd->driver->initiator_select_passive_target) {
+    pnd->last_error = NFC_EDEVNOTSUPP;
+    return pnd->last_error;
+  }
+  // Each modulation gets a single short attempt at a time, so that a target is
+  // found as soon as it enters the field whatever its modulation
+  bool bInfiniteSelect = pnd->bInfiniteSelect;
+  if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, false)) < 0)
+    return res;
+
+  // FIXME It does not support DEP targets
+  for (size_t p = 0; (uiPollNr == 0xff) || (p < uiPollNr); p++) {
+    // A polling lasts uiPeriod * 150 ms for each modulation, modulations are tried in turn all along,
+    // at most once per period each
+    const int64_t i64Period = (int64_t) uiPeriod * 150000;
+    const int64_t i64Deadline = nfc_poll_now_us() + (int64_t) szModulations * i64Period;
+    int64_t i64Now;
+    do {
+      const int64_t i64Due = MIN(nfc_poll_now_us() + i64Period, i64Deadline);
+      nfc_poll_schedule(pnd, pnmModulations, szModulations, anmScheduled);
+      for (size_t n = 0; n < szModulations; n++) {
+        uint8_t *pbtInitiatorData;
+        size_t szInitiatorData;
+        prepare_initiator_data(anmScheduled[n], &pbtInitiatorData, &szInitiatorData);
+
+        const int64_t i64Start = nfc_poll_now_us();
+        res = nfc_initiator_select_passive_target(pnd, anmScheduled[n], pbtInitiatorData, szInitiatorData, pnt);
+        // A garbled answer, e.g. from colliding targets, does not end the polling
+        if ((res < 0) && (res != NFC_ETIMEOUT) && (res != NFC_ERFTRANS)) {
+          result = res;
+          goto end;
+        }
+        nfc_poll_stats_update(pnd, anmScheduled[n], res > 0, nfc_poll_now_us() - i64Start);
+        if (res > 0) {
+          result = res;
+          goto end;
+        }
+      }
+      // Chips which give up at once (no target, simulated ones) would otherwise spin
+      if ((i64Now = nfc_poll_now_us()) < i64Due) {
+        const struct timespec ts = { .tv_sec = (i64Due - i64Now) / 1000000, .tv_nsec = ((i64Due - i64Now) % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+        i64Now = i64Due;
+      }
+    } while (i64Now < i64Deadline);
+  }
+  // We reach this point when each polling gives no result, we simply have to return 0
+end:
+  if (bInfiniteSelect) {
+    if ((res = nfc_device_set_property_bool(pnd, NP_INFINITE_SELECT, true)) < 0)
+      return res;
+  }
+  pnd->last_error = (result < 0) ? result : NFC_SUCCESS;
+  return result;
+}
+
 /** @ingroup initiator
  * @brief Polling for NFC targets
  * @return Returns polled targets count, otherwise returns libnfc's error code (negative value).
@@ -673,6 +1459,13 @@ nfc_initiator_list_passive_targets(nfc_device *pnd,
  * @param uiPeriod indicates the polling period in units of 150 ms (0x01 – 0x0F: 150ms – 2.25s)
  * @note e.g. if uiPeriod=10, it will poll each desired target type during 1.5s
  * @param[out] pnt pointer on \a nfc_target (over)writable struct
+ *
+ * Modulations are not polled in the given order: those which recently found
+ * targets on this device come first, and modulations sharing the same chip
+ * settings are polled one after the other. Devices which can't poll by
+ * themselves (e.g. PN531, PN533) are polled by libnfc, which tries each
+ * modulation in turn during the whole polling period and records its hit rate
+ * and latency, see nfc_initiator_poll_stats().
  */
 int
 nfc_initiator_poll_target(nfc_device *pnd,
@@ -680,9 +1473,47 @@ nfc_initiator_poll_target(nfc_device *pnd,
                           const uint8_t uiPollNr, const uint8_t uiPeriod,
                           nfc_target *pnt)
 {
-  HAL(initiator_poll_target, pnd, pnmModulations, szModulations, uiPollNr, uiPeriod, pnt);
+  nfc_modulation anmScheduled[NFC_POLL_MAX_MODULATIONS];
+
+  pnd->last_error = 0;
+  if ((szModulations == 0) || (szModulations > NFC_POLL_MAX_MODULATIONS)) {
+    pnd->last_error = NFC_EINVARG;
+    return pnd->last_error;
+  }
+  nfc_poll_schedule(pnd, pnmModulations, szModulations, anmScheduled);
+  if (pnd->driver->initiator_poll_target) {
+    int res;
+    HAL_SCOPE(res = pnd->driver->initiator_poll_target(pnd, anmScheduled, szModulations, uiPollNr, uiPeriod, pnt));
+    if (res != NFC_EDEVNOTSUPP) {
+      // The chip polls by itself, only the hit is known
+      if (res > 0)
+        nfc_poll_stats_update(pnd, pnt->nm, true, -1);
+      return res;
+    }
+  }
+  return nfc_initiator_poll_target_soft(pnd, pnmModulations, szModulations, uiPollNr, uiPeriod, pnt);
 }
 
+/** @ingroup initiator
+ * @brief Get the polling statistics of the modulations polled on this device
+ * @return Returns the number of modulations polled so far, which may exceed \a szStats, otherwise returns libnfc's error code (negative value)
+ *
+ * @param pnd \a nfc_device struct pointer that represent currently used device
+ * @param[out] stats array of \a nfc_poll_stats that will be filled, can be NULL
+ * @param szStats size of \a stats
+ *
+ * Statistics are kept by nfc_initiator_poll_target() for the lifetime of the
+ * device. Latencies are only measured when libnfc polls by itself.
+ */
+int
+nfc_initiator_poll_stats(nfc_device *pnd, nfc_poll_stats stats[], const size_t szStats)
+{
+  pnd->last_error = 0;
+  if (stats) {
+    memcpy(stats, pnd->poll.stats, MIN(szStats, pnd->poll.szStats) * sizeof(nfc_poll_stats));
+  }
+  return (int) pnd->poll.szStats;
+}
 
 /** @ingroup initiator
  * @brief Select a target and request active or passive mode for D.E.P. (Data Exchange Protocol)
@@ -1279,7 +2110,7 @@ nfc_device_get_supported_baud_rate_target_mode(nfc_device *pnd, const nfc_modula
  * @param nm \a nfc_modulation.
  *
  */
-static int
+int
 nfc_device_validate_modulation(nfc_device *pnd, const nfc_mode mode, const nfc_modulation *nm)
 {
   int res;
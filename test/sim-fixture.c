@@ -0,0 +1,26 @@
+#include <cutter.h>
+
+#include "sim-fixture.h"
+
+void
+sim_fixture_setup(const char *connstring, nfc_context **pcontext, nfc_device **pdevice, struct pn53x_sim **psim)
+{
+  *pdevice = NULL;
+  *psim = NULL;
+  nfc_init(pcontext);
+  cut_assert_not_null(*pcontext, cut_message("nfc_init"));
+  *pdevice = nfc_open(*pcontext, connstring);
+  if (!*pdevice)
+    cut_omit("pn53x_sim driver not available");
+  *psim = pn53x_sim_device_get(*pdevice);
+  cut_assert_not_null(*psim, cut_message("pn53x_sim_device_get"));
+  cut_assert_equal_int(0, nfc_initiator_init(*pdevice), cut_message("nfc_initiator_init"));
+}
+
+void
+sim_fixture_teardown(nfc_context *context, nfc_device *device)
+{
+  if (device)
+    nfc_close(device);
+  nfc_exit(context);
+}
@@ -0,0 +1,14 @@
+#ifndef _TEST_SIM_FIXTURE_H_
+#  define _TEST_SIM_FIXTURE_H_
+
+#include <nfc/nfc.h>
+#include "drivers/pn53x_sim.h"
+
+/*
+ * Opens a simulated reader as an initiator for each test. Outputs are set
+ * before the test may be omitted, so teardown always sees the current ones.
+ */
+void sim_fixture_setup(const char *connstring, nfc_context **pcontext, nfc_device **pdevice, struct pn53x_sim **psim);
+void sim_fixture_teardown(nfc_context *context, nfc_device *device);
+
+#endif // _TEST_SIM_FIXTURE_H_
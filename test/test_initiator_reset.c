@@ -0,0 +1,127 @@
+#include <cutter.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include "chips/pn53x.h"
+#include "drivers/pn53x_sim.h"
+#include "sim-fixture.h"
+
+/*
+ * A repeated nfc_initiator_init() and nfc_initiator_reset() only send to the
+ * (simulated) chip the initiator settings which are not in effect anymore.
+ */
+void test_initiator_reset_warm_init(void);
+void test_initiator_reset_warm(void);
+void test_initiator_reset_raw(void);
+void test_initiator_reset_crypto1(void);
+
+static nfc_context *context;
+static nfc_device *device;
+static struct pn53x_sim *sim;
+
+static const nfc_modulation nmMifare = {
+  .nmt = NMT_ISO14443A,
+  .nbr = NBR_106,
+};
+
+// Any command flushes register writes left pending
+static void
+flush(void)
+{
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_ACTIVATE_FIELD, true), cut_message("NP_ACTIVATE_FIELD"));
+}
+
+static void
+select_tag(nfc_target *pnt)
+{
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(device, nmMifare, NULL, 0, pnt), cut_message("nfc_initiator_select_passive_target"));
+}
+
+static void
+assert_initiator_settings(void)
+{
+  cut_assert_true(sim->abtRegisters[PN53X_REG_CIU_Control] & SYMBOL_INITIATOR, cut_message("initiator"));
+  cut_assert_true(sim->abtRegisters[PN53X_REG_CIU_TxMode] & SYMBOL_TX_CRC_ENABLE, cut_message("TX CRC"));
+  cut_assert_true(sim->abtRegisters[PN53X_REG_CIU_RxMode] & SYMBOL_RX_CRC_ENABLE, cut_message("RX CRC"));
+  cut_assert_false(sim->abtRegisters[PN53X_REG_CIU_RxMode] & SYMBOL_RX_NO_ERROR, cut_message("RX no error"));
+  cut_assert_false(sim->abtRegisters[PN53X_REG_CIU_ManualRCV] & SYMBOL_PARITY_DISABLE, cut_message("parity"));
+  cut_assert_false(sim->abtRegisters[PN53X_REG_CIU_Status2] & SYMBOL_MF_CRYPTO1_ON, cut_message("Crypto1"));
+}
+
+void
+cut_setup(void)
+{
+  sim_fixture_setup("pn53x_sim:pn532:mfc1k", &context, &device, &sim);
+  flush();
+}
+
+void
+cut_teardown(void)
+{
+  sim_fixture_teardown(context, device);
+}
+
+void
+test_initiator_reset_warm_init(void)
+{
+  nfc_target nt;
+
+  select_tag(&nt);
+  cut_assert_true(nfc_initiator_deselect_target(device) >= 0, cut_message("nfc_initiator_deselect_target"));
+
+  // Selecting a tag leaves the initiator settings in effect, only the field is cycled
+  const uint64_t count = sim->command_count;
+  cut_assert_equal_int(0, nfc_initiator_init(device), cut_message("nfc_initiator_init"));
+  cut_assert_equal_int(count + 2, sim->command_count, cut_message("field off and on"));
+  flush();
+  cut_assert_equal_int(count + 3, sim->command_count, cut_message("nothing pending"));
+  assert_initiator_settings();
+  select_tag(&nt);
+}
+
+void
+test_initiator_reset_warm(void)
+{
+  const uint64_t count = sim->command_count;
+
+  cut_assert_equal_int(0, nfc_initiator_reset(device), cut_message("nfc_initiator_reset"));
+  flush();
+  cut_assert_equal_int(count + 1, sim->command_count, cut_message("nothing to send"));
+  cut_assert_true(sim->field, cut_message("field left on"));
+}
+
+void
+test_initiator_reset_raw(void)
+{
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_HANDLE_CRC, false), cut_message("NP_HANDLE_CRC"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_HANDLE_PARITY, false), cut_message("NP_HANDLE_PARITY"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_ACCEPT_INVALID_FRAMES, true), cut_message("NP_ACCEPT_INVALID_FRAMES"));
+  flush();
+
+  const uint64_t count = sim->command_count;
+  cut_assert_equal_int(0, nfc_initiator_reset(device), cut_message("nfc_initiator_reset"));
+  flush();
+  // At most one ReadRegister and one WriteRegister, no field cycle
+  cut_assert_true(sim->command_count <= count + 3, cut_message("one or two frames"));
+  cut_assert_true(sim->field, cut_message("field left on"));
+  assert_initiator_settings();
+}
+
+void
+test_initiator_reset_crypto1(void)
+{
+  nfc_target nt;
+  uint8_t abtAuth[12] = { 0x60, 0x04, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+  select_tag(&nt);
+  memcpy(abtAuth + 8, nt.nti.nai.abtUid, 4);
+  cut_assert_equal_int(0, nfc_initiator_transceive_bytes(device, abtAuth, sizeof(abtAuth), NULL, 0, -1), cut_message("AUTH"));
+  cut_assert_true(sim->abtRegisters[PN53X_REG_CIU_Status2] & SYMBOL_MF_CRYPTO1_ON, cut_message("Crypto1 on"));
+
+  // Only Crypto1 has to be switched off again
+  const uint64_t count = sim->command_count;
+  cut_assert_equal_int(0, nfc_initiator_reset(device), cut_message("nfc_initiator_reset"));
+  flush();
+  cut_assert_equal_int(count + 2, sim->command_count, cut_message("one WriteRegister"));
+  assert_initiator_settings();
+}
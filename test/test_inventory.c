@@ -0,0 +1,96 @@
+#include <cutter.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include "drivers/pn53x_sim.h"
+#include "sim-fixture.h"
+
+#define TAG_COUNT 24
+
+/*
+ * nfc_initiator_inventory() walks the ISO/IEC 14443A anticollision tree of a
+ * dense stack of (simulated) tags with single and double size UIDs.
+ */
+void test_inventory_all(void);
+void test_inventory_limit(void);
+void test_inventory_modulation(void);
+
+static nfc_context *context;
+static nfc_device *device;
+static struct pn53x_sim *sim;
+
+static const nfc_modulation nmMifare = {
+  .nmt = NMT_ISO14443A,
+  .nbr = NBR_106,
+};
+
+void
+cut_setup(void)
+{
+  nfc_connstring connstring = "pn53x_sim:pn532:";
+
+  for (size_t n = 0; n < TAG_COUNT; n++) {
+    strcat(connstring, (n % 3 == 0) ? "mful," : ((n % 4 == 1) ? "iso14443-4," : "mfc1k,"));
+  }
+  sim_fixture_setup(connstring, &context, &device, &sim);
+  cut_assert_equal_int(TAG_COUNT, (int) sim->tag_count, cut_message("tags in the field"));
+}
+
+void
+cut_teardown(void)
+{
+  sim_fixture_teardown(context, device);
+}
+
+void
+test_inventory_all(void)
+{
+  nfc_target ant[TAG_COUNT + 1];
+  nfc_target nt;
+  size_t szRoundTrips = 0;
+
+  cut_assert_equal_int(TAG_COUNT, nfc_initiator_inventory(device, nmMifare, ant, TAG_COUNT + 1, &szRoundTrips), cut_message("nfc_initiator_inventory"));
+  cut_assert_true(szRoundTrips > TAG_COUNT, cut_message("round trips"));
+
+  // Each simulated tag is found exactly once, with its SAK
+  for (size_t n = 0; n < TAG_COUNT; n++) {
+    const nfc_iso14443a_info *pnai = &(sim->tags[n]->target.nti.nai);
+    size_t szMatches = 0;
+    for (size_t i = 0; i < TAG_COUNT; i++) {
+      if ((ant[i].nti.nai.szUidLen == pnai->szUidLen) && (memcmp(ant[i].nti.nai.abtUid, pnai->abtUid, pnai->szUidLen) == 0)) {
+        cut_assert_equal_int(pnai->btSak, ant[i].nti.nai.btSak, cut_message("SAK of tag %d", (int) n));
+        szMatches++;
+      }
+    }
+    cut_assert_equal_int(1, (int) szMatches, cut_message("tag %d", (int) n));
+  }
+
+  // All the tags are halted, the usual settings are back
+  cut_assert_equal_int(0, nfc_initiator_list_passive_targets(device, nmMifare, &nt, 1), cut_message("halted tags"));
+  cut_assert_equal_int(0, nfc_initiator_init(device), cut_message("nfc_initiator_init"));
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(device, nmMifare, NULL, 0, &nt), cut_message("select after a field cycle"));
+}
+
+void
+test_inventory_limit(void)
+{
+  nfc_target ant[3];
+  nfc_target nt;
+
+  cut_assert_equal_int(3, nfc_initiator_inventory(device, nmMifare, ant, 3, NULL), cut_message("nfc_initiator_inventory"));
+  cut_assert_not_equal_memory(ant[0].nti.nai.abtUid, ant[0].nti.nai.szUidLen, ant[1].nti.nai.abtUid, ant[1].nti.nai.szUidLen, cut_message("distinct tags"));
+  // The tags left are still there
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(device, nmMifare, NULL, 0, &nt), cut_message("remaining tags"));
+}
+
+void
+test_inventory_modulation(void)
+{
+  nfc_target ant[2];
+  const nfc_modulation nmFelica = {
+    .nmt = NMT_FELICA,
+    .nbr = NBR_212,
+  };
+
+  cut_assert_equal_int(NFC_EINVARG, nfc_initiator_inventory(device, nmFelica, ant, 2, NULL), cut_message("FeliCa"));
+}
@@ -0,0 +1,95 @@
+#include <cutter.h>
+
+#include <nfc/nfc.h>
+
+void test_iso14443_crc_vectors(void);
+void test_iso14443_crc_lengths(void);
+void test_iso14443_crc_incremental(void);
+
+/* Bit-by-bit reference, as libnfc used to compute it */
+static uint16_t
+reference_crc(uint16_t wCrc, const uint8_t *pbtData, size_t szLen)
+{
+  while (szLen--) {
+    uint8_t bt = *pbtData++;
+    bt = (bt ^ (uint8_t)(wCrc & 0x00FF));
+    bt = (bt ^ (bt << 4));
+    wCrc = (wCrc >> 8) ^ ((uint16_t) bt << 8) ^ ((uint16_t) bt << 3) ^ ((uint16_t) bt >> 4);
+  }
+  return wCrc;
+}
+
+void
+test_iso14443_crc_vectors(void)
+{
+  uint8_t abtCrc[2];
+
+  /* ISO/IEC 14443-3 Annex B examples */
+  uint8_t abtA1[] = { 0x00, 0x00 };
+  iso14443a_crc(abtA1, sizeof(abtA1), abtCrc);
+  cut_assert_equal_memory("\xa0\x1e", 2, abtCrc, 2, cut_message("CRC_A 00 00"));
+
+  uint8_t abtA2[] = { 0x12, 0x34 };
+  iso14443a_crc(abtA2, sizeof(abtA2), abtCrc);
+  cut_assert_equal_memory("\x26\xcf", 2, abtCrc, 2, cut_message("CRC_A 12 34"));
+
+  uint8_t abtB1[] = { 0x00, 0x00, 0x00 };
+  iso14443b_crc(abtB1, sizeof(abtB1), abtCrc);
+  cut_assert_equal_memory("\xcc\xc6", 2, abtCrc, 2, cut_message("CRC_B 00 00 00"));
+
+  uint8_t abtB2[] = { 0x0f, 0xaa, 0xff };
+  iso14443b_crc(abtB2, sizeof(abtB2), abtCrc);
+  cut_assert_equal_memory("\xfc\xd1", 2, abtCrc, 2, cut_message("CRC_B 0f aa ff"));
+
+  uint8_t abtB3[] = { 0x0a, 0x12, 0x34, 0x56 };
+  iso14443b_crc(abtB3, sizeof(abtB3), abtCrc);
+  cut_assert_equal_memory("\x2c\xf6", 2, abtCrc, 2, cut_message("CRC_B 0a 12 34 56"));
+}
+
+void
+test_iso14443_crc_lengths(void)
+{
+  uint8_t abtData[300];
+  uint8_t abtCrc[2];
+
+  for (size_t n = 0; n < sizeof(abtData); n++)
+    abtData[n] = (uint8_t)(n * 0x3b + 0x11);
+
+  for (size_t szLen = 1; szLen <= sizeof(abtData); szLen++) {
+    uint16_t wCrc = reference_crc(0x6363, abtData, szLen);
+    iso14443a_crc(abtData, szLen, abtCrc);
+    cut_assert_equal_uint(wCrc, abtCrc[0] | (abtCrc[1] << 8), cut_message("CRC_A, %zu bytes", szLen));
+
+    wCrc = ~reference_crc(0xFFFF, abtData, szLen);
+    iso14443b_crc(abtData, szLen, abtCrc);
+    cut_assert_equal_uint(wCrc, abtCrc[0] | (abtCrc[1] << 8), cut_message("CRC_B, %zu bytes", szLen));
+  }
+}
+
+void
+test_iso14443_crc_incremental(void)
+{
+  uint8_t abtData[64];
+  uint8_t abtCrc[2], abtExpected[2];
+
+  for (size_t n = 0; n < sizeof(abtData); n++)
+    abtData[n] = (uint8_t)(n * 0x9d);
+
+  iso14443a_crc(abtData, sizeof(abtData), abtExpected);
+  for (size_t szSplit = 0; szSplit <= sizeof(abtData); szSplit++) {
+    uint16_t wCrc = iso14443a_crc_init();
+    wCrc = iso14443a_crc_update(wCrc, abtData, szSplit);
+    wCrc = iso14443a_crc_update(wCrc, abtData + szSplit, sizeof(abtData) - szSplit);
+    iso14443a_crc_final(wCrc, abtCrc);
+    cut_assert_equal_memory(abtExpected, 2, abtCrc, 2, cut_message("CRC_A split at %zu", szSplit));
+  }
+
+  iso14443b_crc(abtData, sizeof(abtData), abtExpected);
+  for (size_t szSplit = 0; szSplit <= sizeof(abtData); szSplit++) {
+    uint16_t wCrc = iso14443b_crc_init();
+    wCrc = iso14443b_crc_update(wCrc, abtData, szSplit);
+    wCrc = iso14443b_crc_update(wCrc, abtData + szSplit, sizeof(abtData) - szSplit);
+    iso14443b_crc_final(wCrc, abtCrc);
+    cut_assert_equal_memory(abtExpected, 2, abtCrc, 2, cut_message("CRC_B split at %zu", szSplit));
+  }
+}
@@ -0,0 +1,97 @@
+#include <cutter.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nfc/nfc.h>
+#include "nfc-internal.h"
+
+/*
+ * nfc_list_devices() scans drivers in parallel, except intrusive ones which
+ * share their ports and are scanned one after the other, and lists devices in
+ * driver order.
+ */
+void test_list_devices_intrusive(void);
+
+static nfc_context *context;
+
+// Number of intrusive scans running, and the most seen at once
+static int busy;
+static int busy_max;
+
+static size_t
+scan(const char *connstring, const bool intrusive, nfc_connstring connstrings[], const size_t connstrings_len)
+{
+  if (intrusive) {
+    const int n = __atomic_add_fetch(&busy, 1, __ATOMIC_SEQ_CST);
+    int max = __atomic_load_n(&busy_max, __ATOMIC_SEQ_CST);
+    while ((n > max) && !__atomic_compare_exchange_n(&busy_max, &max, n, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+      ;
+  }
+  usleep(20000);
+  if (intrusive)
+    __atomic_sub_fetch(&busy, 1, __ATOMIC_SEQ_CST);
+  if (connstrings_len < 1)
+    return 0;
+  strcpy(connstrings[0], connstring);
+  return 1;
+}
+
+static size_t
+scan_uart1(const nfc_context *ctx, nfc_connstring connstrings[], const size_t connstrings_len)
+{
+  (void) ctx;
+  return scan("uart1:0", true, connstrings, connstrings_len);
+}
+
+static size_t
+scan_uart2(const nfc_context *ctx, nfc_connstring connstrings[], const size_t connstrings_len)
+{
+  (void) ctx;
+  return scan("uart2:0", true, connstrings, connstrings_len);
+}
+
+static size_t
+scan_usb(const nfc_context *ctx, nfc_connstring connstrings[], const size_t connstrings_len)
+{
+  (void) ctx;
+  return scan("usb1:0", false, connstrings, connstrings_len);
+}
+
+static const struct nfc_driver uart1_driver = { .name = "uart1", .scan_type = INTRUSIVE, .scan = scan_uart1 };
+static const struct nfc_driver uart2_driver = { .name = "uart2", .scan_type = INTRUSIVE, .scan = scan_uart2 };
+static const struct nfc_driver usb_driver = { .name = "usb1", .scan_type = NOT_INTRUSIVE, .scan = scan_usb };
+
+void
+cut_setup(void)
+{
+  nfc_init(&context);
+  cut_assert_not_null(context, cut_message("nfc_init"));
+  busy = 0;
+  busy_max = 0;
+}
+
+void
+cut_teardown(void)
+{
+  nfc_exit(context);
+}
+
+void
+test_list_devices_intrusive(void)
+{
+  nfc_connstring connstrings[16];
+
+  // Registered drivers are searched last registered first
+  cut_assert_equal_int(NFC_SUCCESS, nfc_register_driver(&uart2_driver), cut_message("uart2"));
+  cut_assert_equal_int(NFC_SUCCESS, nfc_register_driver(&usb_driver), cut_message("usb1"));
+  cut_assert_equal_int(NFC_SUCCESS, nfc_register_driver(&uart1_driver), cut_message("uart1"));
+  context->allow_intrusive_scan = true;
+  context->scan_timeout = 0;
+
+  const size_t sz = nfc_list_devices(context, connstrings, 16);
+  cut_assert_true(sz >= 3, cut_message("devices"));
+  cut_assert_equal_string("uart1:0", connstrings[0], cut_message("first device"));
+  cut_assert_equal_string("usb1:0", connstrings[1], cut_message("second device"));
+  cut_assert_equal_string("uart2:0", connstrings[2], cut_message("third device"));
+  cut_assert_equal_int(1, busy_max, cut_message("intrusive scans overlapped"));
+}
@@ -0,0 +1,100 @@
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cutter.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <nfc/nfc.h>
+#include "nfc-internal.h"
+#include "log.h"
+
+/*
+ * Each context keeps its own log level: it applies to the threads working for
+ * it and does not clobber the default level of the process.
+ */
+void test_log_level_contexts(void);
+void test_log_level_scope(void);
+void test_log_level_threads(void);
+
+void
+cut_setup(void)
+{
+#ifndef LOG
+  cut_omit("libnfc built without log");
+#endif
+}
+
+void
+test_log_level_contexts(void)
+{
+  nfc_context *context1;
+  nfc_context *context2;
+
+  setenv("LIBNFC_LOG_LEVEL", "1", 1);
+  nfc_init(&context1);
+  cut_assert_not_null(context1, cut_message("nfc_init"));
+  const uint32_t level = log_get_level();
+
+  setenv("LIBNFC_LOG_LEVEL", "3", 1);
+  nfc_init(&context2);
+  unsetenv("LIBNFC_LOG_LEVEL");
+  cut_assert_not_null(context2, cut_message("nfc_init"));
+  cut_assert_equal_uint(3, context2->log_level, cut_message("second context level"));
+  cut_assert_equal_uint(level, log_get_level(), cut_message("default level kept"));
+
+  struct log_scope scope;
+  log_scope_enter(&scope, context2->log_level, false);
+  cut_assert_equal_uint(3, log_get_level(), cut_message("second context scope"));
+  log_scope_leave(&scope);
+  cut_assert_equal_uint(level, log_get_level(), cut_message("scope left"));
+
+  nfc_exit(context2);
+  nfc_exit(context1);
+}
+
+void
+test_log_level_scope(void)
+{
+  const uint32_t level = log_get_level();
+  struct log_scope outer;
+  struct log_scope inner;
+
+  // An enclosing scope wins over a nested one, unless the nested one is forced
+  log_scope_enter(&outer, 0, false);
+  log_scope_enter(&inner, 3, false);
+  cut_assert_equal_uint(0, log_get_level(), cut_message("enclosing level kept"));
+  log_scope_leave(&inner);
+  log_scope_enter(&inner, 3, true);
+  cut_assert_equal_uint(3, log_get_level(), cut_message("forced level"));
+  log_scope_leave(&inner);
+  cut_assert_equal_uint(0, log_get_level(), cut_message("forced scope left"));
+  log_scope_leave(&outer);
+  cut_assert_equal_uint(level, log_get_level(), cut_message("default level"));
+}
+
+static void *
+scope_thread(void *arg)
+{
+  uint32_t *plevel = arg;
+  struct log_scope scope;
+
+  log_scope_enter(&scope, 0, true);
+  *plevel = log_get_level();
+  // The scope is not left: it dies with the thread
+  return NULL;
+}
+
+void
+test_log_level_threads(void)
+{
+  const uint32_t level = log_get_level();
+  uint32_t thread_level = 0xffffffff;
+  pthread_t thread;
+
+  cut_assert_equal_int(0, pthread_create(&thread, NULL, scope_thread, &thread_level), cut_message("pthread_create"));
+  pthread_join(thread, NULL);
+  cut_assert_equal_uint(0, thread_level, cut_message("thread level"));
+  cut_assert_equal_uint(level, log_get_level(), cut_message("other threads level"));
+}
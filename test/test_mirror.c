@@ -0,0 +1,58 @@
+#include <cutter.h>
+
+#include <string.h>
+
+#include "mirror-subr.h"
+
+void test_mirror_bytes(void);
+void test_mirror_words(void);
+
+static uint8_t
+ref_mirror(uint8_t bt)
+{
+  uint8_t btMirror = 0;
+  for (int n = 0; n < 8; n++) {
+    btMirror = (btMirror << 1) | ((bt >> n) & 0x01);
+  }
+  return btMirror;
+}
+
+void
+test_mirror_bytes(void)
+{
+  uint8_t abtSrc[300 + 3], abtDst[300 + 3], abtExpected[300];
+
+  for (size_t n = 0; n < sizeof(abtSrc); n++)
+    abtSrc[n] = (uint8_t)(n * 0x3b + 0x11);
+
+  /* Every length and a few misalignments, so every kernel and tail is used */
+  for (size_t szOffset = 0; szOffset < 4; szOffset++) {
+    for (size_t szLen = 0; szLen <= 300; szLen++) {
+      for (size_t n = 0; n < szLen; n++)
+        abtExpected[n] = ref_mirror(abtSrc[szOffset + n]);
+
+      memset(abtDst, 0x5a, sizeof(abtDst));
+      mirror_bytes(abtDst + szOffset, abtSrc + szOffset, szLen);
+      cut_assert_equal_memory(abtExpected, szLen, abtDst + szOffset, szLen,
+                              cut_message("mirror_bytes, %zu bytes at offset %zu", szLen, szOffset));
+      if (szOffset + szLen < sizeof(abtDst))
+        cut_assert_equal_int(0x5a, abtDst[szOffset + szLen], cut_message("overrun, %zu bytes", szLen));
+
+      /* In place */
+      memcpy(abtDst, abtSrc, sizeof(abtSrc));
+      mirror_bytes(abtDst + szOffset, abtDst + szOffset, szLen);
+      cut_assert_equal_memory(abtExpected, szLen, abtDst + szOffset, szLen,
+                              cut_message("mirror_bytes in place, %zu bytes at offset %zu", szLen, szOffset));
+    }
+  }
+}
+
+void
+test_mirror_words(void)
+{
+  for (unsigned n = 0; n < 256; n++)
+    cut_assert_equal_uint(ref_mirror(n), mirror(n), cut_message("mirror(%u)", n));
+
+  cut_assert_equal_uint(0x8040c020, mirror32(0x01020304), cut_message("mirror32"));
+  cut_assert_true(mirror64(0x0102030405060708ULL) == 0x8040c020a060e010ULL, cut_message("mirror64"));
+}
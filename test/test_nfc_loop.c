@@ -0,0 +1,225 @@
+#include <cutter.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#define DEVICE_COUNT 3
+
+static const nfc_connstring connstring = "pn53x_sim:pn532:mful";
+
+/*
+ * Drives several simulated PN53x from a single nfc_loop, and through
+ * asynchronous operations with completion callbacks.
+ */
+void test_nfc_loop_initiator(void);
+void test_nfc_loop_busy(void);
+void test_nfc_async_callback(void);
+void test_nfc_async_cancel(void);
+
+static nfc_context *context;
+static nfc_device *devices[DEVICE_COUNT];
+static nfc_loop *loop;
+
+void
+cut_setup(void)
+{
+  nfc_init(&context);
+  cut_assert_not_null(context, cut_message("nfc_init"));
+  loop = nfc_loop_new(context);
+  if (!loop)
+    cut_omit("event loop not available");
+  for (size_t i = 0; i < DEVICE_COUNT; i++) {
+    devices[i] = nfc_open(context, connstring);
+    if (!devices[i])
+      cut_omit("pn53x_sim driver not available");
+    cut_assert_equal_int(0, nfc_initiator_init(devices[i]), cut_message("nfc_initiator_init"));
+    cut_assert_equal_int(0, nfc_loop_add_device(loop, devices[i]), cut_message("nfc_loop_add_device"));
+  }
+}
+
+void
+cut_teardown(void)
+{
+  nfc_loop_free(loop);
+  for (size_t i = 0; i < DEVICE_COUNT; i++) {
+    if (devices[i])
+      nfc_close(devices[i]);
+    devices[i] = NULL;
+  }
+  nfc_exit(context);
+}
+
+static size_t
+device_index(const nfc_device *pnd)
+{
+  for (size_t i = 0; i < DEVICE_COUNT; i++) {
+    if (devices[i] == pnd)
+      return i;
+  }
+  cut_fail("completion for an unknown device");
+  return 0;
+}
+
+void
+test_nfc_loop_initiator(void)
+{
+  nfc_loop_completion completions[DEVICE_COUNT];
+  nfc_target ant[DEVICE_COUNT];
+  uint8_t abtRx[DEVICE_COUNT][64];
+  bool done[DEVICE_COUNT] = { false };
+  int res;
+
+  // Nothing in flight
+  res = nfc_loop_run(loop, completions, DEVICE_COUNT, -1);
+  cut_assert_equal_int(0, res, cut_message("idle loop"));
+
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  for (size_t i = 0; i < DEVICE_COUNT; i++) {
+    res = nfc_loop_initiator_select_passive_target(loop, devices[i], nm, NULL, 0, &ant[i], -1, &ant[i]);
+    cut_assert_equal_int(0, res, cut_message("submit select"));
+  }
+  for (size_t n = 0; n < DEVICE_COUNT;) {
+    // Room for a single completion, so the loop must keep the others pending
+    res = nfc_loop_run(loop, completions, 1, -1);
+    cut_assert_equal_int(1, res, cut_message("nfc_loop_run"));
+    const size_t i = device_index(completions[0].pnd);
+    cut_assert_false(done[i], cut_message("completed once"));
+    done[i] = true;
+    cut_assert_equal_int(NLO_INITIATOR_SELECT_PASSIVE_TARGET, completions[0].op);
+    cut_assert_equal_int(1, completions[0].res, cut_message("select"));
+    cut_assert_equal_pointer(&ant[i], completions[0].user_data);
+    cut_assert_equal_uint(7, ant[i].nti.nai.szUidLen, cut_message("Ultralight UID size"));
+    n++;
+  }
+
+  const uint8_t abtRead[2] = { 0x30, 0x00 };
+  for (size_t i = 0; i < DEVICE_COUNT; i++) {
+    res = nfc_loop_initiator_transceive_bytes(loop, devices[i], abtRead, sizeof(abtRead), abtRx[i], sizeof(abtRx[i]), -1, NULL);
+    cut_assert_equal_int(0, res, cut_message("submit read"));
+  }
+  size_t n = 0;
+  while ((res = nfc_loop_run(loop, completions, DEVICE_COUNT, 1000)) > 0) {
+    for (int j = 0; j < res; j++) {
+      const size_t i = device_index(completions[j].pnd);
+      cut_assert_equal_int(NLO_INITIATOR_TRANSCEIVE_BYTES, completions[j].op);
+      cut_assert_equal_int(16, completions[j].res, cut_message("read"));
+      // The UID starts the first page
+      cut_assert_equal_memory(ant[i].nti.nai.abtUid, 3, abtRx[i], 3, cut_message("UID read back"));
+    }
+    n += res;
+  }
+  cut_assert_equal_int(0, res, cut_message("nfc_loop_run"));
+  cut_assert_equal_uint(DEVICE_COUNT, n, cut_message("reads completed"));
+}
+
+void
+test_nfc_loop_busy(void)
+{
+  nfc_loop_completion completion;
+  nfc_target nt;
+  int res;
+
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  res = nfc_loop_initiator_select_passive_target(loop, devices[0], nm, NULL, 0, &nt, -1, NULL);
+  cut_assert_equal_int(0, res, cut_message("submit select"));
+  res = nfc_loop_initiator_select_passive_target(loop, devices[0], nm, NULL, 0, &nt, -1, NULL);
+  cut_assert_equal_int(NFC_EINVARG, res, cut_message("second operation on a busy device"));
+  res = nfc_loop_run(loop, &completion, 1, -1);
+  cut_assert_equal_int(1, res, cut_message("nfc_loop_run"));
+  cut_assert_equal_pointer(devices[0], completion.pnd);
+
+  // Once removed, the device can not be used by the loop anymore
+  res = nfc_loop_remove_device(loop, devices[0]);
+  cut_assert_equal_int(0, res, cut_message("nfc_loop_remove_device"));
+  res = nfc_loop_initiator_select_passive_target(loop, devices[0], nm, NULL, 0, &nt, -1, NULL);
+  cut_assert_equal_int(NFC_EINVARG, res, cut_message("submit to a removed device"));
+}
+
+struct async_result {
+  nfc_device *pnd;
+  int res;
+  size_t count;
+};
+
+static void
+async_done(nfc_device *pnd, int res, void *user_data)
+{
+  struct async_result *result = user_data;
+  result->pnd = pnd;
+  result->res = res;
+  result->count++;
+}
+
+void
+test_nfc_async_callback(void)
+{
+  struct async_result result = { NULL, 0, 0 };
+  nfc_loop_completion completion;
+  nfc_target nt;
+  uint8_t abtRx[64];
+  int res;
+
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  const uint8_t abtRead[2] = { 0x30, 0x00 };
+
+  // Without an event loop
+  res = nfc_loop_remove_device(loop, devices[0]);
+  cut_assert_equal_int(0, res, cut_message("nfc_loop_remove_device"));
+  res = nfc_initiator_select_passive_target(devices[0], nm, NULL, 0, &nt);
+  cut_assert_equal_int(1, res, cut_message("select"));
+  res = nfc_initiator_transceive_bytes_async(devices[0], abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), -1, async_done, &result);
+  cut_assert_equal_int(0, res, cut_message("submit read"));
+  res = nfc_device_process_async(devices[0], -1);
+  cut_assert_equal_int(1, res, cut_message("nfc_device_process_async"));
+  cut_assert_equal_uint(1, result.count, cut_message("callback called once"));
+  cut_assert_equal_pointer(devices[0], result.pnd);
+  cut_assert_equal_int(16, result.res, cut_message("read"));
+  res = nfc_device_process_async(devices[0], 0);
+  cut_assert_equal_int(0, res, cut_message("nothing left in flight"));
+
+  // Through the event loop, callbacks are called instead of storing completions
+  res = nfc_initiator_select_passive_target(devices[1], nm, NULL, 0, &nt);
+  cut_assert_equal_int(1, res, cut_message("select"));
+  res = nfc_initiator_transceive_bytes_async(devices[1], abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), -1, async_done, &result);
+  cut_assert_equal_int(0, res, cut_message("submit read"));
+  res = nfc_loop_run(loop, &completion, 1, -1);
+  cut_assert_equal_int(0, res, cut_message("nfc_loop_run"));
+  cut_assert_equal_uint(2, result.count, cut_message("callback called once"));
+  cut_assert_equal_pointer(devices[1], result.pnd);
+  cut_assert_equal_int(16, result.res, cut_message("read"));
+}
+
+void
+test_nfc_async_cancel(void)
+{
+  struct async_result result = { NULL, 0, 0 };
+  nfc_target nt;
+  uint8_t abtRx[64];
+  int res;
+
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  const uint8_t abtRead[2] = { 0x30, 0x00 };
+
+  res = nfc_loop_remove_device(loop, devices[0]);
+  cut_assert_equal_int(0, res, cut_message("nfc_loop_remove_device"));
+  res = nfc_initiator_select_passive_target(devices[0], nm, NULL, 0, &nt);
+  cut_assert_equal_int(1, res, cut_message("select"));
+
+  res = nfc_device_cancel_async(devices[0]);
+  cut_assert_equal_int(NFC_EINVARG, res, cut_message("nothing to cancel"));
+  res = nfc_initiator_transceive_bytes_async(devices[0], abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), -1, async_done, &result);
+  cut_assert_equal_int(0, res, cut_message("submit read"));
+  res = nfc_device_cancel_async(devices[0]);
+  cut_assert_equal_int(0, res, cut_message("nfc_device_cancel_async"));
+  cut_assert_equal_uint(0, result.count, cut_message("completion is deferred"));
+  res = nfc_device_process_async(devices[0], -1);
+  cut_assert_equal_int(1, res, cut_message("nfc_device_process_async"));
+  cut_assert_equal_int(NFC_EOPABORTED, result.res, cut_message("cancelled"));
+
+  // The device is usable again
+  res = nfc_initiator_transceive_bytes_async(devices[0], abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), -1, async_done, &result);
+  cut_assert_equal_int(0, res, cut_message("submit read"));
+  res = nfc_device_process_async(devices[0], -1);
+  cut_assert_equal_int(1, res, cut_message("nfc_device_process_async"));
+  cut_assert_equal_int(16, result.res, cut_message("read"));
+}
@@ -0,0 +1,176 @@
+#include <cutter.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#include "chips/pn53x.h"
+
+void test_pn53x_wrap_frame(void);
+void test_pn53x_wrap_frame_parity(void);
+void test_pn53x_unwrap_frame(void);
+
+#define MAX_BYTES 40
+
+static uint8_t
+ref_mirror(uint8_t bt)
+{
+  uint8_t btMirror = 0;
+  for (int n = 0; n < 8; n++) {
+    btMirror = (btMirror << 1) | ((bt >> n) & 0x01);
+  }
+  return btMirror;
+}
+
+/* pn53x_wrap_frame() and pn53x_unwrap_frame() as they were implemented bit by bit */
+static int
+ref_wrap_frame(const uint8_t *pbtTx, const size_t szTxBits, const uint8_t *pbtTxPar, uint8_t *pbtFrame)
+{
+  uint8_t btData;
+  uint32_t uiBitPos;
+  uint32_t uiDataPos = 0;
+  size_t szBitsLeft = szTxBits;
+  size_t szFrameBits = 0;
+
+  if (szBitsLeft < 9) {
+    *pbtFrame = *pbtTx;
+    return szTxBits;
+  }
+  szFrameBits = szTxBits + (szTxBits / 8);
+  while (1) {
+    uint8_t btFrame = 0;
+    for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
+      btData = ref_mirror(pbtTx[uiDataPos]);
+      btFrame |= (btData >> uiBitPos);
+      *pbtFrame = ref_mirror(btFrame);
+      btFrame = (btData << (8 - uiBitPos));
+      btFrame |= ((pbtTxPar[uiDataPos] & 0x01) << (7 - uiBitPos));
+      pbtFrame++;
+      *pbtFrame = ref_mirror(btFrame);
+      uiDataPos++;
+      if (szBitsLeft < 9)
+        return szFrameBits;
+      szBitsLeft -= 8;
+    }
+    pbtFrame++;
+  }
+}
+
+static int
+ref_unwrap_frame(const uint8_t *pbtFrame, const size_t szFrameBits, uint8_t *pbtRx, uint8_t *pbtRxPar)
+{
+  uint8_t btFrame;
+  uint8_t btData;
+  uint8_t uiBitPos;
+  uint32_t uiDataPos = 0;
+  const uint8_t *pbtFramePos = pbtFrame;
+  size_t szBitsLeft = szFrameBits;
+
+  if (szBitsLeft < 9) {
+    *pbtRx = *pbtFrame;
+    return szFrameBits;
+  }
+  while (1) {
+    for (uiBitPos = 0; uiBitPos < 8; uiBitPos++) {
+      btFrame = ref_mirror(pbtFramePos[uiDataPos]);
+      btData = (btFrame << uiBitPos);
+      btFrame = ref_mirror(pbtFramePos[uiDataPos + 1]);
+      btData |= (btFrame >> (8 - uiBitPos));
+      pbtRx[uiDataPos] = ref_mirror(btData);
+      pbtRxPar[uiDataPos] = ((btFrame >> (7 - uiBitPos)) & 0x01);
+      uiDataPos++;
+      if (szBitsLeft < 9)
+        return szFrameBits - (szFrameBits / 9);
+      szBitsLeft -= 9;
+    }
+    pbtFramePos++;
+  }
+}
+
+static void
+random_bytes(uint8_t *pbt, size_t sz)
+{
+  while (sz--)
+    *pbt++ = (uint8_t)random();
+}
+
+void
+test_pn53x_wrap_frame(void)
+{
+  uint8_t abtTx[MAX_BYTES], abtPar[MAX_BYTES];
+  uint8_t abtFrame[MAX_BYTES * 2], abtExpected[MAX_BYTES * 2];
+
+  srandom(0x14443);
+  for (size_t szTxBits = 1; szTxBits <= MAX_BYTES * 8; szTxBits++) {
+    random_bytes(abtTx, sizeof(abtTx));
+    random_bytes(abtPar, sizeof(abtPar));
+    memset(abtFrame, 0x5a, sizeof(abtFrame));
+    memset(abtExpected, 0x5a, sizeof(abtExpected));
+
+    int res = pn53x_wrap_frame(abtTx, szTxBits, abtPar, abtFrame);
+    int expected = ref_wrap_frame(abtTx, szTxBits, abtPar, abtExpected);
+    cut_assert_equal_int(expected, res, cut_message("frame bits for %zu bits", szTxBits));
+    cut_assert_equal_memory(abtExpected, sizeof(abtExpected), abtFrame, sizeof(abtFrame),
+                            cut_message("frame for %zu bits", szTxBits));
+  }
+}
+
+void
+test_pn53x_wrap_frame_parity(void)
+{
+  uint8_t abtTx[MAX_BYTES], abtPar[MAX_BYTES];
+  uint8_t abtFrame[MAX_BYTES * 2], abtExpected[MAX_BYTES * 2];
+
+  srandom(0x9000);
+  for (size_t szTxBits = 9; szTxBits <= MAX_BYTES * 8; szTxBits++) {
+    random_bytes(abtTx, sizeof(abtTx));
+    for (size_t n = 0; n < sizeof(abtTx); n++) {
+      uint8_t bt = abtTx[n];
+      int ones = 0;
+      while (bt) {
+        ones += bt & 1;
+        bt >>= 1;
+      }
+      abtPar[n] = !(ones & 1);
+    }
+    memset(abtFrame, 0x5a, sizeof(abtFrame));
+    memset(abtExpected, 0x5a, sizeof(abtExpected));
+
+    /* Without parity array, odd parity is computed */
+    pn53x_wrap_frame(abtTx, szTxBits, NULL, abtFrame);
+    ref_wrap_frame(abtTx, szTxBits, abtPar, abtExpected);
+    cut_assert_equal_memory(abtExpected, sizeof(abtExpected), abtFrame, sizeof(abtFrame),
+                            cut_message("frame with computed parity for %zu bits", szTxBits));
+  }
+}
+
+void
+test_pn53x_unwrap_frame(void)
+{
+  uint8_t abtFrame[MAX_BYTES * 2];
+  uint8_t abtRx[MAX_BYTES * 2], abtRxPar[MAX_BYTES * 2];
+  uint8_t abtExpected[MAX_BYTES * 2], abtExpectedPar[MAX_BYTES * 2];
+
+  srandom(0x4a4b);
+  for (size_t szFrameBits = 1; szFrameBits <= MAX_BYTES * 9; szFrameBits++) {
+    /* Frame bytes past the received ones are zero, as in pn53x receive buffers */
+    memset(abtFrame, 0, sizeof(abtFrame));
+    random_bytes(abtFrame, (szFrameBits + 7) / 8);
+    memset(abtRx, 0, sizeof(abtRx));
+    memset(abtRxPar, 0, sizeof(abtRxPar));
+
+    int res = pn53x_unwrap_frame(abtFrame, szFrameBits, abtRx, abtRxPar);
+    int expected = ref_unwrap_frame(abtFrame, szFrameBits, abtExpected, abtExpectedPar);
+    cut_assert_equal_int(expected, res, cut_message("data bits for %zu bits", szFrameBits));
+
+    size_t szRxBytes = ((size_t)res + 7) / 8;
+    cut_assert_equal_memory(abtExpected, szRxBytes, abtRx, szRxBytes,
+                            cut_message("data for %zu bits", szFrameBits));
+    if (szFrameBits >= 9)
+      cut_assert_equal_memory(abtExpectedPar, szRxBytes, abtRxPar, szRxBytes,
+                              cut_message("parity for %zu bits", szFrameBits));
+    /* Nothing is written past the data */
+    cut_assert_equal_int(0, abtRx[szRxBytes], cut_message("overrun for %zu bits", szFrameBits));
+  }
+}
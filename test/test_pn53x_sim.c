@@ -0,0 +1,236 @@
+#include <cutter.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include "drivers/pn53x_sim.h"
+
+#define MAX_TARGET_COUNT 8
+
+static const nfc_connstring connstring = "pn53x_sim:pn532:mfc1k,mful,iso14443-4,felica,jewel";
+
+/*
+ * Exercises the initiator and target API against the simulated PN53x, so it
+ * runs without any hardware.
+ */
+void test_pn53x_sim_initiator(void);
+void test_pn53x_sim_target(void);
+void test_pn53x_sim_list_pairs(void);
+void test_pn53x_sim_list_st25tb(void);
+void test_pn53x_sim_list_felica(void);
+
+static nfc_context *context;
+static nfc_device *device;
+
+void
+cut_setup(void)
+{
+  nfc_init(&context);
+  cut_assert_not_null(context, cut_message("nfc_init"));
+  device = nfc_open(context, connstring);
+  if (!device)
+    cut_omit("pn53x_sim driver not available");
+}
+
+void
+cut_teardown(void)
+{
+  if (device)
+    nfc_close(device);
+  nfc_exit(context);
+}
+
+void
+test_pn53x_sim_initiator(void)
+{
+  nfc_target ant[MAX_TARGET_COUNT];
+  nfc_target nt;
+  uint8_t abtRx[64];
+  int res;
+
+  res = nfc_initiator_init(device);
+  cut_assert_equal_int(0, res, cut_message("nfc_initiator_init"));
+
+  const nfc_modulation nmMifare = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  res = nfc_initiator_list_passive_targets(device, nmMifare, ant, MAX_TARGET_COUNT);
+  cut_assert_equal_int(3, res, cut_message("ISO14443A targets"));
+  cut_assert_equal_uint(0x08, ant[0].nti.nai.btSak, cut_message("MIFARE Classic SAK"));
+  cut_assert_equal_uint(7, ant[1].nti.nai.szUidLen, cut_message("Ultralight UID size"));
+  cut_assert_equal_uint(5, ant[2].nti.nai.szAtsLen, cut_message("ISO14443-4 ATS"));
+
+  // Listed tags are halted, cycle the field to wake them up
+  res = nfc_device_set_property_bool(device, NP_ACTIVATE_FIELD, false);
+  cut_assert_equal_int(0, res, cut_message("field off"));
+
+  // MIFARE Classic, authenticated write then read back
+  res = nfc_initiator_select_passive_target(device, nmMifare, ant[0].nti.nai.abtUid, ant[0].nti.nai.szUidLen, &nt);
+  cut_assert_equal_int(1, res, cut_message("select MIFARE Classic"));
+  uint8_t abtAuth[12] = { 0x60, 0x04, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  memcpy(abtAuth + 8, nt.nti.nai.abtUid, 4);
+  res = nfc_initiator_transceive_bytes(device, abtAuth, sizeof(abtAuth), abtRx, sizeof(abtRx), -1);
+  cut_assert_equal_int(0, res, cut_message("authenticate"));
+  uint8_t abtWrite[18] = { 0xa0, 0x04, 0x01, 0x02, 0x03, 0x04 };
+  res = nfc_initiator_transceive_bytes(device, abtWrite, sizeof(abtWrite), abtRx, sizeof(abtRx), -1);
+  cut_assert_equal_int(0, res, cut_message("write block"));
+  const uint8_t abtRead[2] = { 0x30, 0x04 };
+  res = nfc_initiator_transceive_bytes(device, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), -1);
+  cut_assert_equal_int(16, res, cut_message("read block"));
+  cut_assert_equal_memory(abtWrite + 2, 16, abtRx, 16, cut_message("read back"));
+  abtAuth[2] = 0x00;
+  res = nfc_initiator_transceive_bytes(device, abtAuth, sizeof(abtAuth), abtRx, sizeof(abtRx), -1);
+  cut_assert_equal_int(NFC_EMFCAUTHFAIL, res, cut_message("authenticate with a wrong key"));
+
+  // ISO14443-4 APDU
+  res = nfc_initiator_select_passive_target(device, nmMifare, ant[2].nti.nai.abtUid, ant[2].nti.nai.szUidLen, &nt);
+  cut_assert_equal_int(1, res, cut_message("select ISO14443-4 target"));
+  const uint8_t abtSelect[] = { 0x00, 0xa4, 0x04, 0x00, 0x02, 0xe1, 0x03 };
+  res = nfc_initiator_transceive_bytes(device, abtSelect, sizeof(abtSelect), abtRx, sizeof(abtRx), -1);
+  cut_assert_equal_int(2, res, cut_message("SELECT"));
+  cut_assert_equal_memory("\x90\x00", 2, abtRx, 2, cut_message("SELECT status word"));
+
+  // FeliCa and Jewel
+  const nfc_modulation nmFelica = { .nmt = NMT_FELICA, .nbr = NBR_212 };
+  res = nfc_initiator_select_passive_target(device, nmFelica, NULL, 0, &nt);
+  cut_assert_equal_int(1, res, cut_message("select FeliCa"));
+  uint8_t abtFelicaRead[16] = { 16, 0x06 };
+  memcpy(abtFelicaRead + 2, nt.nti.nfi.abtId, 8);
+  memcpy(abtFelicaRead + 10, "\x01\x0b\x00\x01\x80\x00", 6);
+  res = nfc_initiator_transceive_bytes(device, abtFelicaRead, sizeof(abtFelicaRead), abtRx, sizeof(abtRx), -1);
+  cut_assert_equal_int(29, res, cut_message("FeliCa read without encryption"));
+
+  const nfc_modulation nmJewel = { .nmt = NMT_JEWEL, .nbr = NBR_106 };
+  res = nfc_initiator_select_passive_target(device, nmJewel, NULL, 0, &nt);
+  cut_assert_equal_int(1, res, cut_message("select Jewel"));
+  res = nfc_initiator_target_is_present(device, &nt);
+  cut_assert_equal_int(0, res, cut_message("Jewel is present"));
+
+  // Nothing in field for ISO14443B
+  const nfc_modulation nmB = { .nmt = NMT_ISO14443B, .nbr = NBR_106 };
+  res = nfc_initiator_list_passive_targets(device, nmB, ant, MAX_TARGET_COUNT);
+  cut_assert_equal_int(0, res, cut_message("ISO14443B targets"));
+}
+
+void
+test_pn53x_sim_target(void)
+{
+  struct pn53x_sim *sim = pn53x_sim_device_get(device);
+  cut_assert_not_null(sim, cut_message("pn53x_sim_device_get"));
+
+  const uint8_t abtCommand[] = { 0x30, 0x00 };
+  pn53x_sim_push_initiator_frame(sim, abtCommand, sizeof(abtCommand));
+
+  nfc_target nt = {
+    .nm = { .nmt = NMT_ISO14443A, .nbr = NBR_UNDEFINED },
+    .nti = { .nai = { .abtAtqa = { 0x00, 0x04 }, .abtUid = { 0x08, 0xab, 0xcd, 0xef }, .btSak = 0x09, .szUidLen = 4 } },
+  };
+  uint8_t abtRx[64];
+  int res = nfc_target_init(device, &nt, abtRx, sizeof(abtRx), 0);
+  cut_assert_equal_int(sizeof(abtCommand), res, cut_message("nfc_target_init"));
+  cut_assert_equal_memory(abtCommand, sizeof(abtCommand), abtRx, res, cut_message("initiator command"));
+
+  const uint8_t abtResponse[] = { 0x01, 0x02, 0x03, 0x04 };
+  res = nfc_target_send_bytes(device, abtResponse, sizeof(abtResponse), 0);
+  cut_assert_equal_int(sizeof(abtResponse), res, cut_message("nfc_target_send_bytes"));
+  cut_assert_equal_memory(abtResponse, sizeof(abtResponse), sim->target_response.abtData, sim->target_response.szData, cut_message("response seen by the initiator"));
+
+  res = nfc_target_receive_bytes(device, abtRx, sizeof(abtRx), 0);
+  cut_assert_equal_int(NFC_ETGRELEASED, res, cut_message("initiator gone"));
+}
+
+void
+test_pn53x_sim_list_pairs(void)
+{
+  nfc_target ant[MAX_TARGET_COUNT];
+  int res;
+
+  // The ISO14443-4 target comes first, its ATS precedes the second target of the pair
+  const nfc_connstring connstring_pairs = "pn53x_sim:pn532:iso14443-4,mfc1k,mful,felica,felica";
+  nfc_device *pnd = nfc_open(context, connstring_pairs);
+  cut_assert_not_null(pnd, cut_message("nfc_open"));
+  struct pn53x_sim *sim = pn53x_sim_device_get(pnd);
+  cut_assert_equal_int(0, nfc_initiator_init(pnd), cut_message("nfc_initiator_init"));
+  // Any command flushes register writes left pending by nfc_initiator_init()
+  cut_assert_equal_int(0, nfc_device_set_property_bool(pnd, NP_ACTIVATE_FIELD, true), cut_message("NP_ACTIVATE_FIELD"));
+
+  const nfc_modulation nmMifare = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  uint64_t count = sim->command_count;
+  res = nfc_initiator_list_passive_targets(pnd, nmMifare, ant, MAX_TARGET_COUNT);
+  cut_assert_equal_int(3, res, cut_message("ISO14443A targets"));
+  cut_assert_equal_uint(5, ant[0].nti.nai.szAtsLen, cut_message("ISO14443-4 ATS"));
+  cut_assert_equal_uint(0x08, ant[1].nti.nai.btSak, cut_message("MIFARE Classic SAK"));
+  cut_assert_equal_uint(7, ant[2].nti.nai.szUidLen, cut_message("Ultralight UID size"));
+  // Two InListPassiveTarget and two InRelease, within RFConfiguration switching select retries off and on
+  cut_assert_equal_int(count + 6, sim->command_count, cut_message("commands"));
+
+  // Both FeliCa targets answer the same polling
+  const nfc_modulation nmFelica = { .nmt = NMT_FELICA, .nbr = NBR_212 };
+  res = nfc_initiator_list_passive_targets(pnd, nmFelica, ant, MAX_TARGET_COUNT);
+  cut_assert_equal_int(2, res, cut_message("FeliCa targets"));
+  cut_assert_not_equal_memory(ant[0].nti.nfi.abtId, 8, ant[1].nti.nfi.abtId, 8, cut_message("IDm"));
+
+  nfc_close(pnd);
+}
+
+void
+test_pn53x_sim_list_st25tb(void)
+{
+  nfc_target ant[MAX_TARGET_COUNT];
+  nfc_target nt;
+  int res;
+
+  // More ST SRx tags than slots, some of them draw the same one
+  const nfc_connstring connstring_st25tb = "pn53x_sim:pn532:st25tb,st25tb,st25tb,st25tb,st25tb,st25tb,st25tb,st25tb,mfc1k";
+  nfc_device *pnd = nfc_open(context, connstring_st25tb);
+  cut_assert_not_null(pnd, cut_message("nfc_open"));
+  cut_assert_equal_int(0, nfc_initiator_init(pnd), cut_message("nfc_initiator_init"));
+
+  const nfc_modulation nmSr = { .nmt = NMT_ISO14443B2SR, .nbr = NBR_106 };
+  res = nfc_initiator_list_passive_targets(pnd, nmSr, ant, MAX_TARGET_COUNT);
+  cut_assert_equal_int(8, res, cut_message("ST SRx targets"));
+  for (int n = 0; n < res; n++) {
+    cut_assert_equal_uint(0xd0, ant[n].nti.nsi.abtUID[7], cut_message("UID of target %d", n));
+    for (int i = 0; i < n; i++) {
+      cut_assert_not_equal_memory(ant[i].nti.nsi.abtUID, 8, ant[n].nti.nsi.abtUID, 8, cut_message("UID %d and %d", i, n));
+    }
+  }
+
+  // Each tag can be selected again by its UID during the same field activation
+  for (int n = 0; n < res; n++) {
+    const uint8_t abtRead[2] = { 0x08, 0x00 };
+    uint8_t abtRx[4];
+    cut_assert_equal_int(1, nfc_initiator_select_passive_target(pnd, nmSr, ant[n].nti.nsi.abtUID, 8, &nt), cut_message("select target %d", n));
+    cut_assert_equal_memory(ant[n].nti.nsi.abtUID, 8, nt.nti.nsi.abtUID, 8, cut_message("selected UID %d", n));
+    cut_assert_equal_int(4, nfc_initiator_transceive_bytes(pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 0), cut_message("READ_BLOCK %d", n));
+  }
+
+  nfc_close(pnd);
+}
+
+void
+test_pn53x_sim_list_felica(void)
+{
+  nfc_target ant[MAX_TARGET_COUNT];
+  int res;
+
+  // More FeliCa cards than one polling can report, each answers in a random time slot
+  const nfc_connstring connstring_felica = "pn53x_sim:pn532:felica,felica,felica,felica,felica,mfc1k";
+  nfc_device *pnd = nfc_open(context, connstring_felica);
+  cut_assert_not_null(pnd, cut_message("nfc_open"));
+  cut_assert_equal_int(0, nfc_initiator_init(pnd), cut_message("nfc_initiator_init"));
+
+  const nfc_modulation nmFelica = { .nmt = NMT_FELICA, .nbr = NBR_212 };
+  res = nfc_initiator_list_passive_targets(pnd, nmFelica, ant, MAX_TARGET_COUNT);
+  cut_assert_equal_int(5, res, cut_message("FeliCa targets"));
+  for (int n = 0; n < res; n++) {
+    for (int i = 0; i < n; i++) {
+      cut_assert_not_equal_memory(ant[i].nti.nfi.abtId, 8, ant[n].nti.nfi.abtId, 8, cut_message("IDm %d and %d", i, n));
+    }
+  }
+
+  // Only one card is asked for: a single time slot and a single polling
+  struct pn53x_sim *sim = pn53x_sim_device_get(pnd);
+  const uint64_t count = sim->command_count;
+  cut_assert_equal_int(1, nfc_initiator_list_passive_targets(pnd, nmFelica, ant, 1), cut_message("one FeliCa target"));
+  cut_assert_true(sim->command_count <= count + 4, cut_message("one polling"));
+
+  nfc_close(pnd);
+}
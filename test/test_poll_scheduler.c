@@ -0,0 +1,149 @@
+#include <cutter.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include "drivers/pn53x_sim.h"
+#include "sim-fixture.h"
+
+/*
+ * nfc_initiator_poll_target() polls the modulations which recently found
+ * targets first, keeps modulations sharing chip settings together, and polls
+ * by itself (simulated) chips which can't.
+ */
+void test_poll_scheduler_software(void);
+void test_poll_scheduler_hit_rate(void);
+void test_poll_scheduler_groups(void);
+void test_poll_scheduler_autopoll(void);
+void test_poll_scheduler_invalid(void);
+
+static nfc_context *context;
+static nfc_device *device;
+static struct pn53x_sim *sim;
+
+static const nfc_modulation nmMifare = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+static const nfc_modulation nmIso14443b = { .nmt = NMT_ISO14443B, .nbr = NBR_106 };
+static const nfc_modulation nmFelica = { .nmt = NMT_FELICA, .nbr = NBR_212 };
+static const nfc_modulation nmJewel = { .nmt = NMT_JEWEL, .nbr = NBR_106 };
+
+// Each test picks the simulated chip and tags it needs
+static void
+open_device(const char *connstring)
+{
+  if (context)
+    sim_fixture_teardown(context, device);
+  context = NULL;
+  sim_fixture_setup(connstring, &context, &device, &sim);
+}
+
+static nfc_poll_stats
+get_stats(const nfc_modulation nm)
+{
+  nfc_poll_stats stats[16];
+  nfc_poll_stats st;
+  const int res = nfc_initiator_poll_stats(device, stats, 16);
+
+  cut_assert_true(res >= 0, cut_message("nfc_initiator_poll_stats"));
+  for (int n = 0; n < res; n++) {
+    if ((stats[n].nm.nmt == nm.nmt) && (stats[n].nm.nbr == nm.nbr))
+      return stats[n];
+  }
+  memset(&st, 0, sizeof(st));
+  return st;
+}
+
+void
+cut_setup(void)
+{
+  context = NULL;
+  device = NULL;
+}
+
+void
+cut_teardown(void)
+{
+  if (context)
+    sim_fixture_teardown(context, device);
+}
+
+void
+test_poll_scheduler_software(void)
+{
+  const nfc_modulation anm[] = { nmIso14443b, nmFelica, nmMifare };
+  nfc_target nt;
+
+  // PN533 has no InAutoPoll
+  open_device("pn53x_sim:pn533:mfc1k");
+  cut_assert_equal_int(1, nfc_initiator_poll_target(device, anm, 3, 1, 1, &nt), cut_message("nfc_initiator_poll_target"));
+  cut_assert_equal_int(NMT_ISO14443A, nt.nm.nmt, cut_message("modulation"));
+  cut_assert_equal_uint(0x08, nt.nti.nai.btSak, cut_message("MIFARE Classic SAK"));
+
+  const nfc_poll_stats st = get_stats(nmMifare);
+  cut_assert_equal_uint(1, st.uiAttempts, cut_message("ISO14443A attempts"));
+  cut_assert_equal_uint(1, st.uiHits, cut_message("ISO14443A hits"));
+  cut_assert_true(st.uiHitRate > 0, cut_message("ISO14443A hit rate"));
+  cut_assert_equal_uint(1, get_stats(nmIso14443b).uiAttempts, cut_message("ISO14443B attempts"));
+  cut_assert_equal_uint(0, get_stats(nmIso14443b).uiHits, cut_message("ISO14443B hits"));
+
+  // Nothing in the field: each modulation is tried during the whole polling
+  open_device("pn53x_sim:pn533:none");
+  cut_assert_equal_int(0, nfc_initiator_poll_target(device, anm, 3, 1, 1, &nt), cut_message("no target"));
+  cut_assert_true(get_stats(nmFelica).uiAttempts > 1, cut_message("FeliCa tried again"));
+}
+
+void
+test_poll_scheduler_hit_rate(void)
+{
+  const nfc_modulation anm[] = { nmMifare, nmIso14443b, nmFelica };
+  nfc_target nt;
+
+  open_device("pn53x_sim:pn533:felica");
+  cut_assert_equal_int(1, nfc_initiator_poll_target(device, anm, 3, 1, 0, &nt), cut_message("first poll"));
+  cut_assert_equal_int(NMT_FELICA, nt.nm.nmt, cut_message("FeliCa target"));
+  cut_assert_equal_uint(1, get_stats(nmMifare).uiAttempts, cut_message("ISO14443A attempts"));
+
+  // FeliCa found a target, it is now polled first
+  cut_assert_equal_int(1, nfc_initiator_poll_target(device, anm, 3, 1, 0, &nt), cut_message("second poll"));
+  cut_assert_equal_uint(1, get_stats(nmMifare).uiAttempts, cut_message("ISO14443A not tried again"));
+  cut_assert_equal_uint(1, get_stats(nmIso14443b).uiAttempts, cut_message("ISO14443B not tried again"));
+  cut_assert_equal_uint(2, get_stats(nmFelica).uiHits, cut_message("FeliCa hits"));
+}
+
+void
+test_poll_scheduler_groups(void)
+{
+  const nfc_modulation anm[] = { nmMifare, nmFelica, nmJewel };
+  nfc_target nt;
+
+  // Jewel shares the ISO14443A settings, it is tried before FeliCa
+  open_device("pn53x_sim:pn533:jewel");
+  cut_assert_equal_int(1, nfc_initiator_poll_target(device, anm, 3, 1, 0, &nt), cut_message("nfc_initiator_poll_target"));
+  cut_assert_equal_int(NMT_JEWEL, nt.nm.nmt, cut_message("Jewel target"));
+  cut_assert_equal_uint(1, get_stats(nmMifare).uiAttempts, cut_message("ISO14443A attempts"));
+  cut_assert_equal_uint(0, get_stats(nmFelica).uiAttempts, cut_message("FeliCa attempts"));
+}
+
+void
+test_poll_scheduler_autopoll(void)
+{
+  const nfc_modulation anm[] = { nmFelica, nmMifare };
+  nfc_target nt;
+
+  // PN532 polls by itself, only hits are recorded
+  open_device("pn53x_sim:pn532:mfc1k");
+  cut_assert_equal_int(1, nfc_initiator_poll_target(device, anm, 2, 1, 1, &nt), cut_message("nfc_initiator_poll_target"));
+  cut_assert_equal_int(NMT_ISO14443A, nt.nm.nmt, cut_message("modulation"));
+  const nfc_poll_stats st = get_stats(nmMifare);
+  cut_assert_equal_uint(1, st.uiHits, cut_message("ISO14443A hits"));
+  cut_assert_equal_uint(0, st.uiLastLatency, cut_message("no latency"));
+  cut_assert_equal_int(2, nfc_initiator_poll_stats(device, NULL, 0), cut_message("modulations"));
+}
+
+void
+test_poll_scheduler_invalid(void)
+{
+  nfc_target nt;
+
+  open_device("pn53x_sim:pn533:mfc1k");
+  cut_assert_equal_int(NFC_EINVARG, nfc_initiator_poll_target(device, &nmMifare, 0, 1, 1, &nt), cut_message("no modulation"));
+  cut_assert_equal_int(NFC_EINVARG, nfc_device_get_last_error(device), cut_message("last error"));
+}
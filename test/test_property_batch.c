@@ -0,0 +1,103 @@
+#include <cutter.h>
+
+#include <nfc/nfc.h>
+#include "chips/pn53x.h"
+#include "drivers/pn53x_sim.h"
+#include "sim-fixture.h"
+
+/*
+ * Property changes made between nfc_device_begin_properties() and
+ * nfc_device_commit_properties() are sent to the (simulated) chip with as
+ * few commands as possible.
+ */
+void test_property_batch_coalesce(void);
+void test_property_batch_in_effect(void);
+void test_property_batch_field(void);
+void test_property_batch_nested(void);
+
+static nfc_context *context;
+static nfc_device *device;
+static struct pn53x_sim *sim;
+
+void
+cut_setup(void)
+{
+  sim_fixture_setup("pn53x_sim:pn532:mfc1k", &context, &device, &sim);
+  // Any command flushes register writes left pending by nfc_initiator_init()
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_ACTIVATE_FIELD, true), cut_message("NP_ACTIVATE_FIELD"));
+}
+
+void
+cut_teardown(void)
+{
+  sim_fixture_teardown(context, device);
+}
+
+void
+test_property_batch_coalesce(void)
+{
+  const uint64_t count = sim->command_count;
+
+  cut_assert_equal_int(0, nfc_device_begin_properties(device), cut_message("nfc_device_begin_properties"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_AUTO_ISO14443_4, false), cut_message("NP_AUTO_ISO14443_4"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_HANDLE_CRC, false), cut_message("NP_HANDLE_CRC"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_HANDLE_PARITY, false), cut_message("NP_HANDLE_PARITY"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_INFINITE_SELECT, false), cut_message("NP_INFINITE_SELECT"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_ACCEPT_INVALID_FRAMES, true), cut_message("NP_ACCEPT_INVALID_FRAMES"));
+  cut_assert_equal_int(count, sim->command_count, cut_message("nothing sent before commit"));
+  cut_assert_true(sim->ui8Parameters & PARAM_AUTO_RATS, cut_message("parameters unchanged before commit"));
+
+  cut_assert_equal_int(0, nfc_device_commit_properties(device), cut_message("nfc_device_commit_properties"));
+  // One SetParameters and one RFConfiguration, register changes go with one WriteRegister ahead of them
+  cut_assert_equal_int(count + 3, sim->command_count, cut_message("commands sent by commit"));
+  cut_assert_false(sim->ui8Parameters & PARAM_AUTO_RATS, cut_message("PARAM_AUTO_RATS"));
+  cut_assert_equal_uint(0x02, sim->ui8MaxRtyPassiveActivation, cut_message("MxRtyPassiveActivation"));
+  cut_assert_false(sim->abtRegisters[PN53X_REG_CIU_TxMode] & SYMBOL_TX_CRC_ENABLE, cut_message("TX CRC"));
+  cut_assert_false(sim->abtRegisters[PN53X_REG_CIU_RxMode] & SYMBOL_RX_CRC_ENABLE, cut_message("RX CRC"));
+  cut_assert_true(sim->abtRegisters[PN53X_REG_CIU_RxMode] & SYMBOL_RX_NO_ERROR, cut_message("RX no error"));
+  cut_assert_true(sim->abtRegisters[PN53X_REG_CIU_ManualRCV] & SYMBOL_PARITY_DISABLE, cut_message("parity"));
+}
+
+void
+test_property_batch_in_effect(void)
+{
+  const uint64_t count = sim->command_count;
+
+  // nfc_initiator_init() already set these values
+  cut_assert_equal_int(0, nfc_device_begin_properties(device), cut_message("nfc_device_begin_properties"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_AUTO_ISO14443_4, true), cut_message("NP_AUTO_ISO14443_4"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_INFINITE_SELECT, true), cut_message("NP_INFINITE_SELECT"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_HANDLE_CRC, true), cut_message("NP_HANDLE_CRC"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_FORCE_SPEED_106, true), cut_message("NP_FORCE_SPEED_106"));
+  cut_assert_equal_int(0, nfc_device_commit_properties(device), cut_message("nfc_device_commit_properties"));
+  cut_assert_equal_int(count, sim->command_count, cut_message("nothing to send"));
+}
+
+void
+test_property_batch_field(void)
+{
+  const uint64_t count = sim->command_count;
+
+  cut_assert_equal_int(0, nfc_device_begin_properties(device), cut_message("nfc_device_begin_properties"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_ACTIVATE_FIELD, false), cut_message("field off"));
+  cut_assert_true(sim->field, cut_message("field still on"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_ACTIVATE_FIELD, true), cut_message("field on"));
+  cut_assert_equal_int(0, nfc_device_commit_properties(device), cut_message("nfc_device_commit_properties"));
+  // The field state is never assumed, its last requested state is sent once
+  cut_assert_equal_int(count + 1, sim->command_count, cut_message("RFConfiguration"));
+  cut_assert_true(sim->field, cut_message("field on"));
+}
+
+void
+test_property_batch_nested(void)
+{
+  cut_assert_equal_int(0, nfc_device_begin_properties(device), cut_message("outer batch"));
+  cut_assert_equal_int(0, nfc_device_begin_properties(device), cut_message("inner batch"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_AUTO_ISO14443_4, false), cut_message("NP_AUTO_ISO14443_4"));
+  cut_assert_equal_int(0, nfc_device_commit_properties(device), cut_message("inner commit"));
+  cut_assert_true(sim->ui8Parameters & PARAM_AUTO_RATS, cut_message("applied by the outermost commit only"));
+  cut_assert_equal_int(0, nfc_device_commit_properties(device), cut_message("outer commit"));
+  cut_assert_false(sim->ui8Parameters & PARAM_AUTO_RATS, cut_message("PARAM_AUTO_RATS"));
+
+  cut_assert_equal_int(NFC_EINVARG, nfc_device_commit_properties(device), cut_message("commit without batch"));
+}
@@ -0,0 +1,83 @@
+#include <cutter.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+#include "nfc-internal.h"
+
+/*
+ * A driver can be registered once per nfc_init() / nfc_exit() cycle, and is
+ * forgotten when the last context is released.
+ */
+void test_register_driver_duplicate(void);
+void test_register_driver_cycles(void);
+
+static size_t
+dummy_scan(const nfc_context *context, nfc_connstring connstrings[], const size_t connstrings_len)
+{
+  (void) context;
+  if (connstrings_len < 1)
+    return 0;
+  strcpy(connstrings[0], "dummy:0");
+  return 1;
+}
+
+static const struct nfc_driver dummy_driver = {
+  .name = "dummy",
+  .scan_type = NOT_INTRUSIVE,
+  .scan = dummy_scan,
+};
+
+static const struct nfc_driver dummy_copy_driver = {
+  .name = "dummy",
+  .scan_type = NOT_INTRUSIVE,
+  .scan = dummy_scan,
+};
+
+static size_t
+count_dummies(nfc_context *context)
+{
+  nfc_connstring connstrings[16];
+  size_t found = 0;
+
+  const size_t sz = nfc_list_devices(context, connstrings, 16);
+  for (size_t n = 0; n < sz; n++) {
+    if (strcmp(connstrings[n], "dummy:0") == 0)
+      found++;
+  }
+  return found;
+}
+
+void
+test_register_driver_duplicate(void)
+{
+  nfc_context *context;
+
+  nfc_init(&context);
+  cut_assert_not_null(context, cut_message("nfc_init"));
+  cut_assert_equal_int(NFC_SUCCESS, nfc_register_driver(&dummy_driver), cut_message("first registration"));
+  cut_assert_equal_int(NFC_EINVARG, nfc_register_driver(&dummy_driver), cut_message("same driver"));
+  cut_assert_equal_int(NFC_EINVARG, nfc_register_driver(&dummy_copy_driver), cut_message("same name"));
+  cut_assert_equal_uint(1, count_dummies(context), cut_message("listed once"));
+  nfc_exit(context);
+}
+
+void
+test_register_driver_cycles(void)
+{
+  nfc_context *context1;
+  nfc_context *context2;
+
+  for (int n = 0; n < 3; n++) {
+    nfc_init(&context1);
+    cut_assert_not_null(context1, cut_message("nfc_init"));
+    cut_assert_equal_uint(0, count_dummies(context1), cut_message("forgotten by the last nfc_exit"));
+    cut_assert_equal_int(NFC_SUCCESS, nfc_register_driver(&dummy_driver), cut_message("registration"));
+
+    // Another context keeps the registered drivers alive
+    nfc_init(&context2);
+    cut_assert_not_null(context2, cut_message("nfc_init"));
+    nfc_exit(context1);
+    cut_assert_equal_uint(1, count_dummies(context2), cut_message("kept by a live context"));
+    nfc_exit(context2);
+  }
+}
@@ -0,0 +1,101 @@
+#include <cutter.h>
+
+#include <nfc/nfc.h>
+#include "chips/pn53x.h"
+#include "drivers/pn53x_sim.h"
+#include "sim-fixture.h"
+
+/*
+ * Register values are shadowed by the PN53x chip layer: check that what
+ * pn53x_read_register() answers always matches the (simulated) chip.
+ */
+void test_register_shadow_masked_write(void);
+void test_register_shadow_volatile(void);
+void test_register_shadow_invalidate(void);
+
+static const nfc_modulation nmMifare = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+
+static nfc_context *context;
+static nfc_device *device;
+static struct pn53x_sim *sim;
+
+void
+cut_setup(void)
+{
+  sim_fixture_setup("pn53x_sim:pn532:mfc1k", &context, &device, &sim);
+}
+
+void
+cut_teardown(void)
+{
+  sim_fixture_teardown(context, device);
+}
+
+void
+test_register_shadow_masked_write(void)
+{
+  uint8_t value;
+  int res;
+
+  sim->abtRegisters[PN53X_REG_CIU_TxSel] = 0x5a;
+  res = pn53x_read_register(device, PN53X_REG_CIU_TxSel, &value);
+  cut_assert_equal_int(0, res, cut_message("read register"));
+  cut_assert_equal_uint(0x5a, value, cut_message("register value"));
+
+  // Masked writes are merged with the shadowed value
+  res = pn53x_write_register(device, PN53X_REG_CIU_TxSel, 0x0f, 0x03);
+  cut_assert_equal_int(0, res, cut_message("write register low nibble"));
+  res = pn53x_write_register(device, PN53X_REG_CIU_TxSel, 0xc0, 0x00);
+  cut_assert_equal_int(0, res, cut_message("write register high bits"));
+  res = pn53x_read_register(device, PN53X_REG_CIU_TxSel, &value);
+  cut_assert_equal_int(0, res, cut_message("read register"));
+  cut_assert_equal_uint(0x13, value, cut_message("pending register value"));
+
+  // Any command flushes the write-back cache
+  res = nfc_initiator_select_passive_target(device, nmMifare, NULL, 0, NULL);
+  cut_assert_equal_int(1, res, cut_message("nfc_initiator_select_passive_target"));
+  cut_assert_equal_uint(0x13, sim->abtRegisters[PN53X_REG_CIU_TxSel], cut_message("written register value"));
+}
+
+void
+test_register_shadow_volatile(void)
+{
+  uint8_t value;
+  int res;
+
+  // Raw mode ANTICOLLISION: collision position is read from the chip each time
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_HANDLE_CRC, false), cut_message("NP_HANDLE_CRC"));
+  cut_assert_equal_int(0, nfc_device_set_property_bool(device, NP_EASY_FRAMING, false), cut_message("NP_EASY_FRAMING"));
+  for (int i = 0; i < 4; i++) {
+    const uint8_t abtWupa[1] = { 0x52 };
+    const uint8_t abtAnticol[2] = { 0x93, 0x20 };
+    uint8_t abtRx[16];
+    res = nfc_initiator_transceive_bits(device, abtWupa, 7, NULL, abtRx, sizeof(abtRx), NULL);
+    cut_assert_equal_int(16, res, cut_message("WUPA"));
+    res = nfc_initiator_transceive_bytes(device, abtAnticol, sizeof(abtAnticol), abtRx, sizeof(abtRx), 0);
+    cut_assert_equal_int(5, res, cut_message("ANTICOLLISION"));
+
+    sim->abtRegisters[PN53X_REG_CIU_Coll] = (uint8_t) i;
+    res = pn53x_read_register(device, PN53X_REG_CIU_Coll, &value);
+    cut_assert_equal_int(0, res, cut_message("read register"));
+    cut_assert_equal_uint(i, value, cut_message("volatile register value"));
+  }
+}
+
+void
+test_register_shadow_invalidate(void)
+{
+  uint8_t value;
+  int res;
+
+  res = pn53x_read_register(device, PN53X_REG_CIU_RxThreshold, &value);
+  cut_assert_equal_int(0, res, cut_message("read register"));
+
+  // Firmware commands may reprogram the CIU, the shadow can't be trusted afterwards
+  sim->abtRegisters[PN53X_REG_CIU_RxThreshold] = (uint8_t)(value + 1);
+  res = nfc_initiator_select_passive_target(device, nmMifare, NULL, 0, NULL);
+  cut_assert_equal_int(1, res, cut_message("nfc_initiator_select_passive_target"));
+  res = pn53x_read_register(device, PN53X_REG_CIU_RxThreshold, &value);
+  cut_assert_equal_int(0, res, cut_message("read register"));
+  cut_assert_equal_uint(sim->abtRegisters[PN53X_REG_CIU_RxThreshold], value, cut_message("register value"));
+}
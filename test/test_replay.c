@@ -0,0 +1,118 @@
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cutter.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nfc/nfc.h>
+#include "nfc-internal.h"
+
+/*
+ * A session recorded on a (simulated) PN532 plays back identically with the
+ * replay driver, and a command which was not recorded fails.
+ */
+void test_replay_round_trip(void);
+void test_replay_divergent_command(void);
+
+static const nfc_connstring connstring = "pn53x_sim:pn532:mful";
+
+static const nfc_modulation nmMifare = {
+  .nmt = NMT_ISO14443A,
+  .nbr = NBR_106,
+};
+
+static nfc_context *context;
+static char acTracePath[sizeof(context->trace_path)];
+static char acTraceFile[sizeof(acTracePath) + sizeof(nfc_connstring) + 8];
+static nfc_target ntRecorded;
+static uint8_t abtRecorded[16];
+
+// Recorded session: select the tag and read its block 4
+static void
+record_session(void)
+{
+  nfc_target nt;
+  const uint8_t abtRead[2] = { 0x30, 0x04 };
+
+  strcpy(context->trace_path, acTracePath);
+  nfc_device *pnd = nfc_open(context, connstring);
+  if (!pnd)
+    cut_omit("pn53x_sim driver not available");
+  context->trace_path[0] = '\0';
+  cut_assert_equal_int(0, nfc_initiator_init(pnd), cut_message("nfc_initiator_init"));
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(pnd, nmMifare, NULL, 0, &nt), cut_message("nfc_initiator_select_passive_target"));
+  ntRecorded = nt;
+  cut_assert_equal_int(16, nfc_initiator_transceive_bytes(pnd, abtRead, sizeof(abtRead), abtRecorded, sizeof(abtRecorded), 0), cut_message("READ"));
+  nfc_close(pnd);
+}
+
+static nfc_device *
+open_replay(void)
+{
+  nfc_connstring ncs;
+
+  snprintf(ncs, sizeof(ncs), "replay:%s", acTraceFile);
+  nfc_device *pnd = nfc_open(context, ncs);
+  if (!pnd)
+    cut_omit("replay driver not available");
+  cut_assert_equal_string("replay:pn53x_sim:pn532:mful", nfc_device_get_name(pnd), cut_message("name"));
+  return pnd;
+}
+
+void
+cut_setup(void)
+{
+  const char *tmpdir = getenv("TMPDIR");
+
+  snprintf(acTracePath, sizeof(acTracePath), "%s/libnfc-test-replay-%ld", tmpdir ? tmpdir : "/tmp", (long) getpid());
+  // See pn53x_data_new(): the connstring is appended with ':' replaced
+  snprintf(acTraceFile, sizeof(acTraceFile), "%s-pn53x_sim_pn532_mful.trace", acTracePath);
+  nfc_init(&context);
+  cut_assert_not_null(context, cut_message("nfc_init"));
+  record_session();
+}
+
+void
+cut_teardown(void)
+{
+  unlink(acTraceFile);
+  nfc_exit(context);
+}
+
+void
+test_replay_round_trip(void)
+{
+  nfc_target nt;
+  uint8_t abtRx[16];
+  const uint8_t abtRead[2] = { 0x30, 0x04 };
+
+  nfc_device *pnd = open_replay();
+  cut_assert_equal_int(0, nfc_initiator_init(pnd), cut_message("nfc_initiator_init"));
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(pnd, nmMifare, NULL, 0, &nt), cut_message("nfc_initiator_select_passive_target"));
+  cut_assert_equal_uint(ntRecorded.nti.nai.szUidLen, nt.nti.nai.szUidLen, cut_message("UID size"));
+  cut_assert_equal_memory(ntRecorded.nti.nai.abtUid, ntRecorded.nti.nai.szUidLen, nt.nti.nai.abtUid, nt.nti.nai.szUidLen, cut_message("UID"));
+  cut_assert_equal_uint(ntRecorded.nti.nai.btSak, nt.nti.nai.btSak, cut_message("SAK"));
+  cut_assert_equal_int(16, nfc_initiator_transceive_bytes(pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 0), cut_message("READ"));
+  cut_assert_equal_memory(abtRecorded, sizeof(abtRecorded), abtRx, sizeof(abtRx), cut_message("block 4"));
+  nfc_close(pnd);
+}
+
+void
+test_replay_divergent_command(void)
+{
+  nfc_target nt;
+  uint8_t abtRx[16];
+  const uint8_t abtRead[2] = { 0x30, 0x05 };
+
+  nfc_device *pnd = open_replay();
+  cut_assert_equal_int(0, nfc_initiator_init(pnd), cut_message("nfc_initiator_init"));
+  cut_assert_equal_int(1, nfc_initiator_select_passive_target(pnd, nmMifare, NULL, 0, &nt), cut_message("nfc_initiator_select_passive_target"));
+  // Block 5 was never read during the recorded session
+  cut_assert_equal_int(NFC_EIO, nfc_initiator_transceive_bytes(pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), 0), cut_message("READ block 5"));
+  cut_assert_equal_int(NFC_EIO, nfc_device_get_last_error(pnd), cut_message("last error"));
+  nfc_close(pnd);
+}
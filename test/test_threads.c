@@ -0,0 +1,115 @@
+#include <cutter.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <nfc/nfc.h>
+
+#define THREAD_COUNT 8
+#define ROUND_COUNT 1000
+
+static const nfc_connstring connstring = "pn53x_sim:pn532:mful";
+
+/*
+ * Drives one simulated PN53x per thread, each thread with its own context, to
+ * make sure concurrent devices do not share any state.
+ */
+void test_threads_devices(void);
+
+struct thread_result {
+  int res;
+  const char *step;
+  size_t rounds;
+};
+
+static void *
+device_thread(void *arg)
+{
+  struct thread_result *result = arg;
+  nfc_context *context;
+  nfc_device *pnd;
+  nfc_target nt;
+  uint8_t abtRx[64];
+  int res;
+
+  nfc_init(&context);
+  if (!context) {
+    result->step = "nfc_init";
+    return NULL;
+  }
+  if (!(pnd = nfc_open(context, connstring))) {
+    result->step = "nfc_open";
+    nfc_exit(context);
+    return NULL;
+  }
+  if ((res = nfc_initiator_init(pnd)) < 0) {
+    result->res = res;
+    result->step = "nfc_initiator_init";
+    goto out;
+  }
+
+  const nfc_modulation nm = { .nmt = NMT_ISO14443A, .nbr = NBR_106 };
+  const uint8_t abtRead[2] = { 0x30, 0x00 };
+  for (result->rounds = 0; result->rounds < ROUND_COUNT; result->rounds++) {
+    if ((res = nfc_initiator_select_passive_target(pnd, nm, NULL, 0, &nt)) != 1) {
+      result->res = res;
+      result->step = "nfc_initiator_select_passive_target";
+      goto out;
+    }
+    if (nt.nti.nai.szUidLen != 7) {
+      result->res = nt.nti.nai.szUidLen;
+      result->step = "UID size";
+      goto out;
+    }
+    if ((res = nfc_initiator_transceive_bytes(pnd, abtRead, sizeof(abtRead), abtRx, sizeof(abtRx), -1)) != 16) {
+      result->res = res;
+      result->step = "nfc_initiator_transceive_bytes";
+      goto out;
+    }
+    // The UID starts the first page
+    if (memcmp(nt.nti.nai.abtUid, abtRx, 3)) {
+      result->step = "UID read back";
+      goto out;
+    }
+  }
+  result->step = NULL;
+
+out:
+  nfc_close(pnd);
+  nfc_exit(context);
+  return NULL;
+}
+
+void
+test_threads_devices(void)
+{
+  pthread_t threads[THREAD_COUNT];
+  struct thread_result results[THREAD_COUNT];
+  int res;
+
+  // Make sure the simulator is there before starting the threads
+  nfc_context *context;
+  nfc_init(&context);
+  cut_assert_not_null(context, cut_message("nfc_init"));
+  nfc_device *pnd = nfc_open(context, connstring);
+  if (pnd)
+    nfc_close(pnd);
+  nfc_exit(context);
+  if (!pnd)
+    cut_omit("pn53x_sim driver not available");
+
+  for (size_t i = 0; i < THREAD_COUNT; i++) {
+    results[i].res = 0;
+    results[i].step = "not run";
+    results[i].rounds = 0;
+    if ((res = pthread_create(&threads[i], NULL, device_thread, &results[i])))
+      cut_fail("pthread_create() returned %d", res);
+  }
+  for (size_t i = 0; i < THREAD_COUNT; i++) {
+    if ((res = pthread_join(threads[i], NULL)))
+      cut_fail("pthread_join() returned %d", res);
+  }
+  for (size_t i = 0; i < THREAD_COUNT; i++) {
+    cut_assert_null(results[i].step, cut_message("thread %d failed at %s (%d) after %d rounds", (int) i, results[i].step, results[i].res, (int) results[i].rounds));
+    cut_assert_equal_uint(ROUND_COUNT, results[i].rounds);
+  }
+}
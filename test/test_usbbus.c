@@ -0,0 +1,108 @@
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cutter.h>
+#include <string.h>
+
+#include "buses/usbbus.h"
+
+/*
+ * usb_busses_lock() only enumerates again after a USB uevent, and scans only
+ * skip opening the devices this process holds. libusb is stubbed: this module is
+ * built with its own copy of usbbus.c, which resolves to the functions below.
+ */
+void test_usbbus_enumeration_cache(void);
+void test_usbbus_claims(void);
+
+static int enumerations;
+static struct usb_bus bus;
+static struct usb_device dev;
+
+void
+usb_init(void)
+{
+}
+
+int
+usb_find_busses(void)
+{
+  return 0;
+}
+
+int
+usb_find_devices(void)
+{
+  enumerations++;
+  return 0;
+}
+
+struct usb_bus *
+usb_get_busses(void)
+{
+  return &bus;
+}
+
+void
+cut_setup(void)
+{
+  memset(&bus, 0, sizeof(bus));
+  memset(&dev, 0, sizeof(dev));
+  strcpy(bus.dirname, "001");
+  strcpy(dev.filename, "004");
+  dev.bus = &bus;
+  dev.descriptor.idVendor = 0x04cc;
+  dev.descriptor.idProduct = 0x2533;
+  bus.devices = &dev;
+  enumerations = 0;
+}
+
+// A failed assertion must not leave the bus list locked
+static bool
+claimed(const struct usb_device *pdev)
+{
+  usb_busses_lock();
+  const bool res = usb_probe_claimed(pdev);
+  usb_busses_unlock();
+  return res;
+}
+
+static void
+claim(const struct usb_device *pdev)
+{
+  usb_busses_lock();
+  usb_probe_claim(pdev);
+  usb_busses_unlock();
+}
+
+void
+test_usbbus_enumeration_cache(void)
+{
+  for (int n = 0; n < 3; n++) {
+    const int res = usb_busses_lock();
+    usb_busses_unlock();
+    cut_assert_equal_int(0, res, cut_message("usb_busses_lock #%d", n));
+  }
+  if (enumerations == 3)
+    cut_omit("no uevent socket, USB devices are enumerated on each scan");
+  cut_assert_true(enumerations <= 1, cut_message("enumerated again without a uevent"));
+}
+
+void
+test_usbbus_claims(void)
+{
+  cut_assert_false(claimed(&dev), cut_message("not opened yet"));
+
+  claim(&dev);
+  cut_assert_true(claimed(&dev), cut_message("opened"));
+
+  // Another device number on the same bus is not ours
+  struct usb_device other = dev;
+  strcpy(other.filename, "005");
+  cut_assert_false(claimed(&other), cut_message("other device"));
+
+  // Once closed, another process may take it: scans must open it again
+  usb_probe_release(&dev);
+  cut_assert_false(claimed(&dev), cut_message("closed"));
+  usb_probe_release(&dev);
+}